@@ -59,6 +59,11 @@ esp_err_t heap_trace_resume(void)
     return heap_trace_start(HEAP_TRACE_ALL);
 }
 
+esp_err_t heap_trace_set_sampling(size_t interval)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
 size_t heap_trace_get_count(void)
 {
     return 0;
@@ -7,6 +7,8 @@
 # linker will ignore this structure as it has no other files depending on it.
 COMPONENT_ADD_LDFLAGS += -u esp_app_desc
 
+COMPONENT_PRIV_INCLUDEDIRS := private_include
+
 ifndef IS_BOOTLOADER_BUILD
     # If ``CONFIG_APP_PROJECT_VER_FROM_CONFIG`` option is set, the value of ``CONFIG_APP_PROJECT_VER`` will be used
     # Else, if ``PROJECT_VER`` variable set in project Makefile file, its value will be used.
@@ -0,0 +1,161 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#if CONFIG_IDF_TARGET_ESP32
+#include "esp32/rom/miniz.h"
+#elif CONFIG_IDF_TARGET_ESP32S2
+#include "esp32s2/rom/miniz.h"
+#elif CONFIG_IDF_TARGET_ESP32S3
+#include "esp32s3/rom/miniz.h"
+#elif CONFIG_IDF_TARGET_ESP32C3
+#include "esp32c3/rom/miniz.h"
+#elif CONFIG_IDF_TARGET_ESP32H2
+#include "esp32h2/rom/miniz.h"
+#endif
+#include "esp_ota_ops.h"
+#include "esp_ota_compressed.h"
+#include "esp_ota_decompress.h"
+
+struct esp_ota_decompress {
+    esp_ota_decompress_write_cb_t write_cb;
+    void *write_arg;
+    esp_ota_compressed_header_t header;
+    size_t header_len;              /* Bytes of the header received */
+    bool done;                      /* End of the compressed stream was reached */
+    uint32_t image_len;             /* Bytes of the image decompressed so far */
+    uint32_t image_crc;
+    tinfl_decompressor inflator;
+    size_t window_size;
+    size_t window_pos;              /* Position of the next decompressed byte in the window */
+    uint8_t *window;                /* Last decompressed bytes, referred to by the compressed data */
+};
+
+const static char *TAG = "esp_ota_decompress";
+
+esp_ota_decompress_t *esp_ota_decompress_new(esp_ota_decompress_write_cb_t write_cb, void *arg)
+{
+    esp_ota_decompress_t *decompress = calloc(1, sizeof(esp_ota_decompress_t));
+    if (decompress == NULL) {
+        return NULL;
+    }
+    decompress->write_cb = write_cb;
+    decompress->write_arg = arg;
+    tinfl_init(&decompress->inflator);
+    return decompress;
+}
+
+static esp_err_t decompress_check_header(esp_ota_decompress_t *decompress)
+{
+    const esp_ota_compressed_header_t *header = &decompress->header;
+    if (memcmp(header->magic, ESP_OTA_COMPRESSED_MAGIC, sizeof(header->magic)) != 0 ||
+            header->version != ESP_OTA_COMPRESSED_VERSION) {
+        ESP_LOGE(TAG, "OTA image is neither an app image nor a compressed image");
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    if (header->compression != ESP_OTA_COMPRESSION_DEFLATE ||
+            header->window_bits < ESP_OTA_COMPRESSED_MIN_WINDOW_BITS || header->window_bits > ESP_OTA_COMPRESSED_MAX_WINDOW_BITS) {
+        ESP_LOGE(TAG, "Unsupported compression %d, window bits %d", header->compression, header->window_bits);
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    /* The inflater wraps around in the window, it needs a power of two at least as large as the compressor's window */
+    decompress->window_size = 1 << header->window_bits;
+    decompress->window = malloc(decompress->window_size);
+    if (decompress->window == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGD(TAG, "Compressed image of %d bytes, %d byte window", header->image_size, decompress->window_size);
+    return ESP_OK;
+}
+
+static esp_err_t decompress_data(esp_ota_decompress_t *decompress, const uint8_t *data, size_t size)
+{
+    while (!decompress->done) {
+        size_t in_len = size;
+        size_t out_len = decompress->window_size - decompress->window_pos;
+        uint8_t *out = decompress->window + decompress->window_pos;
+        tinfl_status status = tinfl_decompress(&decompress->inflator, data, &in_len, decompress->window, out, &out_len,
+                                               TINFL_FLAG_HAS_MORE_INPUT);
+        data += in_len;
+        size -= in_len;
+        if (status < TINFL_STATUS_DONE) {
+            ESP_LOGE(TAG, "Compressed image is corrupted (%d)", status);
+            return ESP_ERR_OTA_VALIDATE_FAILED;
+        }
+        if (out_len > 0) {
+            if (out_len > decompress->header.image_size - decompress->image_len) {
+                ESP_LOGE(TAG, "Compressed image is larger than its header says");
+                return ESP_ERR_OTA_VALIDATE_FAILED;
+            }
+            esp_err_t err = decompress->write_cb(decompress->write_arg, out, out_len);
+            if (err != ESP_OK) {
+                return err;
+            }
+            decompress->image_crc = esp_rom_crc32_le(decompress->image_crc, out, out_len);
+            decompress->image_len += out_len;
+            decompress->window_pos = (decompress->window_pos + out_len) & (decompress->window_size - 1);
+        }
+        if (status == TINFL_STATUS_DONE) {
+            decompress->done = true;
+        } else if (status == TINFL_STATUS_NEEDS_MORE_INPUT) {
+            break;
+        }
+    }
+    if (size > 0) {
+        ESP_LOGE(TAG, "Data after the end of the compressed image");
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_decompress_write(esp_ota_decompress_t *decompress, const uint8_t *data, size_t size)
+{
+    if (decompress->header_len < sizeof(decompress->header)) {
+        const size_t len = MIN(sizeof(decompress->header) - decompress->header_len, size);
+        memcpy((uint8_t *)&decompress->header + decompress->header_len, data, len);
+        decompress->header_len += len;
+        data += len;
+        size -= len;
+        if (decompress->header_len < sizeof(decompress->header)) {
+            return ESP_OK;
+        }
+        esp_err_t err = decompress_check_header(decompress);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return decompress_data(decompress, data, size);
+}
+
+esp_err_t esp_ota_decompress_finish(esp_ota_decompress_t *decompress)
+{
+    if (!decompress->done || decompress->image_len != decompress->header.image_size) {
+        ESP_LOGE(TAG, "Compressed image is incomplete (%d of %d bytes)", decompress->image_len, decompress->header.image_size);
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    if (decompress->image_crc != decompress->header.image_crc) {
+        ESP_LOGE(TAG, "Decompressed image doesn't match its CRC");
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    return ESP_OK;
+}
+
+void esp_ota_decompress_free(esp_ota_decompress_t *decompress)
+{
+    if (decompress) {
+        free(decompress->window);
+        free(decompress);
+    }
+}
@@ -0,0 +1,333 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_ota_ops.h"
+#include "esp_ota_delta.h"
+
+/* Size of the window of the new image which is built in RAM before it is written */
+#define DELTA_BUF_SIZE SPI_FLASH_SEC_SIZE
+/* Longest varint, a 32 bit value */
+#define DELTA_VARINT_MAX_SHIFT 28
+
+typedef enum {
+    DELTA_STATE_HEADER,
+    DELTA_STATE_CMD,
+    DELTA_STATE_LENGTH,
+    DELTA_STATE_OFFSET,
+    DELTA_STATE_DATA,
+} delta_state_t;
+
+struct esp_ota_delta {
+    const esp_partition_t *source;
+    esp_ota_handle_t ota_handle;
+    esp_ota_delta_header_t header;
+    size_t header_len;              /* Bytes of the header received */
+    delta_state_t state;
+    uint8_t cmd;
+    uint32_t varint;                /* Value of the varint being decoded */
+    int varint_shift;
+    uint32_t length;                /* Bytes left to produce by the command */
+    uint32_t source_pos;            /* Source offset of the next byte used by COPY and ADD */
+    uint32_t target_pos;            /* Bytes of the new image produced so far */
+    uint32_t target_crc;            /* CRC-32 of the part of the new image written */
+    size_t buf_len;
+    uint8_t buf[DELTA_BUF_SIZE];    /* Part of the new image not written yet */
+};
+
+const static char *TAG = "esp_ota_delta";
+
+esp_err_t esp_ota_delta_begin(const esp_partition_t *source, const esp_partition_t *target, esp_ota_delta_handle_t *out_handle)
+{
+    if (target == NULL || out_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (source == NULL) {
+        source = esp_ota_get_running_partition();
+    }
+    if (source == NULL || source == target) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_ota_delta_handle_t handle = calloc(1, sizeof(struct esp_ota_delta));
+    if (handle == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t err = esp_ota_begin(target, OTA_WITH_SEQUENTIAL_WRITES, &handle->ota_handle);
+    if (err != ESP_OK) {
+        free(handle);
+        return err;
+    }
+    handle->source = source;
+    handle->state = DELTA_STATE_HEADER;
+    *out_handle = handle;
+    return ESP_OK;
+}
+
+static esp_err_t delta_check_header(esp_ota_delta_handle_t handle)
+{
+    const esp_ota_delta_header_t *header = &handle->header;
+
+    if (memcmp(header->magic, ESP_OTA_DELTA_MAGIC, sizeof(header->magic)) != 0 ||
+            header->version != ESP_OTA_DELTA_VERSION) {
+        ESP_LOGE(TAG, "Not a delta OTA patch or unsupported version");
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    if (header->source_size > handle->source->size) {
+        ESP_LOGE(TAG, "Source image is larger than the source partition");
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    /* Applying the patch to another image would only produce garbage, check before writing anything */
+    uint32_t crc = 0;
+    for (uint32_t offset = 0; offset < header->source_size; offset += DELTA_BUF_SIZE) {
+        const size_t len = MIN(DELTA_BUF_SIZE, header->source_size - offset);
+        esp_err_t err = esp_partition_read(handle->source, offset, handle->buf, len);
+        if (err != ESP_OK) {
+            return err;
+        }
+        crc = esp_rom_crc32_le(crc, handle->buf, len);
+    }
+    if (crc != header->source_crc) {
+        ESP_LOGE(TAG, "Patch was generated against a different image (CRC 0x%08x, expected 0x%08x)", crc, header->source_crc);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    ESP_LOGD(TAG, "Patch for a %d byte image produces a %d byte image", header->source_size, header->target_size);
+    return ESP_OK;
+}
+
+static esp_err_t delta_flush(esp_ota_delta_handle_t handle)
+{
+    if (handle->buf_len == 0) {
+        return ESP_OK;
+    }
+    esp_err_t err = esp_ota_write(handle->ota_handle, handle->buf, handle->buf_len);
+    if (err != ESP_OK) {
+        return err;
+    }
+    handle->target_crc = esp_rom_crc32_le(handle->target_crc, handle->buf, handle->buf_len);
+    handle->buf_len = 0;
+    return ESP_OK;
+}
+
+/* Makes room in the window for up to len bytes of the new image, returns the room */
+static esp_err_t delta_reserve(esp_ota_delta_handle_t handle, size_t len, size_t *out_len)
+{
+    if (handle->buf_len == DELTA_BUF_SIZE) {
+        esp_err_t err = delta_flush(handle);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    *out_len = MIN(len, DELTA_BUF_SIZE - handle->buf_len);
+    return ESP_OK;
+}
+
+static esp_err_t delta_copy(esp_ota_delta_handle_t handle)
+{
+    while (handle->length > 0) {
+        size_t len;
+        esp_err_t err = delta_reserve(handle, handle->length, &len);
+        if (err == ESP_OK) {
+            err = esp_partition_read(handle->source, handle->source_pos, handle->buf + handle->buf_len, len);
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+        handle->buf_len += len;
+        handle->source_pos += len;
+        handle->length -= len;
+    }
+    return ESP_OK;
+}
+
+/* Consumes patch data of an ADD or INSERT command, returns the number of bytes used */
+static esp_err_t delta_data(esp_ota_delta_handle_t handle, const uint8_t *data, size_t size, size_t *out_used)
+{
+    size_t len;
+    esp_err_t err = delta_reserve(handle, MIN(size, handle->length), &len);
+    if (err != ESP_OK) {
+        return err;
+    }
+    uint8_t *out = handle->buf + handle->buf_len;
+    if (handle->cmd == ESP_OTA_DELTA_CMD_ADD) {
+        err = esp_partition_read(handle->source, handle->source_pos, out, len);
+        if (err != ESP_OK) {
+            return err;
+        }
+        for (size_t i = 0; i < len; i++) {
+            out[i] += data[i];
+        }
+        handle->source_pos += len;
+    } else {
+        memcpy(out, data, len);
+    }
+    handle->buf_len += len;
+    handle->length -= len;
+    *out_used = len;
+    return ESP_OK;
+}
+
+/* Returns true once the last byte of the varint was decoded */
+static bool delta_varint(esp_ota_delta_handle_t handle, uint8_t byte, esp_err_t *err)
+{
+    if (handle->varint_shift > DELTA_VARINT_MAX_SHIFT) {
+        *err = ESP_ERR_OTA_VALIDATE_FAILED;
+        return false;
+    }
+    handle->varint |= (uint32_t)(byte & 0x7f) << handle->varint_shift;
+    handle->varint_shift += 7;
+    return (byte & 0x80) == 0;
+}
+
+static esp_err_t delta_command(esp_ota_delta_handle_t handle, uint8_t cmd)
+{
+    if (handle->target_pos == handle->header.target_size) {
+        ESP_LOGE(TAG, "Data after the end of the patch");
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    if (cmd != ESP_OTA_DELTA_CMD_COPY && cmd != ESP_OTA_DELTA_CMD_ADD && cmd != ESP_OTA_DELTA_CMD_INSERT) {
+        ESP_LOGE(TAG, "Invalid patch command 0x%02x", cmd);
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    handle->cmd = cmd;
+    return ESP_OK;
+}
+
+static esp_err_t delta_length(esp_ota_delta_handle_t handle, uint32_t length)
+{
+    if (length > handle->header.target_size - handle->target_pos) {
+        ESP_LOGE(TAG, "Patch produces more data than the size of the image");
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    handle->length = length;
+    handle->target_pos += length;
+    return ESP_OK;
+}
+
+static esp_err_t delta_source_offset(esp_ota_delta_handle_t handle, uint32_t zigzag)
+{
+    const int32_t delta = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+    const int64_t pos = (int64_t)handle->source_pos + delta;
+    if (pos < 0 || pos + handle->length > handle->header.source_size) {
+        ESP_LOGE(TAG, "Patch refers to data outside of the source image");
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    handle->source_pos = pos;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_delta_write(esp_ota_delta_handle_t handle, const void *data, size_t size)
+{
+    if (handle == NULL || data == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const uint8_t *p = (const uint8_t *)data;
+    const uint8_t *end = p + size;
+    esp_err_t err = ESP_OK;
+    while (p < end && err == ESP_OK) {
+        switch (handle->state) {
+        case DELTA_STATE_HEADER: {
+            const size_t len = MIN(sizeof(handle->header) - handle->header_len, end - p);
+            memcpy((uint8_t *)&handle->header + handle->header_len, p, len);
+            handle->header_len += len;
+            p += len;
+            if (handle->header_len == sizeof(handle->header)) {
+                err = delta_check_header(handle);
+                handle->state = DELTA_STATE_CMD;
+            }
+            break;
+        }
+        case DELTA_STATE_CMD:
+            err = delta_command(handle, *p++);
+            handle->varint = 0;
+            handle->varint_shift = 0;
+            handle->state = DELTA_STATE_LENGTH;
+            break;
+        case DELTA_STATE_LENGTH:
+            if (!delta_varint(handle, *p++, &err)) {
+                break;
+            }
+            err = delta_length(handle, handle->varint);
+            handle->varint = 0;
+            handle->varint_shift = 0;
+            handle->state = (handle->cmd == ESP_OTA_DELTA_CMD_INSERT) ? DELTA_STATE_DATA : DELTA_STATE_OFFSET;
+            break;
+        case DELTA_STATE_OFFSET:
+            if (!delta_varint(handle, *p++, &err)) {
+                break;
+            }
+            err = delta_source_offset(handle, handle->varint);
+            if (err == ESP_OK && handle->cmd == ESP_OTA_DELTA_CMD_COPY) {
+                err = delta_copy(handle);
+                handle->state = DELTA_STATE_CMD;
+            } else {
+                handle->state = DELTA_STATE_DATA;
+            }
+            break;
+        case DELTA_STATE_DATA: {
+            size_t used = 0;
+            err = delta_data(handle, p, end - p, &used);
+            p += used;
+            break;
+        }
+        }
+        if (handle->state == DELTA_STATE_DATA && handle->length == 0) {
+            handle->state = DELTA_STATE_CMD;
+        }
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to apply patch (%s)", esp_err_to_name(err));
+    }
+    return err;
+}
+
+esp_err_t esp_ota_delta_end(esp_ota_delta_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err = ESP_OK;
+    if (handle->state != DELTA_STATE_CMD || handle->target_pos != handle->header.target_size) {
+        ESP_LOGE(TAG, "Patch is incomplete");
+        err = ESP_ERR_INVALID_SIZE;
+    } else {
+        err = delta_flush(handle);
+    }
+    if (err == ESP_OK && handle->target_crc != handle->header.target_crc) {
+        ESP_LOGE(TAG, "New image doesn't match the patch (CRC 0x%08x, expected 0x%08x)", handle->target_crc, handle->header.target_crc);
+        err = ESP_ERR_INVALID_CRC;
+    }
+
+    if (err == ESP_OK) {
+        err = esp_ota_end(handle->ota_handle);
+    } else {
+        esp_ota_abort(handle->ota_handle);
+    }
+    free(handle);
+    return err;
+}
+
+esp_err_t esp_ota_delta_abort(esp_ota_delta_handle_t handle)
+{
+    if (handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_ota_abort(handle->ota_handle);
+    free(handle);
+    return ESP_OK;
+}
@@ -22,6 +22,8 @@
 #include "sdkconfig.h"
 
 #include "esp_ota_ops.h"
+#include "esp_ota_compressed.h"
+#include "esp_ota_decompress.h"
 #include "sys/queue.h"
 #include "esp_log.h"
 #include "esp_flash_partitions.h"
@@ -41,6 +43,7 @@ typedef struct ota_ops_entry_ {
     uint32_t wrote_size;
     uint8_t partial_bytes;
     WORD_ALIGNED_ATTR uint8_t partial_data[16];
+    esp_ota_decompress_t *decompress;   /* Set when the image written is a compressed image */
     LIST_ENTRY(ota_ops_entry_) entries;
 } ota_ops_entry_t;
 
@@ -110,12 +113,12 @@ static esp_ota_img_states_t set_new_state_otadata(void)
 #endif
 }
 
-esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp_ota_handle_t *out_handle)
+static esp_err_t ota_begin_at(const esp_partition_t *partition, size_t image_size, size_t image_offset, esp_ota_handle_t *out_handle)
 {
     ota_ops_entry_t *new_entry;
     esp_err_t ret = ESP_OK;
 
-    if ((partition == NULL) || (out_handle == NULL)) {
+    if ((partition == NULL) || (out_handle == NULL) || (image_offset % SPI_FLASH_SEC_SIZE) != 0) {
         return ESP_ERR_INVALID_ARG;
     }
 
@@ -143,13 +146,20 @@ esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp
     }
 #endif
 
+    if (image_offset > partition->size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
     if (image_size != OTA_WITH_SEQUENTIAL_WRITES) {
         // If input image size is 0 or OTA_SIZE_UNKNOWN, erase entire partition
+        // Data already written below image_offset is kept
         if ((image_size == 0) || (image_size == OTA_SIZE_UNKNOWN)) {
-            ret = esp_partition_erase_range(partition, 0, partition->size);
+            ret = esp_partition_erase_range(partition, image_offset, partition->size - image_offset);
         } else {
             const int aligned_erase_size = (image_size + SPI_FLASH_SEC_SIZE - 1) & ~(SPI_FLASH_SEC_SIZE - 1);
-            ret = esp_partition_erase_range(partition, 0, aligned_erase_size);
+            if ((size_t)aligned_erase_size > image_offset) {
+                ret = esp_partition_erase_range(partition, image_offset, aligned_erase_size - image_offset);
+            }
         }
         if (ret != ESP_OK) {
             return ret;
@@ -166,14 +176,89 @@ esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp
     new_entry->part = partition;
     new_entry->handle = ++s_ota_ops_last_handle;
     new_entry->need_erase = (image_size == OTA_WITH_SEQUENTIAL_WRITES);
+    new_entry->wrote_size = image_offset;
     *out_handle = new_entry->handle;
     return ESP_OK;
 }
 
+esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp_ota_handle_t *out_handle)
+{
+    return ota_begin_at(partition, image_size, 0, out_handle);
+}
+
+esp_err_t esp_ota_resume(const esp_partition_t *partition, size_t image_size, size_t image_offset, esp_ota_handle_t *out_handle)
+{
+    return ota_begin_at(partition, image_size, image_offset, out_handle);
+}
+
+static esp_err_t ota_write_image(void *arg, const uint8_t *data_bytes, size_t size)
+{
+    ota_ops_entry_t *it = (ota_ops_entry_t *)arg;
+    esp_err_t ret;
+
+    if (it->need_erase) {
+        // must erase the partition before writing to it
+        uint32_t first_sector = it->wrote_size / SPI_FLASH_SEC_SIZE;
+        uint32_t last_sector = (it->wrote_size + size) / SPI_FLASH_SEC_SIZE;
+
+        ret = ESP_OK;
+        if ((it->wrote_size % SPI_FLASH_SEC_SIZE) == 0) {
+            ret = esp_partition_erase_range(it->part, it->wrote_size, ((last_sector - first_sector) + 1) * SPI_FLASH_SEC_SIZE);
+        } else if (first_sector != last_sector) {
+            ret = esp_partition_erase_range(it->part, (first_sector + 1) * SPI_FLASH_SEC_SIZE, (last_sector - first_sector) * SPI_FLASH_SEC_SIZE);
+        }
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    if (it->wrote_size == 0 && it->partial_bytes == 0 && size > 0 && data_bytes[0] != ESP_IMAGE_HEADER_MAGIC) {
+        ESP_LOGE(TAG, "OTA image has invalid magic byte (expected 0xE9, saw 0x%02x)", data_bytes[0]);
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+
+    if (esp_flash_encryption_enabled()) {
+        /* Can only write 16 byte blocks to flash, so need to cache anything else */
+        size_t copy_len;
+
+        /* check if we have partially written data from earlier */
+        if (it->partial_bytes != 0) {
+            copy_len = MIN(16 - it->partial_bytes, size);
+            memcpy(it->partial_data + it->partial_bytes, data_bytes, copy_len);
+            it->partial_bytes += copy_len;
+            if (it->partial_bytes != 16) {
+                return ESP_OK; /* nothing to write yet, just filling buffer */
+            }
+            /* write 16 byte to partition */
+            ret = esp_partition_write(it->part, it->wrote_size, it->partial_data, 16);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            it->partial_bytes = 0;
+            memset(it->partial_data, 0xFF, 16);
+            it->wrote_size += 16;
+            data_bytes += copy_len;
+            size -= copy_len;
+        }
+
+        /* check if we need to save trailing data that we're about to write */
+        it->partial_bytes = size % 16;
+        if (it->partial_bytes != 0) {
+            size -= it->partial_bytes;
+            memcpy(it->partial_data, data_bytes + size, it->partial_bytes);
+        }
+    }
+
+    ret = esp_partition_write(it->part, it->wrote_size, data_bytes, size);
+    if(ret == ESP_OK){
+        it->wrote_size += size;
+    }
+    return ret;
+}
+
 esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
 {
     const uint8_t *data_bytes = (const uint8_t *)data;
-    esp_err_t ret;
     ota_ops_entry_t *it;
 
     if (data == NULL) {
@@ -184,64 +269,18 @@ esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
     // find ota handle in linked list
     for (it = LIST_FIRST(&s_ota_ops_entries_head); it != NULL; it = LIST_NEXT(it, entries)) {
         if (it->handle == handle) {
-            if (it->need_erase) {
-                // must erase the partition before writing to it
-                uint32_t first_sector = it->wrote_size / SPI_FLASH_SEC_SIZE;
-                uint32_t last_sector = (it->wrote_size + size) / SPI_FLASH_SEC_SIZE;
-
-                ret = ESP_OK;
-                if ((it->wrote_size % SPI_FLASH_SEC_SIZE) == 0) {
-                    ret = esp_partition_erase_range(it->part, it->wrote_size, ((last_sector - first_sector) + 1) * SPI_FLASH_SEC_SIZE);
-                } else if (first_sector != last_sector) {
-                    ret = esp_partition_erase_range(it->part, (first_sector + 1) * SPI_FLASH_SEC_SIZE, (last_sector - first_sector) * SPI_FLASH_SEC_SIZE);
-                }
-                if (ret != ESP_OK) {
-                    return ret;
+            if (it->wrote_size == 0 && it->partial_bytes == 0 && it->decompress == NULL &&
+                    size > 0 && data_bytes[0] == ESP_OTA_COMPRESSED_MAGIC[0]) {
+                // A compressed image is decompressed as it is written
+                it->decompress = esp_ota_decompress_new(ota_write_image, it);
+                if (it->decompress == NULL) {
+                    return ESP_ERR_NO_MEM;
                 }
             }
-
-            if (it->wrote_size == 0 && it->partial_bytes == 0 && size > 0 && data_bytes[0] != ESP_IMAGE_HEADER_MAGIC) {
-                ESP_LOGE(TAG, "OTA image has invalid magic byte (expected 0xE9, saw 0x%02x)", data_bytes[0]);
-                return ESP_ERR_OTA_VALIDATE_FAILED;
+            if (it->decompress) {
+                return esp_ota_decompress_write(it->decompress, data_bytes, size);
             }
-
-            if (esp_flash_encryption_enabled()) {
-                /* Can only write 16 byte blocks to flash, so need to cache anything else */
-                size_t copy_len;
-
-                /* check if we have partially written data from earlier */
-                if (it->partial_bytes != 0) {
-                    copy_len = MIN(16 - it->partial_bytes, size);
-                    memcpy(it->partial_data + it->partial_bytes, data_bytes, copy_len);
-                    it->partial_bytes += copy_len;
-                    if (it->partial_bytes != 16) {
-                        return ESP_OK; /* nothing to write yet, just filling buffer */
-                    }
-                    /* write 16 byte to partition */
-                    ret = esp_partition_write(it->part, it->wrote_size, it->partial_data, 16);
-                    if (ret != ESP_OK) {
-                        return ret;
-                    }
-                    it->partial_bytes = 0;
-                    memset(it->partial_data, 0xFF, 16);
-                    it->wrote_size += 16;
-                    data_bytes += copy_len;
-                    size -= copy_len;
-                }
-
-                /* check if we need to save trailing data that we're about to write */
-                it->partial_bytes = size % 16;
-                if (it->partial_bytes != 0) {
-                    size -= it->partial_bytes;
-                    memcpy(it->partial_data, data_bytes + size, it->partial_bytes);
-                }
-            }
-
-            ret = esp_partition_write(it->part, it->wrote_size, data_bytes, size);
-            if(ret == ESP_OK){
-                it->wrote_size += size;
-            }
-            return ret;
+            return ota_write_image(it, data_bytes, size);
         }
     }
 
@@ -267,6 +306,11 @@ esp_err_t esp_ota_write_with_offset(esp_ota_handle_t handle, const void *data, s
             // must erase the partition before writing to it
             assert(it->need_erase == 0 && "must erase the partition before writing to it");
 
+            if (it->decompress) {
+                ESP_LOGE(TAG, "Compressed image must be written in order with esp_ota_write");
+                return ESP_ERR_INVALID_STATE;
+            }
+
             /* esp_ota_write_with_offset is used to write data in non contiguous manner.
              * Hence, unaligned data(less than 16 bytes) cannot be cached if flash encryption is enabled.
              */
@@ -276,7 +320,8 @@ esp_err_t esp_ota_write_with_offset(esp_ota_handle_t handle, const void *data, s
             }
             ret = esp_partition_write(it->part, offset, data_bytes, size);
             if (ret == ESP_OK) {
-                it->wrote_size += size;
+                /* Several tasks may write ranges of the image at once */
+                __atomic_fetch_add(&it->wrote_size, size, __ATOMIC_RELAXED);
             }
             return ret;
         }
@@ -306,6 +351,7 @@ esp_err_t esp_ota_abort(esp_ota_handle_t handle)
         return ESP_ERR_NOT_FOUND;
     }
     LIST_REMOVE(it, entries);
+    esp_ota_decompress_free(it->decompress);
     free(it);
     return ESP_OK;
 }
@@ -322,11 +368,18 @@ esp_err_t esp_ota_end(esp_ota_handle_t handle)
     /* 'it' holds the ota_ops_entry_t for 'handle' */
 
     // esp_ota_end() is only valid if some data was written to this handle
-    if (it->wrote_size == 0) {
+    if (it->wrote_size == 0 && it->decompress == NULL) {
         ret = ESP_ERR_INVALID_ARG;
         goto cleanup;
     }
 
+    if (it->decompress) {
+        ret = esp_ota_decompress_finish(it->decompress);
+        if (ret != ESP_OK) {
+            goto cleanup;
+        }
+    }
+
     if (it->partial_bytes > 0) {
         /* Write out last 16 bytes, if necessary */
         ret = esp_partition_write(it->part, it->wrote_size, it->partial_data, 16);
@@ -351,6 +404,7 @@ esp_err_t esp_ota_end(esp_ota_handle_t handle)
 
  cleanup:
     LIST_REMOVE(it, entries);
+    esp_ota_decompress_free(it->decompress);
     free(it);
     return ret;
 }
@@ -0,0 +1,74 @@
+#!/usr/bin/env python
+#
+# gen_ota_compressed compresses an app image for OTA updates,
+# esp_ota_write() decompresses it as it is written
+#
+# SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+from __future__ import division, print_function
+
+import argparse
+import binascii
+import struct
+import sys
+import zlib
+
+__version__ = '1.0'
+
+COMPRESSED_MAGIC = b'EOTZ'
+COMPRESSED_VERSION = 1
+COMPRESSION_DEFLATE = 1
+COMPRESSED_HEADER = struct.Struct('<4sBBBxII16x')
+
+IMAGE_HEADER_MAGIC = 0xE9
+APP_DESC_MAGIC_WORD = 0xABCD5432
+# esp_app_desc_t follows esp_image_header_t and the first esp_image_segment_header_t
+APP_DESC_OFFSET = 24 + 8
+APP_DESC_SIZE = 256
+
+MIN_WINDOW_BITS = 9
+MAX_WINDOW_BITS = 15
+DEFAULT_WINDOW_BITS = 12
+
+
+def compress(image, window_bits=DEFAULT_WINDOW_BITS):  # type: (bytes, int) -> bytes
+    """ Returns the compressed image, the device needs a window of 2^window_bits bytes to decompress it """
+    if len(image) < APP_DESC_OFFSET + APP_DESC_SIZE or image[0] != IMAGE_HEADER_MAGIC:
+        raise ValueError('Input is not an app image')
+    app_desc = image[APP_DESC_OFFSET:APP_DESC_OFFSET + APP_DESC_SIZE]
+    if struct.unpack_from('<I', app_desc)[0] != APP_DESC_MAGIC_WORD:
+        raise ValueError('App image has no app description')
+    if not MIN_WINDOW_BITS <= window_bits <= MAX_WINDOW_BITS:
+        raise ValueError('Window bits must be between {} and {}'.format(MIN_WINDOW_BITS, MAX_WINDOW_BITS))
+
+    compressor = zlib.compressobj(9, zlib.DEFLATED, -window_bits, 9)
+    data = compressor.compress(image) + compressor.flush()
+    header = COMPRESSED_HEADER.pack(COMPRESSED_MAGIC, COMPRESSED_VERSION, COMPRESSION_DEFLATE, window_bits,
+                                    len(image), binascii.crc32(image) & 0xffffffff)
+    return header + app_desc + data
+
+
+def main():  # type: () -> None
+    parser = argparse.ArgumentParser(description='ESP32 compressed OTA image generator tool')
+    parser.add_argument('--quiet', '-q', help='Don\'t print the size of the compressed image', action='store_true')
+    parser.add_argument('--window-bits', '-w', help='Base two logarithm of the window size, the device allocates the window '
+                        'during the update (default: {}, a {} byte window)'.format(DEFAULT_WINDOW_BITS, 1 << DEFAULT_WINDOW_BITS),
+                        type=int, default=DEFAULT_WINDOW_BITS)
+    parser.add_argument('input', help='App image', type=argparse.FileType('rb'))
+    parser.add_argument('output', help='Compressed image', type=argparse.FileType('wb'))
+    args = parser.parse_args()
+
+    image = args.input.read()
+    compressed = compress(image, args.window_bits)
+    args.output.write(compressed)
+
+    if not args.quiet:
+        print('Compressed image is {} bytes, {:.1f}% of the {} byte image'.format(len(compressed), 100.0 * len(compressed) / len(image), len(image)))
+
+
+if __name__ == '__main__':
+    try:
+        main()
+    except ValueError as e:
+        print(e, file=sys.stderr)
+        sys.exit(2)
@@ -0,0 +1,229 @@
+#!/usr/bin/env python
+#
+# gen_ota_delta generates a patch which turns one app image into another,
+# to be applied on the device with the esp_ota_delta_* functions
+#
+# SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+from __future__ import division, print_function
+
+import argparse
+import binascii
+import struct
+import sys
+
+__version__ = '1.0'
+
+DELTA_MAGIC = b'EDLT'
+DELTA_VERSION = 1
+DELTA_HEADER = struct.Struct('<4sB3xIIII8x')
+
+CMD_COPY = 0x01
+CMD_ADD = 0x02
+CMD_INSERT = 0x03
+
+# Length of the source data indexed to find matches, and distance between indexed source positions
+BLOCK_SIZE = 16
+BLOCK_STEP = 4
+# Candidates kept for one block of source data, limits the time spent on repetitive data
+MAX_CANDIDATES = 8
+# Longest run of different bytes bridged with ADD while following a match, e.g. a relocated pointer
+MAX_ADD_GAP = 8
+# Equal bytes needed after such a run to keep following the match
+MIN_RESYNC = 8
+
+
+def _crc32(data):  # type: (bytes) -> int
+    return binascii.crc32(data) & 0xffffffff
+
+
+def _varint(value):  # type: (int) -> bytes
+    out = bytearray()
+    while True:
+        byte = value & 0x7f
+        value >>= 7
+        if value:
+            out.append(byte | 0x80)
+        else:
+            out.append(byte)
+            return bytes(out)
+
+
+def _zigzag(value):  # type: (int) -> int
+    return value << 1 if value >= 0 else ((-value) << 1) - 1
+
+
+def _match_len(a, a_pos, b, b_pos):  # type: (bytes, int, bytes, int) -> int
+    limit = min(len(a) - a_pos, len(b) - b_pos)
+    n = 0
+    while n + 64 <= limit and a[a_pos + n:a_pos + n + 64] == b[b_pos + n:b_pos + n + 64]:
+        n += 64
+    while n < limit and a[a_pos + n] == b[b_pos + n]:
+        n += 1
+    return n
+
+
+class _PatchWriter(object):
+    def __init__(self):  # type: () -> None
+        self.data = bytearray()
+        self.source_pos = 0  # end of the source data used by the previous COPY or ADD
+
+    def _source(self, pos, length):  # type: (int, int) -> None
+        self.data += _varint(_zigzag(pos - self.source_pos))
+        self.source_pos = pos + length
+
+    def copy(self, pos, length):  # type: (int, int) -> None
+        self.data += bytes([CMD_COPY]) + _varint(length)
+        self._source(pos, length)
+
+    def add(self, pos, diff):  # type: (int, bytes) -> None
+        self.data += bytes([CMD_ADD]) + _varint(len(diff))
+        self._source(pos, len(diff))
+        self.data += diff
+
+    def insert(self, data):  # type: (bytes) -> None
+        self.data += bytes([CMD_INSERT]) + _varint(len(data)) + data
+
+
+def generate(source, target):  # type: (bytes, bytes) -> bytes
+    """ Returns a patch producing target from source.
+
+    Matches are found through an index of the source, then followed as far as possible. Short runs
+    of different bytes inside a match, typical for code which moved and had its addresses
+    relocated, are encoded with ADD so that the match continues past them.
+    """
+    index = {}  # type: dict
+    for pos in range(0, len(source) - BLOCK_SIZE + 1, BLOCK_STEP):
+        candidates = index.setdefault(source[pos:pos + BLOCK_SIZE], [])
+        if len(candidates) < MAX_CANDIDATES:
+            candidates.append(pos)
+
+    patch = _PatchWriter()
+    literal_start = 0
+    target_pos = 0
+    while target_pos < len(target):
+        # The data following the previous match is the most likely candidate, e.g. after an insertion
+        candidates = [patch.source_pos + target_pos - literal_start]
+        candidates += index.get(target[target_pos:target_pos + BLOCK_SIZE], [])
+        best_len, best_pos = 0, 0
+        for pos in candidates:
+            if pos < len(source):
+                length = _match_len(target, target_pos, source, pos)
+                if length > best_len:
+                    best_len, best_pos = length, pos
+        if best_len < BLOCK_SIZE:
+            target_pos += 1
+            continue
+
+        # The match may start before the indexed block
+        while target_pos > literal_start and best_pos > 0 and target[target_pos - 1] == source[best_pos - 1]:
+            target_pos -= 1
+            best_pos -= 1
+            best_len += 1
+        if target_pos > literal_start:
+            patch.insert(target[literal_start:target_pos])
+
+        source_pos = best_pos
+        length = best_len
+        while True:
+            patch.copy(source_pos, length)
+            target_pos += length
+            source_pos += length
+            gap = _find_resync(source, source_pos, target, target_pos)
+            if gap == 0:
+                break
+            diff = bytes((target[target_pos + i] - source[source_pos + i]) & 0xff for i in range(gap))
+            patch.add(source_pos, diff)
+            target_pos += gap
+            source_pos += gap
+            length = _match_len(target, target_pos, source, source_pos)
+        literal_start = target_pos
+
+    if literal_start < len(target):
+        patch.insert(target[literal_start:])
+
+    header = DELTA_HEADER.pack(DELTA_MAGIC, DELTA_VERSION, len(source), _crc32(source), len(target), _crc32(target))
+    return header + bytes(patch.data)
+
+
+def _find_resync(source, source_pos, target, target_pos):  # type: (bytes, int, bytes, int) -> int
+    """ Returns the length of the run of different bytes after which source and target are equal again, or 0 """
+    for gap in range(1, MAX_ADD_GAP + 1):
+        s = source[source_pos + gap:source_pos + gap + MIN_RESYNC]
+        if len(s) < MIN_RESYNC:
+            break
+        if s == target[target_pos + gap:target_pos + gap + MIN_RESYNC]:
+            return gap
+    return 0
+
+
+def _read_varint(patch, pos):  # type: (bytes, int) -> tuple
+    value = 0
+    shift = 0
+    while True:
+        byte = patch[pos]
+        pos += 1
+        value |= (byte & 0x7f) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def apply(source, patch):  # type: (bytes, bytes) -> bytes
+    """ Applies a patch as esp_ota_delta_write() does, raises ValueError if the patch doesn't match the source """
+    magic, version, source_size, source_crc, target_size, target_crc = DELTA_HEADER.unpack_from(patch)
+    if magic != DELTA_MAGIC or version != DELTA_VERSION:
+        raise ValueError('Not a delta OTA patch')
+    if source_size > len(source) or _crc32(source[:source_size]) != source_crc:
+        raise ValueError('Patch was generated against a different image')
+
+    target = bytearray()
+    source_pos = 0
+    pos = DELTA_HEADER.size
+    while len(target) < target_size:
+        cmd = patch[pos]
+        length, pos = _read_varint(patch, pos + 1)
+        if cmd in (CMD_COPY, CMD_ADD):
+            zigzag, pos = _read_varint(patch, pos)
+            source_pos += (zigzag >> 1) ^ -(zigzag & 1)
+            data = source[source_pos:source_pos + length]
+            if cmd == CMD_ADD:
+                data = bytes((a + b) & 0xff for a, b in zip(data, patch[pos:pos + length]))
+                pos += length
+            source_pos += length
+        elif cmd == CMD_INSERT:
+            data = patch[pos:pos + length]
+            pos += length
+        else:
+            raise ValueError('Invalid patch command 0x%02x' % cmd)
+        target += data
+    if pos != len(patch) or len(target) != target_size or _crc32(bytes(target)) != target_crc:
+        raise ValueError('Patch is corrupted')
+    return bytes(target)
+
+
+def main():  # type: () -> None
+    parser = argparse.ArgumentParser(description='ESP32 delta OTA patch generator tool')
+    parser.add_argument('--quiet', '-q', help='Don\'t print the size of the patch', action='store_true')
+    parser.add_argument('source', help='App image running on the device', type=argparse.FileType('rb'))
+    parser.add_argument('target', help='New app image', type=argparse.FileType('rb'))
+    parser.add_argument('output', help='Patch file', type=argparse.FileType('wb'))
+    args = parser.parse_args()
+
+    source = args.source.read()
+    target = args.target.read()
+    patch = generate(source, target)
+    if apply(source, patch) != target:
+        raise RuntimeError('Generated patch doesn\'t reproduce the new image')
+    args.output.write(patch)
+
+    if not args.quiet:
+        print('Patch is {} bytes, {:.1f}% of the {} byte image'.format(len(patch), 100.0 * len(patch) / max(len(target), 1), len(target)))
+
+
+if __name__ == '__main__':
+    try:
+        main()
+    except (ValueError, RuntimeError) as e:
+        print(e, file=sys.stderr)
+        sys.exit(2)
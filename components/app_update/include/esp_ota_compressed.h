@@ -0,0 +1,48 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_app_format.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define ESP_OTA_COMPRESSED_MAGIC    "EOTZ"      /*!< First bytes of an image compressed by gen_ota_compressed.py */
+#define ESP_OTA_COMPRESSED_VERSION  1           /*!< Version of the compressed image format */
+
+#define ESP_OTA_COMPRESSION_DEFLATE 1           /*!< Raw deflate stream (RFC 1951), decompressed by the inflater in ROM */
+
+#define ESP_OTA_COMPRESSED_MIN_WINDOW_BITS  9   /*!< Smallest window supported, 512 bytes */
+#define ESP_OTA_COMPRESSED_MAX_WINDOW_BITS  15  /*!< Largest window supported, 32 KB */
+
+/**
+ * @brief Header of a compressed app image
+ *
+ * esp_ota_write() accepts a compressed image in place of an app image. The header is followed by
+ * the compressed app image, which is decompressed as it is written. The memory used is the window
+ * plus about 11 KB of decompressor state.
+ */
+typedef struct {
+    char magic[4];              /*!< ESP_OTA_COMPRESSED_MAGIC */
+    uint8_t version;            /*!< ESP_OTA_COMPRESSED_VERSION */
+    uint8_t compression;        /*!< ESP_OTA_COMPRESSION_DEFLATE */
+    uint8_t window_bits;        /*!< Base two logarithm of the window size the image was compressed with */
+    uint8_t reserved;
+    uint32_t image_size;        /*!< Size of the decompressed image */
+    uint32_t image_crc;         /*!< CRC-32 of the decompressed image */
+    uint8_t reserved2[16];
+    esp_app_desc_t app_desc;    /*!< Copy of the app description of the image, readable before the image is decompressed */
+} __attribute__((packed)) esp_ota_compressed_header_t;
+
+_Static_assert(sizeof(esp_ota_compressed_header_t) == 288, "esp_ota_compressed_header_t should be 288 bytes");
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,131 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_partition.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define ESP_OTA_DELTA_MAGIC     "EDLT"      /*!< First bytes of a patch generated by gen_ota_delta.py */
+#define ESP_OTA_DELTA_VERSION   1           /*!< Version of the patch format */
+
+/**
+ * @brief Header of a patch
+ *
+ * The header is followed by commands which produce the new image in order.
+ * Each command is a command byte followed by varint arguments:
+ *  - ESP_OTA_DELTA_CMD_COPY, length, source offset delta:
+ *    copy `length` bytes of the source image
+ *  - ESP_OTA_DELTA_CMD_ADD, length, source offset delta, `length` bytes:
+ *    add the bytes to `length` bytes of the source image (bsdiff style)
+ *  - ESP_OTA_DELTA_CMD_INSERT, length, `length` bytes: copy the bytes
+ *
+ * Lengths are unsigned LEB128 varints. The source offset delta is a zigzag encoded
+ * signed varint, relative to the end of the source data used by the previous command.
+ */
+typedef struct {
+    char magic[4];          /*!< ESP_OTA_DELTA_MAGIC */
+    uint8_t version;        /*!< ESP_OTA_DELTA_VERSION */
+    uint8_t reserved[3];
+    uint32_t source_size;   /*!< Size of the source image the patch applies to */
+    uint32_t source_crc;    /*!< CRC-32 of the source image */
+    uint32_t target_size;   /*!< Size of the image produced by the patch */
+    uint32_t target_crc;    /*!< CRC-32 of the image produced by the patch */
+    uint8_t reserved2[8];
+} __attribute__((packed)) esp_ota_delta_header_t;
+
+_Static_assert(sizeof(esp_ota_delta_header_t) == 32, "esp_ota_delta_header_t should be 32 bytes");
+
+#define ESP_OTA_DELTA_CMD_COPY      0x01    /*!< Copy data of the source image */
+#define ESP_OTA_DELTA_CMD_ADD       0x02    /*!< Add the patch data to data of the source image */
+#define ESP_OTA_DELTA_CMD_INSERT    0x03    /*!< Copy the patch data */
+
+/**
+ * Opaque handle for a delta OTA update
+ */
+typedef struct esp_ota_delta *esp_ota_delta_handle_t;
+
+/**
+ * @brief   Commence a delta OTA update.
+ *
+ * A delta update applies a patch generated by `components/app_update/gen_ota_delta.py` to the image
+ * in the source partition, usually the running app, and writes the resulting image to the target
+ * partition with esp_ota_write(). Only a patch produced against the exact image in the source
+ * partition can be applied, the patch only contains the differences between the images.
+ *
+ * The patch is streamed with esp_ota_delta_write() in pieces of any size, and the memory used
+ * doesn't depend on the size of the image.
+ *
+ * @param source Partition holding the image the patch was generated against, NULL for the running partition.
+ * @param target Partition which receives the new image, as for esp_ota_begin().
+ * @param out_handle On success, returns a handle which should be used for subsequent esp_ota_delta_write()
+ *                   and esp_ota_delta_end() calls.
+ *
+ * @return
+ *    - ESP_OK: Delta OTA update commenced successfully.
+ *    - ESP_ERR_INVALID_ARG: target or out_handle arguments were NULL.
+ *    - ESP_ERR_NO_MEM: Cannot allocate memory for the update.
+ *    - For other return codes, refer to esp_ota_begin().
+ */
+esp_err_t esp_ota_delta_begin(const esp_partition_t *source, const esp_partition_t *target, esp_ota_delta_handle_t *out_handle);
+
+/**
+ * @brief   Apply the next part of the patch
+ *
+ * The first call checks that the patch was generated against the image in the source partition,
+ * before anything is written to the target partition.
+ *
+ * @param handle  Handle obtained from esp_ota_delta_begin
+ * @param data    Patch data
+ * @param size    Size of the patch data in bytes
+ *
+ * @return
+ *    - ESP_OK: Patch data was applied.
+ *    - ESP_ERR_INVALID_ARG: handle or data is invalid.
+ *    - ESP_ERR_INVALID_VERSION: The patch was generated against a different source image.
+ *    - ESP_ERR_OTA_VALIDATE_FAILED: The patch is malformed or refers to data outside of the source image.
+ *    - For other return codes, refer to esp_ota_write().
+ */
+esp_err_t esp_ota_delta_write(esp_ota_delta_handle_t handle, const void *data, size_t size);
+
+/**
+ * @brief   Finish a delta OTA update and validate the new image
+ *
+ * Checks that the whole patch was applied and the CRC of the new image, then validates the image
+ * with esp_ota_end(). The handle is no longer valid after the call, regardless of the result.
+ *
+ * @param handle  Handle obtained from esp_ota_delta_begin
+ *
+ * @return
+ *    - ESP_OK: The new image is valid, it can be selected with esp_ota_set_boot_partition().
+ *    - ESP_ERR_INVALID_ARG: handle is invalid.
+ *    - ESP_ERR_INVALID_SIZE: The patch is incomplete.
+ *    - ESP_ERR_INVALID_CRC: The new image doesn't match the image the patch was generated for.
+ *    - For other return codes, refer to esp_ota_end().
+ */
+esp_err_t esp_ota_delta_end(esp_ota_delta_handle_t handle);
+
+/**
+ * @brief   Abort a delta OTA update and free the handle
+ *
+ * @param handle  Handle obtained from esp_ota_delta_begin
+ *
+ * @return
+ *    - ESP_OK: Handle and its associated memory is freed successfully.
+ *    - ESP_ERR_INVALID_ARG: handle is invalid.
+ */
+esp_err_t esp_ota_delta_abort(esp_ota_delta_handle_t handle);
+
+#ifdef __cplusplus
+}
+#endif
@@ -91,6 +91,28 @@ int esp_ota_get_app_elf_sha256(char* dst, size_t size);
  */
 esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t image_size, esp_ota_handle_t* out_handle);
 
+/**
+ * @brief   Continue an OTA update which was interrupted, e.g. by a reset or a lost connection.
+ *
+ * Works like esp_ota_begin() but keeps the first `image_offset` bytes of the image which were
+ * written to the partition earlier, only the rest of the partition is erased. The next
+ * esp_ota_write() call writes the data at `image_offset`. esp_ota_end() validates the whole image,
+ * so an image assembled from data of a different image is rejected.
+ *
+ * @param partition Pointer to info for partition which receives the OTA update. Required.
+ * @param image_size Size of new OTA app image, as for esp_ota_begin().
+ * @param image_offset Number of bytes of the image already written to the partition,
+ *                     must be a multiple of the flash sector size (SPI_FLASH_SEC_SIZE).
+ * @param out_handle On success, returns a handle which should be used for subsequent esp_ota_write() and esp_ota_end() calls.
+ *
+ * @return
+ *    - ESP_OK: OTA operation resumed successfully.
+ *    - ESP_ERR_INVALID_ARG: partition or out_handle arguments were NULL, partition doesn't point to an OTA app partition
+ *      or image_offset isn't sector aligned or is beyond the end of the partition.
+ *    - For other return codes, refer to esp_ota_begin().
+ */
+esp_err_t esp_ota_resume(const esp_partition_t *partition, size_t image_size, size_t image_offset, esp_ota_handle_t *out_handle);
+
 /**
  * @brief   Write OTA update data to partition
  *
@@ -98,6 +120,9 @@ esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t image_size, esp
  * data is received during the OTA operation. Data is written
  * sequentially to the partition.
  *
+ * The data can also be an image compressed by gen_ota_compressed.py (see esp_ota_compressed.h),
+ * it is then decompressed as it is written.
+ *
  * @param handle  Handle obtained from esp_ota_begin
  * @param data    Data buffer to write
  * @param size    Size of data buffer in bytes.
@@ -105,7 +130,8 @@ esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t image_size, esp
  * @return
  *    - ESP_OK: Data was written to flash successfully.
  *    - ESP_ERR_INVALID_ARG: handle is invalid.
- *    - ESP_ERR_OTA_VALIDATE_FAILED: First byte of image contains invalid app image magic byte.
+ *    - ESP_ERR_OTA_VALIDATE_FAILED: First byte of image contains invalid app image magic byte,
+ *      or the compressed image is invalid.
  *    - ESP_ERR_FLASH_OP_TIMEOUT or ESP_ERR_FLASH_OP_FAIL: Flash write failed.
  *    - ESP_ERR_OTA_SELECT_INFO_INVALID: OTA data partition has invalid contents
  */
@@ -124,10 +150,12 @@ esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size);
  *
  * @note While performing OTA, if the packets arrive out of order, esp_ota_write_with_offset() can be used to write data in non contiguous manner.
  *       Use of esp_ota_write_with_offset() in combination with esp_ota_write() is not recommended.
+ * @note Several tasks may write different ranges of the same update at once with esp_ota_write_with_offset().
  *
  * @return
  *    - ESP_OK: Data was written to flash successfully.
  *    - ESP_ERR_INVALID_ARG: handle is invalid.
+ *    - ESP_ERR_INVALID_STATE: A compressed image is being written with esp_ota_write().
  *    - ESP_ERR_OTA_VALIDATE_FAILED: First byte of image contains invalid app image magic byte.
  *    - ESP_ERR_FLASH_OP_TIMEOUT or ESP_ERR_FLASH_OP_FAIL: Flash write failed.
  *    - ESP_ERR_OTA_SELECT_INFO_INVALID: OTA data partition has invalid contents
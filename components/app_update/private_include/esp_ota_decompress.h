@@ -0,0 +1,46 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Receives the decompressed image in order */
+typedef esp_err_t (*esp_ota_decompress_write_cb_t)(void *arg, const uint8_t *data, size_t size);
+
+typedef struct esp_ota_decompress esp_ota_decompress_t;
+
+/**
+ * Allocates the state for decompressing an image, the memory for the window is allocated
+ * once the header of the compressed image is received.
+ */
+esp_ota_decompress_t *esp_ota_decompress_new(esp_ota_decompress_write_cb_t write_cb, void *arg);
+
+/**
+ * Decompresses the next part of a compressed image, starting with esp_ota_compressed_header_t.
+ * Returns ESP_ERR_OTA_VALIDATE_FAILED if the data is not a valid compressed image,
+ * or the error returned by the callback.
+ */
+esp_err_t esp_ota_decompress_write(esp_ota_decompress_t *decompress, const uint8_t *data, size_t size);
+
+/**
+ * Returns ESP_OK if the whole image was decompressed and its CRC matches the header,
+ * ESP_ERR_OTA_VALIDATE_FAILED otherwise.
+ */
+esp_err_t esp_ota_decompress_finish(esp_ota_decompress_t *decompress);
+
+void esp_ota_decompress_free(esp_ota_decompress_t *decompress);
+
+#ifdef __cplusplus
+}
+#endif
@@ -45,6 +45,28 @@ TEST_CASE("esp_ota_begin() verifies arguments", "[ota]")
     TEST_ASSERT_EQUAL(0, handle);
 }
 
+TEST_CASE("esp_ota_resume() verifies arguments", "[ota]")
+{
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    const esp_partition_t *update = esp_ota_get_next_update_partition(NULL);
+    esp_ota_handle_t handle = 0;
+
+    TEST_ASSERT_NOT_NULL(running);
+    TEST_ASSERT_NOT_EQUAL(ESP_OK, esp_ota_resume(running, OTA_WITH_SEQUENTIAL_WRITES, SPI_FLASH_SEC_SIZE, &handle));
+    TEST_ASSERT_EQUAL(0, handle);
+
+    if (update == NULL || update == running) {
+        return;
+    }
+    /* offset must be sector aligned and inside the partition */
+    TEST_ASSERT_EQUAL_HEX(ESP_ERR_INVALID_ARG, esp_ota_resume(update, OTA_WITH_SEQUENTIAL_WRITES, 1, &handle));
+    TEST_ASSERT_EQUAL_HEX(ESP_ERR_INVALID_ARG, esp_ota_resume(update, OTA_WITH_SEQUENTIAL_WRITES, update->size + SPI_FLASH_SEC_SIZE, &handle));
+    TEST_ASSERT_EQUAL(0, handle);
+
+    TEST_ESP_OK(esp_ota_resume(update, OTA_WITH_SEQUENTIAL_WRITES, SPI_FLASH_SEC_SIZE, &handle));
+    TEST_ESP_OK(esp_ota_abort(handle));
+}
+
 TEST_CASE("esp_ota_get_next_update_partition logic", "[ota]")
 {
     const esp_partition_t *running = esp_ota_get_running_partition();
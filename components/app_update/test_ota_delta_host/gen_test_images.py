@@ -0,0 +1,75 @@
+#!/usr/bin/env python
+#
+# Generates pairs of synthetic app images and the delta OTA patches between them
+#
+# SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+from __future__ import division, print_function
+
+import os
+import random
+import struct
+import sys
+
+sys.path.append('..')
+import gen_ota_delta  # noqa: E402
+
+IMAGE_BASE = 0x400d0000
+
+
+class Firmware(object):
+    """ Image made of functions which call each other through absolute addresses, as in a linked app """
+
+    def __init__(self, seed, count):  # type: (int, int) -> None
+        rnd = random.Random(seed)
+        self.functions = []  # type: list
+        for _ in range(count):
+            body = bytearray(rnd.getrandbits(8) for _ in range(rnd.randrange(16, 400)))
+            # Offsets in the body which hold the address of another function
+            calls = [(rnd.randrange(0, len(body) - 4) & ~3, rnd.randrange(count)) for _ in range(len(body) // 64)]
+            self.functions.append((body, calls))
+
+    def link(self):  # type: () -> bytes
+        addresses = []
+        address = IMAGE_BASE
+        for body, _ in self.functions:
+            addresses.append(address)
+            address += (len(body) + 3) & ~3
+        image = bytearray()
+        for body, calls in self.functions:
+            code = bytearray(body)
+            for offset, callee in calls:
+                struct.pack_into('<I', code, offset, addresses[callee % len(addresses)])
+            image += code + b'\0' * (-len(code) % 4)
+        return bytes(image)
+
+
+def main():  # type: () -> None
+    out_dir = sys.argv[1]
+    if not os.path.isdir(out_dir):
+        os.makedirs(out_dir)
+
+    source = Firmware(1, 3000)
+    pairs = [('identical', source.link(), source.link())]
+
+    fixed = Firmware(1, 3000)
+    fixed.functions[1500][0][10:13] = b'\x01\x02\x03'
+    pairs.append(('small_fix', source.link(), fixed.link()))
+
+    # Code inserted in the middle of the image moves the functions after it and their callers change
+    inserted = Firmware(1, 3000)
+    inserted.functions.insert(1000, Firmware(2, 1).functions[0])
+    pairs.append(('insertion', source.link(), inserted.link()))
+
+    pairs.append(('unrelated', source.link(), Firmware(3, 3000).link()))
+
+    for name, old, new in pairs:
+        patch = gen_ota_delta.generate(old, new)
+        assert gen_ota_delta.apply(old, patch) == new
+        for suffix, data in (('source', old), ('target', new), ('patch', patch)):
+            with open(os.path.join(out_dir, '{}.{}'.format(name, suffix)), 'wb') as f:
+                f.write(data)
+
+
+if __name__ == '__main__':
+    main()
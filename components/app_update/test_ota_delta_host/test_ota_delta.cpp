@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+#include <string>
+
+#include "esp_partition.h"
+#include "esp_ota_ops.h"
+#include "esp_ota_delta.h"
+
+#include "catch.hpp"
+
+extern "C" void _spi_flash_init(const char* chip_size, size_t block_size, size_t sector_size, size_t page_size, const char* partition_bin);
+
+static std::vector<uint8_t> read_file(const std::string &path)
+{
+    FILE *f = fopen(path.c_str(), "rb");
+    REQUIRE(f != NULL);
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), f)) > 0) {
+        data.insert(data.end(), buf, buf + len);
+    }
+    fclose(f);
+    return data;
+}
+
+static void init_flash(const esp_partition_t **source, const esp_partition_t **target)
+{
+    _spi_flash_init(CONFIG_ESPTOOLPY_FLASHSIZE, SPI_FLASH_SEC_SIZE * 16, SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE, "partition_table.bin");
+    *source = esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_FACTORY, NULL);
+    *target = esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_0, NULL);
+    REQUIRE(*source != NULL);
+    REQUIRE(*target != NULL);
+}
+
+static void write_image(const esp_partition_t *partition, const std::vector<uint8_t> &image)
+{
+    REQUIRE(esp_partition_erase_range(partition, 0, partition->size) == ESP_OK);
+    REQUIRE(esp_partition_write(partition, 0, image.data(), image.size()) == ESP_OK);
+}
+
+/* Applies the patch in pieces of random size, returns the result of esp_ota_delta_write() or esp_ota_delta_end() */
+static esp_err_t apply_patch(const esp_partition_t *target, const std::vector<uint8_t> &patch)
+{
+    esp_ota_delta_handle_t handle;
+    REQUIRE(esp_ota_delta_begin(NULL, target, &handle) == ESP_OK);
+    size_t pos = 0;
+    while (pos < patch.size()) {
+        size_t len = std::min<size_t>(1 + rand() % 3000, patch.size() - pos);
+        esp_err_t err = esp_ota_delta_write(handle, patch.data() + pos, len);
+        if (err != ESP_OK) {
+            esp_ota_delta_abort(handle);
+            return err;
+        }
+        pos += len;
+    }
+    return esp_ota_delta_end(handle);
+}
+
+TEST_CASE("delta patches reproduce the new image", "[ota_delta]")
+{
+    const esp_partition_t *source, *target;
+    init_flash(&source, &target);
+    srand(0);
+
+    const char *names[] = { "identical", "small_fix", "insertion", "unrelated" };
+    for (const char *name : names) {
+        std::string base = std::string("images/") + name;
+        std::vector<uint8_t> old_image = read_file(base + ".source");
+        std::vector<uint8_t> new_image = read_file(base + ".target");
+        std::vector<uint8_t> patch = read_file(base + ".patch");
+
+        write_image(source, old_image);
+        CHECK(apply_patch(target, patch) == ESP_OK);
+
+        std::vector<uint8_t> result(new_image.size());
+        REQUIRE(esp_partition_read(target, 0, result.data(), result.size()) == ESP_OK);
+        CHECK(result == new_image);
+        printf("%-10s: patch is %6zu bytes, %5.1f%% of the %zu byte image\n",
+               name, patch.size(), 100.0 * patch.size() / new_image.size(), new_image.size());
+    }
+}
+
+TEST_CASE("delta patch for another image is rejected before writing", "[ota_delta]")
+{
+    const esp_partition_t *source, *target;
+    init_flash(&source, &target);
+
+    std::vector<uint8_t> other_image = read_file("images/unrelated.target");
+    std::vector<uint8_t> patch = read_file("images/small_fix.patch");
+    write_image(source, other_image);
+    REQUIRE(esp_partition_erase_range(target, 0, target->size) == ESP_OK);
+
+    esp_ota_delta_handle_t handle;
+    REQUIRE(esp_ota_delta_begin(NULL, target, &handle) == ESP_OK);
+    CHECK(esp_ota_delta_write(handle, patch.data(), patch.size()) == ESP_ERR_INVALID_VERSION);
+    CHECK(esp_ota_delta_abort(handle) == ESP_OK);
+
+    uint32_t word;
+    REQUIRE(esp_partition_read(target, 0, &word, sizeof(word)) == ESP_OK);
+    CHECK(word == 0xffffffff);
+}
+
+TEST_CASE("incomplete or corrupted delta patch is rejected", "[ota_delta]")
+{
+    const esp_partition_t *source, *target;
+    init_flash(&source, &target);
+
+    write_image(source, read_file("images/unrelated.source"));
+    std::vector<uint8_t> patch = read_file("images/unrelated.patch");
+
+    std::vector<uint8_t> truncated(patch.begin(), patch.end() - 100);
+    CHECK(apply_patch(target, truncated) == ESP_ERR_INVALID_SIZE);
+
+    std::vector<uint8_t> extra(patch);
+    extra.push_back(ESP_OTA_DELTA_CMD_INSERT);
+    CHECK(apply_patch(target, extra) == ESP_ERR_OTA_VALIDATE_FAILED);
+
+    // The last bytes of this patch are data of an INSERT command
+    std::vector<uint8_t> corrupted(patch);
+    corrupted[corrupted.size() - 1] ^= 0x55;
+    CHECK(apply_patch(target, corrupted) == ESP_ERR_INVALID_CRC);
+
+    std::vector<uint8_t> bad_command(patch);
+    bad_command[sizeof(esp_ota_delta_header_t)] = 0x7f;
+    CHECK(apply_patch(target, bad_command) == ESP_ERR_OTA_VALIDATE_FAILED);
+}
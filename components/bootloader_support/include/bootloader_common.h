@@ -216,7 +216,7 @@ esp_err_t bootloader_common_check_chip_validity(const esp_image_header_t* img_hd
  */
 void bootloader_common_vddsdio_configure(void);
 
-#if defined( CONFIG_BOOTLOADER_SKIP_VALIDATE_IN_DEEP_SLEEP ) || defined( CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC )
+#if defined( CONFIG_BOOTLOADER_SKIP_VALIDATE_IN_DEEP_SLEEP ) || defined( CONFIG_BOOTLOADER_SKIP_VALIDATE_UNCHANGED ) || defined( CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC )
 /**
  * @brief Returns partition from rtc_retain_mem
  *
@@ -276,6 +276,29 @@ uint16_t bootloader_common_get_rtc_retain_mem_reboot_counter(void);
  */
 rtc_retain_mem_t* bootloader_common_get_rtc_retain_mem(void);
 
+#ifdef CONFIG_BOOTLOADER_SKIP_VALIDATE_UNCHANGED
+/**
+ * @brief Returns the record of the app validated before the reset from rtc_retain_mem
+ *
+ * Note: This function operates the RTC FAST memory which available only for PRO_CPU.
+ *       Make sure that this function is used only PRO_CPU.
+ *
+ * @return record: If rtc_retain_mem is valid and holds a record.
+ *        - NULL: If it is not valid.
+ */
+esp_image_verified_record_t* bootloader_common_get_rtc_retain_mem_verified_image(void);
+
+/**
+ * @brief Update the record of the validated app in rtc_retain_mem
+ *
+ * Note: This function operates the RTC FAST memory which available only for PRO_CPU.
+ *       Make sure that this function is used only PRO_CPU.
+ *
+ * @param[in] record Record of the validated app. Can be NULL, in this case the record is cleared.
+ */
+void bootloader_common_update_rtc_retain_mem_verified_image(const esp_image_verified_record_t* record);
+#endif // CONFIG_BOOTLOADER_SKIP_VALIDATE_UNCHANGED
+
 #endif
 
 #ifdef __cplusplus
@@ -43,10 +43,20 @@ typedef enum {
 #endif
 } esp_image_load_mode_t;
 
+/* Identifies an app image which was validated, without the need to read the image data again */
+typedef struct {
+    uint32_t offset;                        /*!< Offset of the image in flash */
+    uint32_t header_crc;                    /*!< CRC-32 of the image header */
+    uint8_t digest[ESP_IMAGE_HASH_LEN];     /*!< SHA-256 digest appended to the image */
+} esp_image_verified_record_t;
+
 typedef struct {
     esp_partition_pos_t partition;  /*!< Partition of application which worked before goes to the deep sleep. */
     uint16_t reboot_counter;        /*!< Reboot counter. Reset only when power is off. */
     uint16_t reserve;               /*!< Reserve */
+#ifdef CONFIG_BOOTLOADER_SKIP_VALIDATE_UNCHANGED
+    esp_image_verified_record_t verified_image; /*!< App validated by the bootloader before the last reset */
+#endif
 #ifdef CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC
     uint8_t custom[CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC_SIZE]; /*!< Reserve for custom propose */
 #endif
@@ -57,17 +67,17 @@ typedef struct {
 _Static_assert(CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC_SIZE % 4 == 0, "CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC_SIZE must be a multiple of 4 bytes");
 #endif
 
-#if defined(CONFIG_BOOTLOADER_SKIP_VALIDATE_IN_DEEP_SLEEP) || defined(CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC)
+#if defined(CONFIG_BOOTLOADER_SKIP_VALIDATE_IN_DEEP_SLEEP) || defined(CONFIG_BOOTLOADER_SKIP_VALIDATE_UNCHANGED) || defined(CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC)
 _Static_assert(CONFIG_BOOTLOADER_RESERVE_RTC_SIZE % 4 == 0, "CONFIG_BOOTLOADER_RESERVE_RTC_SIZE must be a multiple of 4 bytes");
 #endif
 
 #ifdef CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC
 #define ESP_BOOTLOADER_RESERVE_RTC (CONFIG_BOOTLOADER_RESERVE_RTC_SIZE + CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC_SIZE)
-#elif defined(CONFIG_BOOTLOADER_SKIP_VALIDATE_IN_DEEP_SLEEP)
+#elif defined(CONFIG_BOOTLOADER_SKIP_VALIDATE_IN_DEEP_SLEEP) || defined(CONFIG_BOOTLOADER_SKIP_VALIDATE_UNCHANGED)
 #define ESP_BOOTLOADER_RESERVE_RTC (CONFIG_BOOTLOADER_RESERVE_RTC_SIZE)
 #endif
 
-#if defined(CONFIG_BOOTLOADER_SKIP_VALIDATE_IN_DEEP_SLEEP) || defined(CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC)
+#if defined(CONFIG_BOOTLOADER_SKIP_VALIDATE_IN_DEEP_SLEEP) || defined(CONFIG_BOOTLOADER_SKIP_VALIDATE_UNCHANGED) || defined(CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC)
 _Static_assert(sizeof(rtc_retain_mem_t) <= ESP_BOOTLOADER_RESERVE_RTC, "Reserved RTC area must exceed size of rtc_retain_mem_t");
 #endif
 
@@ -112,6 +122,37 @@ esp_err_t esp_image_verify(esp_image_load_mode_t mode, const esp_partition_pos_t
  */
 esp_err_t esp_image_get_metadata(const esp_partition_pos_t *part, esp_image_metadata_t *metadata);
 
+/**
+ * @brief Get the record identifying a validated app image
+ *
+ * The record holds the offset, a CRC of the image header and the SHA-256 digest appended to the image,
+ * a different image in the same partition, e.g. written by an OTA update, has a different record.
+ *
+ * @param data Metadata of the image, filled in by esp_image_verify() or bootloader_load_image().
+ * @param[out] record Record identifying the image.
+ *
+ * @return
+ * - ESP_OK if the record was filled in
+ * - ESP_ERR_NOT_SUPPORTED if the image has no appended SHA-256 digest to identify it
+ */
+esp_err_t esp_image_get_verified_record(const esp_image_metadata_t *data, esp_image_verified_record_t *record);
+
+/**
+ * @brief Check if the image in a partition is the one identified by a record
+ *
+ * Only the image header, the segment headers and the appended SHA-256 digest are read from flash,
+ * the image data is neither read nor validated.
+ *
+ * @param part Partition holding the image.
+ * @param record Record obtained from esp_image_get_verified_record().
+ *
+ * @return
+ * - ESP_OK if the image matches the record
+ * - ESP_ERR_NOT_FOUND if the partition holds a different image
+ * - ESP_ERR_INVALID_ARG if the partition or record pointers are invalid.
+ */
+esp_err_t esp_image_check_verified_record(const esp_partition_pos_t *part, const esp_image_verified_record_t *record);
+
 /**
  * @brief Verify and load an app image (available only in space of bootloader).
  *
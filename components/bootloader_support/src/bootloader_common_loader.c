@@ -135,7 +135,7 @@ esp_err_t bootloader_common_get_partition_description(const esp_partition_pos_t
     return ESP_OK;
 }
 
-#if defined( CONFIG_BOOTLOADER_SKIP_VALIDATE_IN_DEEP_SLEEP ) || defined( CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC )
+#if defined( CONFIG_BOOTLOADER_SKIP_VALIDATE_IN_DEEP_SLEEP ) || defined( CONFIG_BOOTLOADER_SKIP_VALIDATE_UNCHANGED ) || defined( CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC )
 
 #define RTC_RETAIN_MEM_ADDR (SOC_RTC_DRAM_HIGH - sizeof(rtc_retain_mem_t))
 
@@ -207,4 +207,28 @@ rtc_retain_mem_t* bootloader_common_get_rtc_retain_mem(void)
 {
     return rtc_retain_mem;
 }
-#endif // defined( CONFIG_BOOTLOADER_SKIP_VALIDATE_IN_DEEP_SLEEP ) || defined( CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC )
+
+#ifdef CONFIG_BOOTLOADER_SKIP_VALIDATE_UNCHANGED
+esp_image_verified_record_t* bootloader_common_get_rtc_retain_mem_verified_image(void)
+{
+    // offset is 0 after bootloader_common_reset_rtc_retain_mem(), no app is at this offset
+    if (check_rtc_retain_mem() && rtc_retain_mem->verified_image.offset != 0) {
+        return &rtc_retain_mem->verified_image;
+    }
+    return NULL;
+}
+
+void bootloader_common_update_rtc_retain_mem_verified_image(const esp_image_verified_record_t* record)
+{
+    if (!check_rtc_retain_mem()) {
+        bootloader_common_reset_rtc_retain_mem();
+    }
+    if (record != NULL) {
+        rtc_retain_mem->verified_image = *record;
+    } else {
+        memset(&rtc_retain_mem->verified_image, 0, sizeof(rtc_retain_mem->verified_image));
+    }
+    update_rtc_retain_mem_crc();
+}
+#endif // CONFIG_BOOTLOADER_SKIP_VALIDATE_UNCHANGED
+#endif // defined( CONFIG_BOOTLOADER_SKIP_VALIDATE_IN_DEEP_SLEEP ) || defined( CONFIG_BOOTLOADER_SKIP_VALIDATE_UNCHANGED ) || defined( CONFIG_BOOTLOADER_CUSTOM_RESERVE_RTC )
@@ -18,6 +18,7 @@
 #include "bootloader_util.h"
 #include "bootloader_common.h"
 #include "esp_rom_sys.h"
+#include "esp_rom_crc.h"
 #include "soc/soc_memory_types.h"
 #if CONFIG_IDF_TARGET_ESP32
 #include "esp32/rom/secure_boot.h"
@@ -238,6 +239,29 @@ err:
     return err;
 }
 
+#if defined(BOOTLOADER_BUILD) && CONFIG_BOOTLOADER_SKIP_VALIDATE_UNCHANGED
+/* Return true if the image in the partition was validated before a software reset or deep sleep, and is unchanged */
+static bool image_validated_before_reset(const esp_partition_pos_t *part)
+{
+    soc_reset_reason_t reason = esp_rom_get_reset_reason(0);
+    if (reason != RESET_REASON_CORE_SW && reason != RESET_REASON_CPU0_SW && reason != RESET_REASON_CORE_DEEP_SLEEP) {
+        return false;
+    }
+    const esp_image_verified_record_t *record = bootloader_common_get_rtc_retain_mem_verified_image();
+    return record != NULL && esp_image_check_verified_record(part, record) == ESP_OK;
+}
+
+/* Keep the record of a validated image for the next reset */
+static void remember_validated_image(const esp_image_metadata_t *data)
+{
+    esp_image_verified_record_t record;
+    // The SHA-256 digest isn't checked when a debugger is attached
+    if (!esp_cpu_in_ocd_debug_mode() && esp_image_get_verified_record(data, &record) == ESP_OK) {
+        bootloader_common_update_rtc_retain_mem_verified_image(&record);
+    }
+}
+#endif
+
 esp_err_t bootloader_load_image(const esp_partition_pos_t *part, esp_image_metadata_t *data)
 {
 #if !defined(BOOTLOADER_BUILD)
@@ -254,9 +278,21 @@ esp_err_t bootloader_load_image(const esp_partition_pos_t *part, esp_image_metad
         mode = ESP_IMAGE_LOAD_NO_VALIDATE;
     }
 #endif // CONFIG_BOOTLOADER_SKIP_...
+#if CONFIG_BOOTLOADER_SKIP_VALIDATE_UNCHANGED
+    if (mode == ESP_IMAGE_LOAD && part != NULL && image_validated_before_reset(part)) {
+        ESP_LOGI(TAG, "App at offset 0x%x is unchanged since it was validated, skipping validation", part->offset);
+        mode = ESP_IMAGE_LOAD_NO_VALIDATE;
+    }
+#endif
 #endif // CONFIG_SECURE_BOOT
 
- return image_load(mode, part, data);
+    esp_err_t err = image_load(mode, part, data);
+#if CONFIG_BOOTLOADER_SKIP_VALIDATE_UNCHANGED
+    if (err == ESP_OK && mode == ESP_IMAGE_LOAD) {
+        remember_validated_image(data);
+    }
+#endif
+    return err;
 #endif // BOOTLOADER_BUILD
 }
 
@@ -294,6 +330,36 @@ err:
     return err;
 }
 
+esp_err_t esp_image_get_verified_record(const esp_image_metadata_t *data, esp_image_verified_record_t *record)
+{
+    if (data == NULL || record == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!data->image.hash_appended) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    record->offset = data->start_addr;
+    record->header_crc = esp_rom_crc32_le(0, (const uint8_t *)&data->image, sizeof(esp_image_header_t));
+    memcpy(record->digest, data->image_digest, HASH_LEN);
+    return ESP_OK;
+}
+
+esp_err_t esp_image_check_verified_record(const esp_partition_pos_t *part, const esp_image_verified_record_t *record)
+{
+    esp_image_metadata_t metadata;
+    esp_image_verified_record_t current;
+    if (part == NULL || record == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (part->offset != record->offset
+            || esp_image_get_metadata(part, &metadata) != ESP_OK
+            || esp_image_get_verified_record(&metadata, &current) != ESP_OK
+            || memcmp(&current, record, sizeof(current)) != 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
 static esp_err_t verify_image_header(uint32_t src_addr, const esp_image_header_t *image, bool silent)
 {
     esp_err_t err = ESP_OK;
@@ -800,11 +866,9 @@ static esp_err_t verify_secure_boot_signature(bootloader_sha256_handle_t sha_han
     ESP_LOGI(TAG, "Verifying image signature...");
 
     // For secure boot, we calculate the signature hash over the whole file, which includes any "simple" hash
-    // appended to the image for corruption detection
+    // appended to the image for corruption detection (already read from flash by process_appended_hash())
     if (data->image.hash_appended) {
-        const void *simple_hash = bootloader_mmap(end - HASH_LEN, HASH_LEN);
-        bootloader_sha256_data(sha_handle, simple_hash, HASH_LEN);
-        bootloader_munmap(simple_hash);
+        bootloader_sha256_data(sha_handle, data->image_digest, HASH_LEN);
     }
 
 #if CONFIG_SECURE_SIGNED_APPS_RSA_SCHEME
@@ -0,0 +1,63 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Functions used by esp_image_format.c, for running it on the host with the flash simulator.
+ * Flash accesses go to the simulator and are counted, to compare the amount of data read.
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_spi_flash.h"
+#include "esp_image_format.h"
+#include "esp_rom_sys.h"
+#include "bootloader_flash_priv.h"
+#include "bootloader_common.h"
+
+size_t bootloader_stubs_bytes_read;
+
+uint32_t bootloader_mmap_get_free_pages(void)
+{
+    return 50;
+}
+
+const void *bootloader_mmap(uint32_t src_addr, uint32_t size)
+{
+    const void *result;
+    spi_flash_mmap_handle_t handle;
+    if (spi_flash_mmap(src_addr, size, SPI_FLASH_MMAP_DATA, &result, &handle) != ESP_OK) {
+        return NULL;
+    }
+    bootloader_stubs_bytes_read += size;
+    return result;
+}
+
+void bootloader_munmap(const void *mapping)
+{
+}
+
+esp_err_t bootloader_flash_read(size_t src, void *dest, size_t size, bool allow_decrypt)
+{
+    bootloader_stubs_bytes_read += size;
+    return spi_flash_read(src, dest, size);
+}
+
+esp_err_t bootloader_common_check_chip_validity(const esp_image_header_t* img_hdr, esp_image_type type)
+{
+    return img_hdr->chip_id == ESP_CHIP_ID_ESP32 ? ESP_OK : ESP_FAIL;
+}
+
+void bootloader_debug_buffer(const void *buffer, size_t length, const char *label)
+{
+}
+
+bool esp_cpu_in_ocd_debug_mode(void)
+{
+    return false;
+}
+
+soc_reset_reason_t esp_rom_get_reset_reason(int cpu_no)
+{
+    return RESET_REASON_CORE_SW;
+}
@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <vector>
+
+#include "esp_partition.h"
+#include "esp_image_format.h"
+extern "C" {
+#include "bootloader_sha.h"
+}
+
+#include "catch.hpp"
+
+extern "C" void _spi_flash_init(const char* chip_size, size_t block_size, size_t sector_size, size_t page_size, const char* partition_bin);
+extern "C" size_t bootloader_stubs_bytes_read;
+
+static const esp_partition_t *init_flash(void)
+{
+    _spi_flash_init(CONFIG_ESPTOOLPY_FLASHSIZE, SPI_FLASH_SEC_SIZE * 16, SPI_FLASH_SEC_SIZE, SPI_FLASH_SEC_SIZE, "partition_table.bin");
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_FACTORY, NULL);
+    REQUIRE(partition != NULL);
+    return partition;
+}
+
+/* Builds an app image of about the given size, laid out as esptool.py does: header, segments, checksum, SHA-256 */
+static std::vector<uint8_t> make_image(size_t size, unsigned seed, bool hash_appended = true)
+{
+    const int segment_count = 8;
+    const uint32_t segment_len = (size / segment_count) & ~3;
+
+    esp_image_header_t header = {};
+    header.magic = ESP_IMAGE_HEADER_MAGIC;
+    header.segment_count = segment_count;
+    header.spi_mode = ESP_IMAGE_SPI_MODE_DIO;
+    header.spi_speed = ESP_IMAGE_SPI_SPEED_40M;
+    header.spi_size = ESP_IMAGE_FLASH_SIZE_4MB;
+    header.entry_addr = 0x40080000;
+    header.wp_pin = 0xEE;
+    header.chip_id = ESP_CHIP_ID_ESP32;
+    header.hash_appended = hash_appended;
+
+    std::vector<uint8_t> image((uint8_t *)&header, (uint8_t *)&header + sizeof(header));
+    uint32_t checksum = 0xEF;
+    srand(seed);
+    for (int i = 0; i < segment_count; i++) {
+        esp_image_segment_header_t segment = { 0x3FFB0000, segment_len };
+        image.insert(image.end(), (uint8_t *)&segment, (uint8_t *)&segment + sizeof(segment));
+        for (uint32_t j = 0; j < segment_len / 4; j++) {
+            uint32_t word = rand();
+            checksum ^= word;
+            image.insert(image.end(), (uint8_t *)&word, (uint8_t *)&word + sizeof(word));
+        }
+    }
+    size_t padded_len = (image.size() + 1 + 15) & ~15;
+    image.resize(padded_len, 0);
+    image.back() = (checksum >> 24) ^ (checksum >> 16) ^ (checksum >> 8) ^ checksum;
+
+    if (hash_appended) {
+        uint8_t digest[ESP_IMAGE_HASH_LEN];
+        bootloader_sha256_handle_t sha = bootloader_sha256_start();
+        bootloader_sha256_data(sha, image.data(), image.size());
+        bootloader_sha256_finish(sha, digest);
+        image.insert(image.end(), digest, digest + sizeof(digest));
+    }
+    return image;
+}
+
+static void write_image(const esp_partition_t *partition, const std::vector<uint8_t> &image)
+{
+    REQUIRE(esp_partition_erase_range(partition, 0, partition->size) == ESP_OK);
+    REQUIRE(esp_partition_write(partition, 0, image.data(), image.size()) == ESP_OK);
+}
+
+static esp_partition_pos_t partition_pos(const esp_partition_t *partition)
+{
+    esp_partition_pos_t pos = { partition->address, partition->size };
+    return pos;
+}
+
+static double elapsed_ms(const struct timespec &start)
+{
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+TEST_CASE("unchanged image matches the record of its validation", "[verified_image]")
+{
+    const esp_partition_t *partition = init_flash();
+    const esp_partition_pos_t pos = partition_pos(partition);
+    write_image(partition, make_image(256 * 1024, 1));
+
+    esp_image_metadata_t data;
+    REQUIRE(esp_image_verify(ESP_IMAGE_VERIFY, &pos, &data) == ESP_OK);
+    esp_image_verified_record_t record;
+    REQUIRE(esp_image_get_verified_record(&data, &record) == ESP_OK);
+    CHECK(record.offset == partition->address);
+    CHECK(memcmp(record.digest, data.image_digest, sizeof(record.digest)) == 0);
+    CHECK(esp_image_check_verified_record(&pos, &record) == ESP_OK);
+}
+
+TEST_CASE("changed image doesn't match the record of its validation", "[verified_image]")
+{
+    const esp_partition_t *partition = init_flash();
+    const esp_partition_pos_t pos = partition_pos(partition);
+    std::vector<uint8_t> image = make_image(256 * 1024, 1);
+    write_image(partition, image);
+
+    esp_image_metadata_t data;
+    esp_image_verified_record_t record;
+    REQUIRE(esp_image_verify(ESP_IMAGE_VERIFY, &pos, &data) == ESP_OK);
+    REQUIRE(esp_image_get_verified_record(&data, &record) == ESP_OK);
+
+    // Another image of the same size, as written by an OTA update
+    write_image(partition, make_image(256 * 1024, 2));
+    CHECK(esp_image_check_verified_record(&pos, &record) == ESP_ERR_NOT_FOUND);
+
+    // Same image data with a different header
+    std::vector<uint8_t> other_header(image);
+    ((esp_image_header_t *)other_header.data())->spi_speed = ESP_IMAGE_SPI_SPEED_80M;
+    write_image(partition, other_header);
+    CHECK(esp_image_check_verified_record(&pos, &record) == ESP_ERR_NOT_FOUND);
+
+    // Same image in another partition
+    write_image(partition, image);
+    CHECK(esp_image_check_verified_record(&pos, &record) == ESP_OK);
+    esp_partition_pos_t other_pos = pos;
+    other_pos.offset += 0x10000;
+    CHECK(esp_image_check_verified_record(&other_pos, &record) == ESP_ERR_NOT_FOUND);
+
+    // Erased partition
+    REQUIRE(esp_partition_erase_range(partition, 0, partition->size) == ESP_OK);
+    CHECK(esp_image_check_verified_record(&pos, &record) == ESP_ERR_NOT_FOUND);
+}
+
+TEST_CASE("image without appended digest has no record", "[verified_image]")
+{
+    const esp_partition_t *partition = init_flash();
+    const esp_partition_pos_t pos = partition_pos(partition);
+    write_image(partition, make_image(64 * 1024, 1, false));
+
+    esp_image_metadata_t data;
+    esp_image_verified_record_t record;
+    REQUIRE(esp_image_verify(ESP_IMAGE_VERIFY, &pos, &data) == ESP_OK);
+    CHECK(esp_image_get_verified_record(&data, &record) == ESP_ERR_NOT_SUPPORTED);
+}
+
+TEST_CASE("checking the record reads a fraction of the image", "[verified_image]")
+{
+    const esp_partition_t *partition = init_flash();
+    const esp_partition_pos_t pos = partition_pos(partition);
+
+    printf("%10s | %14s %10s | %14s %10s\n", "image size", "validate: read", "time", "record: read", "time");
+    const size_t sizes[] = { 256 * 1024, 1024 * 1024, 2 * 1024 * 1024 };
+    for (size_t size : sizes) {
+        write_image(partition, make_image(size, size));
+        esp_image_metadata_t data;
+        esp_image_verified_record_t record;
+        struct timespec start;
+
+        bootloader_stubs_bytes_read = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        REQUIRE(esp_image_verify(ESP_IMAGE_VERIFY_SILENT, &pos, &data) == ESP_OK);
+        double validate_ms = elapsed_ms(start);
+        size_t validate_read = bootloader_stubs_bytes_read;
+        REQUIRE(esp_image_get_verified_record(&data, &record) == ESP_OK);
+
+        bootloader_stubs_bytes_read = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        REQUIRE(esp_image_check_verified_record(&pos, &record) == ESP_OK);
+        double record_ms = elapsed_ms(start);
+        size_t record_read = bootloader_stubs_bytes_read;
+
+        printf("%10zu | %14zu %7.2f ms | %14zu %7.3f ms\n", size, validate_read, validate_ms, record_read, record_ms);
+        CHECK(validate_read >= size);
+        // Only the headers and the digest, independent of the image size
+        CHECK(record_read < 256);
+    }
+}
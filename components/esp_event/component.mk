@@ -7,12 +7,14 @@ COMPONENT_SRCDIRS := .
 COMPONENT_ADD_LDFRAGMENTS := linker.lf
 
 ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
-	PROFILING_ENABLED := 1
+	ATOMICS_USED := 1
+else ifneq ($(CONFIG_ESP_EVENT_POST_DATA_POOL_SIZE), 0)
+	ATOMICS_USED := 1
 else
-	PROFILING_ENABLED := 0
+	ATOMICS_USED := 0
 endif
 
-ifeq ($(PROFILING_ENABLED), 1)
+ifeq ($(ATOMICS_USED), 1)
 # uses C11 atomic feature
 esp_event.o: CFLAGS += -std=gnu11
 endif
@@ -32,8 +32,8 @@
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
 // LOOP @<address, name> rx:<recieved events no.> dr:<dropped events no.>
 #define LOOP_DUMP_FORMAT              "LOOP @%p,%s rx:%u dr:%u\n"
- // handler @<address> ev:<base, id> inv:<times invoked> time:<runtime>
-#define HANDLER_DUMP_FORMAT           "  HANDLER @%p ev:%s,%s inv:%u time:%lld us\n"
+ // handler @<address> ev:<base, id> inv:<times invoked> time:<runtime> max:<longest runtime>
+#define HANDLER_DUMP_FORMAT           "  HANDLER @%p ev:%s,%s inv:%u time:%lld us max:%lld us\n"
 
 #define PRINT_DUMP_INFO(dst, sz, ...)  do { \
                                             int cb = snprintf(dst, sz, __VA_ARGS__); \
@@ -42,6 +42,15 @@
                                         } while(0);
 #endif
 
+#if CONFIG_ESP_EVENT_POST_DATA_POOL_SIZE > 0
+#define POST_DATA_POOL_SIZE             CONFIG_ESP_EVENT_POST_DATA_POOL_SIZE
+#define POST_DATA_BLOCK_SIZE            ((CONFIG_ESP_EVENT_POST_DATA_POOL_BLOCK_SIZE + 3) & ~3)
+#define POST_DATA_POOL_ALL_FREE         ((uint32_t) ((1ULL << POST_DATA_POOL_SIZE) - 1))
+#else
+#define POST_DATA_POOL_SIZE             0
+#define POST_DATA_BLOCK_SIZE            0
+#endif
+
 /* ------------------------- Static Variables ------------------------------- */
 
 static const char* TAG = "event";
@@ -98,7 +107,7 @@ static int esp_event_dump_prepare(void)
     // Reserve slightly more memory than computed
     int allowance = 3;
     int size = (((loops + allowance) * (sizeof(LOOP_DUMP_FORMAT) + 10 + 20 + 2 * 11)) +
-                        ((handlers + allowance) * (sizeof(HANDLER_DUMP_FORMAT) + 10 + 2 * 20 + 11 + 20)));
+                        ((handlers + allowance) * (sizeof(HANDLER_DUMP_FORMAT) + 10 + 2 * 20 + 11 + 2 * 20)));
 
     return size;
 }
@@ -122,9 +131,18 @@ static void esp_event_loop_run_task(void* args)
     vTaskSuspend(NULL);
 }
 
-static void handler_execute(esp_event_loop_instance_t* loop, esp_event_handler_node_t *handler, esp_event_post_instance_t post)
+// Returns false if the handler was unregistered after the dispatch of the event started, it isn't executed then
+static bool handler_execute(esp_event_loop_instance_t* loop, esp_event_handler_node_t *handler, esp_event_post_instance_t post)
 {
-    ESP_LOGD(TAG, "running post %s:%d with handler %p and context %p on loop %p", post.base, post.id, handler->handler_ctx->handler, &handler->handler_ctx, loop);
+    esp_event_handler_instance_context_t* handler_ctx = handler->handler_ctx;
+    // The tasks of a loop with several tasks read the handler without the loop mutex, see handler_instance_delete()
+    esp_event_handler_t event_handler = __atomic_load_n(&(handler_ctx->handler), __ATOMIC_ACQUIRE);
+
+    if (event_handler == NULL) {
+        return false;
+    }
+
+    ESP_LOGD(TAG, "running post %s:%d with handler %p and context %p on loop %p", post.base, post.id, event_handler, handler_ctx, loop);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     int64_t start, diff;
@@ -142,9 +160,9 @@ static void handler_execute(esp_event_loop_instance_t* loop, esp_event_handler_n
         }
     }
 
-    (*(handler->handler_ctx->handler))(handler->handler_ctx->arg, post.base, post.id, data_ptr);
+    (*event_handler)(handler_ctx->arg, post.base, post.id, data_ptr);
 #else
-    (*(handler->handler_ctx->handler))(handler->handler_ctx->arg, post.base, post.id, post.data);
+    (*event_handler)(handler_ctx->arg, post.base, post.id, post.data);
 #endif
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
@@ -154,9 +172,13 @@ static void handler_execute(esp_event_loop_instance_t* loop, esp_event_handler_n
 
     handler->invoked++;
     handler->time += diff;
+    if (diff > handler->max_time) {
+        handler->max_time = diff;
+    }
 
     xSemaphoreGive(loop->profiling_mutex);
 #endif
+    return true;
 }
 
 static esp_err_t handler_instances_add(esp_event_handler_nodes_t* handlers, esp_event_handler_t event_handler, void* event_handler_arg, esp_event_handler_instance_context_t **handler_ctx, bool legacy)
@@ -319,7 +341,28 @@ static esp_err_t loop_node_add_handler(esp_event_loop_node_t* loop_node,
     }
 }
 
-static esp_err_t handler_instances_remove(esp_event_handler_nodes_t* handlers, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
+static void handler_instance_delete(esp_event_loop_instance_t* loop, esp_event_handler_node_t* handler)
+{
+    esp_event_dispatch_table_t* table = loop->dispatch_table;
+
+    loop->dispatch_table_stale = true;
+
+    if ((table != NULL && table->dispatching > 0) || loop->list_dispatching > 0 || !STAILQ_EMPTY(&(loop->retired_tables))) {
+        // Tasks executing the handlers of an event may still execute the handler. It is marked, so that they skip it,
+        // and freed once no task can execute it anymore, see loop_free_retired().
+        __atomic_store_n(&(handler->handler_ctx->handler), NULL, __ATOMIC_RELEASE);
+        if (table != NULL) {
+            SLIST_INSERT_HEAD(&(table->removed_handlers), handler, removed_next);
+        } else {
+            SLIST_INSERT_HEAD(&(loop->removed_handlers), handler, removed_next);
+        }
+    } else {
+        free(handler->handler_ctx);
+        free(handler);
+    }
+}
+
+static esp_err_t handler_instances_remove(esp_event_loop_instance_t* loop, esp_event_handler_nodes_t* handlers, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
 {
     esp_event_handler_node_t *it, *temp;
 
@@ -327,15 +370,13 @@ static esp_err_t handler_instances_remove(esp_event_handler_nodes_t* handlers, e
         if (legacy) {
             if (it->handler_ctx->handler == handler_ctx->handler) {
                 SLIST_REMOVE(handlers, it, esp_event_handler_node, next);
-                free(it->handler_ctx);
-                free(it);
+                handler_instance_delete(loop, it);
                 return ESP_OK;
             }
         } else {
             if (it->handler_ctx == handler_ctx) {
                 SLIST_REMOVE(handlers, it, esp_event_handler_node, next);
-                free(it->handler_ctx);
-                free(it);
+                handler_instance_delete(loop, it);
                 return ESP_OK;
             }
         }
@@ -345,16 +386,16 @@ static esp_err_t handler_instances_remove(esp_event_handler_nodes_t* handlers, e
 }
 
 
-static esp_err_t base_node_remove_handler(esp_event_base_node_t* base_node, int32_t id, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
+static esp_err_t base_node_remove_handler(esp_event_loop_instance_t* loop, esp_event_base_node_t* base_node, int32_t id, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
 {
     if (id == ESP_EVENT_ANY_ID) {
-        return handler_instances_remove(&(base_node->handlers), handler_ctx, legacy);
+        return handler_instances_remove(loop, &(base_node->handlers), handler_ctx, legacy);
     }
     else {
         esp_event_id_node_t *it, *temp;
         SLIST_FOREACH_SAFE(it, &(base_node->id_nodes), next, temp) {
             if (it->id == id) {
-                esp_err_t res = handler_instances_remove(&(it->handlers), handler_ctx, legacy);
+                esp_err_t res = handler_instances_remove(loop, &(it->handlers), handler_ctx, legacy);
 
                 if (res == ESP_OK) {
                     if (SLIST_EMPTY(&(it->handlers))) {
@@ -370,16 +411,16 @@ static esp_err_t base_node_remove_handler(esp_event_base_node_t* base_node, int3
     return ESP_ERR_NOT_FOUND;
 }
 
-static esp_err_t loop_node_remove_handler(esp_event_loop_node_t* loop_node, esp_event_base_t base, int32_t id, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
+static esp_err_t loop_node_remove_handler(esp_event_loop_instance_t* loop, esp_event_loop_node_t* loop_node, esp_event_base_t base, int32_t id, esp_event_handler_instance_context_t* handler_ctx, bool legacy)
 {
     if (base == esp_event_any_base && id == ESP_EVENT_ANY_ID) {
-        return handler_instances_remove(&(loop_node->handlers), handler_ctx, legacy);
+        return handler_instances_remove(loop, &(loop_node->handlers), handler_ctx, legacy);
     }
     else {
         esp_event_base_node_t *it, *temp;
         SLIST_FOREACH_SAFE(it, &(loop_node->base_nodes), next, temp) {
             if (it->base == base) {
-                esp_err_t res = base_node_remove_handler(it, id, handler_ctx, legacy);
+                esp_err_t res = base_node_remove_handler(loop, it, id, handler_ctx, legacy);
 
                 if (res == ESP_OK) {
                     if (SLIST_EMPTY(&(it->handlers)) && SLIST_EMPTY(&(it->id_nodes))) {
@@ -429,20 +470,475 @@ static void loop_node_remove_all_handler(esp_event_loop_node_t* loop_node)
     }
 }
 
-static void inline __attribute__((always_inline)) post_instance_delete(esp_event_post_instance_t* post)
+static void* post_data_alloc(esp_event_loop_instance_t* loop, size_t size)
+{
+#if CONFIG_ESP_EVENT_POST_DATA_POOL_SIZE > 0
+    if (size <= POST_DATA_BLOCK_SIZE) {
+        // Claim the lowest free block. Posting tasks only contend on the bitmap, no lock is taken.
+        uint_least32_t free_blocks = atomic_load(&loop->data_pool_free);
+        while (free_blocks != 0) {
+            int block = __builtin_ctz(free_blocks);
+            if (atomic_compare_exchange_weak(&loop->data_pool_free, &free_blocks, free_blocks & ~(1U << block))) {
+                return loop->data_pool + block * POST_DATA_BLOCK_SIZE;
+            }
+        }
+    }
+#endif
+    return malloc(size);
+}
+
+static void post_data_free(esp_event_loop_instance_t* loop, void* data)
+{
+#if CONFIG_ESP_EVENT_POST_DATA_POOL_SIZE > 0
+    uint8_t* block = (uint8_t*) data;
+    if (block >= loop->data_pool && block < loop->data_pool + POST_DATA_POOL_SIZE * POST_DATA_BLOCK_SIZE) {
+        atomic_fetch_or(&loop->data_pool_free, 1U << ((block - loop->data_pool) / POST_DATA_BLOCK_SIZE));
+        return;
+    }
+#endif
+    free(data);
+}
+
+static void inline __attribute__((always_inline)) post_instance_delete(esp_event_loop_instance_t* loop, esp_event_post_instance_t* post)
 {
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
     if (post->data_allocated && post->data.ptr) {
-        free(post->data.ptr);
+        post_data_free(loop, post->data.ptr);
     }
 #else
     if (post->data) {
-        free(post->data);
+        post_data_free(loop, post->data);
     }
 #endif
     memset(post, 0, sizeof(*post));
 }
 
+static inline __attribute__((always_inline)) uint32_t dispatch_table_hash(esp_event_base_t base, int32_t id)
+{
+    uint32_t hash = (uint32_t) (uintptr_t) base * 0x9E3779B1 + (uint32_t) id;
+    return hash ^ (hash >> 16);
+}
+
+// Returns the entry of the event, or the unused entry where it would be added
+static esp_event_dispatch_entry_t* dispatch_table_find(esp_event_dispatch_table_t* table, esp_event_base_t base, int32_t id)
+{
+    for (uint32_t i = dispatch_table_hash(base, id) & table->mask; ; i = (i + 1) & table->mask) {
+        esp_event_dispatch_entry_t* entry = &(table->entries[i]);
+        if (entry->base == NULL || (entry->base == base && entry->id == id)) {
+            return entry;
+        }
+    }
+}
+
+// Collects the handlers executed for an event in the order esp_event_loop_run_lists() executes them, a NULL base
+// collects the loop level handlers only. Returns the number of handlers, they are stored in handlers if not NULL.
+static size_t dispatch_table_collect(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id, esp_event_handler_node_t** handlers)
+{
+    size_t count = 0;
+
+    esp_event_handler_node_t *handler;
+    esp_event_loop_node_t *loop_node;
+    esp_event_base_node_t *base_node;
+    esp_event_id_node_t *id_node;
+
+    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
+        SLIST_FOREACH(handler, &(loop_node->handlers), next) {
+            if (handlers) {
+                handlers[count] = handler;
+            }
+            count++;
+        }
+
+        if (base == NULL) {
+            continue;
+        }
+
+        SLIST_FOREACH(base_node, &(loop_node->base_nodes), next) {
+            if (base_node->base == base) {
+                SLIST_FOREACH(handler, &(base_node->handlers), next) {
+                    if (handlers) {
+                        handlers[count] = handler;
+                    }
+                    count++;
+                }
+
+                SLIST_FOREACH(id_node, &(base_node->id_nodes), next) {
+                    if (id_node->id == id) {
+                        SLIST_FOREACH(handler, &(id_node->handlers), next) {
+                            if (handlers) {
+                                handlers[count] = handler;
+                            }
+                            count++;
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    return count;
+}
+
+static void dispatch_table_add(esp_event_dispatch_table_t* table, esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id, size_t* handlers)
+{
+    esp_event_dispatch_entry_t* entry = dispatch_table_find(table, base, id);
+
+    if (entry->base == NULL) {
+        size_t count = dispatch_table_collect(loop, base, id, NULL);
+        entry->base = base;
+        entry->id = id;
+        entry->first = *handlers;
+        entry->count = count;
+        *handlers += count;
+    }
+}
+
+static void removed_handlers_free(esp_event_handler_nodes_t* handlers)
+{
+    esp_event_handler_node_t *handler, *temp_handler;
+    SLIST_FOREACH_SAFE(handler, handlers, removed_next, temp_handler) {
+        free(handler->handler_ctx);
+        free(handler);
+    }
+    SLIST_INIT(handlers);
+}
+
+static void dispatch_table_delete(esp_event_dispatch_table_t* table)
+{
+    if (table) {
+        removed_handlers_free(&(table->removed_handlers));
+        free(table->handlers);
+        free(table);
+    }
+}
+
+// Replaces the table of the loop. The old one is kept until no task executes its handlers and the older tables
+// are freed, since the handlers unregistered while it was the loop's table may be in the older tables too.
+static void dispatch_table_replace(esp_event_loop_instance_t* loop, esp_event_dispatch_table_t* table)
+{
+    esp_event_dispatch_table_t* old = loop->dispatch_table;
+
+    if (old != NULL) {
+        if (old->dispatching > 0 || !STAILQ_EMPTY(&(loop->retired_tables))) {
+            STAILQ_INSERT_TAIL(&(loop->retired_tables), old, next);
+        } else {
+            dispatch_table_delete(old);
+        }
+    }
+    loop->dispatch_table = table;
+}
+
+// Frees the tables replaced while tasks executed their handlers and the handlers unregistered meanwhile, once no
+// task can execute them anymore. Called with the loop mutex held whenever a task finishes executing an event.
+static void loop_free_retired(esp_event_loop_instance_t* loop)
+{
+    esp_event_dispatch_table_t* table;
+    while ((table = STAILQ_FIRST(&(loop->retired_tables))) != NULL && table->dispatching == 0) {
+        STAILQ_REMOVE_HEAD(&(loop->retired_tables), next);
+        dispatch_table_delete(table);
+    }
+
+    if (!STAILQ_EMPTY(&(loop->retired_tables)) || loop->list_dispatching > 0) {
+        return;
+    }
+
+    // The handlers unregistered while the loop had no table are in no table in use anymore, those unregistered
+    // while the loop's table is in use are in that table only
+    removed_handlers_free(&(loop->removed_handlers));
+    if (loop->dispatch_table != NULL && loop->dispatch_table->dispatching == 0) {
+        removed_handlers_free(&(loop->dispatch_table->removed_handlers));
+    }
+}
+
+// Builds the table of the handlers executed for each event registered with the loop, one entry for each (base, id)
+// with id level handlers and one for each base, for the other ids of the base. Returns NULL if out of memory.
+static esp_event_dispatch_table_t* dispatch_table_create(esp_event_loop_instance_t* loop)
+{
+    esp_event_loop_node_t *loop_node;
+    esp_event_base_node_t *base_node;
+    esp_event_id_node_t *id_node;
+
+    // The same event can have nodes in several loop nodes, this counts it once for each
+    size_t events = 0;
+    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
+        SLIST_FOREACH(base_node, &(loop_node->base_nodes), next) {
+            events++;
+            SLIST_FOREACH(id_node, &(base_node->id_nodes), next) {
+                events++;
+            }
+        }
+    }
+
+    // Keep the table at most half full, to keep probing short
+    uint32_t size = 8;
+    while (size < 2 * events) {
+        size *= 2;
+    }
+
+    esp_event_dispatch_table_t* table = calloc(1, sizeof(*table) + size * sizeof(esp_event_dispatch_entry_t));
+    if (table == NULL) {
+        return NULL;
+    }
+
+    table->mask = size - 1;
+    size_t handlers = table->loop_count = dispatch_table_collect(loop, NULL, 0, NULL);
+
+    SLIST_FOREACH(loop_node, &(loop->loop_nodes), next) {
+        SLIST_FOREACH(base_node, &(loop_node->base_nodes), next) {
+            dispatch_table_add(table, loop, base_node->base, ESP_EVENT_ANY_ID, &handlers);
+            SLIST_FOREACH(id_node, &(base_node->id_nodes), next) {
+                dispatch_table_add(table, loop, base_node->base, id_node->id, &handlers);
+            }
+        }
+    }
+
+    if (handlers > UINT16_MAX) {
+        ESP_LOGW(TAG, "too many handlers registered for a dispatch table for loop %p", loop);
+        free(table);
+        return NULL;
+    }
+
+    table->handlers = malloc(handlers * sizeof(esp_event_handler_node_t*));
+    if (table->handlers == NULL && handlers > 0) {
+        free(table);
+        return NULL;
+    }
+
+    dispatch_table_collect(loop, NULL, 0, table->handlers);
+    for (uint32_t i = 0; i < size; i++) {
+        esp_event_dispatch_entry_t* entry = &(table->entries[i]);
+        if (entry->base != NULL) {
+            dispatch_table_collect(loop, entry->base, entry->id, table->handlers + entry->first);
+        }
+    }
+
+    return table;
+}
+
+static bool esp_event_loop_run_table(esp_event_loop_instance_t* loop, esp_event_dispatch_table_t* table, esp_event_post_instance_t post)
+{
+    esp_event_dispatch_entry_t* entry = dispatch_table_find(table, post.base, post.id);
+    if (entry->base == NULL) {
+        // No id level handlers for the event, look for base level handlers
+        entry = dispatch_table_find(table, post.base, ESP_EVENT_ANY_ID);
+    }
+
+    esp_event_handler_node_t** handlers = table->handlers;
+    size_t count = table->loop_count;
+    if (entry->base != NULL) {
+        handlers += entry->first;
+        count = entry->count;
+    }
+
+    bool exec = false;
+
+    for (size_t i = 0; i < count; i++) {
+        exec |= handler_execute(loop, handlers[i], post);
+    }
+
+    return exec;
+}
+
+// Walks the linked lists of handlers, used when there is not enough memory for the dispatch table
+static bool esp_event_loop_run_lists(esp_event_loop_instance_t* loop, esp_event_post_instance_t post)
+{
+    bool exec = false;
+
+    esp_event_handler_node_t *handler, *temp_handler;
+    esp_event_loop_node_t *loop_node, *temp_node;
+    esp_event_base_node_t *base_node, *temp_base;
+    esp_event_id_node_t *id_node, *temp_id_node;
+
+    SLIST_FOREACH_SAFE(loop_node, &(loop->loop_nodes), next, temp_node) {
+        // Execute loop level handlers
+        SLIST_FOREACH_SAFE(handler, &(loop_node->handlers), next, temp_handler) {
+            exec |= handler_execute(loop, handler, post);
+        }
+
+        SLIST_FOREACH_SAFE(base_node, &(loop_node->base_nodes), next, temp_base) {
+            if (base_node->base == post.base) {
+                // Execute base level handlers
+                SLIST_FOREACH_SAFE(handler, &(base_node->handlers), next, temp_handler) {
+                    exec |= handler_execute(loop, handler, post);
+                }
+
+                SLIST_FOREACH_SAFE(id_node, &(base_node->id_nodes), next, temp_id_node) {
+                    if (id_node->id == post.id) {
+                        // Execute id level handlers
+                        SLIST_FOREACH_SAFE(handler, &(id_node->handlers), next, temp_handler) {
+                            exec |= handler_execute(loop, handler, post);
+                        }
+                        // Skip to next base node
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    return exec;
+}
+
+// Returns the queue of the task that executes the event. A loop with several tasks distributes the events among them
+// by base and id, so that the events with the same base and id are executed by one task in the order they are posted.
+static inline __attribute__((always_inline)) QueueHandle_t loop_queue(esp_event_loop_instance_t* loop, esp_event_base_t base, int32_t id)
+{
+    if (loop->workers == NULL) {
+        return loop->queue;
+    }
+    return loop->workers[dispatch_table_hash(base, id) % loop->worker_count].queue;
+}
+
+// Returns whether the task is a dedicated task of the loop. It is safe to query the tasks of the loop since they
+// are not mutated after loop creation. ENSURE THIS REMAINS TRUE.
+static bool loop_has_task(esp_event_loop_instance_t* loop, TaskHandle_t task)
+{
+    if (loop->workers == NULL) {
+        return loop->task == task;
+    }
+    for (uint32_t i = 0; i < loop->worker_count; i++) {
+        if (loop->workers[i].task == task) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Waits until the task finishes executing the handlers of the event it is executing, if any. The loop mutex is
+// held by the caller, it is released while waiting.
+static void loop_worker_wait(esp_event_loop_instance_t* loop, esp_event_loop_worker_t* worker)
+{
+    uint32_t dispatches = worker->dispatches;
+    while ((dispatches & 1) && worker->dispatches == dispatches) {
+        // Woken up when any task of the loop finishes an event, the task checks again if it was the one it waits for
+        loop->dispatch_waiters++;
+        xSemaphoreGiveRecursive(loop->mutex);
+        xSemaphoreTake(loop->dispatch_done, portMAX_DELAY);
+        xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
+    }
+}
+
+// Marks the end of the execution of an event by the task, and wakes up the tasks waiting for it. Called with the
+// loop mutex held.
+static void loop_worker_done(esp_event_loop_instance_t* loop, esp_event_loop_worker_t* worker)
+{
+    worker->dispatches++;
+    for (; loop->dispatch_waiters > 0; loop->dispatch_waiters--) {
+        xSemaphoreGive(loop->dispatch_done);
+    }
+}
+
+// Runs the loop, taking the events from the queue of the worker, or from the loop's queue if worker is NULL.
+static esp_err_t loop_run(esp_event_loop_instance_t* loop, esp_event_loop_worker_t* worker, TickType_t ticks_to_run)
+{
+    QueueHandle_t queue = worker != NULL ? worker->queue : loop->queue;
+    esp_event_post_instance_t post;
+    TickType_t marker = xTaskGetTickCount();
+    TickType_t end = 0;
+
+#if (configUSE_16_BIT_TICKS == 1)
+    int32_t remaining_ticks = ticks_to_run;
+#else
+    int64_t remaining_ticks = ticks_to_run;
+#endif
+
+    while(xQueueReceive(queue, &post, ticks_to_run) == pdTRUE) {
+        // The event has already been unqueued, so ensure it gets executed.
+        xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
+
+        loop->running_task = xTaskGetCurrentTaskHandle();
+
+        if (loop->dispatch_table_stale) {
+            dispatch_table_replace(loop, dispatch_table_create(loop));
+            loop->dispatch_table_stale = (loop->dispatch_table == NULL);
+        }
+
+        // The tasks of a loop with several tasks execute the handlers without the mutex held, so that they execute
+        // them in parallel. Tables replaced and handlers unregistered meanwhile are kept until no task executes the
+        // handlers of the table. Without a table, the lists of handlers are walked with the mutex held.
+        esp_event_dispatch_table_t* table = loop->dispatch_table;
+        bool parallel = (worker != NULL && table != NULL);
+        bool exec;
+
+        if (table != NULL) {
+            table->dispatching++;
+        } else {
+            loop->list_dispatching++;
+        }
+        if (worker != NULL) {
+            worker->dispatches++;
+        }
+        if (parallel) {
+            xSemaphoreGiveRecursive(loop->mutex);
+        }
+
+        if (table != NULL) {
+            exec = esp_event_loop_run_table(loop, table, post);
+        } else {
+            exec = esp_event_loop_run_lists(loop, post);
+        }
+
+        if (parallel) {
+            xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
+        }
+        if (worker != NULL) {
+            loop_worker_done(loop, worker);
+        }
+        if (table != NULL) {
+            table->dispatching--;
+        } else {
+            loop->list_dispatching--;
+        }
+        loop_free_retired(loop);
+
+        esp_event_base_t base = post.base;
+        int32_t id = post.id;
+
+        post_instance_delete(loop, &post);
+        if (ticks_to_run != portMAX_DELAY) {
+            end = xTaskGetTickCount();
+            remaining_ticks -= end - marker;
+            // If the ticks to run expired, return to the caller
+            if (remaining_ticks <= 0) {
+                xSemaphoreGiveRecursive(loop->mutex);
+                break;
+            } else {
+                marker = end;
+            }
+        }
+
+        loop->running_task = NULL;
+
+        xSemaphoreGiveRecursive(loop->mutex);
+
+        if (!exec) {
+            // No handlers were registered, not even loop/base level handlers
+            ESP_LOGD(TAG, "no handlers have been registered for event %s:%d posted to loop %p", base, id, loop);
+        }
+    }
+
+    return ESP_OK;
+}
+
+static void esp_event_loop_run_worker_task(void* args)
+{
+    esp_err_t err;
+    esp_event_loop_worker_t* worker = (esp_event_loop_worker_t*) args;
+
+    ESP_LOGD(TAG, "running task %p for loop %p", worker->task, worker->loop);
+
+    while(1) {
+        err = loop_run(worker->loop, worker, portMAX_DELAY);
+        if (err != ESP_OK) {
+            break;
+        }
+    }
+
+    ESP_LOGE(TAG, "suspended task %p for loop %p", worker->task, worker->loop);
+    vTaskSuspend(NULL);
+}
+
 /* ---------------------------- Public API --------------------------------- */
 
 esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, esp_event_loop_handle_t* event_loop)
@@ -457,19 +953,53 @@ esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, es
         return ESP_ERR_INVALID_ARG;
     }
 
+    if (event_loop_args->task_name != NULL && event_loop_args->task_count > ESP_EVENT_LOOP_TASKS_MAX) {
+        ESP_LOGE(TAG, "task_count %u is greater than %d", event_loop_args->task_count, ESP_EVENT_LOOP_TASKS_MAX);
+        return ESP_ERR_INVALID_ARG;
+    }
+
     esp_event_loop_instance_t* loop;
     esp_err_t err = ESP_ERR_NO_MEM; // most likely error
 
-    loop = calloc(1, sizeof(*loop));
+    loop = calloc(1, sizeof(*loop) + POST_DATA_POOL_SIZE * POST_DATA_BLOCK_SIZE);
     if (loop == NULL) {
         ESP_LOGE(TAG, "alloc for event loop failed");
         return err;
     }
 
-    loop->queue = xQueueCreate(event_loop_args->queue_size , sizeof(esp_event_post_instance_t));
-    if (loop->queue == NULL) {
-        ESP_LOGE(TAG, "create event loop queue failed");
-        goto on_err;
+    if (event_loop_args->task_name != NULL && event_loop_args->task_count > 1) {
+        loop->workers = calloc(event_loop_args->task_count, sizeof(esp_event_loop_worker_t));
+        if (loop->workers == NULL) {
+            ESP_LOGE(TAG, "alloc for event loop tasks failed");
+            goto on_err;
+        }
+
+        loop->worker_count = event_loop_args->task_count;
+
+        // Each task has its own queue
+        for (uint32_t i = 0; i < loop->worker_count; i++) {
+            loop->workers[i].loop = loop;
+            loop->workers[i].queue = xQueueCreate(event_loop_args->queue_size , sizeof(esp_event_post_instance_t));
+            if (loop->workers[i].queue == NULL) {
+                ESP_LOGE(TAG, "create event loop queue failed");
+                goto on_err;
+            }
+        }
+
+        loop->queue = loop->workers[0].queue;
+
+        // The count never exceeds the number of tasks waiting for the loop's tasks
+        loop->dispatch_done = xSemaphoreCreateCounting(UINT32_MAX, 0);
+        if (loop->dispatch_done == NULL) {
+            ESP_LOGE(TAG, "create event loop semaphore failed");
+            goto on_err;
+        }
+    } else {
+        loop->queue = xQueueCreate(event_loop_args->queue_size , sizeof(esp_event_post_instance_t));
+        if (loop->queue == NULL) {
+            ESP_LOGE(TAG, "create event loop queue failed");
+            goto on_err;
+        }
     }
 
     loop->mutex = xSemaphoreCreateRecursiveMutex();
@@ -487,9 +1017,38 @@ esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, es
 #endif
 
     SLIST_INIT(&(loop->loop_nodes));
+    SLIST_INIT(&(loop->removed_handlers));
+    STAILQ_INIT(&(loop->retired_tables));
+    loop->dispatch_table_stale = true;
+
+#if CONFIG_ESP_EVENT_POST_DATA_POOL_SIZE > 0
+    atomic_init(&loop->data_pool_free, POST_DATA_POOL_ALL_FREE);
+#endif
 
     // Create the loop task if requested
-    if (event_loop_args->task_name != NULL) {
+    if (event_loop_args->task_name != NULL && loop->workers != NULL) {
+        for (uint32_t i = 0; i < loop->worker_count; i++) {
+            BaseType_t core_id = event_loop_args->task_core_id;
+            if (core_id != tskNO_AFFINITY) {
+                core_id = (core_id + i) % portNUM_PROCESSORS;
+            }
+
+            BaseType_t task_created = xTaskCreatePinnedToCore(esp_event_loop_run_worker_task, event_loop_args->task_name,
+                        event_loop_args->task_stack_size, (void*) &(loop->workers[i]),
+                        event_loop_args->task_priority, &(loop->workers[i].task), core_id);
+
+            if (task_created != pdPASS) {
+                ESP_LOGE(TAG, "create task for loop failed");
+                err = ESP_FAIL;
+                goto on_err;
+            }
+        }
+
+        loop->task = loop->workers[0].task;
+        loop->name = event_loop_args->task_name;
+
+        ESP_LOGD(TAG, "created %u tasks for loop %p", loop->worker_count, loop);
+    } else if (event_loop_args->task_name != NULL) {
         BaseType_t task_created = xTaskCreatePinnedToCore(esp_event_loop_run_task, event_loop_args->task_name,
                     event_loop_args->task_stack_size, (void*) loop,
                     event_loop_args->task_priority, &(loop->task), event_loop_args->task_core_id);
@@ -523,10 +1082,24 @@ esp_err_t esp_event_loop_create(const esp_event_loop_args_t* event_loop_args, es
     return ESP_OK;
 
 on_err:
-    if (loop->queue != NULL) {
+    if (loop->workers != NULL) {
+        for (uint32_t i = 0; i < loop->worker_count; i++) {
+            if (loop->workers[i].task != NULL) {
+                vTaskDelete(loop->workers[i].task);
+            }
+            if (loop->workers[i].queue != NULL) {
+                vQueueDelete(loop->workers[i].queue);
+            }
+        }
+        free(loop->workers);
+    } else if (loop->queue != NULL) {
         vQueueDelete(loop->queue);
     }
 
+    if (loop->dispatch_done != NULL) {
+        vSemaphoreDelete(loop->dispatch_done);
+    }
+
     if (loop->mutex != NULL) {
         vSemaphoreDelete(loop->mutex);
     }
@@ -542,98 +1115,15 @@ on_err:
     return err;
 }
 
-// On event lookup performance: The library implements the event list as a linked list, which results to O(n)
-// lookup time. The test comparing this implementation to the O(lg n) performance of rbtrees
-// (https://github.com/freebsd/freebsd/blob/master/sys/sys/tree.h)
-// indicate that the difference is not that substantial, especially considering the additional
-// pointers per node of rbtrees. Code for the rbtree implementation of the event loop library is archived
-// in feature/esp_event_loop_library_rbtrees if needed.
+// On event lookup performance: The library keeps the registered handlers in linked lists, and builds a table
+// of the handlers executed for each event from them when they change. Looking up an event in the table takes
+// constant time, registrations are much rarer than events. If there is not enough memory for the table, the
+// event is looked up in the linked lists.
 esp_err_t esp_event_loop_run(esp_event_loop_handle_t event_loop, TickType_t ticks_to_run)
 {
     assert(event_loop);
 
-    esp_event_loop_instance_t* loop = (esp_event_loop_instance_t*) event_loop;
-    esp_event_post_instance_t post;
-    TickType_t marker = xTaskGetTickCount();
-    TickType_t end = 0;
-
-#if (configUSE_16_BIT_TICKS == 1)
-    int32_t remaining_ticks = ticks_to_run;
-#else
-    int64_t remaining_ticks = ticks_to_run;
-#endif
-
-    while(xQueueReceive(loop->queue, &post, ticks_to_run) == pdTRUE) {
-        // The event has already been unqueued, so ensure it gets executed.
-        xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
-
-        loop->running_task = xTaskGetCurrentTaskHandle();
-
-        bool exec = false;
-
-        esp_event_handler_node_t *handler, *temp_handler;
-        esp_event_loop_node_t *loop_node, *temp_node;
-        esp_event_base_node_t *base_node, *temp_base;
-        esp_event_id_node_t *id_node, *temp_id_node;
-
-        SLIST_FOREACH_SAFE(loop_node, &(loop->loop_nodes), next, temp_node) {
-            // Execute loop level handlers
-            SLIST_FOREACH_SAFE(handler, &(loop_node->handlers), next, temp_handler) {
-                handler_execute(loop, handler, post);
-                exec |= true;
-            }
-
-            SLIST_FOREACH_SAFE(base_node, &(loop_node->base_nodes), next, temp_base) {
-                if (base_node->base == post.base) {
-                    // Execute base level handlers
-                    SLIST_FOREACH_SAFE(handler, &(base_node->handlers), next, temp_handler) {
-                        handler_execute(loop, handler, post);
-                        exec |= true;
-                    }
-
-                    SLIST_FOREACH_SAFE(id_node, &(base_node->id_nodes), next, temp_id_node) {
-                        if (id_node->id == post.id) {
-                            // Execute id level handlers
-                            SLIST_FOREACH_SAFE(handler, &(id_node->handlers), next, temp_handler) {
-                                handler_execute(loop, handler, post);
-                                exec |= true;
-                            }
-                            // Skip to next base node
-                            break;
-                        }
-                    }
-                }
-            }
-        }
-
-        esp_event_base_t base = post.base;
-        int32_t id = post.id;
-
-        post_instance_delete(&post);
-
-        if (ticks_to_run != portMAX_DELAY) {
-            end = xTaskGetTickCount();
-            remaining_ticks -= end - marker;
-            // If the ticks to run expired, return to the caller
-            if (remaining_ticks <= 0) {
-                xSemaphoreGiveRecursive(loop->mutex);
-                break;
-            } else {
-                marker = end;
-            }
-        }
-
-        loop->running_task = NULL;
-
-        xSemaphoreGiveRecursive(loop->mutex);
-
-        if (!exec) {
-            // No handlers were registered, not even loop/base level handlers
-            ESP_LOGD(TAG, "no handlers have been registered for event %s:%d posted to loop %p", base, id, event_loop);
-        }
-    }
-
-    return ESP_OK;
+    return loop_run((esp_event_loop_instance_t*) event_loop, NULL, ticks_to_run);
 }
 
 esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop)
@@ -648,6 +1138,19 @@ esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop)
 
     xSemaphoreTakeRecursive(loop->mutex, portMAX_DELAY);
 
+    // Delete the task if it was created
+    if (loop->workers != NULL) {
+        for (uint32_t i = 0; i < loop->worker_count; i++) {
+            // The task executes handlers without the mutex held, wait until it isn't executing any
+            while (loop->workers[i].dispatches & 1) {
+                loop_worker_wait(loop, &(loop->workers[i]));
+            }
+            vTaskDelete(loop->workers[i].task);
+        }
+    } else if (loop->task != NULL) {
+        vTaskDelete(loop->task);
+    }
+
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     xSemaphoreTake(loop->profiling_mutex, portMAX_DELAY);
     portENTER_CRITICAL(&s_event_loops_spinlock);
@@ -655,11 +1158,6 @@ esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop)
     portEXIT_CRITICAL(&s_event_loops_spinlock);
 #endif
 
-    // Delete the task if it was created
-    if (loop->task != NULL) {
-        vTaskDelete(loop->task);
-    }
-
     // Remove all registered events and handlers in the loop
     esp_event_loop_node_t *it, *temp;
     SLIST_FOREACH_SAFE(it, &(loop->loop_nodes), next, temp) {
@@ -668,14 +1166,29 @@ esp_err_t esp_event_loop_delete(esp_event_loop_handle_t event_loop)
         free(it);
     }
 
-    // Drop existing posts on the queue
+    // No task executes the handlers anymore, this frees all the tables
+    dispatch_table_replace(loop, NULL);
+    loop_free_retired(loop);
+
+    // Drop existing posts on the queues
     esp_event_post_instance_t post;
-    while(xQueueReceive(loop->queue, &post, 0) == pdTRUE) {
-        post_instance_delete(&post);
+    if (loop->workers != NULL) {
+        for (uint32_t i = 0; i < loop->worker_count; i++) {
+            while(xQueueReceive(loop->workers[i].queue, &post, 0) == pdTRUE) {
+                post_instance_delete(loop, &post);
+            }
+            vQueueDelete(loop->workers[i].queue);
+        }
+        free(loop->workers);
+        vSemaphoreDelete(loop->dispatch_done);
+    } else {
+        while(xQueueReceive(loop->queue, &post, 0) == pdTRUE) {
+            post_instance_delete(loop, &post);
+        }
+        vQueueDelete(loop->queue);
     }
 
     // Cleanup loop
-    vQueueDelete(loop->queue);
     free(loop);
     // Free loop mutex before deleting
     xSemaphoreGiveRecursive(loop_mutex);
@@ -751,6 +1264,10 @@ esp_err_t esp_event_handler_register_with_internal(esp_event_loop_handle_t event
     }
 
 on_err:
+    if (err == ESP_OK) {
+        loop->dispatch_table_stale = true;
+    }
+
     xSemaphoreGiveRecursive(loop->mutex);
     return err;
 }
@@ -790,7 +1307,7 @@ esp_err_t esp_event_handler_unregister_with_internal(esp_event_loop_handle_t eve
     esp_event_loop_node_t *it, *temp;
 
     SLIST_FOREACH_SAFE(it, &(loop->loop_nodes), next, temp) {
-        esp_err_t res = loop_node_remove_handler(it, event_base, event_id, handler_ctx, legacy);
+        esp_err_t res = loop_node_remove_handler(loop, it, event_base, event_id, handler_ctx, legacy);
 
         if (res == ESP_OK && SLIST_EMPTY(&(it->base_nodes)) && SLIST_EMPTY(&(it->handlers))) {
             SLIST_REMOVE(&(loop->loop_nodes), it, esp_event_loop_node, next);
@@ -799,6 +1316,14 @@ esp_err_t esp_event_handler_unregister_with_internal(esp_event_loop_handle_t eve
         }
     }
 
+    // The tasks of a loop with several tasks execute handlers without the mutex held. Unless called from a handler,
+    // wait until the events they are executing are done, so that the handler isn't executing once this returns.
+    if (loop->workers != NULL && !loop_has_task(loop, xTaskGetCurrentTaskHandle())) {
+        for (uint32_t i = 0; i < loop->worker_count; i++) {
+            loop_worker_wait(loop, &(loop->workers[i]));
+        }
+    }
+
     xSemaphoreGiveRecursive(loop->mutex);
 
     return ESP_OK;
@@ -837,8 +1362,8 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t
     memset((void*)(&post), 0, sizeof(post));
 
     if (event_data != NULL && event_data_size != 0) {
-        // Make persistent copy of event data on heap.
-        void* event_data_copy = calloc(1, event_data_size);
+        // Make persistent copy of event data, in a block of the loop's pool if one is free or on heap.
+        void* event_data_copy = post_data_alloc(loop, event_data_size);
 
         if (event_data_copy == NULL) {
             return ESP_ERR_NO_MEM;
@@ -857,33 +1382,31 @@ esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t
     post.id = event_id;
 
     BaseType_t result = pdFALSE;
+    QueueHandle_t queue = loop_queue(loop, event_base, event_id);
 
     // Find the task that currently executes the loop. It is safe to query loop->task since it is
     // not mutated since loop creation. ENSURE THIS REMAINS TRUE.
     if (loop->task == NULL) {
-        // The loop has no dedicated task. Find out what task is currently running it.
-        result = xSemaphoreTakeRecursive(loop->mutex, ticks_to_wait);
-
-        if (result == pdTRUE) {
-            if (loop->running_task != xTaskGetCurrentTaskHandle()) {
-                xSemaphoreGiveRecursive(loop->mutex);
-                result = xQueueSendToBack(loop->queue, &post, ticks_to_wait);
-            } else {
-                xSemaphoreGiveRecursive(loop->mutex);
-                result = xQueueSendToBack(loop->queue, &post, 0);
-            }
+        // The loop has no dedicated task. Find out if the current task is running it. Only the task running
+        // the loop sets loop->running_task to itself, so this doesn't need to take the loop mutex, which is
+        // held while handlers execute.
+        if (loop->running_task != xTaskGetCurrentTaskHandle()) {
+            result = xQueueSendToBack(queue, &post, ticks_to_wait);
+        } else {
+            result = xQueueSendToBack(queue, &post, 0);
         }
     } else {
-        // The loop has a dedicated task.
-        if (loop->task != xTaskGetCurrentTaskHandle()) {
-            result = xQueueSendToBack(loop->queue, &post, ticks_to_wait);
+        // The loop has dedicated tasks. A task of a loop with several tasks doesn't wait for another either, which
+        // may be waiting for it.
+        if (!loop_has_task(loop, xTaskGetCurrentTaskHandle())) {
+            result = xQueueSendToBack(queue, &post, ticks_to_wait);
         } else {
-            result = xQueueSendToBack(loop->queue, &post, 0);
+            result = xQueueSendToBack(queue, &post, 0);
         }
     }
 
     if (result != pdTRUE) {
-        post_instance_delete(&post);
+        post_instance_delete(loop, &post);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
         atomic_fetch_add(&loop->events_dropped, 1);
@@ -928,10 +1451,10 @@ esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop, esp_event_ba
     BaseType_t result = pdFALSE;
 
     // Post the event from an ISR,
-    result = xQueueSendToBackFromISR(loop->queue, &post, task_unblocked);
+    result = xQueueSendToBackFromISR(loop_queue(loop, event_base, event_id), &post, task_unblocked);
 
     if (result != pdTRUE) {
-        post_instance_delete(&post);
+        post_instance_delete(loop, &post);
 
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
         atomic_fetch_add(&loop->events_dropped, 1);
@@ -982,13 +1505,13 @@ esp_err_t esp_event_dump(FILE* file)
         SLIST_FOREACH(loop_node_it, &(loop_it->loop_nodes), next) {
             SLIST_FOREACH(handler_it, &(loop_node_it->handlers), next) {
                 PRINT_DUMP_INFO(dst, sz, HANDLER_DUMP_FORMAT, handler_it->handler_ctx->handler, "ESP_EVENT_ANY_BASE",
-                                "ESP_EVENT_ANY_ID", handler_it->invoked, handler_it->time);
+                                "ESP_EVENT_ANY_ID", handler_it->invoked, handler_it->time, handler_it->max_time);
             }
 
             SLIST_FOREACH(base_node_it, &(loop_node_it->base_nodes), next) {
                 SLIST_FOREACH(handler_it, &(base_node_it->handlers), next) {
                     PRINT_DUMP_INFO(dst, sz, HANDLER_DUMP_FORMAT, handler_it->handler_ctx->handler, base_node_it->base ,
-                                    "ESP_EVENT_ANY_ID", handler_it->invoked, handler_it->time);
+                                    "ESP_EVENT_ANY_ID", handler_it->invoked, handler_it->time, handler_it->max_time);
                 }
 
                 SLIST_FOREACH(id_node_it, &(base_node_it->id_nodes), next) {
@@ -997,7 +1520,7 @@ esp_err_t esp_event_dump(FILE* file)
                         snprintf(id_str_buf, sizeof(id_str_buf), "%d", id_node_it->id);
 
                         PRINT_DUMP_INFO(dst, sz, HANDLER_DUMP_FORMAT, handler_it->handler_ctx->handler, base_node_it->base ,
-                                        id_str_buf, handler_it->invoked, handler_it->time);
+                                        id_str_buf, handler_it->invoked, handler_it->time, handler_it->max_time);
                     }
                 }
             }
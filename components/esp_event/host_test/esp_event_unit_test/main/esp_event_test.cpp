@@ -10,6 +10,10 @@
 #define CATCH_CONFIG_MAIN
 
 #include <stdio.h>
+#include <array>
+#include <chrono>
+#include <map>
+#include <vector>
 #include "esp_event.h"
 
 #include "catch.hpp"
@@ -150,3 +154,279 @@ TEST_CASE("registering with ANY_BASE but specific ID fails") {
             dummy_handler,
             nullptr) == ESP_ERR_INVALID_ARG);
 }
+
+namespace {
+
+ESP_EVENT_DEFINE_BASE(s_test_base1);
+ESP_EVENT_DEFINE_BASE(s_test_base2);
+
+std::vector<int> s_dispatched;
+
+void record_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    s_dispatched.push_back(*static_cast<int*>(event_handler_arg));
+}
+
+void other_record_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    s_dispatched.push_back(*static_cast<int*>(event_handler_arg));
+}
+
+void unregister_other_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    esp_event_loop_handle_t loop = static_cast<esp_event_loop_handle_t>(event_handler_arg);
+    s_dispatched.push_back(-1);
+    CHECK(esp_event_handler_unregister_with(loop, event_base, event_id, other_record_handler) == ESP_OK);
+}
+
+void register_other_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    static int other = 2;
+    esp_event_loop_handle_t loop = static_cast<esp_event_loop_handle_t>(event_handler_arg);
+    s_dispatched.push_back(-1);
+    CHECK(esp_event_handler_register_with(loop, event_base, event_id, other_record_handler, &other) == ESP_OK);
+}
+
+int s_handled;
+
+void count_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    s_handled++;
+}
+
+void data_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    std::vector<uint8_t>* received = static_cast<std::vector<uint8_t>*>(event_handler_arg);
+    const uint8_t* data = static_cast<const uint8_t*>(event_data);
+    received->insert(received->end(), data, data + event_id);
+}
+
+int s_running_task;
+std::vector<std::array<int, 3> > s_executed;
+
+void task_record_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    s_executed.push_back({ s_running_task, event_id, *static_cast<int*>(event_data) });
+}
+
+esp_event_loop_handle_t create_loop_without_task(void)
+{
+    esp_event_loop_handle_t loop = nullptr;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_name = nullptr;
+    REQUIRE(esp_event_loop_create(&loop_args, &loop) == ESP_OK);
+    return loop;
+}
+
+}
+
+TEST_CASE("events are dispatched in the order handlers are registered")
+{
+    FakeQueue queue;
+    esp_event_loop_handle_t loop = create_loop_without_task();
+    int args[7] = { 0, 1, 2, 3, 4, 5, 6 };
+    s_dispatched.clear();
+
+    REQUIRE(esp_event_handler_register_with(loop, s_test_base2, 0, record_handler, &args[0]) == ESP_OK);
+    REQUIRE(esp_event_handler_register_with(loop, ESP_EVENT_ANY_BASE, ESP_EVENT_ANY_ID, record_handler, &args[1]) == ESP_OK);
+    REQUIRE(esp_event_handler_register_with(loop, s_test_base1, ESP_EVENT_ANY_ID, record_handler, &args[2]) == ESP_OK);
+    REQUIRE(esp_event_handler_register_with(loop, s_test_base2, 1, record_handler, &args[3]) == ESP_OK);
+    REQUIRE(esp_event_handler_register_with(loop, s_test_base1, 0, record_handler, &args[4]) == ESP_OK);
+    REQUIRE(esp_event_handler_register_with(loop, s_test_base2, ESP_EVENT_ANY_ID, record_handler, &args[5]) == ESP_OK);
+    REQUIRE(esp_event_handler_register_with(loop, s_test_base1, 1, record_handler, &args[6]) == ESP_OK);
+
+    CHECK(esp_event_post_to(loop, s_test_base2, 1, nullptr, 0, portMAX_DELAY) == ESP_OK);
+    CHECK(esp_event_post_to(loop, s_test_base1, 0, nullptr, 0, portMAX_DELAY) == ESP_OK);
+    CHECK(esp_event_post_to(loop, s_test_base1, 1, nullptr, 0, portMAX_DELAY) == ESP_OK);
+    CHECK(esp_event_post_to(loop, s_test_base2, 0, nullptr, 0, portMAX_DELAY) == ESP_OK);
+    // No id level handlers for this one
+    CHECK(esp_event_post_to(loop, s_test_base1, 5, nullptr, 0, portMAX_DELAY) == ESP_OK);
+    CHECK(esp_event_loop_run(loop, 1) == ESP_OK);
+
+    CHECK(s_dispatched == std::vector<int>({1, 3, 5, 1, 2, 4, 1, 2, 6, 0, 1, 5, 1, 2}));
+
+    CHECK(esp_event_loop_delete(loop) == ESP_OK);
+}
+
+TEST_CASE("handler unregistered by another handler of the same event isn't executed")
+{
+    FakeQueue queue;
+    esp_event_loop_handle_t loop = create_loop_without_task();
+    int other = 1;
+    s_dispatched.clear();
+
+    REQUIRE(esp_event_handler_register_with(loop, s_test_base1, 0, unregister_other_handler, loop) == ESP_OK);
+    REQUIRE(esp_event_handler_register_with(loop, s_test_base1, 0, other_record_handler, &other) == ESP_OK);
+
+    CHECK(esp_event_post_to(loop, s_test_base1, 0, nullptr, 0, portMAX_DELAY) == ESP_OK);
+    CHECK(esp_event_loop_run(loop, 1) == ESP_OK);
+    CHECK(s_dispatched == std::vector<int>({-1}));
+
+    CHECK(esp_event_loop_delete(loop) == ESP_OK);
+}
+
+TEST_CASE("handler registered by another handler is executed from the next event")
+{
+    FakeQueue queue;
+    esp_event_loop_handle_t loop = create_loop_without_task();
+    s_dispatched.clear();
+
+    REQUIRE(esp_event_handler_register_with(loop, s_test_base1, 0, register_other_handler, loop) == ESP_OK);
+
+    CHECK(esp_event_post_to(loop, s_test_base1, 0, nullptr, 0, portMAX_DELAY) == ESP_OK);
+    CHECK(esp_event_post_to(loop, s_test_base1, 0, nullptr, 0, portMAX_DELAY) == ESP_OK);
+    CHECK(esp_event_loop_run(loop, 1) == ESP_OK);
+    CHECK(s_dispatched == std::vector<int>({-1, -1, 2}));
+
+    CHECK(esp_event_loop_delete(loop) == ESP_OK);
+}
+
+TEST_CASE("posted event data is copied, whether it fits in a preallocated block or not")
+{
+    FakeQueue queue;
+    esp_event_loop_handle_t loop = create_loop_without_task();
+    std::vector<uint8_t> sent, received;
+
+    REQUIRE(esp_event_handler_register_with(loop, s_test_base1, ESP_EVENT_ANY_ID, data_handler, &received) == ESP_OK);
+
+    // The event id is the size of the data, more events than there are preallocated blocks
+    for (int i = 0; i < 24; i++) {
+        std::vector<uint8_t> data(i % 3 == 0 ? 300 : 4 + i);
+        for (size_t j = 0; j < data.size(); j++) {
+            data[j] = i + j;
+        }
+        CHECK(esp_event_post_to(loop, s_test_base1, data.size(), data.data(), data.size(), portMAX_DELAY) == ESP_OK);
+        sent.insert(sent.end(), data.begin(), data.end());
+        std::fill(data.begin(), data.end(), 0);
+    }
+    CHECK(esp_event_loop_run(loop, 1) == ESP_OK);
+    CHECK(received == sent);
+
+    // Events left in the queue when the loop is deleted are freed
+    CHECK(esp_event_post_to(loop, s_test_base1, 4, sent.data(), 4, portMAX_DELAY) == ESP_OK);
+    CHECK(esp_event_post_to(loop, s_test_base1, 300, sent.data(), 300, portMAX_DELAY) == ESP_OK);
+    CHECK(esp_event_loop_delete(loop) == ESP_OK);
+}
+
+// Benchmark, run it explicitly by its name
+TEST_CASE("event throughput of a loop with many handlers", "[.]")
+{
+    FakeQueue queue;
+    esp_event_loop_handle_t loop = create_loop_without_task();
+    static const char bases[8][4] = { "B0", "B1", "B2", "B3", "B4", "B5", "B6", "B7" };
+    s_handled = 0;
+
+    REQUIRE(esp_event_handler_register_with(loop, ESP_EVENT_ANY_BASE, ESP_EVENT_ANY_ID, count_handler, nullptr) == ESP_OK);
+    for (int base = 0; base < 8; base++) {
+        REQUIRE(esp_event_handler_register_with(loop, bases[base], ESP_EVENT_ANY_ID, count_handler, nullptr) == ESP_OK);
+        for (int id = 0; id < 16; id++) {
+            REQUIRE(esp_event_handler_register_with(loop, bases[base], id, count_handler, nullptr) == ESP_OK);
+        }
+    }
+
+    const int events = 1000000;
+    const size_t sizes[] = { 0, 4, 20, 44 };
+    uint8_t data[44] = { };
+    int posted = 0;
+    int expected = 0;
+    auto start = std::chrono::steady_clock::now();
+    uint32_t random = 1;
+    for (int i = 0; i < events; i++) {
+        // Events in random order, some without id level handlers, data of the sizes of typical Wi-Fi and IP events
+        random = random * 1103515245 + 12345;
+        int id = (random >> 16) % 20;
+        size_t size = sizes[i % 4];
+        posted += esp_event_post_to(loop, bases[(random >> 8) % 8], id, size ? data : nullptr, size, portMAX_DELAY) == ESP_OK;
+        expected += id < 16 ? 3 : 2;
+        if (i % 8 == 7) {
+            esp_event_loop_run(loop, 1);
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    printf("%d events in %.3f s, %.0f events/s\n", events, elapsed.count(), events / elapsed.count());
+
+    CHECK(posted == events);
+    CHECK(s_handled == expected);
+
+    CHECK(esp_event_loop_delete(loop) == ESP_OK);
+}
+
+TEST_CASE("loop with several tasks executes the events with the same id in one task, in order")
+{
+    FakeQueue queue;
+    FakeTasks tasks;
+    esp_event_loop_handle_t loop = nullptr;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_count = 4;
+    REQUIRE(esp_event_loop_create(&loop_args, &loop) == ESP_OK);
+
+    // Each task has its own queue and is pinned to the core after the previous task's
+    CHECK(tasks.state().created.size() == 4);
+    CHECK(queue.state().queues.size() == 4);
+    for (int i = 0; i < 4; i++) {
+        CHECK(tasks.state().core_ids[i] == i % portNUM_PROCESSORS);
+    }
+
+    REQUIRE(esp_event_handler_register_with(loop, s_test_base1, ESP_EVENT_ANY_ID, task_record_handler, nullptr) == ESP_OK);
+    s_executed.clear();
+
+    for (int seq = 0; seq < 4; seq++) {
+        for (int id = 0; id < 8; id++) {
+            CHECK(esp_event_post_to(loop, s_test_base1, id, &seq, sizeof(seq), portMAX_DELAY) == ESP_OK);
+        }
+    }
+
+    int used_queues = 0;
+    for (int i = 0; i < 4; i++) {
+        used_queues += queue.count(i) > 0;
+    }
+    CHECK(used_queues > 1);
+
+    for (int i = 0; i < 4; i++) {
+        FakeQueue::receive_from(i);
+        s_running_task = i;
+        CHECK(esp_event_loop_run(loop, 1) == ESP_OK);
+    }
+
+    REQUIRE(s_executed.size() == 32);
+    std::map<int, int> task_of_id, next_seq;
+    for (const std::array<int, 3> &executed : s_executed) {
+        int task = executed[0], id = executed[1], seq = executed[2];
+        if (task_of_id.count(id) == 0) {
+            task_of_id[id] = task;
+        }
+        CHECK(task_of_id[id] == task);
+        CHECK(next_seq[id]++ == seq);
+    }
+
+    CHECK(esp_event_loop_delete(loop) == ESP_OK);
+    CHECK(tasks.state().deleted == tasks.state().created);
+}
+
+TEST_CASE("loop with several tasks not pinned to a core")
+{
+    FakeQueue queue;
+    FakeTasks tasks;
+    esp_event_loop_handle_t loop = nullptr;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_count = 3;
+    loop_args.task_core_id = tskNO_AFFINITY;
+    REQUIRE(esp_event_loop_create(&loop_args, &loop) == ESP_OK);
+
+    CHECK(tasks.state().core_ids == std::vector<BaseType_t>(3, tskNO_AFFINITY));
+
+    CHECK(esp_event_loop_delete(loop) == ESP_OK);
+}
+
+TEST_CASE("tasks already created are deleted when creating a loop with several tasks fails")
+{
+    FakeQueue queue;
+    FakeTasks tasks(2);
+    esp_event_loop_handle_t loop = nullptr;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+    loop_args.task_count = 4;
+
+    CHECK(esp_event_loop_create(&loop_args, &loop) == ESP_FAIL);
+    CHECK(tasks.state().created.size() == 2);
+    CHECK(tasks.state().deleted == tasks.state().created);
+}
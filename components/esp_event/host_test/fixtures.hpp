@@ -7,6 +7,8 @@
    CONDITIONS OF ANY KIND, either express or implied.
 */
 
+#include <cstring>
+#include <vector>
 #include "esp_event.h"
 
 #include "catch.hpp"
@@ -146,3 +148,164 @@ struct MockTask : public CMockFix {
 
     TaskHandle_t task;
 };
+
+/**
+ * Replaces the mocked queue of an event loop with a working queue, so that events can be posted to a loop
+ * without dedicated task and run from the test. The mutex, semaphore and task functions used by the loop are ignored.
+ *
+ * A loop with several tasks has a queue for each task, esp_event_loop_run() receives the events from the queue
+ * selected with receive_from(), as if the loop was run by that task.
+ */
+struct FakeQueue : public CMockFix {
+    FakeQueue()
+    {
+        state() = State();
+        xQueueGenericCreate_StubWithCallback(create);
+        xQueueGenericSend_StubWithCallback(send);
+        xQueueReceive_StubWithCallback(receive);
+        vQueueDelete_Ignore();
+        xQueueCreateMutex_IgnoreAndReturn(reinterpret_cast<QueueHandle_t>(0xdeadbeef));
+        xQueueCreateCountingSemaphore_IgnoreAndReturn(reinterpret_cast<QueueHandle_t>(0xdeadbeef));
+        xQueueTakeMutexRecursive_IgnoreAndReturn(pdTRUE);
+        xQueueGiveMutexRecursive_IgnoreAndReturn(pdTRUE);
+        xTaskGetCurrentTaskHandle_IgnoreAndReturn(reinterpret_cast<TaskHandle_t>(1));
+        xTaskGetTickCount_IgnoreAndReturn(0);
+    }
+
+    ~FakeQueue()
+    {
+        xQueueGenericCreate_StubWithCallback(nullptr);
+        xQueueGenericSend_StubWithCallback(nullptr);
+        xQueueReceive_StubWithCallback(nullptr);
+        vQueueDelete_StopIgnore();
+        xQueueCreateMutex_StopIgnore();
+        xQueueCreateCountingSemaphore_StopIgnore();
+        xQueueTakeMutexRecursive_StopIgnore();
+        xQueueGiveMutexRecursive_StopIgnore();
+        xTaskGetCurrentTaskHandle_StopIgnore();
+        xTaskGetTickCount_StopIgnore();
+    }
+
+    struct Queue {
+        std::vector<uint8_t> items;
+        size_t length;
+        size_t item_size;
+        size_t head;
+        size_t count;
+    };
+
+    struct State {
+        std::vector<Queue> queues;
+        QueueHandle_t receive_from;
+    };
+
+    static State &state()
+    {
+        static State s_state;
+        return s_state;
+    }
+
+    static Queue &queue_of(QueueHandle_t handle)
+    {
+        return state().queues.at(reinterpret_cast<uintptr_t>(handle) - 1);
+    }
+
+    /**
+     * Selects the queue of the n-th queue created, for the task of a loop with several tasks.
+     */
+    static void receive_from(size_t n)
+    {
+        state().receive_from = reinterpret_cast<QueueHandle_t>(n + 1);
+    }
+
+    static size_t count(size_t n)
+    {
+        return state().queues.at(n).count;
+    }
+
+    static QueueHandle_t create(const UBaseType_t length, const UBaseType_t size, const uint8_t type, int cmock_num_calls)
+    {
+        Queue queue;
+        queue.items.assign(length * size, 0);
+        queue.length = length;
+        queue.item_size = size;
+        queue.head = 0;
+        queue.count = 0;
+        state().queues.push_back(queue);
+        return reinterpret_cast<QueueHandle_t>(state().queues.size());
+    }
+
+    static BaseType_t send(QueueHandle_t handle, const void * const item, TickType_t ticks, const BaseType_t position, int cmock_num_calls)
+    {
+        Queue &queue = queue_of(handle);
+        if (queue.count == queue.length) {
+            return pdFALSE;
+        }
+        memcpy(&queue.items[((queue.head + queue.count) % queue.length) * queue.item_size], item, queue.item_size);
+        queue.count++;
+        return pdTRUE;
+    }
+
+    static BaseType_t receive(QueueHandle_t handle, void * const item, TickType_t ticks, int cmock_num_calls)
+    {
+        Queue &queue = queue_of(state().receive_from != nullptr ? state().receive_from : handle);
+        if (queue.count == 0) {
+            return pdFALSE;
+        }
+        memcpy(item, &queue.items[queue.head * queue.item_size], queue.item_size);
+        queue.head = (queue.head + 1) % queue.length;
+        queue.count--;
+        return pdTRUE;
+    }
+};
+
+/**
+ * Replaces the mocked task functions with fakes recording the tasks created and deleted by an event loop. The tasks
+ * are never run.
+ */
+struct FakeTasks : public CMockFix {
+    FakeTasks(int fail_at = -1)
+    {
+        state() = State();
+        state().fail_at = fail_at;
+        xTaskCreatePinnedToCore_StubWithCallback(create);
+        vTaskDelete_StubWithCallback(remove);
+    }
+
+    ~FakeTasks()
+    {
+        xTaskCreatePinnedToCore_StubWithCallback(nullptr);
+        vTaskDelete_StubWithCallback(nullptr);
+    }
+
+    struct State {
+        int calls;
+        int fail_at;
+        std::vector<BaseType_t> core_ids;
+        std::vector<TaskHandle_t> created;
+        std::vector<TaskHandle_t> deleted;
+    };
+
+    static State &state()
+    {
+        static State s_state;
+        return s_state;
+    }
+
+    static BaseType_t create(TaskFunction_t function, const char * const name, const uint32_t stack_size, void * const arg,
+            UBaseType_t priority, TaskHandle_t * const task, const BaseType_t core_id, int cmock_num_calls)
+    {
+        if (state().calls++ == state().fail_at) {
+            return pdFAIL;
+        }
+        *task = reinterpret_cast<TaskHandle_t>(0x100 + state().calls);
+        state().core_ids.push_back(core_id);
+        state().created.push_back(*task);
+        return pdPASS;
+    }
+
+    static void remove(TaskHandle_t task, int cmock_num_calls)
+    {
+        state().deleted.push_back(task);
+    }
+};
@@ -32,7 +32,10 @@
 extern "C" {
 #endif
 
-/// Configuration for creating event loops
+/// Maximum number of tasks of an event loop, see esp_event_loop_args_t::task_count
+#define ESP_EVENT_LOOP_TASKS_MAX    (portNUM_PROCESSORS * 4)
+
+/// Configuration for creating event loops, fields not set must be zero, e.g. by initializing the structure with {}
 typedef struct {
     int32_t queue_size;                         /**< size of the event loop queue */
     const char *task_name;                      /**< name of the event loop task; if NULL,
@@ -41,17 +44,25 @@ typedef struct {
     uint32_t task_stack_size;                   /**< stack size of the event loop task, ignored if task name is NULL */
     BaseType_t task_core_id;                    /**< core to which the event loop task is pinned to,
                                                         ignored if task name is NULL */
+    uint32_t task_count;                        /**< number of event loop tasks, 0 is the same as 1, at most
+                                                        ESP_EVENT_LOOP_TASKS_MAX; ignored if task name is NULL.
+                                                        Each task is pinned to the core after the previous task's,
+                                                        unless task_core_id is tskNO_AFFINITY */
 } esp_event_loop_args_t;
 
 /**
  * @brief Create a new event loop.
  *
+ * An event loop with several tasks executes the handlers of different events in parallel. Events with the same base
+ * and id are always executed by the same task, in the order they are posted, so the handlers of an event are
+ * executed in the order they are registered, as in a loop with a single task.
+ *
  * @param[in] event_loop_args configuration structure for the event loop to create
  * @param[out] event_loop handle to the created event loop
  *
  * @return
  *  - ESP_OK: Success
- *  - ESP_ERR_INVALID_ARG: event_loop_args or event_loop was NULL
+ *  - ESP_ERR_INVALID_ARG: event_loop_args or event_loop was NULL, or task_count is greater than ESP_EVENT_LOOP_TASKS_MAX
  *  - ESP_ERR_NO_MEM: Cannot allocate memory for event loops list
  *  - ESP_FAIL: Failed to create task loop
  *  - Others: Fail
@@ -500,12 +511,13 @@ esp_err_t esp_event_isr_post_to(esp_event_loop_handle_t event_loop,
            total_dropped - number of events unsuccessfully posted due to queue being full
 
    handler
-       format: address ev:base,id inv:total_invoked run:total_runtime
+       format: address ev:base,id inv:total_invoked run:total_runtime max:max_runtime
        where:
            address - address of the handler function
            base,id - the event specified by event base and id this handler executes
            total_invoked - number of times this handler has been invoked
            total_runtime - total amount of time used for invoking this handler
+           max_runtime - longest time used for a single invocation of this handler
 
  @endverbatim
  *
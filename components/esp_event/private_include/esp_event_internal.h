@@ -37,8 +37,12 @@ typedef struct esp_event_handler_node {
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     uint32_t invoked;                                               /**< number of times this handler has been invoked */
     int64_t time;                                                   /**< total runtime of this handler across all calls */
+    int64_t max_time;                                               /**< longest runtime of this handler in a single call */
 #endif
     SLIST_ENTRY(esp_event_handler_node) next;                   /**< next event handler in the list */
+    SLIST_ENTRY(esp_event_handler_node) removed_next;           /**< next handler unregistered while its handlers were
+                                                                        executed, the next link is kept for tasks walking
+                                                                        the list */
 } esp_event_handler_node_t;
 
 typedef SLIST_HEAD(esp_event_handler_instances, esp_event_handler_node) esp_event_handler_nodes_t;
@@ -73,22 +77,75 @@ typedef struct esp_event_loop_node {
 
 typedef SLIST_HEAD(esp_event_loop_nodes, esp_event_loop_node) esp_event_loop_nodes_t;
 
+/// Handlers executed for an event, in the order they are executed
+typedef struct esp_event_dispatch_entry {
+    esp_event_base_t base;                                          /**< base of the event, NULL for an unused entry */
+    int32_t id;                                                     /**< id of the event, ESP_EVENT_ANY_ID for events of
+                                                                            the base without id level handlers */
+    uint16_t first;                                                 /**< index of the first handler in the table's handlers */
+    uint16_t count;                                                 /**< number of handlers */
+} esp_event_dispatch_entry_t;
+
+/// Handlers of the loop indexed by event, built from the linked lists after registrations change
+typedef struct esp_event_dispatch_table {
+    uint32_t mask;                                                  /**< number of entries minus one, entries is a power of two */
+    uint16_t loop_count;                                            /**< number of loop level handlers, first in handlers, for
+                                                                            events of a base without handlers */
+    uint32_t dispatching;                                           /**< number of tasks executing handlers of the table */
+    esp_event_handler_nodes_t removed_handlers;                     /**< handlers unregistered while this was the loop's table,
+                                                                            freed with it */
+    esp_event_handler_node_t** handlers;                            /**< handlers of all entries */
+    STAILQ_ENTRY(esp_event_dispatch_table) next;                    /**< next newer table replaced while tasks executed
+                                                                            its handlers */
+    esp_event_dispatch_entry_t entries[];                           /**< hash table of (base, id), with linear probing */
+} esp_event_dispatch_table_t;
+
+typedef STAILQ_HEAD(esp_event_dispatch_tables, esp_event_dispatch_table) esp_event_dispatch_tables_t;
+
+/// Task of an event loop with several tasks, executes the events posted to its own queue
+typedef struct esp_event_loop_worker {
+    struct esp_event_loop_instance* loop;                           /**< event loop of the task */
+    QueueHandle_t queue;                                            /**< queue of the events executed by the task */
+    TaskHandle_t task;                                              /**< task that consumes the queue */
+    uint32_t dispatches;                                            /**< incremented when the task starts and finishes executing
+                                                                            the handlers of an event, odd while executing them */
+} esp_event_loop_worker_t;
+
 /// Event loop
 typedef struct esp_event_loop_instance {
     const char* name;                                               /**< name of this event loop */
-    QueueHandle_t queue;                                            /**< event queue */
+    QueueHandle_t queue;                                            /**< event queue, of the first task for a loop with several tasks */
     TaskHandle_t task;                                              /**< task that consumes the event queue */
+    uint32_t worker_count;                                          /**< number of tasks of a loop with several tasks */
+    esp_event_loop_worker_t* workers;                               /**< tasks of a loop with several tasks, NULL otherwise */
     TaskHandle_t running_task;                                      /**< for loops with no dedicated task, the
                                                                             task that consumes the queue */
     SemaphoreHandle_t mutex;                                        /**< mutex for updating the events linked list */
     esp_event_loop_nodes_t loop_nodes;                              /**< set of linked lists containing the
                                                                             registered handlers for the loop */
+    esp_event_dispatch_table_t* dispatch_table;                     /**< registered handlers indexed by event */
+    bool dispatch_table_stale;                                      /**< registered handlers changed since the table was built */
+    uint32_t list_dispatching;                                      /**< number of tasks executing handlers found by walking
+                                                                            the lists, without a table */
+    esp_event_handler_nodes_t removed_handlers;                     /**< handlers unregistered while the loop had no table,
+                                                                            freed once no task walks the lists */
+    esp_event_dispatch_tables_t retired_tables;                     /**< tables replaced while tasks executed their handlers,
+                                                                            oldest first */
+    SemaphoreHandle_t dispatch_done;                                /**< given to each waiting task when a task of a loop
+                                                                            with several tasks finishes executing an event */
+    uint32_t dispatch_waiters;                                      /**< number of tasks waiting for dispatch_done */
+#if CONFIG_ESP_EVENT_POST_DATA_POOL_SIZE > 0
+    atomic_uint_least32_t data_pool_free;                           /**< bitmap of the unused blocks of data_pool */
+#endif
 #ifdef CONFIG_ESP_EVENT_LOOP_PROFILING
     atomic_uint_least32_t events_recieved;                          /**< number of events successfully posted to the loop */
     atomic_uint_least32_t events_dropped;                           /**< number of events dropped due to queue being full */
     SemaphoreHandle_t profiling_mutex;                              /**< mutex used for profiliing */
     SLIST_ENTRY(esp_event_loop_instance) next;                      /**< next event loop in the list */
 #endif
+#if CONFIG_ESP_EVENT_POST_DATA_POOL_SIZE > 0
+    uint8_t data_pool[] __attribute__((aligned(4)));                /**< blocks for copies of small event data */
+#endif
 } esp_event_loop_instance_t;
 
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
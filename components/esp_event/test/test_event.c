@@ -158,6 +158,11 @@ static void test_event_ordered_dispatch(void* event_handler_arg, esp_event_base_
     data->arr[data->index++] = *arg;
 }
 
+static void test_event_wait_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
+{
+    xSemaphoreTake((SemaphoreHandle_t) event_handler_arg, portMAX_DELAY);
+}
+
 static void test_event_performance_handler(void* event_handler_arg, esp_event_base_t event_base, int32_t event_id, void* event_data)
 {
     performance_data_t* data = (performance_data_t*) event_handler_arg;
@@ -1932,6 +1937,71 @@ TEST_CASE("events are dispatched in the order they are registered", "[event]")
     TEST_TEARDOWN();
 }
 
+TEST_CASE("loop with several tasks executes other events while a handler blocks", "[event]")
+{
+    TEST_SETUP();
+
+    esp_event_loop_handle_t loop;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+
+    loop_args.task_count = 2;
+    TEST_ESP_OK(esp_event_loop_create(&loop_args, &loop));
+
+    SemaphoreHandle_t blocked = xSemaphoreCreateBinary();
+    int count = 0;
+
+    simple_arg_t arg = {
+        .data = &count,
+        .mutex = xSemaphoreCreateMutex()
+    };
+
+    TEST_ESP_OK(esp_event_handler_register_with(loop, s_test_base1, TEST_EVENT_BASE1_EV1, test_event_wait_handler, blocked));
+    TEST_ESP_OK(esp_event_handler_register_with(loop, s_test_base2, ESP_EVENT_ANY_ID, test_event_simple_handler, &arg));
+
+    // The task executing the first event blocks, the events executed by the other task still are
+    TEST_ESP_OK(esp_event_post_to(loop, s_test_base1, TEST_EVENT_BASE1_EV1, NULL, 0, portMAX_DELAY));
+    for (int id = 0; id < 16; id++) {
+        TEST_ESP_OK(esp_event_post_to(loop, s_test_base2, id, NULL, 0, portMAX_DELAY));
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(10));
+
+    xSemaphoreTake(arg.mutex, portMAX_DELAY);
+    TEST_ASSERT_GREATER_THAN(0, count);
+    xSemaphoreGive(arg.mutex);
+
+    xSemaphoreGive(blocked);
+    vTaskDelay(pdMS_TO_TICKS(10));
+
+    xSemaphoreTake(arg.mutex, portMAX_DELAY);
+    TEST_ASSERT_EQUAL(16, count);
+    xSemaphoreGive(arg.mutex);
+
+    TEST_ESP_OK(esp_event_loop_delete(loop));
+
+    vSemaphoreDelete(blocked);
+    vSemaphoreDelete(arg.mutex);
+
+    TEST_TEARDOWN();
+}
+
+TEST_CASE("can't create a loop with too many tasks", "[event]")
+{
+    TEST_SETUP();
+
+    esp_event_loop_handle_t loop;
+    esp_event_loop_args_t loop_args = test_event_get_default_loop_args();
+
+    loop_args.task_count = ESP_EVENT_LOOP_TASKS_MAX + 1;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, esp_event_loop_create(&loop_args, &loop));
+
+    loop_args.task_count = ESP_EVENT_LOOP_TASKS_MAX;
+    TEST_ESP_OK(esp_event_loop_create(&loop_args, &loop));
+    TEST_ESP_OK(esp_event_loop_delete(loop));
+
+    TEST_TEARDOWN();
+}
+
 #if CONFIG_ESP_EVENT_POST_FROM_ISR
 TEST_CASE("can properly prepare event data posted to loop", "[event]")
 {
@@ -15,6 +15,7 @@
 #include "esp_transport_tcp.h"
 #include "http_utils.h"
 #include "http_auth.h"
+#include "http_pool.h"
 #include "sdkconfig.h"
 #include "esp_http_client.h"
 #include "errno.h"
@@ -115,6 +116,14 @@ struct esp_http_client {
     bool                        is_async;
     esp_transport_keep_alive_t  keep_alive_cfg;
     struct ifreq                *if_name;
+    http_pool_tls_cfg_t         tls_cfg;
+    bool                        conn_reused;
+    char                        *conn_scheme;   /* Origin of the connection, connection_info changes with the URL */
+    char                        *conn_host;
+    int                         conn_port;
+    bool                        is_pipelining;
+    char                        *pipeline_pending;      /* Received bytes which belong to the next pipelined response */
+    int                         pipeline_pending_len;
 };
 
 typedef struct esp_http_client esp_http_client_t;
@@ -139,6 +148,7 @@ static const int DEFAULT_TIMEOUT_MS = 5000;
 static const int DEFAULT_KEEP_ALIVE_IDLE = 5;
 static const int DEFAULT_KEEP_ALIVE_INTERVAL= 5;
 static const int DEFAULT_KEEP_ALIVE_COUNT= 3;
+static const int DEFAULT_PIPELINE_RETRIES = 3;
 
 static const char *HTTP_METHOD_MAPPING[] = {
     "GET",
@@ -275,6 +285,10 @@ static int http_on_message_complete(http_parser *parser)
     ESP_LOGD(TAG, "http_on_message_complete, parser=%x", (int)parser);
     esp_http_client_handle_t client = parser->data;
     client->is_chunk_complete = true;
+    if (client->is_pipelining) {
+        /* Stop at the end of the response, the rest of the data belongs to the next one */
+        http_parser_pause(parser, 1);
+    }
     return 0;
 }
 
@@ -535,33 +549,28 @@ static char *_get_host_header(char *host, int port)
     return host_name;
 }
 
-esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+static void _set_transport_options(esp_http_client_handle_t client)
 {
+    esp_transport_handle_t tcp = esp_transport_list_get_transport(client->transport_list, "http");
+    esp_transport_tcp_set_keep_alive(tcp, client->keep_alive_cfg.keep_alive_enable ? &client->keep_alive_cfg : NULL);
+    esp_transport_tcp_set_interface_name(tcp, client->if_name);
+}
 
-    esp_http_client_handle_t client;
-    esp_transport_handle_t tcp = NULL;
-    char *host_name;
-    bool _success;
-
-    _success = (
-                   (client                         = calloc(1, sizeof(esp_http_client_t)))           &&
-                   (client->parser                 = calloc(1, sizeof(struct http_parser)))          &&
-                   (client->parser_settings        = calloc(1, sizeof(struct http_parser_settings))) &&
-                   (client->auth_data              = calloc(1, sizeof(esp_http_auth_data_t)))        &&
-                   (client->request                = calloc(1, sizeof(esp_http_data_t)))             &&
-                   (client->request->headers       = http_header_init())                             &&
-                   (client->request->buffer        = calloc(1, sizeof(esp_http_buffer_t)))           &&
-                   (client->response               = calloc(1, sizeof(esp_http_data_t)))             &&
-                   (client->response->headers      = http_header_init())                             &&
-                   (client->response->buffer       = calloc(1, sizeof(esp_http_buffer_t)))
-               );
-
-    if (!_success) {
-        ESP_LOGE(TAG, "Error allocate memory");
-        goto error;
-    }
+#ifdef CONFIG_ESP_HTTP_CLIENT_ENABLE_CONNECTION_POOL
+static void _get_pool_key(esp_http_client_handle_t client, const char *scheme, const char *host, int port, http_pool_key_t *key)
+{
+    key->scheme = scheme;
+    key->host = host;
+    key->port = port;
+    key->if_name = client->if_name;
+    key->tls = &client->tls_cfg;
+}
+#endif
 
-    _success = (
+static esp_err_t _init_transport_list(esp_http_client_handle_t client)
+{
+    esp_transport_handle_t tcp = NULL;
+    bool _success = (
                    (client->transport_list = esp_transport_list_init()) &&
                    (tcp = esp_transport_tcp_init()) &&
                    (esp_transport_set_default_port(tcp, DEFAULT_HTTP_PORT) == ESP_OK) &&
@@ -569,25 +578,12 @@ esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *co
                );
     if (!_success) {
         ESP_LOGE(TAG, "Error initialize transport");
-        goto error;
-    }
-
-    if (config->keep_alive_enable == true) {
-        client->keep_alive_cfg.keep_alive_enable = true;
-        client->keep_alive_cfg.keep_alive_idle = (config->keep_alive_idle == 0) ? DEFAULT_KEEP_ALIVE_IDLE : config->keep_alive_idle;
-        client->keep_alive_cfg.keep_alive_interval = (config->keep_alive_interval == 0) ? DEFAULT_KEEP_ALIVE_INTERVAL : config->keep_alive_interval;
-        client->keep_alive_cfg.keep_alive_count =  (config->keep_alive_count == 0) ? DEFAULT_KEEP_ALIVE_COUNT : config->keep_alive_count;
-        esp_transport_tcp_set_keep_alive(tcp, &client->keep_alive_cfg);
-    }
-
-    if (config->if_name) {
-        client->if_name = calloc(1, sizeof(struct ifreq) + 1);
-        HTTP_MEM_CHECK(TAG, client->if_name, goto error);
-        memcpy(client->if_name, config->if_name, sizeof(struct ifreq));
-        esp_transport_tcp_set_interface_name(tcp, client->if_name);
+        return ESP_FAIL;
     }
+    _set_transport_options(client);
 
 #ifdef CONFIG_ESP_HTTP_CLIENT_ENABLE_HTTPS
+    const http_pool_tls_cfg_t *tls_cfg = &client->tls_cfg;
     esp_transport_handle_t ssl = NULL;
     _success = (
                    (ssl = esp_transport_ssl_init()) &&
@@ -597,45 +593,99 @@ esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *co
 
     if (!_success) {
         ESP_LOGE(TAG, "Error initialize SSL Transport");
-        goto error;
+        return ESP_FAIL;
     }
 
-    if (config->crt_bundle_attach != NULL) {
+    if (tls_cfg->crt_bundle_attach != NULL) {
 #ifdef CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
-        esp_transport_ssl_crt_bundle_attach(ssl, config->crt_bundle_attach);
+        esp_transport_ssl_crt_bundle_attach(ssl, tls_cfg->crt_bundle_attach);
 #else //CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
         ESP_LOGE(TAG, "use_crt_bundle configured but not enabled in menuconfig: Please enable MBEDTLS_CERTIFICATE_BUNDLE option");
 #endif
-    } else if (config->use_global_ca_store == true) {
+    } else if (tls_cfg->use_global_ca_store == true) {
         esp_transport_ssl_enable_global_ca_store(ssl);
-    } else if (config->cert_pem) {
-        if (!config->cert_len) {
-            esp_transport_ssl_set_cert_data(ssl, config->cert_pem, strlen(config->cert_pem));
+    } else if (tls_cfg->cert_pem) {
+        if (!tls_cfg->cert_len) {
+            esp_transport_ssl_set_cert_data(ssl, tls_cfg->cert_pem, strlen(tls_cfg->cert_pem));
         } else {
-            esp_transport_ssl_set_cert_data_der(ssl, config->cert_pem, config->cert_len);
+            esp_transport_ssl_set_cert_data_der(ssl, tls_cfg->cert_pem, tls_cfg->cert_len);
         }
     }
 
-    if (config->client_cert_pem) {
-        if (!config->client_cert_len) {
-            esp_transport_ssl_set_client_cert_data(ssl, config->client_cert_pem, strlen(config->client_cert_pem));
+    if (tls_cfg->client_cert_pem) {
+        if (!tls_cfg->client_cert_len) {
+            esp_transport_ssl_set_client_cert_data(ssl, tls_cfg->client_cert_pem, strlen(tls_cfg->client_cert_pem));
         } else {
-            esp_transport_ssl_set_client_cert_data_der(ssl, config->client_cert_pem, config->client_cert_len);
+            esp_transport_ssl_set_client_cert_data_der(ssl, tls_cfg->client_cert_pem, tls_cfg->client_cert_len);
         }
     }
 
-    if (config->client_key_pem) {
-        if (!config->client_key_len) {
-            esp_transport_ssl_set_client_key_data(ssl, config->client_key_pem, strlen(config->client_key_pem));
+    if (tls_cfg->client_key_pem) {
+        if (!tls_cfg->client_key_len) {
+            esp_transport_ssl_set_client_key_data(ssl, tls_cfg->client_key_pem, strlen(tls_cfg->client_key_pem));
         } else {
-            esp_transport_ssl_set_client_key_data_der(ssl, config->client_key_pem, config->client_key_len);
+            esp_transport_ssl_set_client_key_data_der(ssl, tls_cfg->client_key_pem, tls_cfg->client_key_len);
         }
     }
 
-    if (config->skip_cert_common_name_check) {
+    if (tls_cfg->skip_cert_common_name_check) {
         esp_transport_ssl_skip_common_name_check(ssl);
     }
 #endif
+    return ESP_OK;
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+
+    esp_http_client_handle_t client;
+    char *host_name;
+    bool _success;
+
+    _success = (
+                   (client                         = calloc(1, sizeof(esp_http_client_t)))           &&
+                   (client->parser                 = calloc(1, sizeof(struct http_parser)))          &&
+                   (client->parser_settings        = calloc(1, sizeof(struct http_parser_settings))) &&
+                   (client->auth_data              = calloc(1, sizeof(esp_http_auth_data_t)))        &&
+                   (client->request                = calloc(1, sizeof(esp_http_data_t)))             &&
+                   (client->request->headers       = http_header_init())                             &&
+                   (client->request->buffer        = calloc(1, sizeof(esp_http_buffer_t)))           &&
+                   (client->response               = calloc(1, sizeof(esp_http_data_t)))             &&
+                   (client->response->headers      = http_header_init())                             &&
+                   (client->response->buffer       = calloc(1, sizeof(esp_http_buffer_t)))
+               );
+
+    if (!_success) {
+        ESP_LOGE(TAG, "Error allocate memory");
+        goto error;
+    }
+
+    if (config->keep_alive_enable == true) {
+        client->keep_alive_cfg.keep_alive_enable = true;
+        client->keep_alive_cfg.keep_alive_idle = (config->keep_alive_idle == 0) ? DEFAULT_KEEP_ALIVE_IDLE : config->keep_alive_idle;
+        client->keep_alive_cfg.keep_alive_interval = (config->keep_alive_interval == 0) ? DEFAULT_KEEP_ALIVE_INTERVAL : config->keep_alive_interval;
+        client->keep_alive_cfg.keep_alive_count =  (config->keep_alive_count == 0) ? DEFAULT_KEEP_ALIVE_COUNT : config->keep_alive_count;
+    }
+
+    if (config->if_name) {
+        client->if_name = calloc(1, sizeof(struct ifreq) + 1);
+        HTTP_MEM_CHECK(TAG, client->if_name, goto error);
+        memcpy(client->if_name, config->if_name, sizeof(struct ifreq));
+    }
+
+    client->tls_cfg.cert_pem = config->cert_pem;
+    client->tls_cfg.cert_len = config->cert_len;
+    client->tls_cfg.client_cert_pem = config->client_cert_pem;
+    client->tls_cfg.client_cert_len = config->client_cert_len;
+    client->tls_cfg.client_key_pem = config->client_key_pem;
+    client->tls_cfg.client_key_len = config->client_key_len;
+    client->tls_cfg.crt_bundle_attach = config->crt_bundle_attach;
+    client->tls_cfg.use_global_ca_store = config->use_global_ca_store;
+    client->tls_cfg.skip_cert_common_name_check = config->skip_cert_common_name_check;
+
+    if (_init_transport_list(client) != ESP_OK) {
+        goto error;
+    }
 
     if (_set_config(client, config) != ESP_OK) {
         ESP_LOGE(TAG, "Error set configurations");
@@ -720,7 +770,9 @@ esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
         return ESP_FAIL;
     }
     esp_http_client_close(client);
-    esp_transport_list_destroy(client->transport_list);
+    if (client->transport_list) {
+        esp_transport_list_destroy(client->transport_list);
+    }
     if (client->request) {
         http_header_destroy(client->request->headers);
         if (client->request->buffer) {
@@ -748,6 +800,8 @@ esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
     free(client->current_header_key);
     free(client->location);
     free(client->auth_header);
+    free(client->conn_scheme);
+    free(client->conn_host);
     free(client);
     return ESP_OK;
 }
@@ -1056,7 +1110,16 @@ esp_err_t esp_http_client_perform(esp_http_client_handle_t client)
                     if (client->is_async && errno == EAGAIN) {
                         return ESP_ERR_HTTP_EAGAIN;
                     }
-                    if (esp_transport_get_errno(client->transport) == ENOTCONN) {
+                    int sock_errno = esp_transport_get_errno(client->transport);
+                    if (client->conn_reused && (sock_errno == ENOTCONN || sock_errno == ECONNRESET)) {
+                        /* The server closed the pooled connection before it got the request,
+                         * send it again over a new connection */
+                        ESP_LOGD(TAG, "Pooled connection closed by server, retry");
+                        esp_http_client_close(client);
+                        client->process_again = 1;
+                        break;
+                    }
+                    if (sock_errno == ENOTCONN) {
                         ESP_LOGW(TAG, "Close connection due to FIN received");
                         esp_http_client_close(client);
                         http_dispatch_event(client, HTTP_EVENT_ERROR, esp_transport_get_error_handle(client->transport), 0);
@@ -1110,6 +1173,172 @@ esp_err_t esp_http_client_perform(esp_http_client_handle_t client)
     return ESP_OK;
 }
 
+static esp_err_t http_pipeline_send(esp_http_client_handle_t client, const esp_http_client_pipeline_req_t *req, const char *default_path)
+{
+    client->connection_info.method = req->method;
+    http_utils_assign_string(&client->connection_info.path, req->path ? req->path : default_path, -1);
+    HTTP_MEM_CHECK(TAG, client->connection_info.path, return ESP_ERR_NO_MEM);
+    client->post_data = (char *)req->data;
+    client->post_len = req->data ? req->data_len : 0;
+    client->first_line_prepared = false;
+
+    esp_err_t err = esp_http_client_request_send(client, client->post_len);
+    if (err == ESP_OK) {
+        err = esp_http_client_send_post_data(client);
+    }
+    return err;
+}
+
+/* Reads the response to the oldest request in flight */
+static esp_err_t http_pipeline_read_response(esp_http_client_handle_t client)
+{
+    esp_http_buffer_t *buffer = client->response->buffer;
+
+    client->state = HTTP_STATE_REQ_COMPLETE_DATA;
+    client->response->status_code = -1;
+    client->is_chunk_complete = false;
+    http_parser_pause(client->parser, 0);
+    while (!client->is_chunk_complete) {
+        if (client->pipeline_pending_len == 0) {
+            int rlen = esp_transport_read(client->transport, buffer->data, client->buffer_size_rx, client->timeout_ms);
+            if (rlen <= 0) {
+                if (rlen < 0 && esp_transport_get_errno(client->transport) == ENOTCONN) {
+                    /* Completes a response whose body ends with the connection */
+                    http_parser_execute(client->parser, client->parser_settings, buffer->data, 0);
+                    if (client->is_chunk_complete) {
+                        break;
+                    }
+                    return ESP_ERR_HTTP_CONNECTION_CLOSED;
+                }
+                return ESP_ERR_HTTP_FETCH_HEADER;
+            }
+            client->pipeline_pending = buffer->data;
+            client->pipeline_pending_len = rlen;
+        }
+        int parsed = http_parser_execute(client->parser, client->parser_settings,
+                                         client->pipeline_pending, client->pipeline_pending_len);
+        enum http_errno parser_errno = HTTP_PARSER_ERRNO(client->parser);
+        if (parser_errno != HPE_OK && parser_errno != HPE_PAUSED) {
+            ESP_LOGE(TAG, "Invalid pipelined response: %s", http_errno_description(parser_errno));
+            return ESP_FAIL;
+        }
+        client->pipeline_pending += parsed;
+        client->pipeline_pending_len -= parsed;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_perform_pipelined(esp_http_client_handle_t client, esp_http_client_pipeline_req_t *reqs, size_t count, size_t depth)
+{
+    if (client == NULL || (reqs == NULL && count) || depth == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (client->is_async) {
+        ESP_LOGE(TAG, "Pipelining is not supported in asynchronous mode");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (client->state > HTTP_STATE_CONNECTED) {
+        ESP_LOGE(TAG, "A request is in progress");
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (reqs[i].method == HTTP_METHOD_HEAD) {
+            ESP_LOGE(TAG, "HEAD requests can't be pipelined");
+            return ESP_ERR_INVALID_ARG;
+        }
+        reqs[i].status_code = -1;
+    }
+
+    /* The requests are sent with their own method, path and body,
+     * the settings of the client are restored afterwards */
+    esp_http_client_method_t method = client->connection_info.method;
+    char *path = client->connection_info.path;
+    char *query = client->connection_info.query;
+    char *post_data = client->post_data;
+    int post_len = client->post_len;
+    void *user_data = client->user_data;
+    char *default_path = NULL;
+    if (query) {
+        if (asprintf(&default_path, "%s?%s", path, query) == -1) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    client->connection_info.path = NULL;
+    client->connection_info.query = NULL;
+    client->is_pipelining = true;
+
+    esp_err_t err = ESP_OK;
+    size_t sent = 0, done = 0;
+    int retries = 0;
+    while (done < count) {
+        if (client->state < HTTP_STATE_CONNECTED) {
+            /* Requests without a response are sent again over the new connection */
+            sent = done;
+            client->pipeline_pending_len = 0;
+            if ((err = esp_http_client_connect(client)) != ESP_OK) {
+                http_dispatch_event(client, HTTP_EVENT_ERROR, esp_transport_get_error_handle(client->transport), 0);
+                break;
+            }
+        }
+        while (err == ESP_OK && sent < count && sent - done < depth) {
+            client->user_data = reqs[sent].user_data ? reqs[sent].user_data : user_data;
+            if ((err = http_pipeline_send(client, &reqs[sent], default_path ? default_path : path)) == ESP_OK) {
+                sent++;
+            }
+        }
+        if (err == ESP_ERR_NO_MEM) {
+            break;
+        }
+        if (err == ESP_OK) {
+            client->user_data = reqs[done].user_data ? reqs[done].user_data : user_data;
+            err = http_pipeline_read_response(client);
+        }
+        if (err == ESP_OK) {
+            reqs[done++].status_code = client->response->status_code;
+            http_dispatch_event(client, HTTP_EVENT_ON_FINISH, NULL, 0);
+            client->response->buffer->raw_len = 0;
+            client->conn_reused = false;
+            retries = 0;
+            if (!http_should_keep_alive(client->parser)) {
+                ESP_LOGD(TAG, "Server closes the connection, %d requests left", (int)(count - done));
+                esp_http_client_close(client);
+            }
+            continue;
+        }
+        if (++retries > DEFAULT_PIPELINE_RETRIES) {
+            ESP_LOGE(TAG, "Connection lost, %d requests without response", (int)(count - done));
+            http_dispatch_event(client, HTTP_EVENT_ERROR, esp_transport_get_error_handle(client->transport), 0);
+            break;
+        }
+        ESP_LOGW(TAG, "Connection lost, send %d requests again", (int)(sent - done));
+        if (client->state >= HTTP_STATE_CONNECTED) {
+            esp_http_client_close(client);
+        }
+        err = ESP_OK;
+    }
+
+    client->is_pipelining = false;
+    http_parser_pause(client->parser, 0);
+    client->user_data = user_data;
+    client->connection_info.method = method;
+    free(client->connection_info.path);
+    client->connection_info.path = path;
+    client->connection_info.query = query;
+    client->post_data = post_data;
+    client->post_len = post_len;
+    free(default_path);
+    if (client->state > HTTP_STATE_CONNECTED) {
+        /* Data received after the last response can't belong to a later request */
+        if (err == ESP_OK && client->pipeline_pending_len == 0) {
+            client->state = HTTP_STATE_CONNECTED;
+            client->first_line_prepared = false;
+        } else {
+            esp_http_client_close(client);
+        }
+    }
+    return err;
+}
+
 int esp_http_client_fetch_headers(esp_http_client_handle_t client)
 {
     if (client->state < HTTP_STATE_REQ_COMPLETE_HEADER) {
@@ -1127,6 +1356,7 @@ int esp_http_client_fetch_headers(esp_http_client_handle_t client)
         }
         http_parser_execute(client->parser, client->parser_settings, buffer->data, buffer->len);
     }
+    client->conn_reused = false;
     ESP_LOGD(TAG, "content_length = %d", client->response->content_length);
     if (client->response->content_length <= 0) {
         client->response->is_chunked = true;
@@ -1135,6 +1365,21 @@ int esp_http_client_fetch_headers(esp_http_client_handle_t client)
     return client->response->content_length;
 }
 
+#ifdef CONFIG_ESP_HTTP_CLIENT_ENABLE_CONNECTION_POOL
+static esp_err_t _set_connection_origin(esp_http_client_handle_t client)
+{
+    http_utils_assign_string(&client->conn_scheme, client->connection_info.scheme, -1);
+    http_utils_assign_string(&client->conn_host, client->connection_info.host, -1);
+    client->conn_port = client->connection_info.port;
+    if (client->conn_scheme == NULL || client->conn_host == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate memory for connection origin");
+        esp_http_client_close(client);
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+#endif
+
 static esp_err_t esp_http_client_connect(esp_http_client_handle_t client)
 {
     esp_err_t err;
@@ -1151,6 +1396,27 @@ static esp_err_t esp_http_client_connect(esp_http_client_handle_t client)
     }
 
     if (client->state < HTTP_STATE_CONNECTED) {
+#ifdef CONFIG_ESP_HTTP_CLIENT_ENABLE_CONNECTION_POOL
+        if (!client->is_async) {
+            http_pool_key_t key;
+            _get_pool_key(client, client->connection_info.scheme, client->connection_info.host, client->connection_info.port, &key);
+            esp_transport_list_handle_t pooled = http_pool_acquire(&key);
+            if (pooled) {
+                if (client->transport_list) {
+                    esp_transport_list_destroy(client->transport_list);
+                }
+                client->transport_list = pooled;
+                _set_transport_options(client);
+                client->transport = esp_transport_list_get_transport(client->transport_list, client->connection_info.scheme);
+                client->conn_reused = true;
+                client->state = HTTP_STATE_CONNECTED;
+                return _set_connection_origin(client);
+            }
+        }
+#endif
+        if (client->transport_list == NULL && _init_transport_list(client) != ESP_OK) {
+            return ESP_ERR_NO_MEM;
+        }
         ESP_LOGD(TAG, "Begin connect to: %s://%s:%d", client->connection_info.scheme, client->connection_info.host, client->connection_info.port);
         client->transport = esp_transport_list_get_transport(client->transport_list, client->connection_info.scheme);
         if (client->transport == NULL) {
@@ -1183,6 +1449,9 @@ static esp_err_t esp_http_client_connect(esp_http_client_handle_t client)
         }
         client->state = HTTP_STATE_CONNECTED;
         http_dispatch_event(client, HTTP_EVENT_ON_CONNECTED, NULL, 0);
+#ifdef CONFIG_ESP_HTTP_CLIENT_ENABLE_CONNECTION_POOL
+        return _set_connection_origin(client);
+#endif
     }
     return ESP_OK;
 }
@@ -1349,16 +1618,50 @@ int esp_http_client_write(esp_http_client_handle_t client, const char *buffer, i
     return widx;
 }
 
+#ifdef CONFIG_ESP_HTTP_CLIENT_ENABLE_CONNECTION_POOL
+/* A connection can be handed to another client if no request is in flight on it */
+static bool _is_connection_idle(esp_http_client_handle_t client)
+{
+    if (client->is_async) {
+        return false;
+    }
+    if (client->state == HTTP_STATE_CONNECTED) {
+        return !client->first_line_prepared;
+    }
+    return client->state >= HTTP_STATE_RES_COMPLETE_HEADER &&
+           esp_http_client_is_complete_data_received(client) &&
+           http_should_keep_alive(client->parser);
+}
+#endif
+
 esp_err_t esp_http_client_close(esp_http_client_handle_t client)
 {
     if (client->state >= HTTP_STATE_INIT) {
         http_dispatch_event(client, HTTP_EVENT_DISCONNECTED, esp_transport_get_error_handle(client->transport), 0);
+        client->conn_reused = false;
+#ifdef CONFIG_ESP_HTTP_CLIENT_ENABLE_CONNECTION_POOL
+        if (client->state >= HTTP_STATE_CONNECTED && client->conn_host && _is_connection_idle(client)) {
+            http_pool_key_t key;
+            _get_pool_key(client, client->conn_scheme, client->conn_host, client->conn_port, &key);
+            http_pool_release(&key, client->transport_list);
+            client->transport_list = NULL;
+            client->transport = NULL;
+            client->state = HTTP_STATE_INIT;
+            return ESP_OK;
+        }
+#endif
         client->state = HTTP_STATE_INIT;
         return esp_transport_close(client->transport);
     }
     return ESP_OK;
 }
 
+esp_err_t esp_http_client_pool_flush(void)
+{
+    http_pool_flush();
+    return ESP_OK;
+}
+
 esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client, const char *data, int len)
 {
     esp_err_t err = ESP_OK;
@@ -136,12 +136,25 @@ typedef struct {
     struct ifreq                *if_name;            /*!< The name of interface for data to go through. Use the default interface without setting */
 } esp_http_client_config_t;
 
+/**
+ * @brief Request sent by esp_http_client_perform_pipelined()
+ */
+typedef struct {
+    esp_http_client_method_t    method;         /*!< HTTP Method, HTTP_METHOD_HEAD is not supported */
+    const char                  *path;          /*!< HTTP Path, with the query if any. The path and query of the client if NULL */
+    const char                  *data;          /*!< Request body, may be NULL */
+    int                         data_len;       /*!< Length of the request body */
+    void                        *user_data;     /*!< Passed as user_data of the events of this request instead of the user_data of the client, if not NULL */
+    int                         status_code;    /*!< [out] Status code of the response, -1 if no response was received */
+} esp_http_client_pipeline_req_t;
+
 /**
  * Enum for the HTTP status codes.
  */
 typedef enum {
     /* 2xx - Success */
     HttpStatus_Ok                = 200,
+    HttpStatus_PartialContent    = 206,
 
     /* 3xx - Redirection */
     HttpStatus_MultipleChoices   = 300,
@@ -244,6 +257,35 @@ esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t client, const
  */
 int esp_http_client_get_post_field(esp_http_client_handle_t client, char **data);
 
+/**
+ * @brief      Send several requests to the server of the client without waiting for the response to the previous one
+ *             (HTTP pipelining), and receive the responses in order. Up to `depth` requests are in flight on the
+ *             connection at once, which saves a round trip per request on high latency links.
+ *             The headers of the client are sent with every request, Content-Length is set to the length of its body.
+ *             The response to each request is delivered through the HTTP_EVENT_ON_HEADER, HTTP_EVENT_ON_DATA
+ *             and HTTP_EVENT_ON_FINISH events, and its status code is stored in the request.
+ *             Redirections and authorization requests are not followed.
+ *
+ * @note       If the connection is closed before all the responses were received, the requests without a complete
+ *             response are sent again over a new connection, so the server may receive a request twice and the events of
+ *             a partially received response are repeated. The function gives up after 3 consecutive connection failures.
+ *             Servers which don't support pipelining answer the requests one at a time or close the connection after
+ *             each response, which works but is slower than esp_http_client_perform.
+ *
+ * @param[in]     client  The esp_http_client handle, not in asynchronous mode
+ * @param[inout]  reqs    The requests
+ * @param[in]     count   Number of requests
+ * @param[in]     depth   Maximum number of requests in flight, 1 sends the next request after the previous response
+ *
+ * @return
+ *     - ESP_OK if a response was received for every request
+ *     - ESP_ERR_INVALID_ARG
+ *     - ESP_ERR_INVALID_STATE if a request sent with esp_http_client_open is in progress
+ *     - ESP_ERR_NO_MEM
+ *     - Error of the connection otherwise
+ */
+esp_err_t esp_http_client_perform_pipelined(esp_http_client_handle_t client, esp_http_client_pipeline_req_t *reqs, size_t count, size_t depth);
+
 /**
  * @brief      Set http request header, this function must be called after esp_http_client_init and before any
  *             perform function
@@ -463,6 +505,11 @@ int esp_http_client_get_content_length(esp_http_client_handle_t client);
 /**
  * @brief      Close http connection, still kept all http request resources
  *
+ * @note       With CONFIG_ESP_HTTP_CLIENT_ENABLE_CONNECTION_POOL, a connection which has no request in flight
+ *             and whose response was completely received with keep-alive is not closed but kept in the
+ *             connection pool. The next client connecting to the same server with the same TLS settings
+ *             takes it over without HTTP_EVENT_ON_CONNECTED.
+ *
  * @param[in]  client  The esp_http_client handle
  *
  * @return
@@ -588,6 +635,15 @@ esp_err_t esp_http_client_get_url(esp_http_client_handle_t client, char *url, co
  */
 esp_err_t esp_http_client_get_chunk_length(esp_http_client_handle_t client, int *len);
 
+/**
+ * @brief          Close all idle connections kept in the connection pool, for instance after the network changed.
+ *                 Does nothing unless CONFIG_ESP_HTTP_CLIENT_ENABLE_CONNECTION_POOL is enabled.
+ *
+ * @return
+ *     - ESP_OK
+ */
+esp_err_t esp_http_client_pool_flush(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,218 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <sys/lock.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#include "http_pool.h"
+
+#ifdef CONFIG_ESP_HTTP_CLIENT_ENABLE_CONNECTION_POOL
+
+static const char *TAG = "HTTP_POOL";
+
+/**
+ * Idle connection
+ */
+typedef struct {
+    esp_transport_list_handle_t list;       /*!< Transports of the client which opened the connection */
+    char                        *scheme;
+    char                        *host;
+    int                         port;
+    char                        if_name[IFNAMSIZ];
+    http_pool_tls_cfg_t         tls;
+    TickType_t                  idle_since; /*!< Tick count when the connection was released */
+} http_pool_conn_t;
+
+static http_pool_conn_t s_conns[CONFIG_ESP_HTTP_CLIENT_POOL_SIZE];
+static int s_conn_count;
+static _lock_t s_pool_lock;
+
+static bool http_pool_tls_equal(const http_pool_tls_cfg_t *a, const http_pool_tls_cfg_t *b)
+{
+    return a->cert_pem == b->cert_pem && a->cert_len == b->cert_len &&
+           a->client_cert_pem == b->client_cert_pem && a->client_cert_len == b->client_cert_len &&
+           a->client_key_pem == b->client_key_pem && a->client_key_len == b->client_key_len &&
+           a->crt_bundle_attach == b->crt_bundle_attach &&
+           a->use_global_ca_store == b->use_global_ca_store &&
+           a->skip_cert_common_name_check == b->skip_cert_common_name_check;
+}
+
+static bool http_pool_match(const http_pool_conn_t *conn, const http_pool_key_t *key)
+{
+    if (conn->port != key->port ||
+            strcasecmp(conn->scheme, key->scheme) != 0 ||
+            strcasecmp(conn->host, key->host) != 0) {
+        return false;
+    }
+    if (strncmp(conn->if_name, key->if_name ? key->if_name->ifr_name : "", IFNAMSIZ) != 0) {
+        return false;
+    }
+    /* Compared for http too, the transport list ends up in the client which takes the
+     * connection and its https transport must verify servers the way the client expects */
+    return http_pool_tls_equal(&conn->tls, key->tls);
+}
+
+/* Must be called with the lock held, the list is destroyed by the caller */
+static esp_transport_list_handle_t http_pool_remove(int index)
+{
+    esp_transport_list_handle_t list = s_conns[index].list;
+    free(s_conns[index].scheme);
+    free(s_conns[index].host);
+    s_conns[index] = s_conns[--s_conn_count];
+    return list;
+}
+
+static TickType_t http_pool_idle_time(int index, TickType_t now)
+{
+    return now - s_conns[index].idle_since;
+}
+
+/* Must be called with the lock held, returns the number of lists added to stale */
+static int http_pool_expire(esp_transport_list_handle_t *stale, TickType_t now)
+{
+    const TickType_t timeout = pdMS_TO_TICKS(CONFIG_ESP_HTTP_CLIENT_POOL_IDLE_TIMEOUT_MS);
+    int count = 0;
+    for (int i = s_conn_count - 1; i >= 0; i--) {
+        if (http_pool_idle_time(i, now) >= timeout) {
+            stale[count++] = http_pool_remove(i);
+        }
+    }
+    return count;
+}
+
+static void http_pool_destroy(esp_transport_list_handle_t *stale, int count)
+{
+    for (int i = 0; i < count; i++) {
+        esp_transport_list_destroy(stale[i]);
+    }
+}
+
+esp_transport_list_handle_t http_pool_acquire(const http_pool_key_t *key)
+{
+    esp_transport_list_handle_t stale[CONFIG_ESP_HTTP_CLIENT_POOL_SIZE];
+    esp_transport_list_handle_t list;
+    int stale_count;
+
+    do {
+        list = NULL;
+        _lock_acquire(&s_pool_lock);
+        const TickType_t now = xTaskGetTickCount();
+        stale_count = http_pool_expire(stale, now);
+        /* The most recently used connection is the least likely to have been closed by the server */
+        int found = -1;
+        for (int i = 0; i < s_conn_count; i++) {
+            if (http_pool_match(&s_conns[i], key) &&
+                    (found < 0 || http_pool_idle_time(i, now) < http_pool_idle_time(found, now))) {
+                found = i;
+            }
+        }
+        if (found >= 0) {
+            list = http_pool_remove(found);
+        }
+        _lock_release(&s_pool_lock);
+        http_pool_destroy(stale, stale_count);
+
+        if (list) {
+            /* An idle connection must not have anything to read, otherwise the
+             * server closed it or sent data which doesn't belong to any request */
+            esp_transport_handle_t t = esp_transport_list_get_transport(list, key->scheme);
+            if (esp_transport_poll_read(t, 0) == 0) {
+                ESP_LOGD(TAG, "Reuse connection to %s://%s:%d", key->scheme, key->host, key->port);
+                return list;
+            }
+            ESP_LOGD(TAG, "Discard connection to %s://%s:%d closed by server", key->scheme, key->host, key->port);
+            esp_transport_list_destroy(list);
+        }
+    } while (list);
+    return NULL;
+}
+
+void http_pool_release(const http_pool_key_t *key, esp_transport_list_handle_t list)
+{
+    esp_transport_list_handle_t stale[CONFIG_ESP_HTTP_CLIENT_POOL_SIZE + 1];
+    http_pool_conn_t conn = {
+        .list = list,
+        .scheme = strdup(key->scheme),
+        .host = strdup(key->host),
+        .port = key->port,
+        .idle_since = xTaskGetTickCount(),
+    };
+    if (!conn.scheme || !conn.host) {
+        ESP_LOGE(TAG, "Memory exhausted");
+        free(conn.scheme);
+        free(conn.host);
+        esp_transport_list_destroy(list);
+        return;
+    }
+    if (key->if_name) {
+        strlcpy(conn.if_name, key->if_name->ifr_name, IFNAMSIZ);
+    }
+    conn.tls = *key->tls;
+
+    _lock_acquire(&s_pool_lock);
+    const TickType_t now = conn.idle_since;
+    int stale_count = http_pool_expire(stale, now);
+    /* Make room by closing the connection which has been idle the longest,
+     * to the same origin if it reached its limit, to any origin otherwise */
+    int same_origin = 0, oldest = -1, oldest_same_origin = -1;
+    for (int i = 0; i < s_conn_count; i++) {
+        if (oldest < 0 || http_pool_idle_time(i, now) > http_pool_idle_time(oldest, now)) {
+            oldest = i;
+        }
+        if (http_pool_match(&s_conns[i], key)) {
+            same_origin++;
+            if (oldest_same_origin < 0 || http_pool_idle_time(i, now) > http_pool_idle_time(oldest_same_origin, now)) {
+                oldest_same_origin = i;
+            }
+        }
+    }
+    if (same_origin >= CONFIG_ESP_HTTP_CLIENT_POOL_MAX_PER_ORIGIN) {
+        stale[stale_count++] = http_pool_remove(oldest_same_origin);
+    } else if (s_conn_count == CONFIG_ESP_HTTP_CLIENT_POOL_SIZE) {
+        stale[stale_count++] = http_pool_remove(oldest);
+    }
+    s_conns[s_conn_count++] = conn;
+    _lock_release(&s_pool_lock);
+    http_pool_destroy(stale, stale_count);
+    ESP_LOGD(TAG, "Keep connection to %s://%s:%d", key->scheme, key->host, key->port);
+}
+
+void http_pool_flush(void)
+{
+    esp_transport_list_handle_t stale[CONFIG_ESP_HTTP_CLIENT_POOL_SIZE];
+    int stale_count = 0;
+
+    _lock_acquire(&s_pool_lock);
+    while (s_conn_count) {
+        stale[stale_count++] = http_pool_remove(s_conn_count - 1);
+    }
+    _lock_release(&s_pool_lock);
+    http_pool_destroy(stale, stale_count);
+}
+
+#else
+
+esp_transport_list_handle_t http_pool_acquire(const http_pool_key_t *key)
+{
+    return NULL;
+}
+
+void http_pool_release(const http_pool_key_t *key, esp_transport_list_handle_t list)
+{
+    esp_transport_list_destroy(list);
+}
+
+void http_pool_flush(void)
+{
+}
+
+#endif
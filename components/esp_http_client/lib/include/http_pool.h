@@ -0,0 +1,70 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#ifndef _HTTP_POOL_H_
+#define _HTTP_POOL_H_
+
+#include <stdbool.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include "esp_err.h"
+#include "esp_transport.h"
+
+/**
+ * TLS settings of a client, a pooled connection is only handed to clients with the same settings
+ */
+typedef struct {
+    const char  *cert_pem;              /*!< Server certificate used to verify the server */
+    size_t      cert_len;               /*!< Length of cert_pem, 0 for null-terminated pem */
+    const char  *client_cert_pem;       /*!< Client certificate */
+    size_t      client_cert_len;        /*!< Length of client_cert_pem, 0 for null-terminated pem */
+    const char  *client_key_pem;        /*!< Client key */
+    size_t      client_key_len;         /*!< Length of client_key_pem, 0 for null-terminated pem */
+    esp_err_t   (*crt_bundle_attach)(void *conf);   /*!< Certificate bundle attach function */
+    bool        use_global_ca_store;    /*!< Server is verified with the global CA store */
+    bool        skip_cert_common_name_check;    /*!< Server certificate CN is not verified */
+} http_pool_tls_cfg_t;
+
+/**
+ * Origin of a connection
+ */
+typedef struct {
+    const char                  *scheme;    /*!< Scheme of the connected transport, "http" or "https" */
+    const char                  *host;      /*!< Server host */
+    int                         port;       /*!< Server port */
+    const struct ifreq          *if_name;   /*!< Interface the connection is bound to, NULL for the default one */
+    const http_pool_tls_cfg_t   *tls;       /*!< TLS settings of the client */
+} http_pool_key_t;
+
+/**
+ * @brief      Take an idle connection to the origin out of the pool.
+ *             Idle connections which timed out or were closed by the server are discarded.
+ *
+ * @param[in]  key   The origin
+ *
+ * @return
+ *     - Transport list whose `key->scheme` transport is connected, owned by the caller
+ *     - NULL if there is no usable connection to the origin
+ */
+esp_transport_list_handle_t http_pool_acquire(const http_pool_key_t *key);
+
+/**
+ * @brief      Keep a connection in the pool until another client needs it.
+ *             The pool takes ownership of the transport list and destroys it
+ *             if the connection can't be kept.
+ *
+ * @param[in]  key   The origin
+ * @param[in]  list  Transport list whose `key->scheme` transport is connected and idle
+ */
+void http_pool_release(const http_pool_key_t *key, esp_transport_list_handle_t list);
+
+/**
+ * @brief      Close all the idle connections in the pool
+ */
+void http_pool_flush(void);
+
+#endif
@@ -132,3 +132,72 @@ TEST_CASE("Username and password will not reset if new absolute URL doesnot spec
     TEST_ASSERT_NOT_NULL(value);
     esp_http_client_cleanup(client);
 }
+
+#if CONFIG_ESP_HTTP_CLIENT_ENABLE_CONNECTION_POOL
+static int s_connected_count;
+
+static esp_err_t count_connected_handler(esp_http_client_event_t *evt)
+{
+    if (evt->event_id == HTTP_EVENT_ON_CONNECTED) {
+        s_connected_count++;
+    }
+    return ESP_OK;
+}
+
+/**
+ * Test case to test that a client created after another one was cleaned up
+ * reuses the connection of the first client, kept in the connection pool
+ **/
+TEST_CASE("Connection is reused by the next client to the same server", "[ESP HTTP CLIENT]")
+{
+    esp_http_client_config_t config = {
+        .url = "http://" HOST "/get",
+        .event_handler = count_connected_handler,
+    };
+    test_case_uses_tcpip();
+    s_connected_count = 0;
+    for (int i = 0; i < 2; i++) {
+        esp_http_client_handle_t client = esp_http_client_init(&config);
+        TEST_ASSERT_NOT_NULL(client);
+        TEST_ASSERT_EQUAL(ESP_OK, esp_http_client_perform(client));
+        TEST_ASSERT_EQUAL(HttpStatus_Ok, esp_http_client_get_status_code(client));
+        esp_http_client_cleanup(client);
+    }
+    TEST_ASSERT_EQUAL(1, s_connected_count);
+
+    TEST_ASSERT_EQUAL(ESP_OK, esp_http_client_pool_flush());
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    TEST_ASSERT_NOT_NULL(client);
+    TEST_ASSERT_EQUAL(ESP_OK, esp_http_client_perform(client));
+    esp_http_client_cleanup(client);
+    TEST_ASSERT_EQUAL(2, s_connected_count);
+    esp_http_client_pool_flush();
+}
+#endif
+
+/**
+ * Test case to test that the responses to pipelined requests are matched to the requests
+ **/
+TEST_CASE("Pipelined requests get a response each", "[ESP HTTP CLIENT]")
+{
+    esp_http_client_config_t config = {
+        .url = "http://" HOST "/get",
+    };
+    esp_http_client_pipeline_req_t reqs[] = {
+        { .method = HTTP_METHOD_GET, .path = "/status/200" },
+        { .method = HTTP_METHOD_POST, .path = "/status/201", .data = "{}", .data_len = 2 },
+        { .method = HTTP_METHOD_GET, .path = "/status/404" },
+    };
+    test_case_uses_tcpip();
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    TEST_ASSERT_NOT_NULL(client);
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, esp_http_client_perform_pipelined(client, reqs, 3, 0));
+    TEST_ASSERT_EQUAL(ESP_OK, esp_http_client_perform_pipelined(client, reqs, 3, 3));
+    TEST_ASSERT_EQUAL(200, reqs[0].status_code);
+    TEST_ASSERT_EQUAL(201, reqs[1].status_code);
+    TEST_ASSERT_EQUAL(404, reqs[2].status_code);
+    // The client is usable with its own settings afterwards
+    TEST_ASSERT_EQUAL(ESP_OK, esp_http_client_perform(client));
+    TEST_ASSERT_EQUAL(HttpStatus_Ok, esp_http_client_get_status_code(client));
+    esp_http_client_cleanup(client);
+}
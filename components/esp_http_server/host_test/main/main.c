@@ -0,0 +1,637 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "esp_log.h"
+#include "esp_http_server.h"
+
+static const char *TAG = "httpd-host-test";
+
+#define SERVER_PORT     8080
+#define MAX_SESSIONS    256
+#define REQUESTS        5000
+
+/* Latency of fast requests while other clients keep a slow handler busy */
+#define SLOW_CLIENTS    2
+#define SLOW_DELAY_US   20000
+#define FAST_REQUESTS   500
+#define WORKERS         4
+
+/* Static content served from a file and from memory */
+#define FILE_SIZE       (256 * 1024)
+#define FILE_REQUESTS   200
+#define MMAP_ETAG       "\"v1\""
+
+/* Header lookups timed by the URI handler, per header */
+#define HDR_LOOKUPS     1000
+
+/* A browser request, with more headers than are indexed by default.
+ * The client adds the Host header in front of these. */
+static const char s_browser_headers[] =
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Gecko/20100101 Firefox/118.0\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Referer: http://localhost/index.html\r\n"
+    "Connection: keep-alive\r\n"
+    "Cookie: session=0123456789abcdef0123456789abcdef; theme=dark; lang=en\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "Sec-Fetch-Dest: document\r\n"
+    "Sec-Fetch-Mode: navigate\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Sec-Fetch-User: ?1\r\n"
+    "DNT: 1\r\n"
+    "Pragma: no-cache\r\n"
+    "Cache-Control: no-cache\r\n"
+    "X-Empty:\r\n"
+    "If-None-Match: \"abc\"\r\n"
+    "X-Last:   tail\r\n";
+#define BROWSER_HEADERS 19
+
+static const unsigned s_idle_clients[] = { 0, 16, 64, 250 };
+
+static volatile bool s_slow_run;
+static char s_file_path[] = "/tmp/httpd-host-test-XXXXXX";
+static char *s_file_data;
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static esp_err_t hello_handler(httpd_req_t *req)
+{
+    return httpd_resp_send(req, "hello", HTTPD_RESP_USE_STRLEN);
+}
+
+static esp_err_t slow_handler(httpd_req_t *req)
+{
+    usleep(SLOW_DELAY_US);
+    return httpd_resp_send(req, "slow", HTTPD_RESP_USE_STRLEN);
+}
+
+static esp_err_t file_handler(httpd_req_t *req)
+{
+    int fd = open(s_file_path, O_RDONLY);
+    if (fd < 0) {
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, NULL);
+    }
+    httpd_resp_set_type(req, HTTPD_TYPE_OCTET);
+    esp_err_t ret = httpd_resp_send_file(req, fd);
+    close(fd);
+    return ret;
+}
+
+/* The way files were served before httpd_resp_send_file() */
+static esp_err_t chunked_handler(httpd_req_t *req)
+{
+    FILE *f = fopen(s_file_path, "r");
+    if (!f) {
+        return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, NULL);
+    }
+    httpd_resp_set_type(req, HTTPD_TYPE_OCTET);
+    char buf[1024];
+    size_t len;
+    esp_err_t ret = ESP_OK;
+    while (ret == ESP_OK && (len = fread(buf, 1, sizeof(buf), f)) > 0) {
+        ret = httpd_resp_send_chunk(req, buf, len);
+    }
+    fclose(f);
+    return ret == ESP_OK ? httpd_resp_send_chunk(req, NULL, 0) : ret;
+}
+
+static esp_err_t mmap_handler(httpd_req_t *req)
+{
+    httpd_resp_set_type(req, HTTPD_TYPE_OCTET);
+    return httpd_resp_send_mmap(req, s_file_data, FILE_SIZE, MMAP_ETAG);
+}
+
+/* Checks the lookup of request headers, then answers with the time taken
+ * by the lookups of a typical handler */
+static esp_err_t headers_handler(httpd_req_t *req)
+{
+    static const char *fields[] = { "host", "User-Agent", "Accept-Encoding", "Cookie", "If-None-Match", "X-Last" };
+    char val[128];
+    size_t len = sizeof(val);
+    bool ok = httpd_req_get_hdr_value_str(req, "user-agent", val, sizeof(val)) == ESP_OK &&
+              strncmp(val, "Mozilla/5.0 ", 12) == 0 &&
+              httpd_req_get_hdr_value_str(req, "X-EMPTY", val, sizeof(val)) == ESP_OK && val[0] == '\0' &&
+              httpd_req_get_hdr_value_str(req, "x-last", val, sizeof(val)) == ESP_OK && strcmp(val, "tail") == 0 &&
+              httpd_req_get_hdr_value_len(req, "X-Last") == 4 &&
+              httpd_req_get_hdr_value_str(req, "X-La", val, sizeof(val)) == ESP_ERR_NOT_FOUND &&
+              httpd_req_get_hdr_value_str(req, "Referer", val, 5) == ESP_ERR_HTTPD_RESULT_TRUNC &&
+              httpd_req_get_cookie_val(req, "theme", val, &len) == ESP_OK && strcmp(val, "dark") == 0;
+
+    /* Iterating visits every header once, in order */
+    httpd_req_hdr_t hdr;
+    size_t count = 0;
+    for (; ok && httpd_req_get_hdr(req, count, &hdr) == ESP_OK; count++) {
+        char field[32];
+        snprintf(field, sizeof(field), "%.*s", (int) hdr.field_len, hdr.field);
+        ok = httpd_req_get_hdr_value_str(req, field, val, sizeof(val)) == ESP_OK &&
+             strcmp(val, hdr.value) == 0 && strlen(hdr.value) == hdr.value_len;
+        ok = ok && (count != 0 || strcmp(field, "Host") == 0);
+    }
+    ok = ok && count == BROWSER_HEADERS && strncmp(hdr.field, "X-Last", hdr.field_len) == 0;
+
+    int64_t start = now_us();
+    size_t total = 0;
+    for (int i = 0; i < HDR_LOOKUPS; i++) {
+        for (int j = 0; j < sizeof(fields) / sizeof(fields[0]); j++) {
+            total += httpd_req_get_hdr_value_len(req, fields[j]);
+        }
+    }
+    int64_t elapsed = now_us() - start;
+    ok = ok && total > 0;
+
+    char body[32];
+    snprintf(body, sizeof(body), ok ? "ok %d" : "bad",
+             (int) (elapsed * 1000 / HDR_LOOKUPS / (sizeof(fields) / sizeof(fields[0]))));
+    return httpd_resp_send(req, body, HTTPD_RESP_USE_STRLEN);
+}
+
+/* The server sends the status line, headers and body separately, disable
+ * Nagle's algorithm so that the responses don't wait for delayed ACKs */
+static esp_err_t open_handler(httpd_handle_t hd, int sockfd)
+{
+    int nodelay = 1;
+    setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+    return ESP_OK;
+}
+
+static int client_connect(void)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(SERVER_PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
+        return -1;
+    }
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+/* Sends a keep-alive request for uri and waits for the response ending with body */
+static int client_request(int sock, const char *uri, const char *body)
+{
+    char request[64];
+    char response[256];
+    char tail[16];
+    int request_len = snprintf(request, sizeof(request), "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n", uri);
+    snprintf(tail, sizeof(tail), "\r\n\r\n%s", body);
+
+    if (send(sock, request, request_len, 0) != request_len) {
+        return -1;
+    }
+    int received = 0;
+    do {
+        int len = recv(sock, response + received, sizeof(response) - 1 - received, 0);
+        if (len <= 0) {
+            return -1;
+        }
+        received += len;
+        response[received] = '\0';
+    } while (strstr(response, tail) == NULL);
+    return 0;
+}
+
+/* Sends keep-alive requests on one connection, returns the number of requests per second */
+static int client_run(int sock)
+{
+    int64_t start = now_us();
+    for (int i = 0; i < REQUESTS; i++) {
+        if (client_request(sock, "/hello", "hello") != 0) {
+            return -1;
+        }
+    }
+    return (int) (REQUESTS * 1000000LL / (now_us() - start));
+}
+
+/* Response to a GET request, the body isn't kept except for its first bytes */
+struct client_response {
+    int status;
+    size_t body_len;
+    char etag[32];
+    char content_range[64];
+    char body_start[16];
+};
+
+static void header_value(const char *headers, const char *field, char *val, size_t val_size)
+{
+    const char *p = strstr(headers, field);
+    val[0] = '\0';
+    if (p) {
+        p += strlen(field);
+        size_t len = strcspn(p, "\r");
+        snprintf(val, val_size, "%.*s", (int) len, p);
+    }
+}
+
+/* Sends a GET request with extra header lines and reads the whole response,
+ * which may have a Content-Length or be chunked */
+static int client_get(int sock, const char *uri, const char *extra, struct client_response *resp)
+{
+    char buf[4096];
+    int len = snprintf(buf, sizeof(buf), "GET %s HTTP/1.1\r\nHost: localhost\r\n%s\r\n", uri, extra);
+    if (send(sock, buf, len, 0) != len) {
+        return -1;
+    }
+
+    int received = 0;
+    char *body;
+    do {
+        len = recv(sock, buf + received, sizeof(buf) - 1 - received, 0);
+        if (len <= 0) {
+            return -1;
+        }
+        received += len;
+        buf[received] = '\0';
+    } while ((body = strstr(buf, "\r\n\r\n")) == NULL);
+    body += 4;
+
+    char value[64];
+    memset(resp, 0, sizeof(*resp));
+    resp->status = atoi(buf + strlen("HTTP/1.1 "));
+    header_value(buf, "\r\nETag: ", resp->etag, sizeof(resp->etag));
+    header_value(buf, "\r\nContent-Range: ", resp->content_range, sizeof(resp->content_range));
+    header_value(buf, "\r\nContent-Length: ", value, sizeof(value));
+    bool chunked = strstr(buf, "\r\nTransfer-Encoding: chunked") != NULL;
+    size_t content_len = resp->status == 304 ? 0 : strtoul(value, NULL, 10);
+
+    size_t have = received - (body - buf);
+    memcpy(resp->body_start, body, have < sizeof(resp->body_start) ? have : sizeof(resp->body_start));
+    if (!chunked) {
+        resp->body_len = have;
+        while (resp->body_len < content_len) {
+            len = recv(sock, buf, sizeof(buf), 0);
+            if (len <= 0) {
+                return -1;
+            }
+            if (resp->body_len < sizeof(resp->body_start)) {
+                size_t copy = sizeof(resp->body_start) - resp->body_len;
+                memcpy(resp->body_start + resp->body_len, buf, copy < len ? copy : len);
+            }
+            resp->body_len += len;
+        }
+        return 0;
+    }
+
+    /* Chunked bodies end with a chunk of size 0, the framing is counted as well */
+    char tail[8] = "";
+    resp->body_len = have;
+    memmove(buf, body, have);
+    while (1) {
+        size_t keep = strlen(tail);
+        char joined[sizeof(tail) + sizeof(buf)];
+        memcpy(joined, tail, keep);
+        memcpy(joined + keep, buf, have);
+        size_t total = keep + have;
+        if (total >= 7 && memcmp(joined + total - 7, "\r\n0\r\n\r\n", 7) == 0) {
+            return 0;
+        }
+        size_t tail_len = total < 7 ? total : 7;
+        memcpy(tail, joined + total - tail_len, tail_len);
+        tail[tail_len] = '\0';
+        len = recv(sock, buf, sizeof(buf), 0);
+        if (len <= 0) {
+            return -1;
+        }
+        have = len;
+        resp->body_len += len;
+    }
+}
+
+static void *slow_client(void *arg)
+{
+    int sock = (int) (intptr_t) arg;
+    while (s_slow_run && client_request(sock, "/slow", "slow") == 0) {
+    }
+    return NULL;
+}
+
+static int compare_latency(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *) a;
+    int64_t y = *(const int64_t *) b;
+    return (x > y) - (x < y);
+}
+
+static httpd_handle_t server_start(unsigned worker_count)
+{
+    httpd_handle_t server;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.server_port = SERVER_PORT;
+    config.max_open_sockets = MAX_SESSIONS;
+    config.backlog_conn = 64;
+    config.worker_count = worker_count;
+    config.open_fn = open_handler;
+    if (httpd_start(&server, &config) != ESP_OK) {
+        return NULL;
+    }
+
+    httpd_uri_t hello = {
+        .uri      = "/hello",
+        .method   = HTTP_GET,
+        .handler  = hello_handler,
+        .user_ctx = NULL,
+    };
+    httpd_uri_t slow = {
+        .uri      = "/slow",
+        .method   = HTTP_GET,
+        .handler  = slow_handler,
+        .user_ctx = NULL,
+    };
+    httpd_uri_t file = {
+        .uri      = "/file",
+        .method   = HTTP_GET,
+        .handler  = file_handler,
+        .user_ctx = NULL,
+    };
+    httpd_uri_t chunked = {
+        .uri      = "/chunked",
+        .method   = HTTP_GET,
+        .handler  = chunked_handler,
+        .user_ctx = NULL,
+    };
+    httpd_uri_t mmap = {
+        .uri      = "/mmap",
+        .method   = HTTP_GET,
+        .handler  = mmap_handler,
+        .user_ctx = NULL,
+    };
+    httpd_uri_t headers = {
+        .uri      = "/headers",
+        .method   = HTTP_GET,
+        .handler  = headers_handler,
+        .user_ctx = NULL,
+    };
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &hello));
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &slow));
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &file));
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &chunked));
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &mmap));
+    ESP_ERROR_CHECK(httpd_register_uri_handler(server, &headers));
+    return server;
+}
+
+#define CHECK(cond) do { \
+        if (!(cond)) { \
+            ESP_LOGE(TAG, "%s:%d: check failed: %s", __func__, __LINE__, #cond); \
+            return -1; \
+        } \
+    } while (0)
+
+/* Checks the responses to conditional and range requests */
+static int file_check(int sock)
+{
+    struct client_response resp;
+    char extra[128];
+
+    CHECK(client_get(sock, "/file", "", &resp) == 0);
+    CHECK(resp.status == 200 && resp.body_len == FILE_SIZE && resp.etag[0] != '\0');
+    CHECK(memcmp(resp.body_start, s_file_data, sizeof(resp.body_start)) == 0);
+
+    char etag[sizeof(resp.etag)];
+    strcpy(etag, resp.etag);
+    snprintf(extra, sizeof(extra), "If-None-Match: \"other\", %s\r\n", etag);
+    CHECK(client_get(sock, "/file", extra, &resp) == 0);
+    CHECK(resp.status == 304 && resp.body_len == 0);
+
+    CHECK(client_get(sock, "/file", "Range: bytes=1000-1099\r\n", &resp) == 0);
+    CHECK(resp.status == 206 && resp.body_len == 100);
+    CHECK(strcmp(resp.content_range, "bytes 1000-1099/262144") == 0);
+    CHECK(memcmp(resp.body_start, s_file_data + 1000, sizeof(resp.body_start)) == 0);
+
+    snprintf(extra, sizeof(extra), "Range: bytes=-10\r\nIf-Range: %s\r\n", etag);
+    CHECK(client_get(sock, "/file", extra, &resp) == 0);
+    CHECK(resp.status == 206 && resp.body_len == 10);
+
+    CHECK(client_get(sock, "/file", "Range: bytes=10-\r\nIf-Range: \"other\"\r\n", &resp) == 0);
+    CHECK(resp.status == 200 && resp.body_len == FILE_SIZE);
+
+    CHECK(client_get(sock, "/file", "Range: bytes=0-1,5-6\r\n", &resp) == 0);
+    CHECK(resp.status == 200 && resp.body_len == FILE_SIZE);
+
+    CHECK(client_get(sock, "/file", "Range: bytes=262144-\r\n", &resp) == 0);
+    CHECK(resp.status == 416 && strcmp(resp.content_range, "bytes */262144") == 0);
+
+    CHECK(client_get(sock, "/mmap", "If-None-Match: " MMAP_ETAG "\r\n", &resp) == 0);
+    CHECK(resp.status == 304);
+
+    CHECK(client_get(sock, "/mmap", "Range: bytes=262000-300000\r\n", &resp) == 0);
+    CHECK(resp.status == 206 && resp.body_len == 144);
+    CHECK(memcmp(resp.body_start, s_file_data + 262000, sizeof(resp.body_start)) == 0);
+    return 0;
+}
+
+/* Returns the transfer rate in KiB per second */
+static int file_rate(int sock, const char *uri)
+{
+    struct client_response resp;
+    int64_t start = now_us();
+    for (int i = 0; i < FILE_REQUESTS; i++) {
+        if (client_get(sock, uri, "", &resp) != 0 || resp.status != 200) {
+            return -1;
+        }
+    }
+    return (int) ((int64_t) FILE_REQUESTS * (FILE_SIZE / 1024) * 1000000 / (now_us() - start));
+}
+
+/* Serves static content with httpd_resp_send_file() and httpd_resp_send_mmap() */
+static int file_run(void)
+{
+    int fd = mkstemp(s_file_path);
+    s_file_data = malloc(FILE_SIZE);
+    if (fd < 0 || !s_file_data) {
+        return -1;
+    }
+    for (int i = 0; i < FILE_SIZE; i++) {
+        s_file_data[i] = (char) (i % 251);
+    }
+    int written = write(fd, s_file_data, FILE_SIZE);
+    close(fd);
+
+    httpd_handle_t server = written == FILE_SIZE ? server_start(0) : NULL;
+    int sock = server ? client_connect() : -1;
+    int ret = sock < 0 ? -1 : file_check(sock);
+    if (ret == 0) {
+        int chunked = file_rate(sock, "/chunked");
+        int file = file_rate(sock, "/file");
+        int mmap = file_rate(sock, "/mmap");
+        if (chunked < 0 || file < 0 || mmap < 0) {
+            ret = -1;
+        } else {
+            printf("static content: fread + chunks %d KiB/s, file %d KiB/s, mmap %d KiB/s\n",
+                   chunked, file, mmap);
+        }
+    }
+
+    if (sock >= 0) {
+        close(sock);
+    }
+    if (server) {
+        httpd_stop(server);
+    }
+    unlink(s_file_path);
+    free(s_file_data);
+    return ret;
+}
+
+/* Looks up the headers of a browser request */
+static int headers_run(void)
+{
+    httpd_handle_t server = server_start(0);
+    int sock = server ? client_connect() : -1;
+    struct client_response resp;
+    int ret = -1;
+    if (sock >= 0 && client_get(sock, "/headers", s_browser_headers, &resp) == 0 &&
+        resp.status == 200 && strncmp(resp.body_start, "ok ", 3) == 0) {
+        printf("request headers: %d ns per lookup\n", atoi(resp.body_start + 3));
+        ret = 0;
+    }
+
+    if (sock >= 0) {
+        close(sock);
+    }
+    if (server) {
+        httpd_stop(server);
+    }
+    return ret;
+}
+
+/* Measures the latency of fast requests while slow requests are being handled */
+static int latency_run(unsigned worker_count)
+{
+    httpd_handle_t server = server_start(worker_count);
+    if (!server) {
+        return -1;
+    }
+
+    static int64_t latency[FAST_REQUESTS];
+    pthread_t slow[SLOW_CLIENTS];
+    int slow_sock[SLOW_CLIENTS];
+    int ret = 0;
+
+    /* The slow clients connect first, so that the fast one gets its own worker */
+    s_slow_run = true;
+    for (int i = 0; i < SLOW_CLIENTS; i++) {
+        slow_sock[i] = client_connect();
+        if (slow_sock[i] < 0) {
+            ESP_LOGE(TAG, "failed to connect slow client %d", i);
+            return -1;
+        }
+        pthread_create(&slow[i], NULL, slow_client, (void *) (intptr_t) slow_sock[i]);
+    }
+
+    int sock = client_connect();
+    for (int i = 0; i < FAST_REQUESTS && ret == 0; i++) {
+        int64_t start = now_us();
+        ret = sock < 0 ? -1 : client_request(sock, "/hello", "hello");
+        latency[i] = now_us() - start;
+    }
+    if (sock >= 0) {
+        close(sock);
+    }
+
+    s_slow_run = false;
+    for (int i = 0; i < SLOW_CLIENTS; i++) {
+        pthread_join(slow[i], NULL);
+        close(slow_sock[i]);
+    }
+    httpd_stop(server);
+
+    if (ret == 0) {
+        qsort(latency, FAST_REQUESTS, sizeof(latency[0]), compare_latency);
+        printf("%u workers: fast request latency p50 %lld us, p99 %lld us\n", worker_count,
+               (long long) latency[FAST_REQUESTS / 2], (long long) latency[FAST_REQUESTS * 99 / 100]);
+    }
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    httpd_handle_t server = server_start(0);
+    if (!server) {
+        ESP_LOGE(TAG, "failed to start server");
+        return 1;
+    }
+
+    static int idle[MAX_SESSIONS];
+    unsigned idle_count = 0;
+    int ret = 0;
+
+    for (int i = 0; i < sizeof(s_idle_clients) / sizeof(s_idle_clients[0]); i++) {
+        /* Idle clients stay connected without sending anything */
+        while (idle_count < s_idle_clients[i]) {
+            idle[idle_count] = client_connect();
+            if (idle[idle_count] < 0) {
+                ESP_LOGE(TAG, "failed to connect idle client %u", idle_count);
+                ret = 1;
+                goto done;
+            }
+            idle_count++;
+        }
+
+        int sock = client_connect();
+        int rate = sock < 0 ? -1 : client_run(sock);
+        if (sock >= 0) {
+            close(sock);
+        }
+        if (rate < 0) {
+            ESP_LOGE(TAG, "requests failed with %u idle clients", idle_count);
+            ret = 1;
+            goto done;
+        }
+        printf("%3u idle clients: %d requests/sec\n", idle_count, rate);
+    }
+
+done:
+    while (idle_count > 0) {
+        close(idle[--idle_count]);
+    }
+    httpd_stop(server);
+    if (ret) {
+        return ret;
+    }
+
+    /* The slow handler delays the other sessions unless requests are processed by workers */
+    if (latency_run(0) != 0 || latency_run(WORKERS) != 0) {
+        ESP_LOGE(TAG, "latency test failed");
+        return 1;
+    }
+
+    if (file_run() != 0) {
+        ESP_LOGE(TAG, "static content test failed");
+        return 1;
+    }
+
+    if (headers_run() != 0) {
+        ESP_LOGE(TAG, "request headers test failed");
+        return 1;
+    }
+    return 0;
+}
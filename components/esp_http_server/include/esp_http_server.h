@@ -27,6 +27,7 @@ initializer that should be kept in sync
         .task_priority      = tskIDLE_PRIORITY+5,       \
         .stack_size         = 4096,                     \
         .core_id            = tskNO_AFFINITY,           \
+        .worker_count       = 0,                        \
         .server_port        = 80,                       \
         .ctrl_port          = 32768,                    \
         .max_open_sockets   = 7,                        \
@@ -136,6 +137,18 @@ typedef struct httpd_config {
     size_t      stack_size;         /*!< The maximum stack size allowed for the server task */
     BaseType_t  core_id;            /*!< The core the HTTP server task will run on */
 
+    /**
+     * Number of worker tasks processing requests, 0 processes them in the server task.
+     *
+     * With workers, the server task only waits on the sockets and hands the
+     * sessions with incoming data to the workers, so a slow URI handler doesn't
+     * hold up the requests of other sessions. Each session is bound to one worker
+     * when it's opened. New connections aren't accepted while every worker has a
+     * request to process. The workers are created with the same stack size,
+     * priority and core as the server task, which need to be accounted for.
+     */
+    uint8_t     worker_count;
+
     /**
      * TCP Port number for receiving and transmitting HTTP traffic
      */
@@ -871,6 +884,46 @@ size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field);
  */
 esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size);
 
+/**
+ * @brief   A request header, as returned by httpd_req_get_hdr()
+ */
+typedef struct httpd_req_hdr {
+    const char *field;      /*!< Field name, not null terminated */
+    size_t      field_len;  /*!< Length of the field name */
+    const char *value;      /*!< Null terminated value string */
+    size_t      value_len;  /*!< Length of the value string */
+} httpd_req_hdr_t;
+
+/**
+ * @brief   Get a request header by its position in the request, for
+ *          iterating over all request headers:
+ *
+ *      httpd_req_hdr_t hdr;
+ *      for (size_t i = 0; httpd_req_get_hdr(req, i, &hdr) == ESP_OK; i++) {
+ *          printf("%.*s: %s\n", (int) hdr.field_len, hdr.field, hdr.value);
+ *      }
+ *
+ * @note
+ *  - This API is supposed to be called only from the context of
+ *    a URI handler where httpd_req_t* request pointer is valid.
+ *  - The field and value point into the buffer of the request, they
+ *    are invalid once httpd_resp_send() or a similar API is called.
+ *  - Headers are indexed while the request is parsed, up to
+ *    CONFIG_HTTPD_MAX_REQ_HDRS_INDEXED of them. Further headers are
+ *    found by scanning the header lines following the indexed ones.
+ *
+ * @param[in]  r        The request being responded to
+ * @param[in]  index    Position of the header, starting from 0
+ * @param[out] hdr      The header
+ *
+ * @return
+ *  - ESP_OK : Header found
+ *  - ESP_ERR_NOT_FOUND          : The request has no more headers
+ *  - ESP_ERR_INVALID_ARG        : Null arguments
+ *  - ESP_ERR_HTTPD_INVALID_REQ  : Invalid HTTP request pointer
+ */
+esp_err_t httpd_req_get_hdr(httpd_req_t *r, size_t index, httpd_req_hdr_t *hdr);
+
 /**
  * @brief   Get Query string length from the request URL
  *
@@ -916,6 +969,36 @@ size_t httpd_req_get_url_query_len(httpd_req_t *r);
  */
 esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len);
 
+/**
+ * @brief   Get the value of a path parameter of the request URL
+ *
+ * When CONFIG_HTTPD_URI_ROUTER is enabled, a path segment of the form
+ * {name} in the URI of a registered handler, eg. "/api/v1/dev/{id}",
+ * matches any non-empty segment of the request URL. This function
+ * returns the segment which matched the parameter of the given name.
+ *
+ * @note
+ *  - The value is copied as it appears in the URL, decoding has to be
+ *    performed by the user
+ *  - This API is supposed to be called only from the context of
+ *    a URI handler where httpd_req_t* request pointer is valid
+ *  - If output size is greater than input, then the value is truncated,
+ *    accompanied by truncation error as return value
+ *
+ * @param[in]  r         The request being responded to
+ * @param[in]  name      Name of the parameter, without braces
+ * @param[out] val       Pointer to the buffer into which the value will be copied (if found)
+ * @param[in]  val_size  Size of output buffer
+ *
+ * @return
+ *  - ESP_OK : Parameter is found in the request URL and copied to buffer
+ *  - ESP_ERR_NOT_FOUND          : Parameter not found, or the URI router is disabled
+ *  - ESP_ERR_INVALID_ARG        : Null arguments
+ *  - ESP_ERR_HTTPD_INVALID_REQ  : Invalid HTTP request pointer
+ *  - ESP_ERR_HTTPD_RESULT_TRUNC : Value string truncated
+ */
+esp_err_t httpd_req_get_path_param(httpd_req_t *r, const char *name, char *val, size_t val_size);
+
 /**
  * @brief   Helper function to get a URL query tag from a query
  *          string of the type param1=val1&param2=val2
@@ -1103,13 +1186,84 @@ static inline esp_err_t httpd_resp_sendstr_chunk(httpd_req_t *r, const char *str
     return httpd_resp_send_chunk(r, str, (str == NULL) ? 0 : HTTPD_RESP_USE_STRLEN);
 }
 
+/**
+ * @brief   API to send the content of a file as HTTP response.
+ *
+ * The file is sent with a Content-Length header, without copying it
+ * into a user buffer or using chunked encoding. The ETag and Last-Modified
+ * headers are derived from the size and modification time of the file,
+ * unless its file system doesn't keep track of modification times.
+ *
+ * For GET and HEAD requests, as long as no status other than the default
+ * 200 OK was set:
+ *  - If-None-Match and If-Modified-Since requests are answered with
+ *    304 Not Modified if the file didn't change. Dates must match the
+ *    Last-Modified header exactly.
+ *  - A single byte range in a Range header is answered with
+ *    206 Partial Content, or 416 Range Not Satisfiable if it lies beyond
+ *    the end of the file. Multiple ranges are ignored and the whole file
+ *    is sent, as is the range if an If-Range header doesn't match.
+ *
+ * The content type and additional headers are set as for httpd_resp_send().
+ * The body isn't sent in response to HEAD requests.
+ *
+ * @note
+ *  - This API is supposed to be called only from the context of
+ *    a URI handler where httpd_req_t* request pointer is valid.
+ *  - Once this API is called, the request has been responded to.
+ *  - The file is read into the request's scratch buffer, so the handler
+ *    doesn't need a buffer of its own. The file system must support lseek().
+ *
+ * @param[in] r   The request being responded to
+ * @param[in] fd  Descriptor of the file opened for reading
+ *
+ * @return
+ *  - ESP_OK : On successfully sending the response packet
+ *  - ESP_ERR_INVALID_ARG : Null request pointer or invalid descriptor
+ *  - ESP_ERR_HTTPD_RESP_SEND   : Error in raw send
+ *  - ESP_ERR_HTTPD_INVALID_REQ : Invalid request
+ *  - ESP_FAIL : Error reading the file
+ */
+esp_err_t httpd_resp_send_file(httpd_req_t *r, int fd);
+
+/**
+ * @brief   API to send data mapped into memory as HTTP response.
+ *
+ * The data is handed to the socket straight from memory, so a flash
+ * region mapped with esp_partition_mmap() is sent without being copied.
+ * Conditional and range requests are answered as by httpd_resp_send_file().
+ *
+ * @note
+ *  - This API is supposed to be called only from the context of
+ *    a URI handler where httpd_req_t* request pointer is valid.
+ *  - Once this API is called, the request has been responded to.
+ *  - The entity tag should change whenever the data changes, e.g. the hash
+ *    of the partition returned by esp_partition_get_sha256() once after
+ *    boot. Without it, conditional requests aren't supported.
+ *
+ * @param[in] r     The request being responded to
+ * @param[in] data  Data to be sent
+ * @param[in] len   Length of the data
+ * @param[in] etag  Entity tag including the double quotes, NULL if none
+ *
+ * @return
+ *  - ESP_OK : On successfully sending the response packet
+ *  - ESP_ERR_INVALID_ARG : Null request pointer or data
+ *  - ESP_ERR_HTTPD_RESP_SEND   : Error in raw send
+ *  - ESP_ERR_HTTPD_INVALID_REQ : Invalid request
+ */
+esp_err_t httpd_resp_send_mmap(httpd_req_t *r, const void *data, size_t len, const char *etag);
+
 /* Some commonly used status codes */
 #define HTTPD_200      "200 OK"                     /*!< HTTP Response 200 */
 #define HTTPD_204      "204 No Content"             /*!< HTTP Response 204 */
+#define HTTPD_206      "206 Partial Content"        /*!< HTTP Response 206 */
 #define HTTPD_207      "207 Multi-Status"           /*!< HTTP Response 207 */
+#define HTTPD_304      "304 Not Modified"           /*!< HTTP Response 304 */
 #define HTTPD_400      "400 Bad Request"            /*!< HTTP Response 400 */
 #define HTTPD_404      "404 Not Found"              /*!< HTTP Response 404 */
 #define HTTPD_408      "408 Request Timeout"        /*!< HTTP Response 408 */
+#define HTTPD_416      "416 Range Not Satisfiable"  /*!< HTTP Response 416 */
 #define HTTPD_500      "500 Internal Server Error"  /*!< HTTP Response 500 */
 
 /**
@@ -1650,6 +1804,47 @@ esp_err_t httpd_ws_send_frame(httpd_req_t *req, httpd_ws_frame_t *pkt);
  */
 esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame);
 
+/**
+ * @brief What httpd_ws_broadcast() drops for a client which can't keep up
+ */
+typedef enum {
+    HTTPD_WS_BROADCAST_DROP_NEW = 0,    /*!< Drop the new frame if the client's queue is full */
+    HTTPD_WS_BROADCAST_DROP_OLDEST,     /*!< Drop the oldest queued frame to make room for the new one */
+} httpd_ws_broadcast_policy_t;
+
+/**
+ * @brief Send the same WebSocket frame to several clients
+ *
+ * The frame is encoded and copied once and sent by the server task to each client
+ * without blocking on any of them. What a client's socket doesn't take right away
+ * is queued and sent as soon as the socket has room again, so a slow client doesn't
+ * delay the others. Up to CONFIG_HTTPD_WS_TX_QUEUE_LEN frames are queued per client,
+ * further frames are dropped for that client according to the policy. A frame is
+ * never dropped once a client has started receiving it.
+ *
+ * @note    This can be called from any task, including URI handlers. The payload can be
+ *          reused as soon as this returns. Frames sent with httpd_ws_send_frame() or
+ *          httpd_ws_send_frame_async() may overtake queued broadcast frames.
+ * @note    The frames are sent with the MSG_DONTWAIT flag. Custom send functions which
+ *          ignore it, such as the one of esp_https_server, make the server task block
+ *          on slow clients.
+ *
+ * @param[in] hd        Server instance data
+ * @param[in] frame     WebSocket frame
+ * @param[in] fds       Socket descriptors of the clients, or NULL for all WebSocket clients.
+ *                      Descriptors which aren't active WebSocket clients are ignored.
+ * @param[in] fd_count  Number of socket descriptors in fds
+ * @param[in] policy    What to drop if the queue of a client is full
+ * @return
+ *  - ESP_OK                    : The frame was queued for sending
+ *  - ESP_ERR_INVALID_ARG       : Argument is invalid
+ *  - ESP_ERR_HTTPD_ALLOC_MEM   : Failed to allocate memory for the frame
+ *  - ESP_FAIL                  : Failed to queue the frame to the server task
+ */
+esp_err_t httpd_ws_broadcast(httpd_handle_t hd, httpd_ws_frame_t *frame,
+                             const int *fds, size_t fd_count,
+                             httpd_ws_broadcast_policy_t policy);
+
 /**
  * @brief Checks the supplied socket descriptor if it belongs to any active client
  * of this server instance and if the websoket protocol is active
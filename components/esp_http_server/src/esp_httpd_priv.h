@@ -9,6 +9,7 @@
 #define _HTTPD_PRIV_H_
 
 #include <stdbool.h>
+#include <stdatomic.h>
 #include <sys/socket.h>
 #include <sys/param.h>
 #include <netinet/in.h>
@@ -64,12 +65,24 @@ struct sock_db {
     bool lru_socket;                        /*!< Flag indicating LRU socket */
     char pending_data[PARSER_BLOCK_SIZE];   /*!< Buffer for pending data to be received */
     size_t pending_len;                     /*!< Length of pending data to be received */
+    int poll_index;                         /*!< Slot of this socket in the event backend, -1 if not watched */
+    bool poll_pending;                      /*!< Queued for processing without waiting for new data */
+    bool poll_out;                          /*!< Also watched for room in the send buffer */
+    int worker;                             /*!< Index of the worker processing the requests of this socket, -1 if none */
+    bool worker_busy;                       /*!< A request is queued to or processed by the worker */
+    bool worker_close;                      /*!< Close the socket once the worker is done with it */
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     bool ws_handshake_done;                 /*!< True if it has done WebSocket handshake (if this socket is a valid WS) */
     bool ws_close;                          /*!< Set to true to close the socket later (when WS Close frame received) */
     esp_err_t (*ws_handler)(httpd_req_t *r);   /*!< WebSocket handler, leave to null if it's not WebSocket */
     bool ws_control_frames;                         /*!< WebSocket flag indicating that control frames should be passed to user handlers */
     void *ws_user_ctx;                         /*!< Pointer to user context data which will be available to handler for websocket*/
+    struct httpd_ws_tx_frame *ws_tx_queue[CONFIG_HTTPD_WS_TX_QUEUE_LEN]; /*!< Broadcast frames waiting to be sent */
+    unsigned ws_tx_head;                       /*!< Index of the oldest queued frame */
+    unsigned ws_tx_count;                      /*!< Number of queued frames */
+    size_t ws_tx_offset;                       /*!< Bytes of the oldest queued frame already sent */
+    bool ws_tx_nodelay;                        /*!< TCP_NODELAY was set for sending broadcast frames */
+    unsigned ws_tx_senders;                    /*!< Tasks sending frames directly, queued frames wait for them */
 #endif
 };
 
@@ -85,12 +98,29 @@ struct httpd_req_aux {
     char           *content_type;                   /*!< HTTP response's content type */
     bool            first_chunk_sent;               /*!< Used to indicate if first chunk sent */
     unsigned        req_hdrs_count;                 /*!< Count of total headers in request packet */
+    unsigned        req_hdrs_indexed;               /*!< Count of leading request headers in req_hdrs */
+    struct httpd_req_hdr_index {
+        const char *field;                          /*!< Field name in scratch, followed by ':' */
+        const char *value;                          /*!< Null terminated value in scratch */
+        uint16_t    field_len;
+        uint16_t    value_len;
+        uint16_t    hash;                           /*!< Case insensitive hash of the field name */
+    } req_hdrs[CONFIG_HTTPD_MAX_REQ_HDRS_INDEXED];  /*!< Index of the request headers built while parsing, later headers are found by scanning scratch */
     unsigned        resp_hdrs_count;                /*!< Count of additional headers in response packet */
     struct resp_hdr {
         const char *field;
         const char *value;
     } *resp_hdrs;                                   /*!< Additional headers in response packet */
     struct http_parser_url url_parse_res;           /*!< URL parsing result, used for retrieving URL elements */
+#ifdef CONFIG_HTTPD_URI_ROUTER
+    unsigned        path_params_count;              /*!< Count of path parameters matched by the URI handler's template */
+    struct httpd_path_param {
+        const char *name;                           /*!< Name of the parameter, pointing into the URI template */
+        size_t      name_len;
+        const char *value;                          /*!< Value of the parameter, pointing into the request URI */
+        size_t      value_len;
+    } path_params[CONFIG_HTTPD_MAX_PATH_PARAMS];    /*!< Path parameters matched by the URI handler's template */
+#endif
 #ifdef CONFIG_HTTPD_WS_SUPPORT
     bool ws_handshake_detect;                       /*!< WebSocket handshake detection flag */
     httpd_ws_type_t ws_type;                        /*!< WebSocket frame type */
@@ -99,6 +129,44 @@ struct httpd_req_aux {
 #endif
 };
 
+/**
+ * @brief   State of the event backend, which watches the control, listening
+ *          and session sockets and reports the sessions ready for processing
+ *
+ * The backend uses epoll on the Linux target and poll() otherwise. Either way
+ * the sockets are added and removed as sessions come and go, so the work done
+ * on each wakeup depends on the number of active or ready sessions only.
+ */
+struct httpd_poll {
+#ifdef CONFIG_IDF_TARGET_LINUX
+    int epoll_fd;                           /*!< The epoll instance */
+    struct epoll_event *events;             /*!< Events returned by epoll_wait() */
+#else
+    struct pollfd *fds;                     /*!< Control and listening socket, followed by the session sockets */
+    struct sock_db **owners;                /*!< Session of each entry of fds, NULL for the first two */
+#endif
+    unsigned count;                         /*!< Number of watched sockets */
+    bool listening;                         /*!< The listening socket is being watched */
+    struct sock_db **ready;                 /*!< Sessions reported by the last httpd_poll_wait() */
+    struct sock_db **pending;               /*!< Sessions queued by httpd_poll_set_pending() */
+    unsigned pending_count;                 /*!< Number of queued sessions */
+    struct sock_db **writable;              /*!< Sessions reported writable by the last httpd_poll_wait() */
+};
+
+/**
+ * @brief   Worker task processing the requests of the sessions bound to it,
+ *          see httpd_config_t.worker_count
+ */
+struct httpd_worker {
+    struct httpd_data *hd;                  /*!< Server instance */
+    struct thread_data td;                  /*!< Information for the worker thread */
+    oqueue_t queue;                         /*!< Sessions handed to the worker, NULL asks it to stop */
+    unsigned inflight;                      /*!< Number of sessions queued or being processed */
+    unsigned sessions;                      /*!< Number of sessions bound to the worker */
+    struct httpd_req req;                   /*!< The request processed by the worker */
+    struct httpd_req_aux req_aux;           /*!< Additional data about the request kept unexposed */
+};
+
 /**
  * @brief   Server data for each instance. This is exposed publicly as
  *          httpd_handle_t but internal structure/members are kept private.
@@ -111,10 +179,22 @@ struct httpd_data {
     struct thread_data hd_td;               /*!< Information for the HTTPD thread */
     struct sock_db *hd_sd;                  /*!< The socket database */
     int hd_sd_active_count;                 /*!< The number of the active sockets */
+    struct httpd_poll hd_poll;              /*!< Event backend watching the sockets */
     httpd_uri_t **hd_calls;                 /*!< Registered URI handlers */
+#ifdef CONFIG_HTTPD_URI_ROUTER
+    struct httpd_route_node *hd_router;     /*!< Radix tree indexing the registered URI handlers */
+    bool hd_router_stale;                   /*!< The tree is out of date and mustn't be used */
+#endif
     struct httpd_req hd_req;                /*!< The current HTTPD request */
     struct httpd_req_aux hd_req_aux;        /*!< Additional data about the HTTPD request kept unexposed */
     uint64_t lru_counter;                   /*!< LRU counter */
+    struct httpd_worker *hd_workers;        /*!< Worker tasks, NULL if requests are processed by the server task */
+    unsigned hd_workers_started;            /*!< Number of worker tasks launched */
+    oqueue_t hd_workers_done;               /*!< Sessions whose request has been processed by a worker */
+    atomic_bool hd_workers_notified;        /*!< The server task has been asked to collect the processed sessions */
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    omutex_t hd_ws_tx_lock;                 /*!< Protects the WebSocket send queues of the sessions */
+#endif
 
     /* Array of registered error handler functions */
     httpd_err_handler_func_t *err_handler_fns;
@@ -160,7 +240,7 @@ struct sock_db *httpd_sess_get(struct httpd_data *hd, int sockfd);
 
 /**
  * @brief Delete sessions whose FDs have became invalid.
- *        This is a recovery strategy e.g. after select() fails.
+ *        This is a recovery strategy e.g. after httpd_poll_wait() fails.
  *
  * @param[in] hd    Server instance data
  */
@@ -189,19 +269,28 @@ esp_err_t httpd_sess_new(struct httpd_data *hd, int newfd);
 /**
  * @brief   Processes incoming HTTP requests
  *
+ * @note    This doesn't update the LRU counter of the session, as it may run
+ *          in a worker task while the counter is owned by the server task.
+ *
  * @param[in] hd      Server instance data
  * @param[in] session Session
+ * @param[in] r       Request structure of the calling task
+ * @param[in] ra      Auxiliary request data of the calling task
  *
  * @return
  *  - ESP_OK    : on successfully receiving, parsing and responding to a request
  *  - ESP_FAIL  : in case of failure in any of the stages of processing
  */
-esp_err_t httpd_sess_process(struct httpd_data *hd, struct sock_db *session);
+esp_err_t httpd_sess_process(struct httpd_data *hd, struct sock_db *session,
+                             httpd_req_t *r, struct httpd_req_aux *ra);
 
 /**
  * @brief   Remove client descriptor from the session / socket database
  *          and close the connection for this client.
  *
+ * @note    If a worker is processing a request of the session, the
+ *          deletion is deferred until the worker is done with it.
+ *
  * @param[in] hd      Server instance data
  * @param[in] session Session
  */
@@ -215,17 +304,6 @@ void httpd_sess_delete(struct httpd_data *hd, struct sock_db *session);
  */
 void httpd_sess_free_ctx(void **ctx, httpd_free_ctx_fn_t free_fn);
 
-/**
- * @brief   Add descriptors present in the socket database to an fdset and
- *          update the value of maxfd which are needed by the select function
- *          for looking through all available sockets for incoming data.
- *
- * @param[in]  hd    Server instance data
- * @param[out] fdset File descriptor set to be updated.
- * @param[out] maxfd Maximum value among all file descriptors.
- */
-void httpd_sess_set_descriptors(struct httpd_data *hd, fd_set *fdset, int *maxfd);
-
 /**
  * @brief   Checks if session can accept another connection from new client.
  *          If sockets database is full then this returns false.
@@ -242,7 +320,7 @@ bool httpd_is_sess_available(struct httpd_data *hd);
  *
  * This is needed as httpd_unrecv may un-receive next
  * packet in the stream. If only partial packet was
- * received then select() would mark the fd for processing
+ * received then the event backend would report the fd
  * as remaining part of the packet would still be in socket
  * recv queue. But if a complete packet got unreceived
  * then it would not be processed until further data is
@@ -284,6 +362,197 @@ void httpd_sess_close_all(struct httpd_data *hd);
  * @}
  */
 
+/****************** Group : Event Backend ********************/
+/** @name Event Backend
+ * Methods for waiting on the sockets of the server
+ * @{
+ */
+
+/**
+ * @brief   Sockets which became ready in httpd_poll_wait()
+ */
+struct httpd_poll_ready {
+    bool ctrl;                  /*!< A control message is available */
+    bool listen;                /*!< A connection request is available */
+    struct sock_db **sessions;  /*!< Sessions ready for processing */
+    unsigned count;             /*!< Number of sessions */
+    struct sock_db **writable;  /*!< Sessions which can send, see httpd_poll_set_writable() */
+    unsigned writable_count;    /*!< Number of writable sessions */
+};
+
+/**
+ * @brief   Initializes the event backend and starts watching the
+ *          control and listening sockets of the server
+ *
+ * @param[in] hd  Server instance data
+ *
+ * @return
+ *  - ESP_OK : on success
+ *  - ESP_ERR_HTTPD_ALLOC_MEM : if memory allocation failed
+ *  - ESP_FAIL : if the backend couldn't be created
+ */
+esp_err_t httpd_poll_init(struct httpd_data *hd);
+
+/**
+ * @brief   Frees the event backend. Calling it again has no effect.
+ *
+ * @param[in] hd  Server instance data
+ */
+void httpd_poll_deinit(struct httpd_data *hd);
+
+/**
+ * @brief   Starts watching the socket of a session
+ *
+ * @param[in] hd       Server instance data
+ * @param[in] session  Session
+ *
+ * @return
+ *  - ESP_OK   : on success
+ *  - ESP_FAIL : if the socket couldn't be watched
+ */
+esp_err_t httpd_poll_add(struct httpd_data *hd, struct sock_db *session);
+
+/**
+ * @brief   Stops watching the socket of a session and drops it from the
+ *          queue of pending sessions. Does nothing if it isn't watched.
+ *
+ * @param[in] hd       Server instance data
+ * @param[in] session  Session
+ */
+void httpd_poll_del(struct httpd_data *hd, struct sock_db *session);
+
+/**
+ * @brief   Starts or stops watching the listening socket, for example
+ *          when the maximum number of sessions is reached
+ *
+ * @param[in] hd      Server instance data
+ * @param[in] enable  Watch the listening socket
+ */
+void httpd_poll_listen(struct httpd_data *hd, bool enable);
+
+/**
+ * @brief   Queues a session for processing in the next httpd_poll_wait(),
+ *          regardless of new data arriving on its socket. This is needed
+ *          when data has already been received into user space buffers,
+ *          see httpd_sess_pending().
+ *
+ * @param[in] hd       Server instance data
+ * @param[in] session  Session
+ */
+void httpd_poll_set_pending(struct httpd_data *hd, struct sock_db *session);
+
+/**
+ * @brief   Starts or stops reporting a session as writable, for sessions
+ *          with queued output. The setting is kept while the session isn't
+ *          watched and applied again by httpd_poll_add().
+ *
+ * @param[in] hd       Server instance data
+ * @param[in] session  Session
+ * @param[in] enable   Report the session once its socket can send
+ */
+void httpd_poll_set_writable(struct httpd_data *hd, struct sock_db *session, bool enable);
+
+/**
+ * @brief   Waits until a watched socket becomes ready. Doesn't block if
+ *          sessions are queued as pending, these are reported as well.
+ *
+ * @note    The sessions are only valid until they are deleted, callers
+ *          should check their fd before processing them.
+ *
+ * @param[in]  hd     Server instance data
+ * @param[out] ready  Ready sockets and sessions
+ *
+ * @return
+ *  - ESP_OK   : on success
+ *  - ESP_FAIL : if waiting failed, eg. because of an invalid socket
+ */
+esp_err_t httpd_poll_wait(struct httpd_data *hd, struct httpd_poll_ready *ready);
+
+/** End of Group : Event Backend
+ * @}
+ */
+
+/****************** Group : Workers ********************/
+/** @name Workers
+ * Methods for processing requests in worker tasks
+ * @{
+ */
+
+/**
+ * @brief   Launches the worker tasks, if configured
+ *
+ * @param[in] hd  Server instance data
+ *
+ * @return
+ *  - ESP_OK : on success or if no workers are configured
+ *  - ESP_ERR_HTTPD_ALLOC_MEM : if memory allocation failed
+ *  - ESP_ERR_HTTPD_TASK : if a task couldn't be launched
+ */
+esp_err_t httpd_workers_start(struct httpd_data *hd);
+
+/**
+ * @brief   Stops the worker tasks, waiting for them to finish their
+ *          requests, and takes back the sessions they were processing
+ *
+ * @param[in] hd  Server instance data
+ */
+void httpd_workers_stop(struct httpd_data *hd);
+
+/**
+ * @brief   Frees the resources of stopped workers
+ *
+ * @param[in] hd  Server instance data
+ */
+void httpd_workers_free(struct httpd_data *hd);
+
+/**
+ * @brief   Returns the worker running the calling task
+ *
+ * @param[in] hd  Server instance data
+ *
+ * @return the worker, or NULL if not called from a worker task
+ */
+struct httpd_worker *httpd_worker_self(struct httpd_data *hd);
+
+/**
+ * @brief   Binds a new session to the worker with the fewest sessions
+ *
+ * @param[in] hd       Server instance data
+ * @param[in] session  Session
+ */
+void httpd_worker_bind(struct httpd_data *hd, struct sock_db *session);
+
+/**
+ * @brief   Releases the worker of a deleted session
+ *
+ * @param[in] hd       Server instance data
+ * @param[in] session  Session
+ */
+void httpd_worker_unbind(struct httpd_data *hd, struct sock_db *session);
+
+/**
+ * @brief   Hands a session with incoming data to its worker. The session's
+ *          socket isn't watched until the worker is done with it.
+ *
+ * @param[in] hd       Server instance data
+ * @param[in] session  Session
+ */
+void httpd_worker_dispatch(struct httpd_data *hd, struct sock_db *session);
+
+/**
+ * @brief   Checks if every worker has a request to process, in which
+ *          case new connections shouldn't be accepted
+ *
+ * @param[in] hd  Server instance data
+ *
+ * @return True if no worker is idle
+ */
+bool httpd_workers_saturated(struct httpd_data *hd);
+
+/** End of Group : Workers
+ * @}
+ */
+
 /****************** Group : URI Handling ********************/
 /** @name URI Handling
  * Methods for accessing URI handlers
@@ -294,13 +563,14 @@ void httpd_sess_close_all(struct httpd_data *hd);
  * @brief   For an HTTP request, searches through all the registered URI handlers
  *          and invokes the appropriate one if found
  *
- * @param[in] hd  Server instance data for which handler needs to be invoked
+ * @param[in] hd   Server instance data for which handler needs to be invoked
+ * @param[in] req  The parsed request
  *
  * @return
  *  - ESP_OK    : if handler found and executed successfully
  *  - ESP_FAIL  : otherwise
  */
-esp_err_t httpd_uri(struct httpd_data *hd);
+esp_err_t httpd_uri(struct httpd_data *hd, httpd_req_t *req);
 
 /**
  * @brief   Unregister all URI handlers
@@ -330,6 +600,70 @@ bool httpd_validate_req_ptr(httpd_req_t *r);
 #define httpd_valid_req(r)  true
 #endif
 
+#ifdef CONFIG_HTTPD_URI_ROUTER
+/**
+ * @brief   Checks whether the router can be used for the URI matching
+ *          function configured for the server instance. The router implements
+ *          exact matching (no matching function) and httpd_uri_match_wildcard().
+ *
+ * @param[in] hd  Server instance data
+ *
+ * @return True if httpd_router_find() can be used
+ */
+bool httpd_router_supported(struct httpd_data *hd);
+
+/**
+ * @brief   Adds a registered URI handler to the router
+ *
+ * @param[in] hd     Server instance data
+ * @param[in] uri    Registered URI handler, the template string must remain
+ *                   valid until the handler is removed from the router
+ * @param[in] order  Position of the handler in the list of registered handlers.
+ *                   If several handlers match a request, the one with the lowest
+ *                   position is taken, as with the linear search.
+ *
+ * @return
+ *  - ESP_OK                  : on success
+ *  - ESP_ERR_HTTPD_ALLOC_MEM : if the tree couldn't be extended
+ */
+esp_err_t httpd_router_add(struct httpd_data *hd, const httpd_uri_t *uri, unsigned order);
+
+/**
+ * @brief   Rebuilds the router from the list of registered URI handlers
+ *
+ * Needs to be called after handlers have been removed. If memory runs
+ * out, the router is marked as stale and the linear search is used instead.
+ *
+ * @param[in] hd  Server instance data
+ */
+void httpd_router_rebuild(struct httpd_data *hd);
+
+/**
+ * @brief   Frees the router of a server instance
+ *
+ * @param[in] hd  Server instance data
+ */
+void httpd_router_free(struct httpd_data *hd);
+
+/**
+ * @brief   Finds the URI handler for a request, with the same result as the
+ *          linear search through the registered handlers
+ *
+ * @param[in]  hd       Server instance data
+ * @param[in]  uri      Path of the request URI
+ * @param[in]  uri_len  Length of the path
+ * @param[in]  method   Request method
+ * @param[out] err      Set to HTTPD_404_NOT_FOUND or HTTPD_405_METHOD_NOT_ALLOWED
+ *                      if no handler was found, may be NULL
+ * @param[out] ra       If not NULL, receives the path parameters of the handler's template
+ *
+ * @return Matching URI handler or NULL
+ */
+httpd_uri_t *httpd_router_find(struct httpd_data *hd, const char *uri, size_t uri_len,
+                               httpd_method_t method, httpd_err_code_t *err,
+                               struct httpd_req_aux *ra);
+#endif /* CONFIG_HTTPD_URI_ROUTER */
+
 /** End of Group : URI Handling
  * @}
  */
@@ -349,25 +683,27 @@ bool httpd_validate_req_ptr(httpd_req_t *r);
  * http_recv() after this reads the body of the request.
  *
  * @param[in] hd  Server instance data
+ * @param[in] r   Request structure to be filled
+ * @param[in] ra  Auxiliary request data to be associated with r
  * @param[in] sd  Pointer to socket which is needed for receiving TCP packets.
  *
  * @return
  *  - ESP_OK    : if request packet is valid
  *  - ESP_FAIL  : otherwise
  */
-esp_err_t httpd_req_new(struct httpd_data *hd, struct sock_db *sd);
+esp_err_t httpd_req_new(struct httpd_data *hd, httpd_req_t *r, struct httpd_req_aux *ra, struct sock_db *sd);
 
 /**
  * @brief   For an HTTP request, resets the resources allocated for it and
  *          purges any data left to be received
  *
- * @param[in] hd  Server instance data
+ * @param[in] r   Request initiated by httpd_req_new()
  *
  * @return
  *  - ESP_OK    : if request packet deleted and resources cleaned.
  *  - ESP_FAIL  : otherwise.
  */
-esp_err_t httpd_req_delete(struct httpd_data *hd);
+esp_err_t httpd_req_delete(httpd_req_t *r);
 
 /**
  * @brief   For handling HTTP errors by invoking registered
@@ -405,6 +741,19 @@ esp_err_t httpd_req_handle_err(httpd_req_t *req, httpd_err_code_t error);
  */
 int httpd_send(httpd_req_t *req, const char *buf, size_t buf_len);
 
+/**
+ * @brief   For sending out all of the data, retrying partial sends
+ *
+ * @param[in] r       Pointer to the HTTP request for which the response needs to be sent
+ * @param[in] buf     Pointer to the buffer from where the body of the response is taken
+ * @param[in] buf_len Length of the buffer
+ *
+ * @return
+ *  - ESP_OK   : if all of the data was sent
+ *  - ESP_FAIL : if failed
+ */
+esp_err_t httpd_send_all(httpd_req_t *r, const char *buf, size_t buf_len);
+
 /**
  * @brief   For receiving HTTP request data
  *
@@ -520,6 +869,30 @@ esp_err_t httpd_ws_respond_server_handshake(httpd_req_t *req, const char *suppor
  */
 esp_err_t httpd_ws_get_frame_type(httpd_req_t *req);
 
+/**
+ * @brief   Sends as much of the frames queued by httpd_ws_broadcast() as the
+ *          socket takes without blocking, and watches the socket for room
+ *          in the send buffer while frames are left. Runs in the server task.
+ *          Nothing is sent while another task sends a frame to the session
+ *          with httpd_ws_send_frame_async(), which resumes sending afterwards.
+ *
+ * @param[in] hd       Server instance data
+ * @param[in] session  Session
+ *
+ * @return
+ *  - ESP_OK   : on success, even if frames are left
+ *  - ESP_FAIL : socket failures, the session should be closed
+ */
+esp_err_t httpd_ws_tx_flush(struct httpd_data *hd, struct sock_db *session);
+
+/**
+ * @brief   Drops the frames queued for a session, when it is closed
+ *
+ * @param[in] hd       Server instance data
+ * @param[in] session  Session
+ */
+void httpd_ws_tx_clear(struct httpd_data *hd, struct sock_db *session);
+
 /**
  * @brief   Trigger an httpd session close externally
  *
@@ -0,0 +1,371 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <esp_log.h>
+#include <esp_err.h>
+#ifdef CONFIG_IDF_TARGET_LINUX
+#include <sys/sendfile.h>
+#endif
+
+#include <esp_http_server.h>
+#include "esp_httpd_priv.h"
+
+static const char *TAG = "httpd_file";
+
+/* Longest accepted value of the conditional and range request headers,
+ * longer values are ignored and the whole content is sent */
+#define HTTPD_COND_HDR_LEN  96
+
+/* Quoted hexadecimal modification time and size */
+#define HTTPD_ETAG_LEN      (2 * 8 + 4)
+
+/* e.g. "Sun, 06 Nov 1994 08:49:37 GMT" */
+#define HTTPD_DATE_LEN      32
+
+/**
+ * @brief   Content of a static response, either mapped into memory or read from a file
+ */
+struct httpd_static {
+    const char *data;                   /*!< Mapped content, NULL if read from fd */
+    int         fd;                     /*!< File descriptor, if data is NULL */
+    size_t      size;                   /*!< Size of the whole content */
+    const char *etag;                   /*!< Entity tag including the quotes, may be NULL */
+    const char *last_modified;          /*!< Modification date, may be NULL */
+};
+
+/* Headers of the response are gathered in the scratch buffer, which
+ * no longer holds the request headers, and sent with few calls to
+ * send_fn. Strings which don't fit are sent right away. */
+static esp_err_t httpd_hdr_add(httpd_req_t *r, size_t *used, const char *str)
+{
+    struct httpd_req_aux *ra = r->aux;
+    size_t len = strlen(str);
+
+    if (*used + len > sizeof(ra->scratch)) {
+        if (httpd_send_all(r, ra->scratch, *used) != ESP_OK) {
+            return ESP_ERR_HTTPD_RESP_SEND;
+        }
+        *used = 0;
+        if (len > sizeof(ra->scratch)) {
+            return httpd_send_all(r, str, len) == ESP_OK ? ESP_OK : ESP_ERR_HTTPD_RESP_SEND;
+        }
+    }
+    memcpy(ra->scratch + *used, str, len);
+    *used += len;
+    return ESP_OK;
+}
+
+static esp_err_t httpd_hdr_add_field(httpd_req_t *r, size_t *used, const char *field, const char *value)
+{
+    if (httpd_hdr_add(r, used, field) != ESP_OK ||
+            httpd_hdr_add(r, used, ": ") != ESP_OK ||
+            httpd_hdr_add(r, used, value) != ESP_OK ||
+            httpd_hdr_add(r, used, "\r\n") != ESP_OK) {
+        return ESP_ERR_HTTPD_RESP_SEND;
+    }
+    return ESP_OK;
+}
+
+/* Checks if the entity tag is in the comma separated list of an If-None-Match
+ * header. The weak comparison is used, so W/ prefixes are ignored. */
+static bool httpd_etag_listed(const char *list, const char *etag)
+{
+    size_t etag_len = strlen(etag);
+    while (*list) {
+        list += strspn(list, " \t,");
+        if (*list == '*') {
+            return true;
+        }
+        if (strncmp(list, "W/", 2) == 0) {
+            list += 2;
+        }
+        size_t len = strcspn(list, " \t,");
+        if (len == etag_len && strncmp(list, etag, len) == 0) {
+            return true;
+        }
+        list += len;
+    }
+    return false;
+}
+
+/* Parses a single "bytes=first-last" range, with either bound left out.
+ * Returns ESP_ERR_INVALID_SIZE if no byte of the content is in the range,
+ * ESP_ERR_NOT_SUPPORTED if the header has to be ignored because of a
+ * syntax error or multiple ranges. */
+static esp_err_t httpd_parse_range(const char *hdr, size_t size, size_t *start, size_t *end)
+{
+    if (strncmp(hdr, "bytes=", 6) != 0 || strchr(hdr, ',')) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    hdr += 6;
+
+    char *endptr;
+    if (*hdr == '-') {
+        /* Suffix length */
+        unsigned long long suffix = strtoull(hdr + 1, &endptr, 10);
+        if (endptr == hdr + 1 || *endptr != '\0') {
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        if (suffix == 0 || size == 0) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        *start = suffix < size ? size - suffix : 0;
+        *end = size - 1;
+        return ESP_OK;
+    }
+
+    if (*hdr < '0' || *hdr > '9') {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    unsigned long long first = strtoull(hdr, &endptr, 10);
+    if (*endptr != '-') {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    hdr = endptr + 1;
+    unsigned long long last = SIZE_MAX;
+    if (*hdr != '\0') {
+        if (*hdr < '0' || *hdr > '9') {
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        last = strtoull(hdr, &endptr, 10);
+        if (*endptr != '\0' || last < first) {
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+    }
+    if (first >= size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    *start = first;
+    *end = last < size ? last : size - 1;
+    return ESP_OK;
+}
+
+static esp_err_t httpd_send_content(httpd_req_t *r, const struct httpd_static *st, size_t start, size_t len)
+{
+    struct httpd_req_aux *ra = r->aux;
+    if (st->data) {
+        /* Straight from the mapped region */
+        return httpd_send_all(r, st->data + start, len) == ESP_OK ? ESP_OK : ESP_ERR_HTTPD_RESP_SEND;
+    }
+
+#ifdef CONFIG_IDF_TARGET_LINUX
+    /* Let the kernel copy the file into the socket, unless the
+     * session has its own send function, e.g. for TLS */
+    if (ra->sd->send_fn == httpd_default_send) {
+        off_t offset = start;
+        while (len > 0) {
+            ssize_t sent = sendfile(ra->sd->fd, st->fd, &offset, len);
+            if (sent <= 0) {
+                ESP_LOGD(TAG, LOG_FMT("error in sendfile (%d)"), errno);
+                return ESP_ERR_HTTPD_RESP_SEND;
+            }
+            len -= sent;
+        }
+        return ESP_OK;
+    }
+#endif
+
+    /* The scratch buffer is free once the headers are sent,
+     * no other buffer is needed to read the file */
+    if (lseek(st->fd, start, SEEK_SET) < 0) {
+        ESP_LOGW(TAG, LOG_FMT("error in lseek (%d)"), errno);
+        return ESP_FAIL;
+    }
+    while (len > 0) {
+        ssize_t read_len = read(st->fd, ra->scratch, MIN(len, sizeof(ra->scratch)));
+        if (read_len <= 0) {
+            ESP_LOGW(TAG, LOG_FMT("error in read (%d)"), errno);
+            return ESP_FAIL;
+        }
+        if (httpd_send_all(r, ra->scratch, read_len) != ESP_OK) {
+            return ESP_ERR_HTTPD_RESP_SEND;
+        }
+        len -= read_len;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t httpd_resp_send_static(httpd_req_t *r, const struct httpd_static *st)
+{
+    struct httpd_req_aux *ra = r->aux;
+    enum {
+        SEND_ALL,
+        SEND_RANGE,
+        NOT_MODIFIED,
+        NOT_SATISFIABLE,
+    } reply = SEND_ALL;
+    size_t start = 0;
+    size_t end = st->size - 1;
+    char hdr[HTTPD_COND_HDR_LEN];
+
+    /* Conditional and range requests only apply to successful responses
+     * with the whole content, not e.g. to custom error pages */
+    bool cond = strcmp(ra->status, HTTPD_200) == 0 &&
+                (r->method == HTTP_GET || r->method == HTTP_HEAD);
+
+    if (cond && st->etag &&
+            httpd_req_get_hdr_value_str(r, "If-None-Match", hdr, sizeof(hdr)) == ESP_OK) {
+        if (httpd_etag_listed(hdr, st->etag)) {
+            reply = NOT_MODIFIED;
+        }
+    } else if (cond && st->last_modified &&
+               httpd_req_get_hdr_value_str(r, "If-Modified-Since", hdr, sizeof(hdr)) == ESP_OK) {
+        /* Exact match only, dates aren't parsed */
+        if (strcmp(hdr, st->last_modified) == 0) {
+            reply = NOT_MODIFIED;
+        }
+    }
+
+    if (reply == SEND_ALL && cond &&
+            httpd_req_get_hdr_value_str(r, "Range", hdr, sizeof(hdr)) == ESP_OK) {
+        char if_range[HTTPD_COND_HDR_LEN];
+        /* The range is ignored if the content changed since the client got part of it */
+        bool unchanged = true;
+        if (httpd_req_get_hdr_value_str(r, "If-Range", if_range, sizeof(if_range)) == ESP_OK) {
+            unchanged = (st->etag && strcmp(if_range, st->etag) == 0) ||
+                        (st->last_modified && strcmp(if_range, st->last_modified) == 0);
+        }
+        if (unchanged) {
+            esp_err_t ret = httpd_parse_range(hdr, st->size, &start, &end);
+            if (ret == ESP_OK) {
+                reply = SEND_RANGE;
+            } else if (ret == ESP_ERR_INVALID_SIZE) {
+                reply = NOT_SATISFIABLE;
+            }
+        }
+    }
+
+    /* Request headers are no longer available */
+    ra->req_hdrs_count = 0;
+
+    size_t used = 0;
+    char line[48];
+    const char *status = reply == SEND_RANGE ? HTTPD_206 :
+                         reply == NOT_MODIFIED ? HTTPD_304 :
+                         reply == NOT_SATISFIABLE ? HTTPD_416 : ra->status;
+    if (httpd_hdr_add(r, &used, "HTTP/1.1 ") != ESP_OK ||
+            httpd_hdr_add(r, &used, status) != ESP_OK ||
+            httpd_hdr_add(r, &used, "\r\n") != ESP_OK) {
+        return ESP_ERR_HTTPD_RESP_SEND;
+    }
+
+    size_t len = 0;
+    if (reply == NOT_MODIFIED) {
+        /* No content and no content headers */
+    } else if (reply == NOT_SATISFIABLE) {
+        snprintf(line, sizeof(line), "bytes */%u", (unsigned) st->size);
+        if (httpd_hdr_add_field(r, &used, "Content-Range", line) != ESP_OK ||
+                httpd_hdr_add_field(r, &used, "Content-Length", "0") != ESP_OK) {
+            return ESP_ERR_HTTPD_RESP_SEND;
+        }
+    } else {
+        len = st->size ? end - start + 1 : 0;
+        snprintf(line, sizeof(line), "%u", (unsigned) len);
+        if (httpd_hdr_add_field(r, &used, "Content-Type", ra->content_type) != ESP_OK ||
+                httpd_hdr_add_field(r, &used, "Content-Length", line) != ESP_OK) {
+            return ESP_ERR_HTTPD_RESP_SEND;
+        }
+        if (reply == SEND_RANGE) {
+            snprintf(line, sizeof(line), "bytes %u-%u/%u",
+                     (unsigned) start, (unsigned) end, (unsigned) st->size);
+            if (httpd_hdr_add_field(r, &used, "Content-Range", line) != ESP_OK) {
+                return ESP_ERR_HTTPD_RESP_SEND;
+            }
+        }
+        if (cond && httpd_hdr_add_field(r, &used, "Accept-Ranges", "bytes") != ESP_OK) {
+            return ESP_ERR_HTTPD_RESP_SEND;
+        }
+    }
+
+    if (st->etag && httpd_hdr_add_field(r, &used, "ETag", st->etag) != ESP_OK) {
+        return ESP_ERR_HTTPD_RESP_SEND;
+    }
+    if (st->last_modified && httpd_hdr_add_field(r, &used, "Last-Modified", st->last_modified) != ESP_OK) {
+        return ESP_ERR_HTTPD_RESP_SEND;
+    }
+
+    /* Additional headers based on set_header */
+    for (unsigned i = 0; i < ra->resp_hdrs_count; i++) {
+        if (httpd_hdr_add_field(r, &used, ra->resp_hdrs[i].field, ra->resp_hdrs[i].value) != ESP_OK) {
+            return ESP_ERR_HTTPD_RESP_SEND;
+        }
+    }
+
+    /* End header section */
+    if (httpd_hdr_add(r, &used, "\r\n") != ESP_OK ||
+            httpd_send_all(r, ra->scratch, used) != ESP_OK) {
+        return ESP_ERR_HTTPD_RESP_SEND;
+    }
+
+    if (r->method == HTTP_HEAD || len == 0) {
+        return ESP_OK;
+    }
+    ESP_LOGD(TAG, LOG_FMT("sending %u bytes from offset %u"), (unsigned) len, (unsigned) start);
+    return httpd_send_content(r, st, start, len);
+}
+
+esp_err_t httpd_resp_send_file(httpd_req_t *r, int fd)
+{
+    if (r == NULL || fd < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!httpd_valid_req(r)) {
+        return ESP_ERR_HTTPD_INVALID_REQ;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ESP_LOGW(TAG, LOG_FMT("error in fstat (%d)"), errno);
+        return ESP_FAIL;
+    }
+
+    struct httpd_static content = {
+        .fd = fd,
+        .size = st.st_size,
+    };
+
+    /* Without a modification time, changes to the file can't be detected */
+    char etag[HTTPD_ETAG_LEN];
+    char last_modified[HTTPD_DATE_LEN];
+    if (st.st_mtime > 0) {
+        struct tm tm;
+        snprintf(etag, sizeof(etag), "\"%" PRIx32 "-%" PRIx32 "\"",
+                 (uint32_t) st.st_mtime, (uint32_t) st.st_size);
+        content.etag = etag;
+        if (gmtime_r(&st.st_mtime, &tm) &&
+                strftime(last_modified, sizeof(last_modified), "%a, %d %b %Y %H:%M:%S GMT", &tm)) {
+            content.last_modified = last_modified;
+        }
+    }
+    return httpd_resp_send_static(r, &content);
+}
+
+esp_err_t httpd_resp_send_mmap(httpd_req_t *r, const void *data, size_t len, const char *etag)
+{
+    if (r == NULL || (data == NULL && len)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!httpd_valid_req(r)) {
+        return ESP_ERR_HTTPD_INVALID_REQ;
+    }
+
+    struct httpd_static content = {
+        .data = data,
+        .fd = -1,
+        .size = len,
+        .etag = etag,
+    };
+    return httpd_resp_send_static(r, &content);
+}
@@ -16,11 +16,6 @@
 #include "esp_httpd_priv.h"
 #include "ctrl_sock.h"
 
-typedef struct {
-    fd_set *fdset;
-    struct httpd_data *hd;
-} process_session_context_t;
-
 static const char *TAG = "httpd";
 
 static esp_err_t httpd_accept_conn(struct httpd_data *hd, int listen_fd)
@@ -159,58 +154,23 @@ static void httpd_process_ctrl_msg(struct httpd_data *hd)
     }
 }
 
-// Called for each session from httpd_server
-static int httpd_process_session(struct sock_db *session, void *context)
-{
-    if ((!session) || (!context)) {
-        return 0;
-    }
-
-    if (session->fd < 0) {
-        return 1;
-    }
-
-    process_session_context_t *ctx = (process_session_context_t *)context;
-    int fd = session->fd;
-
-    if (FD_ISSET(fd, ctx->fdset) || httpd_sess_pending(ctx->hd, session)) {
-        ESP_LOGD(TAG, LOG_FMT("processing socket %d"), fd);
-        if (httpd_sess_process(ctx->hd, session) != ESP_OK) {
-            httpd_sess_delete(ctx->hd, session); // Delete session
-        }
-    }
-    return 1;
-}
-
 /* Manage in-coming connection or data requests */
 static esp_err_t httpd_server(struct httpd_data *hd)
 {
-    fd_set read_set;
-    FD_ZERO(&read_set);
-    if (hd->config.lru_purge_enable || httpd_is_sess_available(hd)) {
-        /* Only listen for new connections if server has capacity to
-         * handle more (or when LRU purge is enabled, in which case
-         * older connections will be closed) */
-        FD_SET(hd->listen_fd, &read_set);
-    }
-    FD_SET(hd->ctrl_fd, &read_set);
-
-    int tmp_max_fd;
-    httpd_sess_set_descriptors(hd, &read_set, &tmp_max_fd);
-    int maxfd = MAX(hd->listen_fd, tmp_max_fd);
-    tmp_max_fd = maxfd;
-    maxfd = MAX(hd->ctrl_fd, tmp_max_fd);
-
-    ESP_LOGD(TAG, LOG_FMT("doing select maxfd+1 = %d"), maxfd + 1);
-    int active_cnt = select(maxfd + 1, &read_set, NULL, NULL, NULL);
-    if (active_cnt < 0) {
-        ESP_LOGE(TAG, LOG_FMT("error in select (%d)"), errno);
+    /* Only listen for new connections if server has capacity to
+     * handle more (or when LRU purge is enabled, in which case
+     * older connections will be closed) */
+    httpd_poll_listen(hd, (hd->config.lru_purge_enable || httpd_is_sess_available(hd)) &&
+                      !httpd_workers_saturated(hd));
+
+    struct httpd_poll_ready ready;
+    if (httpd_poll_wait(hd, &ready) != ESP_OK) {
         httpd_sess_delete_invalid(hd);
         return ESP_OK;
     }
 
     /* Case0: Do we have a control message? */
-    if (FD_ISSET(hd->ctrl_fd, &read_set)) {
+    if (ready.ctrl) {
         ESP_LOGD(TAG, LOG_FMT("processing ctrl message"));
         httpd_process_ctrl_msg(hd);
         if (hd->hd_td.status == THREAD_STOPPING) {
@@ -219,17 +179,47 @@ static esp_err_t httpd_server(struct httpd_data *hd)
         }
     }
 
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    /* Can frames waiting for slow clients be sent now? */
+    for (unsigned i = 0; i < ready.writable_count; i++) {
+        struct sock_db *session = ready.writable[i];
+        if (session->fd < 0 || session->worker_busy) {
+            continue;
+        }
+        if (httpd_ws_tx_flush(hd, session) != ESP_OK) {
+            httpd_sess_delete(hd, session);
+        }
+    }
+#endif
+
     /* Case1: Do we have any activity on the current data
-     * sessions? */
-    process_session_context_t context = {
-        .fdset = &read_set,
-        .hd = hd
-    };
-    httpd_sess_enum(hd, httpd_process_session, &context);
+     * sessions? Only the ready ones are visited. */
+    for (unsigned i = 0; i < ready.count; i++) {
+        struct sock_db *session = ready.sessions[i];
+        /* The session may have been closed by a control message */
+        if (session->fd < 0) {
+            continue;
+        }
+        if (hd->hd_workers) {
+            ESP_LOGD(TAG, LOG_FMT("dispatching socket %d"), session->fd);
+            httpd_worker_dispatch(hd, session);
+            continue;
+        }
+        ESP_LOGD(TAG, LOG_FMT("processing socket %d"), session->fd);
+        if (httpd_sess_process(hd, session, &hd->hd_req, &hd->hd_req_aux) != ESP_OK) {
+            httpd_sess_delete(hd, session); // Delete session
+            continue;
+        }
+        session->lru_counter = ++hd->lru_counter;
+        if (httpd_sess_pending(hd, session)) {
+            /* Data was already received, don't wait for more */
+            httpd_poll_set_pending(hd, session);
+        }
+    }
 
     /* Case2: Do we have any incoming connection requests to
      * process? */
-    if (FD_ISSET(hd->listen_fd, &read_set)) {
+    if (ready.listen) {
         ESP_LOGD(TAG, LOG_FMT("processing listen socket %d"), hd->listen_fd);
         if (httpd_accept_conn(hd, hd->listen_fd) != ESP_OK) {
             ESP_LOGW(TAG, LOG_FMT("error accepting new connection"));
@@ -254,6 +244,8 @@ static void httpd_thread(void *arg)
     }
 
     ESP_LOGD(TAG, LOG_FMT("web server exiting"));
+    /* The workers may still notify the server through the control socket */
+    httpd_workers_stop(hd);
     close(hd->msg_fd);
     cs_free_ctrl_sock(hd->ctrl_fd);
     httpd_sess_close_all(hd);
@@ -330,6 +322,14 @@ static esp_err_t httpd_server_init(struct httpd_data *hd)
     hd->listen_fd = fd;
     hd->ctrl_fd = ctrl_fd;
     hd->msg_fd  = msg_fd;
+
+    if (httpd_poll_init(hd) != ESP_OK) {
+        ESP_LOGE(TAG, LOG_FMT("error in creating event backend"));
+        close(fd);
+        cs_free_ctrl_sock(ctrl_fd);
+        close(msg_fd);
+        return ESP_FAIL;
+    }
     return ESP_OK;
 }
 
@@ -372,6 +372,18 @@ static struct httpd_data *httpd_create(const httpd_config_t *config)
         free(hd);
         return NULL;
     }
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    hd->hd_ws_tx_lock = httpd_os_mutex_create();
+    if (!hd->hd_ws_tx_lock) {
+        ESP_LOGE(TAG, LOG_FMT("Failed to create the lock of the WebSocket send queues"));
+        free(hd->err_handler_fns);
+        free(ra->resp_hdrs);
+        free(hd->hd_sd);
+        free(hd->hd_calls);
+        free(hd);
+        return NULL;
+    }
+#endif
     /* Save the configuration for this instance */
     hd->config = *config;
     return hd;
@@ -383,11 +395,16 @@ static void httpd_delete(struct httpd_data *hd)
     /* Free memory of httpd instance data */
     free(hd->err_handler_fns);
     free(ra->resp_hdrs);
+    httpd_workers_free(hd);
+    httpd_poll_deinit(hd);
     free(hd->hd_sd);
 
     /* Free registered URI handlers */
     httpd_unregister_all_uri_handlers(hd);
     free(hd->hd_calls);
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    httpd_os_mutex_delete(hd->hd_ws_tx_lock);
+#endif
     free(hd);
 }
 
@@ -407,12 +424,14 @@ esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
      *     3) for receiving control messages over UDP
      * So the total number of required sockets is max_open_sockets + 3
      */
+#ifndef CONFIG_IDF_TARGET_LINUX
     if (CONFIG_LWIP_MAX_SOCKETS < config->max_open_sockets + 3) {
         ESP_LOGE(TAG, "Configuration option max_open_sockets is too large (max allowed %d)\n\t"
                  "Either decrease this or configure LWIP_MAX_SOCKETS to a larger value",
                  CONFIG_LWIP_MAX_SOCKETS - 3);
         return ESP_ERR_INVALID_ARG;
     }
+#endif
 
     struct httpd_data *hd = httpd_create(config);
     if (hd == NULL) {
@@ -426,12 +445,18 @@ esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
     }
 
     httpd_sess_init(hd);
+    esp_err_t err = httpd_workers_start(hd);
+    if (err != ESP_OK) {
+        httpd_delete(hd);
+        return err;
+    }
     if (httpd_os_thread_create(&hd->hd_td.handle, "httpd",
                                hd->config.stack_size,
                                hd->config.task_priority,
                                httpd_thread, hd,
                                hd->config.core_id) != ESP_OK) {
         /* Failed to launch task */
+        httpd_workers_stop(hd);
         httpd_delete(hd);
         return ESP_ERR_HTTPD_TASK;
     }
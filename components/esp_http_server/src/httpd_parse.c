@@ -6,6 +6,7 @@
 
 
 #include <stdlib.h>
+#include <ctype.h>
 #include <sys/param.h>
 #include <esp_log.h>
 #include <esp_err.h>
@@ -46,12 +47,62 @@ typedef struct {
         size_t      length;
     } last;
 
+    /* Start of the field of the header being parsed */
+    const char *field;
+
     /* State variables */
     bool   paused;          /*!< Parser is paused */
     size_t pre_parsed;      /*!< Length of data to be skipped while parsing */
     size_t raw_datalen;     /*!< Full length of the raw data in scratch buffer */
 } parser_data_t;
 
+/* Case insensitive FNV-1a, folded to 16 bits */
+static uint16_t httpd_hdr_hash(const char *field, size_t len)
+{
+    uint32_t hash = 2166136261U;
+    while (len--) {
+        hash = (hash ^ (uint8_t) tolower((unsigned char) *field++)) * 16777619U;
+    }
+    return (uint16_t) (hash ^ (hash >> 16));
+}
+
+/* Adds the header which was just parsed to the index of request headers,
+ * so that lookups don't have to scan the headers section. The index only
+ * covers leading headers, headers which don't fit are scanned for. */
+static void index_header(parser_data_t *parser_data)
+{
+    struct httpd_req_aux *ra = parser_data->req->aux;
+    if (ra->req_hdrs_indexed != ra->req_hdrs_count ||
+        ra->req_hdrs_indexed == CONFIG_HTTPD_MAX_REQ_HDRS_INDEXED) {
+        return;
+    }
+
+    const char *field = parser_data->field;
+    const char *end = parser_data->last.at + parser_data->last.length;
+    const char *val_ptr = memchr(field, ':', end - field);
+    if (!val_ptr) {
+        return;
+    }
+    size_t field_len = val_ptr - field;
+
+    /* Skip ':' and preceding space */
+    val_ptr++;
+    while (val_ptr < end && *val_ptr == ' ') {
+        val_ptr++;
+    }
+    size_t value_len = end - val_ptr;
+    if (field_len > UINT16_MAX || value_len > UINT16_MAX) {
+        return;
+    }
+
+    struct httpd_req_hdr_index *entry = &ra->req_hdrs[ra->req_hdrs_indexed++];
+    entry->field     = field;
+    entry->field_len = field_len;
+    entry->value     = val_ptr;
+    entry->value_len = value_len;
+    entry->hash      = httpd_hdr_hash(field, field_len);
+}
+
 static esp_err_t verify_url (http_parser *parser)
 {
     parser_data_t *parser_data  = (parser_data_t *) parser->data;
@@ -220,6 +271,8 @@ static esp_err_t cb_header_field(http_parser *parser, const char *at, size_t len
             return ESP_FAIL;
         }
     } else if (parser_data->status == PARSING_HDR_VALUE) {
+        index_header(parser_data);
+
         /* Overwrite terminator (CRLFs) following last header
          * (key: value) pair with null characters */
         char *term_start = (char *)parser_data->last.at + parser_data->last.length;
@@ -256,6 +309,7 @@ static esp_err_t cb_header_value(http_parser *parser, const char *at, size_t len
     /* Check previous status */
     if (parser_data->status == PARSING_HDR_FIELD) {
         /* Store current values of the parser callback arguments */
+        parser_data->field       = parser_data->last.at;
         parser_data->last.at     = at;
         parser_data->last.length = 0;
         parser_data->status      = PARSING_HDR_VALUE;
@@ -310,6 +364,8 @@ static esp_err_t cb_headers_complete(http_parser *parser)
             return ESP_FAIL;
         }
     } else if (parser_data->status == PARSING_HDR_VALUE) {
+        index_header(parser_data);
+
         /* Locate end of last header */
         char *at = (char *)parser_data->last.at + parser_data->last.length;
 
@@ -614,9 +670,8 @@ static void parse_init(httpd_req_t *r, http_parser *parser, parser_data_t *data)
 
 /* Function that receives TCP data and runs parser on it
  */
-static esp_err_t httpd_parse_req(struct httpd_data *hd)
+static esp_err_t httpd_parse_req(struct httpd_data *hd, httpd_req_t *r)
 {
-    httpd_req_t *r = &hd->hd_req;
     int blk_len,  offset;
     http_parser   parser;
     parser_data_t parser_data;
@@ -656,7 +711,7 @@ static esp_err_t httpd_parse_req(struct httpd_data *hd)
     } while (parser_data.status != PARSING_COMPLETE);
 
     ESP_LOGD(TAG, LOG_FMT("parsing complete"));
-    return httpd_uri(hd);
+    return httpd_uri(hd, r);
 }
 
 static void init_req(httpd_req_t *r, httpd_config_t *config)
@@ -681,9 +736,13 @@ static void init_req_aux(struct httpd_req_aux *ra, httpd_config_t *config)
     ra->content_type = 0;
     ra->first_chunk_sent = 0;
     ra->req_hdrs_count = 0;
+    ra->req_hdrs_indexed = 0;
     ra->resp_hdrs_count = 0;
 #if CONFIG_HTTPD_WS_SUPPORT
     ra->ws_handshake_detect = false;
+#endif
+#ifdef CONFIG_HTTPD_URI_ROUTER
+    ra->path_params_count = 0;
 #endif
     memset(ra->resp_hdrs, 0, config->max_resp_headers * sizeof(struct resp_hdr));
 }
@@ -720,16 +779,14 @@ static void httpd_req_cleanup(httpd_req_t *r)
 /* Function that processes incoming TCP data and
  * updates the http request data httpd_req_t
  */
-esp_err_t httpd_req_new(struct httpd_data *hd, struct sock_db *sd)
+esp_err_t httpd_req_new(struct httpd_data *hd, httpd_req_t *r, struct httpd_req_aux *ra, struct sock_db *sd)
 {
-    httpd_req_t *r = &hd->hd_req;
     init_req(r, &hd->config);
-    init_req_aux(&hd->hd_req_aux, &hd->config);
+    init_req_aux(ra, &hd->config);
     r->handle = hd;
-    r->aux = &hd->hd_req_aux;
+    r->aux = ra;
 
     /* Associate the request to the socket */
-    struct httpd_req_aux *ra = r->aux;
     ra->sd = sd;
 
     /* Set defaults */
@@ -781,7 +838,7 @@ esp_err_t httpd_req_new(struct httpd_data *hd, struct sock_db *sd)
 #endif
 
     /* Parse request */
-    ret = httpd_parse_req(hd);
+    ret = httpd_parse_req(hd, r);
     if (ret != ESP_OK) {
         httpd_req_cleanup(r);
     }
@@ -790,9 +847,8 @@ esp_err_t httpd_req_new(struct httpd_data *hd, struct sock_db *sd)
 
 /* Function that resets the http request data
  */
-esp_err_t httpd_req_delete(struct httpd_data *hd)
+esp_err_t httpd_req_delete(httpd_req_t *r)
 {
-    httpd_req_t *r = &hd->hd_req;
     struct httpd_req_aux *ra = r->aux;
 
     /* Finish off reading any pending/leftover data */
@@ -832,8 +888,9 @@ bool httpd_validate_req_ptr(httpd_req_t *r)
         struct httpd_data *hd = (struct httpd_data *) r->handle;
         if (hd) {
             /* Check if this function is running in the context of
-             * the correct httpd server thread */
-            if (httpd_os_thread_handle() == hd->hd_td.handle) {
+             * the correct httpd server thread or one of its workers */
+            if (httpd_os_thread_handle() == hd->hd_td.handle ||
+                    httpd_worker_self(hd)) {
                 return true;
             }
         }
@@ -949,59 +1006,138 @@ esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len)
     return ESP_ERR_NOT_FOUND;
 }
 
-/* Get the length of the value string of a header request field */
-size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field)
+esp_err_t httpd_req_get_path_param(httpd_req_t *r, const char *name, char *val, size_t val_size)
 {
-    if (r == NULL || field == NULL) {
-        return 0;
+    if (r == NULL || name == NULL || val == NULL) {
+        return ESP_ERR_INVALID_ARG;
     }
 
     if (!httpd_valid_req(r)) {
-        return 0;
+        return ESP_ERR_HTTPD_INVALID_REQ;
     }
 
+#ifdef CONFIG_HTTPD_URI_ROUTER
     struct httpd_req_aux *ra = r->aux;
-    const char   *hdr_ptr = ra->scratch;         /*!< Request headers are kept in scratch buffer */
-    unsigned      count   = ra->req_hdrs_count;  /*!< Count set during parsing  */
-
-    while (count--) {
-        /* Search for the ':' character. Else, it would mean
-         * that the field is invalid
-         */
-        const char *val_ptr = strchr(hdr_ptr, ':');
-        if (!val_ptr) {
-            break;
-        }
+    size_t name_len = strlen(name);
 
-        /* If the field, does not match, continue searching.
-         * Compare lengths first as field from header is not
-         * null terminated (has ':' in the end).
-         */
-        if ((val_ptr - hdr_ptr != strlen(field)) ||
-            (strncasecmp(hdr_ptr, field, strlen(field)))) {
-            if (count) {
-                /* Jump to end of header field-value string */
-                hdr_ptr = 1 + strchr(hdr_ptr, '\0');
-
-                /* Skip all null characters (with which the line
-                 * terminators had been overwritten) */
-                while (*hdr_ptr == '\0') {
-                    hdr_ptr++;
-                }
-            }
+    for (unsigned i = 0; i < ra->path_params_count; i++) {
+        const struct httpd_path_param *p = &ra->path_params[i];
+        if (p->name_len != name_len || strncmp(p->name, name, name_len) != 0) {
             continue;
         }
 
-        /* Skip ':' */
+        /* Minimum required buffer len for keeping
+         * null terminated value string */
+        size_t min_val_size = p->value_len + 1;
+
+        strlcpy(val, p->value, MIN(val_size, min_val_size));
+        if (val_size < min_val_size) {
+            return ESP_ERR_HTTPD_RESULT_TRUNC;
+        }
+        return ESP_OK;
+    }
+#endif
+    return ESP_ERR_NOT_FOUND;
+}
+
+/* Start of the header line following the given one, the line
+ * terminators having been overwritten with null characters */
+static const char *httpd_hdr_next_line(const char *line)
+{
+    line = 1 + strchr(line, '\0');
+    while (*line == '\0') {
+        line++;
+    }
+    return line;
+}
+
+/* Splits a header line which wasn't indexed into field and value */
+static bool httpd_hdr_parse_line(const char *line, httpd_req_hdr_t *hdr)
+{
+    /* Search for the ':' character. Else, it would mean
+     * that the field is invalid */
+    const char *val_ptr = strchr(line, ':');
+    if (!val_ptr) {
+        return false;
+    }
+    hdr->field = line;
+    hdr->field_len = val_ptr - line;
+
+    /* Skip ':' and preceding space */
+    val_ptr++;
+    while (*val_ptr == ' ') {
         val_ptr++;
+    }
+    hdr->value = val_ptr;
+    hdr->value_len = strlen(val_ptr);
+    return true;
+}
 
-        /* Skip preceding space */
-        while ((*val_ptr != '\0') && (*val_ptr == ' ')) {
-            val_ptr++;
+/* Finds a request header by field name, or by position if field is NULL.
+ * Headers beyond the index are found by scanning the header lines which
+ * follow the last indexed one. */
+static bool httpd_req_find_hdr(struct httpd_req_aux *ra, const char *field, size_t index, httpd_req_hdr_t *hdr)
+{
+    unsigned count = ra->req_hdrs_count;
+    unsigned indexed = MIN(ra->req_hdrs_indexed, count);
+    size_t field_len = 0;
+
+    if (field) {
+        field_len = strlen(field);
+        uint16_t hash = httpd_hdr_hash(field, field_len);
+        /* Stops at the first unindexed header if the field isn't indexed */
+        for (index = 0; index < indexed; index++) {
+            const struct httpd_req_hdr_index *entry = &ra->req_hdrs[index];
+            if (entry->hash == hash && entry->field_len == field_len &&
+                !strncasecmp(entry->field, field, field_len)) {
+                break;
+            }
         }
-        return strlen(val_ptr);
     }
-    return 0;
+    if (index < indexed) {
+        const struct httpd_req_hdr_index *entry = &ra->req_hdrs[index];
+        hdr->field     = entry->field;
+        hdr->field_len = entry->field_len;
+        hdr->value     = entry->value;
+        hdr->value_len = entry->value_len;
+        return true;
+    }
+    if (index >= count) {
+        return false;
+    }
+
+    const char *line = indexed ? httpd_hdr_next_line(ra->req_hdrs[indexed - 1].field) : ra->scratch;
+    for (unsigned i = indexed; i < count; i++) {
+        if (i > indexed) {
+            line = httpd_hdr_next_line(line);
+        }
+        if (!httpd_hdr_parse_line(line, hdr)) {
+            return false;
+        }
+        if (field ? (hdr->field_len == field_len && !strncasecmp(hdr->field, field, field_len))
+                  : (i == index)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Get the length of the value string of a header request field */
+size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field)
+{
+    if (r == NULL || field == NULL) {
+        return 0;
+    }
+
+    if (!httpd_valid_req(r)) {
+        return 0;
+    }
+
+    httpd_req_hdr_t hdr;
+    if (!httpd_req_find_hdr(r->aux, field, 0, &hdr)) {
+        return 0;
+    }
+    return hdr.value_len;
 }
 
 /* Get the value of a field from the request headers */
@@ -1015,60 +1151,35 @@ esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *v
         return ESP_ERR_HTTPD_INVALID_REQ;
     }
 
-    struct httpd_req_aux *ra = r->aux;
-    const char   *hdr_ptr = ra->scratch;         /*!< Request headers are kept in scratch buffer */
-    unsigned     count    = ra->req_hdrs_count;  /*!< Count set during parsing  */
-    const size_t buf_len  = val_size;
-
-    while (count--) {
-        /* Search for the ':' character. Else, it would mean
-         * that the field is invalid
-         */
-        const char *val_ptr = strchr(hdr_ptr, ':');
-        if (!val_ptr) {
-            break;
-        }
-
-        /* If the field, does not match, continue searching.
-         * Compare lengths first as field from header is not
-         * null terminated (has ':' in the end).
-         */
-        if ((val_ptr - hdr_ptr != strlen(field)) ||
-            (strncasecmp(hdr_ptr, field, strlen(field)))) {
-            if (count) {
-                /* Jump to end of header field-value string */
-                hdr_ptr = 1 + strchr(hdr_ptr, '\0');
-
-                /* Skip all null characters (with which the line
-                 * terminators had been overwritten) */
-                while (*hdr_ptr == '\0') {
-                    hdr_ptr++;
-                }
-            }
-            continue;
-        }
+    httpd_req_hdr_t hdr;
+    if (!httpd_req_find_hdr(r->aux, field, 0, &hdr)) {
+        return ESP_ERR_NOT_FOUND;
+    }
 
-        /* Skip ':' */
-        val_ptr++;
+    /* Get the NULL terminated value and copy it to the caller's buffer. */
+    strlcpy(val, hdr.value, val_size);
 
-        /* Skip preceding space */
-        while ((*val_ptr != '\0') && (*val_ptr == ' ')) {
-            val_ptr++;
-        }
+    /* If buffer length is smaller than needed, return truncation error */
+    if (val_size < hdr.value_len + 1) {
+        return ESP_ERR_HTTPD_RESULT_TRUNC;
+    }
+    return ESP_OK;
+}
 
-        /* Get the NULL terminated value and copy it to the caller's buffer. */
-        strlcpy(val, val_ptr, buf_len);
+esp_err_t httpd_req_get_hdr(httpd_req_t *r, size_t index, httpd_req_hdr_t *hdr)
+{
+    if (r == NULL || hdr == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
 
-        /* Update value length, including one byte for null */
-        val_size = strlen(val_ptr) + 1;
+    if (!httpd_valid_req(r)) {
+        return ESP_ERR_HTTPD_INVALID_REQ;
+    }
 
-        /* If buffer length is smaller than needed, return truncation error */
-        if (buf_len < val_size) {
-            return ESP_ERR_HTTPD_RESULT_TRUNC;
-        }
-        return ESP_OK;
+    if (!httpd_req_find_hdr(r->aux, NULL, index, hdr)) {
+        return ESP_ERR_NOT_FOUND;
     }
-    return ESP_ERR_NOT_FOUND;
+    return ESP_OK;
 }
 
 /* Helper function to get a cookie value from a cookie string of the type "cookie1=val1; cookie2=val2" */
@@ -0,0 +1,389 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <esp_log.h>
+#include <esp_err.h>
+#ifdef CONFIG_IDF_TARGET_LINUX
+#include <sys/epoll.h>
+#else
+#include <sys/poll.h>
+#endif
+
+#include <esp_http_server.h>
+#include "esp_httpd_priv.h"
+
+static const char *TAG = "httpd_poll";
+
+/* Reports the pending sessions first, they are not reported again
+ * if their sockets are ready as well */
+static void httpd_poll_take_pending(struct httpd_poll *p, struct httpd_poll_ready *ready)
+{
+    for (unsigned i = 0; i < p->pending_count; i++) {
+        ready->sessions[ready->count++] = p->pending[i];
+    }
+}
+
+static void httpd_poll_clear_pending(struct httpd_poll *p)
+{
+    for (unsigned i = 0; i < p->pending_count; i++) {
+        p->pending[i]->poll_pending = false;
+    }
+    p->pending_count = 0;
+}
+
+static void httpd_poll_add_ready(struct httpd_poll_ready *ready, struct sock_db *session)
+{
+    if (!session->poll_pending) {
+        ready->sessions[ready->count++] = session;
+    }
+}
+
+static void httpd_poll_add_writable(struct httpd_poll_ready *ready, struct sock_db *session)
+{
+    ready->writable[ready->writable_count++] = session;
+}
+
+static esp_err_t httpd_poll_alloc(struct httpd_data *hd)
+{
+    struct httpd_poll *p = &hd->hd_poll;
+    p->ready = calloc(hd->config.max_open_sockets, sizeof(struct sock_db *));
+    p->pending = calloc(hd->config.max_open_sockets, sizeof(struct sock_db *));
+    p->writable = calloc(hd->config.max_open_sockets, sizeof(struct sock_db *));
+    if (!p->ready || !p->pending || !p->writable) {
+        free(p->ready);
+        free(p->pending);
+        free(p->writable);
+        p->ready = NULL;
+        p->pending = NULL;
+        p->writable = NULL;
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    return ESP_OK;
+}
+
+static void httpd_poll_free(struct httpd_poll *p)
+{
+    free(p->ready);
+    free(p->pending);
+    free(p->writable);
+    p->ready = NULL;
+    p->pending = NULL;
+    p->writable = NULL;
+    p->pending_count = 0;
+    p->count = 0;
+}
+
+void httpd_poll_set_pending(struct httpd_data *hd, struct sock_db *session)
+{
+    struct httpd_poll *p = &hd->hd_poll;
+    if (session->poll_pending || session->poll_index < 0) {
+        return;
+    }
+    session->poll_pending = true;
+    p->pending[p->pending_count++] = session;
+}
+
+static void httpd_poll_drop_pending(struct httpd_poll *p, struct sock_db *session)
+{
+    if (!session->poll_pending) {
+        return;
+    }
+    session->poll_pending = false;
+    for (unsigned i = 0; i < p->pending_count; i++) {
+        if (p->pending[i] == session) {
+            p->pending[i] = p->pending[--p->pending_count];
+            return;
+        }
+    }
+}
+
+#ifdef CONFIG_IDF_TARGET_LINUX
+
+/* The listening and the control socket are told apart
+ * from sessions by the addresses of their descriptors */
+static esp_err_t httpd_epoll_ctl(struct httpd_data *hd, int op, int fd, uint32_t events, void *ptr)
+{
+    struct epoll_event ev = {
+        .events = events,
+        .data.ptr = ptr,
+    };
+    if (epoll_ctl(hd->hd_poll.epoll_fd, op, fd, &ev) < 0) {
+        ESP_LOGW(TAG, LOG_FMT("error in epoll_ctl (%d)"), errno);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_poll_init(struct httpd_data *hd)
+{
+    struct httpd_poll *p = &hd->hd_poll;
+    p->epoll_fd = -1;
+    if (httpd_poll_alloc(hd) != ESP_OK) {
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    /* Besides the sessions, the listening and control socket may be ready */
+    p->events = calloc(hd->config.max_open_sockets + 2, sizeof(struct epoll_event));
+    if (!p->events) {
+        httpd_poll_free(p);
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    p->epoll_fd = epoll_create1(0);
+    if (p->epoll_fd < 0) {
+        ESP_LOGE(TAG, LOG_FMT("error in epoll_create1 (%d)"), errno);
+        httpd_poll_deinit(hd);
+        return ESP_FAIL;
+    }
+    if (httpd_epoll_ctl(hd, EPOLL_CTL_ADD, hd->ctrl_fd, EPOLLIN, &hd->ctrl_fd) != ESP_OK) {
+        httpd_poll_deinit(hd);
+        return ESP_FAIL;
+    }
+    p->count = 1;
+    p->listening = false;
+    httpd_poll_listen(hd, true);
+    return ESP_OK;
+}
+
+void httpd_poll_deinit(struct httpd_data *hd)
+{
+    struct httpd_poll *p = &hd->hd_poll;
+    if (!p->ready) {
+        /* Not initialized */
+        return;
+    }
+    if (p->epoll_fd >= 0) {
+        close(p->epoll_fd);
+        p->epoll_fd = -1;
+    }
+    free(p->events);
+    p->events = NULL;
+    httpd_poll_free(p);
+}
+
+esp_err_t httpd_poll_add(struct httpd_data *hd, struct sock_db *session)
+{
+    uint32_t events = EPOLLIN | (session->poll_out ? EPOLLOUT : 0);
+    if (httpd_epoll_ctl(hd, EPOLL_CTL_ADD, session->fd, events, session) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    /* epoll keeps track of the sockets, the index only marks the session as watched */
+    session->poll_index = 0;
+    hd->hd_poll.count++;
+    return ESP_OK;
+}
+
+void httpd_poll_del(struct httpd_data *hd, struct sock_db *session)
+{
+    if (session->poll_index < 0) {
+        return;
+    }
+    httpd_poll_drop_pending(&hd->hd_poll, session);
+    httpd_epoll_ctl(hd, EPOLL_CTL_DEL, session->fd, 0, NULL);
+    session->poll_index = -1;
+    hd->hd_poll.count--;
+}
+
+void httpd_poll_listen(struct httpd_data *hd, bool enable)
+{
+    struct httpd_poll *p = &hd->hd_poll;
+    if (p->listening == enable) {
+        return;
+    }
+    if (httpd_epoll_ctl(hd, enable ? EPOLL_CTL_ADD : EPOLL_CTL_DEL,
+                        hd->listen_fd, EPOLLIN, &hd->listen_fd) == ESP_OK) {
+        p->listening = enable;
+    }
+}
+
+void httpd_poll_set_writable(struct httpd_data *hd, struct sock_db *session, bool enable)
+{
+    if (session->poll_out == enable) {
+        return;
+    }
+    session->poll_out = enable;
+    if (session->poll_index >= 0) {
+        httpd_epoll_ctl(hd, EPOLL_CTL_MOD, session->fd,
+                        EPOLLIN | (enable ? EPOLLOUT : 0), session);
+    }
+}
+
+esp_err_t httpd_poll_wait(struct httpd_data *hd, struct httpd_poll_ready *ready)
+{
+    struct httpd_poll *p = &hd->hd_poll;
+    ready->ctrl = false;
+    ready->listen = false;
+    ready->sessions = p->ready;
+    ready->count = 0;
+    ready->writable = p->writable;
+    ready->writable_count = 0;
+
+    ESP_LOGD(TAG, LOG_FMT("waiting on %u sockets, %u pending"), p->count, p->pending_count);
+    int active_cnt = epoll_wait(p->epoll_fd, p->events, hd->config.max_open_sockets + 2,
+                                p->pending_count ? 0 : -1);
+    if (active_cnt < 0) {
+        if (errno == EINTR) {
+            return ESP_OK;
+        }
+        ESP_LOGE(TAG, LOG_FMT("error in epoll_wait (%d)"), errno);
+        return ESP_FAIL;
+    }
+
+    httpd_poll_take_pending(p, ready);
+    for (int i = 0; i < active_cnt; i++) {
+        void *ptr = p->events[i].data.ptr;
+        if (ptr == &hd->ctrl_fd) {
+            ready->ctrl = true;
+        } else if (ptr == &hd->listen_fd) {
+            ready->listen = true;
+        } else {
+            uint32_t events = p->events[i].events;
+            if (events & EPOLLOUT) {
+                httpd_poll_add_writable(ready, ptr);
+            }
+            /* Errors and hangups are reported as readable, so that
+             * the session notices them when receiving */
+            if (events & ~EPOLLOUT) {
+                httpd_poll_add_ready(ready, ptr);
+            }
+        }
+    }
+    httpd_poll_clear_pending(p);
+    return ESP_OK;
+}
+
+#else /* !CONFIG_IDF_TARGET_LINUX */
+
+/* Fixed entries of the descriptor table, the sessions follow */
+#define POLL_CTRL     0
+#define POLL_LISTEN   1
+#define POLL_SESSIONS 2
+
+esp_err_t httpd_poll_init(struct httpd_data *hd)
+{
+    struct httpd_poll *p = &hd->hd_poll;
+    if (httpd_poll_alloc(hd) != ESP_OK) {
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    p->fds = calloc(hd->config.max_open_sockets + POLL_SESSIONS, sizeof(struct pollfd));
+    p->owners = calloc(hd->config.max_open_sockets + POLL_SESSIONS, sizeof(struct sock_db *));
+    if (!p->fds || !p->owners) {
+        httpd_poll_deinit(hd);
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    p->fds[POLL_CTRL].fd = hd->ctrl_fd;
+    p->fds[POLL_CTRL].events = POLLIN;
+    p->fds[POLL_LISTEN].fd = hd->listen_fd;
+    p->fds[POLL_LISTEN].events = POLLIN;
+    p->count = POLL_SESSIONS;
+    p->listening = true;
+    return ESP_OK;
+}
+
+void httpd_poll_deinit(struct httpd_data *hd)
+{
+    struct httpd_poll *p = &hd->hd_poll;
+    if (!p->ready) {
+        /* Not initialized */
+        return;
+    }
+    free(p->fds);
+    free(p->owners);
+    p->fds = NULL;
+    p->owners = NULL;
+    httpd_poll_free(p);
+}
+
+esp_err_t httpd_poll_add(struct httpd_data *hd, struct sock_db *session)
+{
+    struct httpd_poll *p = &hd->hd_poll;
+    if (p->count == hd->config.max_open_sockets + POLL_SESSIONS) {
+        return ESP_FAIL;
+    }
+    p->fds[p->count].fd = session->fd;
+    p->fds[p->count].events = POLLIN | (session->poll_out ? POLLOUT : 0);
+    p->owners[p->count] = session;
+    session->poll_index = p->count++;
+    return ESP_OK;
+}
+
+void httpd_poll_del(struct httpd_data *hd, struct sock_db *session)
+{
+    struct httpd_poll *p = &hd->hd_poll;
+    int index = session->poll_index;
+    if (index < 0) {
+        return;
+    }
+    httpd_poll_drop_pending(p, session);
+
+    /* Keep the table dense by moving the last entry into the gap */
+    unsigned last = --p->count;
+    if ((unsigned) index != last) {
+        p->fds[index] = p->fds[last];
+        p->owners[index] = p->owners[last];
+        p->owners[index]->poll_index = index;
+    }
+    p->owners[last] = NULL;
+    session->poll_index = -1;
+}
+
+void httpd_poll_listen(struct httpd_data *hd, bool enable)
+{
+    struct httpd_poll *p = &hd->hd_poll;
+    /* poll() ignores entries with negative descriptors */
+    p->fds[POLL_LISTEN].fd = enable ? hd->listen_fd : -1;
+    p->listening = enable;
+}
+
+void httpd_poll_set_writable(struct httpd_data *hd, struct sock_db *session, bool enable)
+{
+    session->poll_out = enable;
+    if (session->poll_index >= 0) {
+        hd->hd_poll.fds[session->poll_index].events = POLLIN | (enable ? POLLOUT : 0);
+    }
+}
+
+esp_err_t httpd_poll_wait(struct httpd_data *hd, struct httpd_poll_ready *ready)
+{
+    struct httpd_poll *p = &hd->hd_poll;
+    ready->ctrl = false;
+    ready->listen = false;
+    ready->sessions = p->ready;
+    ready->count = 0;
+    ready->writable = p->writable;
+    ready->writable_count = 0;
+
+    ESP_LOGD(TAG, LOG_FMT("polling %u sockets, %u pending"), p->count, p->pending_count);
+    int active_cnt = poll(p->fds, p->count, p->pending_count ? 0 : -1);
+    if (active_cnt < 0) {
+        ESP_LOGE(TAG, LOG_FMT("error in poll (%d)"), errno);
+        return ESP_FAIL;
+    }
+
+    httpd_poll_take_pending(p, ready);
+    ready->ctrl = p->fds[POLL_CTRL].revents != 0;
+    ready->listen = p->fds[POLL_LISTEN].revents != 0;
+    active_cnt -= ready->ctrl + ready->listen;
+    /* Stop scanning once all ready sessions have been found */
+    for (unsigned i = POLL_SESSIONS; i < p->count && active_cnt > 0; i++) {
+        short revents = p->fds[i].revents;
+        if (!revents) {
+            continue;
+        }
+        if (revents & POLLOUT) {
+            httpd_poll_add_writable(ready, p->owners[i]);
+        }
+        if (revents & ~POLLOUT) {
+            httpd_poll_add_ready(ready, p->owners[i]);
+        }
+        active_cnt--;
+    }
+    httpd_poll_clear_pending(p);
+    return ESP_OK;
+}
+
+#endif /* CONFIG_IDF_TARGET_LINUX */
@@ -0,0 +1,403 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <esp_log.h>
+#include <esp_err.h>
+
+#include <esp_http_server.h>
+#include "esp_httpd_priv.h"
+
+#ifdef CONFIG_HTTPD_URI_ROUTER
+
+static const char *TAG = "httpd_router";
+
+/* How the URI template of a route matches the rest of the URI
+ * once the part of the template before any wildcard matched */
+enum httpd_route_kind {
+    ROUTE_EXACT,            /* No wildcard, the URI has to end */
+    ROUTE_PREFIX,           /* Trailing '*', anything may follow */
+    ROUTE_OPTIONAL,         /* Trailing '?', the optional character may follow */
+    ROUTE_OPTIONAL_PREFIX,  /* Trailing "?*" or "*?", the optional character and anything after it may follow */
+    ROUTE_NEVER,            /* Invalid wildcard template, never matches */
+};
+
+/**
+ * @brief A registered URI handler whose template ends at a node of the tree
+ */
+struct httpd_route {
+    const httpd_uri_t   *uri;       /*!< The registered handler */
+    unsigned             order;     /*!< Position among the registered handlers, lower positions take precedence */
+    uint8_t              kind;      /*!< One of httpd_route_kind */
+    char                 optional;  /*!< Optional character of ROUTE_OPTIONAL(_PREFIX) templates */
+    struct httpd_route  *next;      /*!< Next route of the node, the routes are sorted by method */
+};
+
+/**
+ * @brief Node of the radix tree over the URI templates
+ *
+ * The labels point into the template strings of the registered handlers,
+ * so the tree has to be rebuilt whenever handlers are removed.
+ */
+struct httpd_route_node {
+    const char               *label;     /*!< Characters on the edge to this node, or the name of a path parameter */
+    size_t                    label_len;
+    struct httpd_route_node  *children;  /*!< Children continuing with a literal, with distinct first characters */
+    struct httpd_route_node  *params;    /*!< Children matching a {name} path segment */
+    struct httpd_route_node  *next;      /*!< Next sibling */
+    struct httpd_route       *routes;    /*!< Handlers whose template ends here */
+};
+
+/**
+ * @brief State of a search through the tree
+ */
+struct httpd_route_search {
+    httpd_method_t             method;
+    const struct httpd_route  *best;        /*!< Matching route with the lowest position so far */
+    bool                       uri_found;   /*!< A route matched the URI, but not necessarily the method */
+    struct httpd_req_aux      *ra;          /*!< Receives the path parameters of the best route, may be NULL */
+    unsigned                   params_count;
+    struct httpd_path_param    params[CONFIG_HTTPD_MAX_PATH_PARAMS];
+};
+
+bool httpd_router_supported(struct httpd_data *hd)
+{
+    return hd->config.uri_match_fn == NULL ||
+           hd->config.uri_match_fn == httpd_uri_match_wildcard;
+}
+
+/* Splits a template into the part which has to match exactly and the kind of
+ * wildcard following it, the same way httpd_uri_match_wildcard() does */
+static void httpd_router_parse_template(struct httpd_data *hd, const char *template,
+                                        size_t *exact_len, uint8_t *kind, char *optional)
+{
+    const size_t tpl_len = strlen(template);
+    *exact_len = tpl_len;
+    *kind = ROUTE_EXACT;
+    *optional = 0;
+
+    if (hd->config.uri_match_fn != httpd_uri_match_wildcard) {
+        return;
+    }
+
+    const char last = (const char) (tpl_len > 0 ? template[tpl_len - 1] : 0);
+    const char prevlast = (const char) (tpl_len > 1 ? template[tpl_len - 2] : 0);
+    const bool asterisk = last == '*' || (prevlast == '*' && last == '?');
+    const bool quest = last == '?' || (prevlast == '?' && last == '*');
+
+    if (tpl_len < asterisk + quest*2) {
+        *kind = ROUTE_NEVER;
+        return;
+    }
+    *exact_len = tpl_len - (asterisk + quest*2);
+    if (quest) {
+        *optional = template[*exact_len];
+        *kind = asterisk ? ROUTE_OPTIONAL_PREFIX : ROUTE_OPTIONAL;
+    } else if (asterisk) {
+        *kind = ROUTE_PREFIX;
+    }
+}
+
+/* Returns the position of the closing brace if a path parameter
+ * of the form {name} starts at pos, otherwise 0 */
+static size_t httpd_router_param_end(const char *template, size_t pos, size_t len)
+{
+    if (template[pos] != '{' || (pos > 0 && template[pos - 1] != '/')) {
+        return 0;
+    }
+    size_t end = pos + 1;
+    while (end < len && template[end] != '}' && template[end] != '/') {
+        end++;
+    }
+    if (end == len || template[end] != '}' || end == pos + 1) {
+        return 0;
+    }
+    /* The parameter has to span the whole path segment */
+    if (end + 1 < len && template[end + 1] != '/') {
+        return 0;
+    }
+    return end;
+}
+
+static struct httpd_route_node *httpd_router_new_node(const char *label, size_t label_len)
+{
+    struct httpd_route_node *node = calloc(1, sizeof(struct httpd_route_node));
+    if (node) {
+        node->label = label;
+        node->label_len = label_len;
+    }
+    return node;
+}
+
+static struct httpd_route_node *httpd_router_insert_literal(struct httpd_route_node *node,
+                                                            const char *str, size_t len)
+{
+    while (len > 0) {
+        struct httpd_route_node **link = &node->children;
+        while (*link && (*link)->label[0] != str[0]) {
+            link = &(*link)->next;
+        }
+
+        struct httpd_route_node *child = *link;
+        if (!child) {
+            child = httpd_router_new_node(str, len);
+            if (!child) {
+                return NULL;
+            }
+            *link = child;
+            return child;
+        }
+
+        size_t common = 1;
+        while (common < child->label_len && common < len && child->label[common] == str[common]) {
+            common++;
+        }
+        if (common < child->label_len) {
+            /* Split the edge, the new node takes the common part of the label */
+            struct httpd_route_node *split = httpd_router_new_node(child->label, common);
+            if (!split) {
+                return NULL;
+            }
+            split->next = child->next;
+            split->children = child;
+            child->next = NULL;
+            child->label += common;
+            child->label_len -= common;
+            *link = split;
+            child = split;
+        }
+        node = child;
+        str += common;
+        len -= common;
+    }
+    return node;
+}
+
+static struct httpd_route_node *httpd_router_insert_param(struct httpd_route_node *node,
+                                                          const char *name, size_t name_len)
+{
+    struct httpd_route_node **link = &node->params;
+    while (*link) {
+        if ((*link)->label_len == name_len && strncmp((*link)->label, name, name_len) == 0) {
+            return *link;
+        }
+        link = &(*link)->next;
+    }
+    *link = httpd_router_new_node(name, name_len);
+    return *link;
+}
+
+esp_err_t httpd_router_add(struct httpd_data *hd, const httpd_uri_t *uri, unsigned order)
+{
+    const char *template = uri->uri;
+    size_t exact_len;
+    uint8_t kind;
+    char optional;
+
+    httpd_router_parse_template(hd, template, &exact_len, &kind, &optional);
+    if (kind == ROUTE_NEVER) {
+        return ESP_OK;
+    }
+
+    struct httpd_route *route = calloc(1, sizeof(struct httpd_route));
+    if (!route) {
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    if (!hd->hd_router) {
+        hd->hd_router = httpd_router_new_node(NULL, 0);
+        if (!hd->hd_router) {
+            free(route);
+            return ESP_ERR_HTTPD_ALLOC_MEM;
+        }
+    }
+
+    struct httpd_route_node *node = hd->hd_router;
+    size_t pos = 0;
+    while (pos < exact_len) {
+        size_t param_end = httpd_router_param_end(template, pos, exact_len);
+        if (param_end) {
+            node = httpd_router_insert_param(node, template + pos + 1, param_end - pos - 1);
+            pos = param_end + 1;
+        } else {
+            size_t literal_end = pos + 1;
+            while (literal_end < exact_len && !httpd_router_param_end(template, literal_end, exact_len)) {
+                literal_end++;
+            }
+            node = httpd_router_insert_literal(node, template + pos, literal_end - pos);
+            pos = literal_end;
+        }
+        if (!node) {
+            free(route);
+            return ESP_ERR_HTTPD_ALLOC_MEM;
+        }
+    }
+
+    route->uri      = uri;
+    route->order    = order;
+    route->kind     = kind;
+    route->optional = optional;
+
+    /* Keep the routes of each method together, in the order of registration */
+    struct httpd_route **link = &node->routes;
+    while (*link && (*link)->uri->method <= uri->method) {
+        link = &(*link)->next;
+    }
+    route->next = *link;
+    *link = route;
+    ESP_LOGD(TAG, LOG_FMT("[%u] added %s"), order, template);
+    return ESP_OK;
+}
+
+static void httpd_router_free_node(struct httpd_route_node *node)
+{
+    while (node) {
+        struct httpd_route_node *next = node->next;
+        httpd_router_free_node(node->children);
+        httpd_router_free_node(node->params);
+        while (node->routes) {
+            struct httpd_route *route = node->routes;
+            node->routes = route->next;
+            free(route);
+        }
+        free(node);
+        node = next;
+    }
+}
+
+void httpd_router_free(struct httpd_data *hd)
+{
+    httpd_router_free_node(hd->hd_router);
+    hd->hd_router = NULL;
+}
+
+void httpd_router_rebuild(struct httpd_data *hd)
+{
+    httpd_router_free(hd);
+    hd->hd_router_stale = false;
+
+    for (unsigned i = 0; i < hd->config.max_uri_handlers; i++) {
+        if (!hd->hd_calls[i]) {
+            break;
+        }
+        if (httpd_router_add(hd, hd->hd_calls[i], i) != ESP_OK) {
+            ESP_LOGW(TAG, LOG_FMT("out of memory, searching URI handlers linearly"));
+            httpd_router_free(hd);
+            hd->hd_router_stale = true;
+            return;
+        }
+    }
+}
+
+static bool httpd_route_matches(const struct httpd_route *route, const char *uri, size_t len, size_t pos)
+{
+    switch (route->kind) {
+        case ROUTE_EXACT:
+            return pos == len;
+        case ROUTE_PREFIX:
+            return true;
+        case ROUTE_OPTIONAL:
+            return pos == len || (pos + 1 == len && uri[pos] == route->optional);
+        case ROUTE_OPTIONAL_PREFIX:
+            return pos == len || uri[pos] == route->optional;
+        default:
+            return false;
+    }
+}
+
+static void httpd_router_match_routes(const struct httpd_route_node *node, const char *uri,
+                                      size_t len, size_t pos, struct httpd_route_search *s)
+{
+    for (const struct httpd_route *route = node->routes; route; route = route->next) {
+        if (!httpd_route_matches(route, uri, len, pos)) {
+            continue;
+        }
+        s->uri_found = true;
+        if (route->uri->method != s->method) {
+            continue;
+        }
+        if (!s->best || route->order < s->best->order) {
+            s->best = route;
+            if (s->ra) {
+                memcpy(s->ra->path_params, s->params, s->params_count * sizeof(struct httpd_path_param));
+                s->ra->path_params_count = s->params_count;
+            }
+        }
+    }
+}
+
+/* Visits all nodes along the URI. Literal edges are followed iteratively,
+ * each path parameter matching the next path segment starts a new branch. */
+static void httpd_router_search(const struct httpd_route_node *node, const char *uri,
+                                size_t len, size_t pos, struct httpd_route_search *s)
+{
+    while (true) {
+        httpd_router_match_routes(node, uri, len, pos, s);
+
+        if (node->params && s->params_count < CONFIG_HTTPD_MAX_PATH_PARAMS) {
+            size_t end = pos;
+            while (end < len && uri[end] != '/') {
+                end++;
+            }
+            if (end > pos) {
+                for (const struct httpd_route_node *param = node->params; param; param = param->next) {
+                    struct httpd_path_param *p = &s->params[s->params_count++];
+                    p->name      = param->label;
+                    p->name_len  = param->label_len;
+                    p->value     = uri + pos;
+                    p->value_len = end - pos;
+                    httpd_router_search(param, uri, len, end, s);
+                    s->params_count--;
+                }
+            }
+        }
+
+        if (pos == len) {
+            return;
+        }
+        const struct httpd_route_node *child = node->children;
+        while (child && child->label[0] != uri[pos]) {
+            child = child->next;
+        }
+        if (!child || child->label_len > len - pos ||
+            strncmp(child->label, uri + pos, child->label_len) != 0) {
+            return;
+        }
+        pos += child->label_len;
+        node = child;
+    }
+}
+
+httpd_uri_t *httpd_router_find(struct httpd_data *hd, const char *uri, size_t uri_len,
+                               httpd_method_t method, httpd_err_code_t *err,
+                               struct httpd_req_aux *ra)
+{
+    struct httpd_route_search s = {
+        .method = method,
+        .ra = ra,
+    };
+    if (ra) {
+        ra->path_params_count = 0;
+    }
+
+    if (hd->hd_router) {
+        httpd_router_search(hd->hd_router, uri, uri_len, 0, &s);
+    }
+
+    if (s.best) {
+        if (err) {
+            *err = 0;
+        }
+        return (httpd_uri_t *) s.best->uri;
+    }
+    if (err) {
+        *err = s.uri_found ? HTTPD_405_METHOD_NOT_ALLOWED : HTTPD_404_NOT_FOUND;
+    }
+    return NULL;
+}
+
+#endif /* CONFIG_HTTPD_URI_ROUTER */
@@ -21,7 +21,6 @@ typedef enum {
     HTTPD_TASK_GET_ACTIVE,      // Get active session (fd!=-1)
     HTTPD_TASK_GET_FREE,        // Get free session slot (fd<0)
     HTTPD_TASK_FIND_FD,         // Find session with specific fd
-    HTTPD_TASK_SET_DESCRIPTOR,  // Set descriptor
     HTTPD_TASK_DELETE_INVALID,  // Delete invalid session
     HTTPD_TASK_FIND_LOWEST_LRU, // Find session with lowest lru
     HTTPD_TASK_CLOSE            // Close session
@@ -30,8 +29,6 @@ typedef enum {
 typedef struct {
     task_t task;
     int fd;
-    fd_set *fdset;
-    int max_fd;
     struct httpd_data *hd;
     uint64_t lru_counter;
     struct sock_db    *session;
@@ -72,6 +69,7 @@ static int enum_function(struct sock_db *session, void *context)
     case HTTPD_TASK_INIT:
         session->fd = -1;
         session->ctx = NULL;
+        session->poll_index = -1;
         break;
     // Get active session
     case HTTPD_TASK_GET_ACTIVE:
@@ -85,15 +83,6 @@ static int enum_function(struct sock_db *session, void *context)
     case HTTPD_TASK_FIND_FD:
         found = (session->fd == ctx->fd);
         break;
-    // Set descriptor
-    case HTTPD_TASK_SET_DESCRIPTOR:
-        if (session->fd != -1) {
-            FD_SET(session->fd, ctx->fdset);
-            if (session->fd > ctx->max_fd) {
-                ctx->max_fd = session->fd;
-            }
-        }
-        break;
     // Delete invalid session
     case HTTPD_TASK_DELETE_INVALID:
         if (!fd_is_valid(session->fd)) {
@@ -162,6 +151,15 @@ bool httpd_is_sess_available(struct httpd_data *hd)
     return httpd_sess_get_free(hd) ? true : false;
 }
 
+/* Returns the request being processed by the calling task, which is
+ * either the server task or one of the workers, NULL if there is none */
+static httpd_req_t *httpd_sess_current_req(struct httpd_data *hd)
+{
+    struct httpd_worker *w = httpd_worker_self(hd);
+    httpd_req_t *r = w ? &w->req : &hd->hd_req;
+    return r->aux ? r : NULL;
+}
+
 struct sock_db *httpd_sess_get(struct httpd_data *hd, int sockfd)
 {
     if ((!hd) || (!hd->hd_sd) || (!hd->config.max_open_sockets)) {
@@ -170,8 +168,12 @@ struct sock_db *httpd_sess_get(struct httpd_data *hd, int sockfd)
 
     // Check if called inside a request handler, and the session sockfd in use is same as the parameter
     // => Just return the pointer to the sock_db corresponding to the request
-    if ((hd->hd_req_aux.sd) && (hd->hd_req_aux.sd->fd == sockfd)) {
-        return hd->hd_req_aux.sd;
+    httpd_req_t *r = httpd_sess_current_req(hd);
+    if (r) {
+        struct httpd_req_aux *ra = r->aux;
+        if ((ra->sd) && (ra->sd->fd == sockfd)) {
+            return ra->sd;
+        }
     }
 
     enum_context_t context = {
@@ -200,6 +202,8 @@ esp_err_t httpd_sess_new(struct httpd_data *hd, int newfd)
     // Clear session data
     memset(session, 0, sizeof (struct sock_db));
     session->fd = newfd;
+    session->poll_index = -1;
+    session->worker = -1;
     session->handle = (httpd_handle_t) hd;
     session->send_fn = httpd_default_send;
     session->recv_fn = httpd_default_recv;
@@ -218,6 +222,16 @@ esp_err_t httpd_sess_new(struct httpd_data *hd, int newfd)
     hd->hd_sd_active_count++;
     ESP_LOGD(TAG, LOG_FMT("active sockets: %d"), hd->hd_sd_active_count);
 
+    // Requests of this session are always processed by the same worker
+    httpd_worker_bind(hd, session);
+
+    // Start watching the socket for requests
+    if (httpd_poll_add(hd, session) != ESP_OK) {
+        httpd_sess_delete(hd, session);
+        ESP_LOGD(TAG, LOG_FMT("unable to watch fd = %d"), newfd);
+        return ESP_FAIL;
+    }
+
     return ESP_OK;
 }
 
@@ -263,9 +277,9 @@ void *httpd_sess_get_ctx(httpd_handle_t handle, int sockfd)
     // Check if the function has been called from inside a
     // request handler, in which case fetch the context from
     // the httpd_req_t structure
-    struct httpd_data *hd = (struct httpd_data *) handle;
-    if (hd->hd_req_aux.sd == session) {
-        return hd->hd_req.sess_ctx;
+    httpd_req_t *r = httpd_sess_current_req(handle);
+    if (r && ((struct httpd_req_aux *) r->aux)->sd == session) {
+        return r->sess_ctx;
     }
     return session->ctx;
 }
@@ -280,17 +294,17 @@ void httpd_sess_set_ctx(httpd_handle_t handle, int sockfd, void *ctx, httpd_free
     // Check if the function has been called from inside a
     // request handler, in which case set the context inside
     // the httpd_req_t structure
-    struct httpd_data *hd = (struct httpd_data *) handle;
-    if (hd->hd_req_aux.sd == session) {
-        if (hd->hd_req.sess_ctx != ctx) {
+    httpd_req_t *r = httpd_sess_current_req(handle);
+    if (r && ((struct httpd_req_aux *) r->aux)->sd == session) {
+        if (r->sess_ctx != ctx) {
             // Don't free previous context if it is in sockdb
             // as it will be freed inside httpd_req_cleanup()
-            if (session->ctx != hd->hd_req.sess_ctx) {
-                httpd_sess_free_ctx(&hd->hd_req.sess_ctx, hd->hd_req.free_ctx); // Free previous context
+            if (session->ctx != r->sess_ctx) {
+                httpd_sess_free_ctx(&r->sess_ctx, r->free_ctx); // Free previous context
             }
-            hd->hd_req.sess_ctx = ctx;
+            r->sess_ctx = ctx;
         }
-        hd->hd_req.free_ctx = free_fn;
+        r->free_ctx = free_fn;
         return;
     }
 
@@ -324,19 +338,6 @@ void httpd_sess_set_transport_ctx(httpd_handle_t handle, int sockfd, void *ctx,
     session->free_transport_ctx = free_fn;
 }
 
-void httpd_sess_set_descriptors(struct httpd_data *hd, fd_set *fdset, int *maxfd)
-{
-    enum_context_t context = {
-        .task = HTTPD_TASK_SET_DESCRIPTOR,
-        .max_fd = -1,
-        .fdset = fdset
-    };
-    httpd_sess_enum(hd, enum_function, &context);
-    if (maxfd) {
-        *maxfd = context.max_fd;
-    }
-}
-
 void httpd_sess_delete_invalid(struct httpd_data *hd)
 {
     enum_context_t context = {
@@ -354,6 +355,19 @@ void httpd_sess_delete(struct httpd_data *hd, struct sock_db *session)
 
     ESP_LOGD(TAG, LOG_FMT("fd = %d"), session->fd);
 
+    // The worker still uses the socket, it's closed once the worker is done
+    if (session->worker_busy) {
+        session->worker_close = true;
+        return;
+    }
+
+    // Stop watching the socket before it gets closed
+    httpd_poll_del(hd, session);
+    session->poll_out = false;
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    httpd_ws_tx_clear(hd, session);
+#endif
+
     // Call close function if defined
     if (hd->config.close_fn) {
         hd->config.close_fn(hd, session->fd);
@@ -366,6 +380,7 @@ void httpd_sess_delete(struct httpd_data *hd, struct sock_db *session)
 
     // mark session slot as available
     session->fd = -1;
+    httpd_worker_unbind(hd, session);
 
     // decrement number of sessions
     hd->hd_sd_active_count--;
@@ -389,7 +404,7 @@ bool httpd_sess_pending(struct httpd_data *hd, struct sock_db *session)
         return false;
     }
     if (session->pending_fn) {
-        // test if there's any data to be read (besides read() function, which is handled by select() in the main httpd loop)
+        // test if there's any data to be read (besides read() function, which is handled by the event backend in the main httpd loop)
         // this should check e.g. for the SSL data buffer
         if (session->pending_fn(hd, session->fd) > 0) {
             return true;
@@ -402,22 +417,22 @@ bool httpd_sess_pending(struct httpd_data *hd, struct sock_db *session)
  * value is returned, everything related to this socket will be
  * cleaned up and the socket will be closed.
  */
-esp_err_t httpd_sess_process(struct httpd_data *hd, struct sock_db *session)
+esp_err_t httpd_sess_process(struct httpd_data *hd, struct sock_db *session,
+                             httpd_req_t *r, struct httpd_req_aux *ra)
 {
     if ((!hd) || (!session)) {
         return ESP_FAIL;
     }
 
     ESP_LOGD(TAG, LOG_FMT("httpd_req_new"));
-    if (httpd_req_new(hd, session) != ESP_OK) {
+    if (httpd_req_new(hd, r, ra, session) != ESP_OK) {
         return ESP_FAIL;
     }
     ESP_LOGD(TAG, LOG_FMT("httpd_req_delete"));
-    if (httpd_req_delete(hd) != ESP_OK) {
+    if (httpd_req_delete(r) != ESP_OK) {
         return ESP_FAIL;
     }
     ESP_LOGD(TAG, LOG_FMT("success"));
-    session->lru_counter = ++hd->lru_counter;
     return ESP_OK;
 }
 
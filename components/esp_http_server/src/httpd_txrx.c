@@ -6,6 +6,7 @@
 
 
 #include <errno.h>
+#include <netinet/tcp.h>
 #include <esp_log.h>
 #include <esp_err.h>
 
@@ -63,7 +64,7 @@ int httpd_send(httpd_req_t *r, const char *buf, size_t buf_len)
     return ret;
 }
 
-static esp_err_t httpd_send_all(httpd_req_t *r, const char *buf, size_t buf_len)
+esp_err_t httpd_send_all(httpd_req_t *r, const char *buf, size_t buf_len)
 {
     struct httpd_req_aux *ra = r->aux;
     int ret;
@@ -581,6 +582,10 @@ int httpd_default_send(httpd_handle_t hd, int sockfd, const char *buf, size_t bu
 
     int ret = send(sockfd, buf, buf_len, flags);
     if (ret < 0) {
+        if ((flags & MSG_DONTWAIT) && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            /* Expected by non-blocking callers, not worth a warning */
+            return HTTPD_SOCK_ERR_TIMEOUT;
+        }
         return httpd_sock_err("send", sockfd);
     }
     return ret;
@@ -85,8 +85,18 @@ bool httpd_uri_match_wildcard(const char *template, const char *uri, size_t len)
 static httpd_uri_t* httpd_find_uri_handler(struct httpd_data *hd,
                                            const char *uri, size_t uri_len,
                                            httpd_method_t method,
-                                           httpd_err_code_t *err)
+                                           httpd_err_code_t *err,
+                                           struct httpd_req_aux *ra)
 {
+#ifdef CONFIG_HTTPD_URI_ROUTER
+    if (httpd_router_supported(hd) && !hd->hd_router_stale) {
+        return httpd_router_find(hd, uri, uri_len, method, err, ra);
+    }
+    if (ra) {
+        ra->path_params_count = 0;
+    }
+#endif
+
     if (err) {
         *err = HTTPD_404_NOT_FOUND;
     }
@@ -123,6 +133,25 @@ static httpd_uri_t* httpd_find_uri_handler(struct httpd_data *hd,
     return NULL;
 }
 
+#ifdef CONFIG_HTTPD_URI_ROUTER
+/* Adds the newly registered handler at position i to the router.
+ * If memory runs out, the handlers are searched linearly until the
+ * next successful rebuild of the router. */
+static void httpd_router_update(struct httpd_data *hd, unsigned i)
+{
+    if (!httpd_router_supported(hd)) {
+        return;
+    }
+    if (hd->hd_router_stale) {
+        httpd_router_rebuild(hd);
+    } else if (httpd_router_add(hd, hd->hd_calls[i], i) != ESP_OK) {
+        ESP_LOGW(TAG, LOG_FMT("out of memory, searching URI handlers linearly"));
+        httpd_router_free(hd);
+        hd->hd_router_stale = true;
+    }
+}
+#endif
+
 esp_err_t httpd_register_uri_handler(httpd_handle_t handle,
                                      const httpd_uri_t *uri_handler)
 {
@@ -132,19 +161,18 @@ esp_err_t httpd_register_uri_handler(httpd_handle_t handle,
 
     struct httpd_data *hd = (struct httpd_data *) handle;
 
-    /* Make sure another handler with matching URI and method
-     * is not already registered. This will also catch cases
-     * when a registered URI wildcard pattern already accounts
-     * for the new URI being registered */
-    if (httpd_find_uri_handler(handle, uri_handler->uri,
-                               strlen(uri_handler->uri),
-                               uri_handler->method, NULL) != NULL) {
-        ESP_LOGW(TAG, LOG_FMT("handler %s with method %d already registered"),
-                 uri_handler->uri, uri_handler->method);
-        return ESP_ERR_HTTPD_HANDLER_EXISTS;
-    }
-
     for (int i = 0; i < hd->config.max_uri_handlers; i++) {
+        /* Make sure another handler with the same URI template and
+         * method is not already registered. Templates are compared
+         * as strings, a handler for "/dev/list" can be registered
+         * after one for "/dev/{id}" or "/dev/*" */
+        if (hd->hd_calls[i] != NULL &&
+            hd->hd_calls[i]->method == uri_handler->method &&
+            strcmp(hd->hd_calls[i]->uri, uri_handler->uri) == 0) {
+            ESP_LOGW(TAG, LOG_FMT("handler %s with method %d already registered"),
+                     uri_handler->uri, uri_handler->method);
+            return ESP_ERR_HTTPD_HANDLER_EXISTS;
+        }
         if (hd->hd_calls[i] == NULL) {
             hd->hd_calls[i] = malloc(sizeof(httpd_uri_t));
             if (hd->hd_calls[i] == NULL) {
@@ -172,6 +200,9 @@ esp_err_t httpd_register_uri_handler(httpd_handle_t handle,
             } else {
                 hd->hd_calls[i]->supported_subprotocol = NULL;
             }
+#endif
+#ifdef CONFIG_HTTPD_URI_ROUTER
+            httpd_router_update(hd, i);
 #endif
             ESP_LOGD(TAG, LOG_FMT("[%d] installed %s"), i, uri_handler->uri);
             return ESP_OK;
@@ -212,6 +243,11 @@ esp_err_t httpd_unregister_uri_handler(httpd_handle_t handle,
             }
             /* Nullify the following non null entry */
             hd->hd_calls[i-1] = NULL;
+#ifdef CONFIG_HTTPD_URI_ROUTER
+            if (httpd_router_supported(hd)) {
+                httpd_router_rebuild(hd);
+            }
+#endif
             return ESP_OK;
         }
     }
@@ -256,11 +292,19 @@ esp_err_t httpd_unregister_uri(httpd_handle_t handle, const char *uri)
     if (!found) {
         ESP_LOGW(TAG, LOG_FMT("no handler found for URI %s"), uri);
     }
+#ifdef CONFIG_HTTPD_URI_ROUTER
+    else if (httpd_router_supported(hd)) {
+        httpd_router_rebuild(hd);
+    }
+#endif
     return (found ? ESP_OK : ESP_ERR_NOT_FOUND);
 }
 
 void httpd_unregister_all_uri_handlers(struct httpd_data *hd)
 {
+#ifdef CONFIG_HTTPD_URI_ROUTER
+    httpd_router_free(hd);
+#endif
     for (unsigned i = 0; i < hd->config.max_uri_handlers; i++) {
         if (!hd->hd_calls[i]) {
             break;
@@ -273,11 +317,11 @@ void httpd_unregister_all_uri_handlers(struct httpd_data *hd)
     }
 }
 
-esp_err_t httpd_uri(struct httpd_data *hd)
+esp_err_t httpd_uri(struct httpd_data *hd, httpd_req_t *req)
 {
     httpd_uri_t            *uri = NULL;
-    httpd_req_t            *req = &hd->hd_req;
-    struct http_parser_url *res = &hd->hd_req_aux.url_parse_res;
+    struct httpd_req_aux   *ra  = req->aux;
+    struct http_parser_url *res = &ra->url_parse_res;
 
     /* For conveying URI not found/method not allowed */
     httpd_err_code_t err = 0;
@@ -287,7 +331,8 @@ esp_err_t httpd_uri(struct httpd_data *hd)
     /* URL parser result contains offset and length of path string */
     if (res->field_set & (1 << UF_PATH)) {
         uri = httpd_find_uri_handler(hd, req->uri + res->field_data[UF_PATH].off,
-                                     res->field_data[UF_PATH].len, req->method, &err);
+                                     res->field_data[UF_PATH].len, req->method, &err,
+                                     ra);
     }
 
     /* If URI with method not found, respond with error code */
@@ -313,7 +358,7 @@ esp_err_t httpd_uri(struct httpd_data *hd)
     struct httpd_req_aux   *aux = req->aux;
     if (uri->is_websocket && aux->ws_handshake_detect && uri->method == HTTP_GET) {
         ESP_LOGD(TAG, LOG_FMT("Responding WS handshake to sock %d"), aux->sd->fd);
-        esp_err_t ret = httpd_ws_respond_server_handshake(&hd->hd_req, uri->supported_subprotocol);
+        esp_err_t ret = httpd_ws_respond_server_handshake(req, uri->supported_subprotocol);
         if (ret != ESP_OK) {
             return ret;
         }
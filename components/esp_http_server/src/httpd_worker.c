@@ -0,0 +1,248 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <esp_log.h>
+#include <esp_err.h>
+
+#include <esp_http_server.h>
+#include "esp_httpd_priv.h"
+
+static const char *TAG = "httpd_worker";
+
+/* Result of a request processed by a worker */
+struct httpd_worker_done {
+    struct sock_db *session;
+    esp_err_t ret;
+};
+
+/* Runs in the server task, which owns the session database. A session
+ * is watched again or deleted once its worker is done with it. */
+static void httpd_worker_finish(struct httpd_data *hd, const struct httpd_worker_done *done)
+{
+    struct sock_db *session = done->session;
+    hd->hd_workers[session->worker].inflight--;
+    session->worker_busy = false;
+
+    if (done->ret != ESP_OK || session->worker_close) {
+        session->worker_close = false;
+        httpd_sess_delete(hd, session);
+        return;
+    }
+    session->lru_counter = ++hd->lru_counter;
+    if (httpd_poll_add(hd, session) != ESP_OK) {
+        httpd_sess_delete(hd, session);
+        return;
+    }
+    if (httpd_sess_pending(hd, session)) {
+        /* Data was already received, don't wait for more */
+        httpd_poll_set_pending(hd, session);
+    }
+}
+
+static void httpd_workers_collect(void *arg)
+{
+    struct httpd_data *hd = (struct httpd_data *) arg;
+    struct httpd_worker_done done;
+
+    /* Cleared before draining the queue, so that a worker which
+     * completes a request afterwards sends a new notification */
+    atomic_store(&hd->hd_workers_notified, false);
+    while (httpd_os_queue_recv(hd->hd_workers_done, &done, false) == OS_SUCCESS) {
+        httpd_worker_finish(hd, &done);
+    }
+}
+
+/* A single control message is enough to collect any number of completed
+ * requests, which keeps the control socket from overflowing */
+static void httpd_workers_notify(struct httpd_data *hd)
+{
+    if (atomic_exchange(&hd->hd_workers_notified, true)) {
+        return;
+    }
+    if (httpd_queue_work(hd, httpd_workers_collect, hd) != ESP_OK) {
+        ESP_LOGW(TAG, LOG_FMT("failed to notify server task"));
+        atomic_store(&hd->hd_workers_notified, false);
+    }
+}
+
+static void httpd_worker_thread(void *arg)
+{
+    struct httpd_worker *w = (struct httpd_worker *) arg;
+    struct httpd_data *hd = w->hd;
+    w->td.status = THREAD_RUNNING;
+
+    ESP_LOGD(TAG, LOG_FMT("worker %d started"), (int) (w - hd->hd_workers));
+    while (1) {
+        struct sock_db *session;
+        if (httpd_os_queue_recv(w->queue, &session, true) != OS_SUCCESS) {
+            continue;
+        }
+        if (!session) {
+            break;
+        }
+        ESP_LOGD(TAG, LOG_FMT("processing socket %d"), session->fd);
+        struct httpd_worker_done done = {
+            .session = session,
+            .ret = httpd_sess_process(hd, session, &w->req, &w->req_aux),
+        };
+        /* Can't block, the queue has room for every session */
+        httpd_os_queue_send(hd->hd_workers_done, &done);
+        httpd_workers_notify(hd);
+    }
+
+    ESP_LOGD(TAG, LOG_FMT("worker %d exiting"), (int) (w - hd->hd_workers));
+    w->td.status = THREAD_STOPPED;
+    httpd_os_thread_delete();
+}
+
+esp_err_t httpd_workers_start(struct httpd_data *hd)
+{
+    unsigned count = hd->config.worker_count;
+    if (!count) {
+        return ESP_OK;
+    }
+
+    hd->hd_workers = calloc(count, sizeof(struct httpd_worker));
+    if (!hd->hd_workers) {
+        ESP_LOGE(TAG, LOG_FMT("Failed to allocate memory for HTTP workers"));
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    /* Every session has at most one request in flight, so
+     * neither the worker queues nor this one can fill up */
+    hd->hd_workers_done = httpd_os_queue_create(hd->config.max_open_sockets,
+                                                sizeof(struct httpd_worker_done));
+    if (!hd->hd_workers_done) {
+        ESP_LOGE(TAG, LOG_FMT("Failed to allocate memory for HTTP workers"));
+        httpd_workers_free(hd);
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+
+    for (unsigned i = 0; i < count; i++) {
+        struct httpd_worker *w = &hd->hd_workers[i];
+        w->hd = hd;
+        w->req_aux.resp_hdrs = calloc(hd->config.max_resp_headers, sizeof(struct resp_hdr));
+        w->queue = httpd_os_queue_create(hd->config.max_open_sockets, sizeof(struct sock_db *));
+        if (!w->req_aux.resp_hdrs || !w->queue) {
+            ESP_LOGE(TAG, LOG_FMT("Failed to allocate memory for HTTP worker"));
+            httpd_workers_stop(hd);
+            httpd_workers_free(hd);
+            return ESP_ERR_HTTPD_ALLOC_MEM;
+        }
+        if (httpd_os_thread_create(&w->td.handle, "httpd_worker",
+                                   hd->config.stack_size,
+                                   hd->config.task_priority,
+                                   httpd_worker_thread, w,
+                                   hd->config.core_id) != ESP_OK) {
+            ESP_LOGE(TAG, LOG_FMT("Failed to launch HTTP worker"));
+            httpd_workers_stop(hd);
+            httpd_workers_free(hd);
+            return ESP_ERR_HTTPD_TASK;
+        }
+        hd->hd_workers_started++;
+    }
+    return ESP_OK;
+}
+
+void httpd_workers_stop(struct httpd_data *hd)
+{
+    for (unsigned i = 0; i < hd->hd_workers_started; i++) {
+        struct sock_db *stop = NULL;
+        httpd_os_queue_send(hd->hd_workers[i].queue, &stop);
+    }
+    /* Requests already queued are processed before the stop request */
+    for (unsigned i = 0; i < hd->hd_workers_started; i++) {
+        while (hd->hd_workers[i].td.status != THREAD_STOPPED) {
+            httpd_os_thread_sleep(10);
+        }
+    }
+    hd->hd_workers_started = 0;
+    if (hd->hd_workers_done) {
+        httpd_workers_collect(hd);
+    }
+}
+
+void httpd_workers_free(struct httpd_data *hd)
+{
+    if (!hd->hd_workers) {
+        return;
+    }
+    for (unsigned i = 0; i < hd->config.worker_count; i++) {
+        struct httpd_worker *w = &hd->hd_workers[i];
+        free(w->req_aux.resp_hdrs);
+        if (w->queue) {
+            httpd_os_queue_delete(w->queue);
+        }
+    }
+    if (hd->hd_workers_done) {
+        httpd_os_queue_delete(hd->hd_workers_done);
+        hd->hd_workers_done = NULL;
+    }
+    free(hd->hd_workers);
+    hd->hd_workers = NULL;
+}
+
+struct httpd_worker *httpd_worker_self(struct httpd_data *hd)
+{
+    if (!hd->hd_workers) {
+        return NULL;
+    }
+    othread_t self = httpd_os_thread_handle();
+    for (unsigned i = 0; i < hd->hd_workers_started; i++) {
+        if (hd->hd_workers[i].td.handle == self) {
+            return &hd->hd_workers[i];
+        }
+    }
+    return NULL;
+}
+
+void httpd_worker_bind(struct httpd_data *hd, struct sock_db *session)
+{
+    session->worker = -1;
+    if (!hd->hd_workers) {
+        return;
+    }
+    unsigned best = 0;
+    for (unsigned i = 1; i < hd->config.worker_count; i++) {
+        if (hd->hd_workers[i].sessions < hd->hd_workers[best].sessions) {
+            best = i;
+        }
+    }
+    hd->hd_workers[best].sessions++;
+    session->worker = best;
+}
+
+void httpd_worker_unbind(struct httpd_data *hd, struct sock_db *session)
+{
+    if (session->worker >= 0) {
+        hd->hd_workers[session->worker].sessions--;
+        session->worker = -1;
+    }
+}
+
+void httpd_worker_dispatch(struct httpd_data *hd, struct sock_db *session)
+{
+    struct httpd_worker *w = &hd->hd_workers[session->worker];
+    /* The socket is watched again in httpd_worker_finish(), meanwhile
+     * the session belongs to the worker and can't be dispatched twice */
+    httpd_poll_del(hd, session);
+    session->worker_busy = true;
+    w->inflight++;
+    httpd_os_queue_send(w->queue, &session);
+}
+
+bool httpd_workers_saturated(struct httpd_data *hd)
+{
+    if (!hd->hd_workers) {
+        return false;
+    }
+    for (unsigned i = 0; i < hd->config.worker_count; i++) {
+        if (!hd->hd_workers[i].inflight) {
+            return false;
+        }
+    }
+    return true;
+}
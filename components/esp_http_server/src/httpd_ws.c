@@ -7,8 +7,11 @@
 
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <sys/random.h>
+#include <sys/socket.h>
+#include <netinet/tcp.h>
 #include <esp_log.h>
 #include <esp_err.h>
 #include <mbedtls/sha1.h>
@@ -31,6 +34,23 @@ static const char *TAG="httpd_ws";
 #define HTTPD_WS_MASK_BIT       0x80U
 #define HTTPD_WS_LENGTH_BITS    0x7fU
 
+/* 2 bytes header and 8 bytes length, server frames aren't masked */
+#define HTTPD_WS_MAX_HEADER_LEN 10
+
+/* A frame sent by httpd_ws_broadcast(), shared by the queues of its clients.
+ * The queues and the reference counts of the frames are changed under
+ * hd_ws_tx_lock, by the server task and by httpd_ws_send_frame_async(). */
+struct httpd_ws_tx_frame {
+    struct httpd_data *hd;
+    unsigned refs;                          /* Queues holding the frame, plus the broadcast itself */
+    httpd_ws_broadcast_policy_t policy;
+    bool all;                               /* Send to all WebSocket clients, ignoring fds */
+    size_t fd_count;
+    size_t len;                             /* Length of the encoded frame */
+    uint8_t *data;                          /* Encoded frame, follows fds */
+    int fds[];
+};
+
 /*
  * The magic GUID string used for handshake
  * Please refer to RFC6455 Section 1.3 for more details.
@@ -221,8 +241,33 @@ static esp_err_t httpd_ws_unmask_payload(uint8_t *payload, size_t len, const uin
         return ESP_ERR_INVALID_ARG;
     }
 
-    for (size_t idx = 0; idx < len; idx++) {
-        payload[idx] = (payload[idx] ^ mask_key[idx % 4]);
+    /* Bytes up to the first aligned word */
+    size_t idx = 0;
+    for (; idx < len && ((uintptr_t)(payload + idx) % sizeof(size_t)); idx++) {
+        payload[idx] ^= mask_key[idx % 4];
+    }
+
+    /* Whole words, the word size being a multiple of the key length, the key
+     * rotated to the first word applies to all of them */
+    size_t words = (len - idx) / sizeof(size_t);
+    if (words) {
+        uint8_t key_bytes[sizeof(size_t)];
+        for (size_t i = 0; i < sizeof(size_t); i++) {
+            key_bytes[i] = mask_key[(idx + i) % 4];
+        }
+        size_t key, word;
+        memcpy(&key, key_bytes, sizeof(key));
+        for (size_t end = idx + words * sizeof(size_t); idx < end; idx += sizeof(size_t)) {
+            /* Aligned, so these compile to plain loads and stores */
+            memcpy(&word, payload + idx, sizeof(word));
+            word ^= key;
+            memcpy(payload + idx, &word, sizeof(word));
+        }
+    }
+
+    /* Remaining bytes */
+    for (; idx < len; idx++) {
+        payload[idx] ^= mask_key[idx % 4];
     }
 
     return ESP_OK;
@@ -354,16 +399,11 @@ esp_err_t httpd_ws_send_frame(httpd_req_t *req, httpd_ws_frame_t *frame)
     return httpd_ws_send_frame_async(req->handle, httpd_req_to_sockfd(req), frame);
 }
 
-esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame)
+/* Returns the length of the header */
+static size_t httpd_ws_encode_header(const httpd_ws_frame_t *frame, uint8_t *header_buf)
 {
-    if (!frame) {
-        ESP_LOGW(TAG, LOG_FMT("Argument is invalid"));
-        return ESP_ERR_INVALID_ARG;
-    }
-
-    /* Prepare Tx buffer - maximum length is 14, which includes 2 bytes header, 8 bytes length, 4 bytes mask key */
-    uint8_t tx_len = 0;
-    uint8_t header_buf[10] = {0 };
+    size_t tx_len = 0;
+    memset(header_buf, 0, HTTPD_WS_MAX_HEADER_LEN);
     /* Set the `FIN` bit by default if message is not fragmented. Else, set it as per the `final` field */
     header_buf[0] |= (!frame->fragmented) ? HTTPD_WS_FIN_BIT : (frame->final? HTTPD_WS_FIN_BIT: HTTPD_WS_CONTINUE);
     header_buf[0] |= frame->type; /* Type (opcode): 4 bits */
@@ -391,27 +431,306 @@ esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t
 
     /* WebSocket server does not required to mask response payload, so leave the MASK bit as 0. */
     header_buf[1] &= (~HTTPD_WS_MASK_BIT);
+    return tx_len;
+}
+
+static esp_err_t httpd_ws_send_all(struct httpd_data *hd, struct sock_db *sess, const uint8_t *buf, size_t len)
+{
+    while (len > 0) {
+        int ret = sess->send_fn(hd, sess->fd, (const char *)buf, len, 0);
+        if (ret < 0) {
+            return ESP_FAIL;
+        }
+        buf += ret;
+        len -= ret;
+    }
+    return ESP_OK;
+}
+
+static void httpd_ws_tx_release(struct httpd_ws_tx_frame *frame)
+{
+    if (--frame->refs == 0) {
+        free(frame);
+    }
+}
+
+static void httpd_ws_tx_pop(struct sock_db *sess)
+{
+    httpd_ws_tx_release(sess->ws_tx_queue[sess->ws_tx_head]);
+    sess->ws_tx_head = (sess->ws_tx_head + 1) % CONFIG_HTTPD_WS_TX_QUEUE_LEN;
+    sess->ws_tx_count--;
+    sess->ws_tx_offset = 0;
+}
+
+/* Makes room in a full queue by dropping the oldest frame. A frame which
+ * was partially sent can't be dropped without breaking the stream. */
+static bool httpd_ws_tx_drop_oldest(struct sock_db *sess)
+{
+    struct httpd_ws_tx_frame *head = sess->ws_tx_queue[sess->ws_tx_head];
+    if (sess->ws_tx_offset == 0 || sess->ws_tx_offset == head->len) {
+        httpd_ws_tx_pop(sess);
+        return true;
+    }
+    if (sess->ws_tx_count < 2) {
+        return false;
+    }
+    /* Drop the second frame and move the partially sent one into its slot */
+    unsigned second = (sess->ws_tx_head + 1) % CONFIG_HTTPD_WS_TX_QUEUE_LEN;
+    httpd_ws_tx_release(sess->ws_tx_queue[second]);
+    sess->ws_tx_queue[second] = head;
+    sess->ws_tx_head = second;
+    sess->ws_tx_count--;
+    return true;
+}
+
+static bool httpd_ws_tx_push(struct sock_db *sess, struct httpd_ws_tx_frame *frame)
+{
+    if (sess->ws_tx_count == CONFIG_HTTPD_WS_TX_QUEUE_LEN) {
+        if (frame->policy != HTTPD_WS_BROADCAST_DROP_OLDEST || !httpd_ws_tx_drop_oldest(sess)) {
+            return false;
+        }
+    }
+    unsigned tail = (sess->ws_tx_head + sess->ws_tx_count) % CONFIG_HTTPD_WS_TX_QUEUE_LEN;
+    sess->ws_tx_queue[tail] = frame;
+    sess->ws_tx_count++;
+    frame->refs++;
+    return true;
+}
+
+/* Sends the queued frames, hd_ws_tx_lock must be held */
+static esp_err_t httpd_ws_tx_send_queued(struct httpd_data *hd, struct sock_db *session)
+{
+    if (session->ws_tx_senders) {
+        /* Resumed by the last of them, see httpd_ws_send_frame_async() */
+        httpd_poll_set_writable(hd, session, false);
+        return ESP_OK;
+    }
+    while (session->ws_tx_count) {
+        struct httpd_ws_tx_frame *head = session->ws_tx_queue[session->ws_tx_head];
+        if (session->ws_tx_offset < head->len) {
+            int ret = session->send_fn(hd, session->fd,
+                                       (const char *)head->data + session->ws_tx_offset,
+                                       head->len - session->ws_tx_offset, MSG_DONTWAIT);
+            if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+                /* Send buffer is full, wait until the socket is writable */
+                break;
+            }
+            if (ret < 0) {
+                ESP_LOGD(TAG, LOG_FMT("error in send_fn"));
+                return ESP_FAIL;
+            }
+            session->ws_tx_offset += ret;
+            continue;
+        }
+        httpd_ws_tx_pop(session);
+    }
+    httpd_poll_set_writable(hd, session, session->ws_tx_count != 0);
+    return ESP_OK;
+}
+
+esp_err_t httpd_ws_tx_flush(struct httpd_data *hd, struct sock_db *session)
+{
+    httpd_os_mutex_lock(hd->hd_ws_tx_lock);
+    esp_err_t ret = httpd_ws_tx_send_queued(hd, session);
+    httpd_os_mutex_unlock(hd->hd_ws_tx_lock);
+    return ret;
+}
+
+void httpd_ws_tx_clear(struct httpd_data *hd, struct sock_db *session)
+{
+    httpd_os_mutex_lock(hd->hd_ws_tx_lock);
+    while (session->ws_tx_count) {
+        httpd_ws_tx_pop(session);
+    }
+    httpd_os_mutex_unlock(hd->hd_ws_tx_lock);
+}
+
+/* Runs in the server task, after frames were sent directly while others were queued */
+static void httpd_ws_tx_resume_work(void *arg)
+{
+    struct sock_db *sess = (struct sock_db *) arg;
+    struct httpd_data *hd = (struct httpd_data *) sess->handle;
+
+    if (sess->fd < 0) {
+        return;
+    }
+    if (sess->worker_busy) {
+        /* Flushed once the worker is done and the socket is watched again */
+        httpd_poll_set_writable(hd, sess, true);
+        return;
+    }
+    if (httpd_ws_tx_flush(hd, sess) != ESP_OK) {
+        ESP_LOGW(TAG, LOG_FMT("Failed to send WS frame to fd %d"), sess->fd);
+        httpd_sess_delete(hd, sess);
+    }
+}
+
+static bool httpd_ws_broadcast_target(const struct httpd_ws_tx_frame *frame, const struct sock_db *sess)
+{
+    if (sess->fd < 0 || !sess->ws_handshake_done || sess->ws_close) {
+        return false;
+    }
+    if (frame->all) {
+        return true;
+    }
+    for (size_t i = 0; i < frame->fd_count; i++) {
+        if (frame->fds[i] == sess->fd) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Runs in the server task */
+static void httpd_ws_broadcast_work(void *arg)
+{
+    struct httpd_ws_tx_frame *frame = (struct httpd_ws_tx_frame *) arg;
+    struct httpd_data *hd = frame->hd;
+
+    for (int i = 0; i < hd->config.max_open_sockets; i++) {
+        struct sock_db *sess = &hd->hd_sd[i];
+        if (!httpd_ws_broadcast_target(frame, sess)) {
+            continue;
+        }
+        if (!sess->ws_tx_nodelay) {
+            /* Frames are sent in one piece, delaying them for coalescing
+             * only adds latency, up to the client's delayed ACK timeout */
+            int nodelay = 1;
+            setsockopt(sess->fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+            sess->ws_tx_nodelay = true;
+        }
+        httpd_os_mutex_lock(hd->hd_ws_tx_lock);
+        bool queued = httpd_ws_tx_push(sess, frame);
+        esp_err_t ret = ESP_OK;
+        if (queued && !sess->worker_busy) {
+            ret = httpd_ws_tx_send_queued(hd, sess);
+        }
+        httpd_os_mutex_unlock(hd->hd_ws_tx_lock);
+        if (!queued) {
+            ESP_LOGD(TAG, LOG_FMT("queue of fd %d is full, frame dropped"), sess->fd);
+            continue;
+        }
+        if (sess->worker_busy) {
+            /* Flushed once the worker is done and the socket is watched again */
+            httpd_poll_set_writable(hd, sess, true);
+            continue;
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, LOG_FMT("Failed to send WS frame to fd %d"), sess->fd);
+            httpd_sess_delete(hd, sess);
+        }
+    }
+    httpd_os_mutex_lock(hd->hd_ws_tx_lock);
+    httpd_ws_tx_release(frame);
+    httpd_os_mutex_unlock(hd->hd_ws_tx_lock);
+}
+
+esp_err_t httpd_ws_broadcast(httpd_handle_t handle, httpd_ws_frame_t *frame,
+                             const int *fds, size_t fd_count,
+                             httpd_ws_broadcast_policy_t policy)
+{
+    if (!handle || !frame || (frame->len && !frame->payload) || (fds && !fd_count)) {
+        ESP_LOGW(TAG, LOG_FMT("Argument is invalid"));
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* Encode the frame once for all clients */
+    uint8_t header_buf[HTTPD_WS_MAX_HEADER_LEN];
+    size_t header_len = httpd_ws_encode_header(frame, header_buf);
+    size_t fds_len = fds ? fd_count : 0;
+    struct httpd_ws_tx_frame *tx = malloc(sizeof(struct httpd_ws_tx_frame) + fds_len * sizeof(int) +
+                                          header_len + frame->len);
+    if (!tx) {
+        ESP_LOGE(TAG, LOG_FMT("Failed to allocate memory for WS frame"));
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    tx->hd = (struct httpd_data *) handle;
+    tx->refs = 1;
+    tx->policy = policy;
+    tx->all = (fds == NULL);
+    tx->fd_count = fds_len;
+    if (fds_len) {
+        memcpy(tx->fds, fds, fds_len * sizeof(int));
+    }
+    tx->len = header_len + frame->len;
+    tx->data = (uint8_t *)&tx->fds[fds_len];
+    memcpy(tx->data, header_buf, header_len);
+    if (frame->len) {
+        memcpy(tx->data + header_len, frame->payload, frame->len);
+    }
+
+    if (httpd_queue_work(handle, httpd_ws_broadcast_work, tx) != ESP_OK) {
+        free(tx);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame)
+{
+    if (!frame) {
+        ESP_LOGW(TAG, LOG_FMT("Argument is invalid"));
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t header_buf[HTTPD_WS_MAX_HEADER_LEN];
+    size_t tx_len = httpd_ws_encode_header(frame, header_buf);
 
     struct sock_db *sess = httpd_sess_get(hd, fd);
     if (!sess) {
         return ESP_ERR_INVALID_ARG;
     }
 
+    /* Take over the rest of the broadcast frame the server task started
+     * sending, so that this frame doesn't end up in the middle of it, and
+     * keep the server task from sending queued frames meanwhile */
+    struct httpd_data *hd_data = (struct httpd_data *) hd;
+    struct httpd_ws_tx_frame *partial = NULL;
+    size_t offset = 0;
+    httpd_os_mutex_lock(hd_data->hd_ws_tx_lock);
+    sess->ws_tx_senders++;
+    if (sess->ws_tx_count && sess->ws_tx_offset) {
+        struct httpd_ws_tx_frame *head = sess->ws_tx_queue[sess->ws_tx_head];
+        if (sess->ws_tx_offset < head->len) {
+            partial = head;
+            partial->refs++;
+            offset = sess->ws_tx_offset;
+            sess->ws_tx_offset = head->len;
+        }
+    }
+    httpd_os_mutex_unlock(hd_data->hd_ws_tx_lock);
+
+    esp_err_t ret = ESP_OK;
+    if (partial && httpd_ws_send_all(hd, sess, partial->data + offset, partial->len - offset) != ESP_OK) {
+        ESP_LOGW(TAG, LOG_FMT("Failed to complete queued WS frame"));
+        ret = ESP_FAIL;
+    }
+
     /* Send off header */
-    if (sess->send_fn(hd, fd, (const char *)header_buf, tx_len, 0) < 0) {
+    if (ret == ESP_OK && httpd_ws_send_all(hd, sess, header_buf, tx_len) != ESP_OK) {
         ESP_LOGW(TAG, LOG_FMT("Failed to send WS header"));
-        return ESP_FAIL;
+        ret = ESP_FAIL;
     }
 
     /* Send off payload */
-    if(frame->len > 0 && frame->payload != NULL) {
-        if (sess->send_fn(hd, fd, (const char *)frame->payload, frame->len, 0) < 0) {
+    if (ret == ESP_OK && frame->len > 0 && frame->payload != NULL) {
+        if (httpd_ws_send_all(hd, sess, frame->payload, frame->len) != ESP_OK) {
             ESP_LOGW(TAG, LOG_FMT("Failed to send WS payload"));
-            return ESP_FAIL;
+            ret = ESP_FAIL;
         }
     }
 
-    return ESP_OK;
+    httpd_os_mutex_lock(hd_data->hd_ws_tx_lock);
+    if (partial) {
+        httpd_ws_tx_release(partial);
+    }
+    bool resume = --sess->ws_tx_senders == 0 && sess->ws_tx_count;
+    httpd_os_mutex_unlock(hd_data->hd_ws_tx_lock);
+    if (resume && httpd_queue_work(hd, httpd_ws_tx_resume_work, sess) != ESP_OK) {
+        ESP_LOGW(TAG, LOG_FMT("Failed to resume sending the queued WS frames"));
+    }
+
+    return ret;
 }
 
 esp_err_t httpd_ws_get_frame_type(httpd_req_t *req)
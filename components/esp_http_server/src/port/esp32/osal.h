@@ -9,8 +9,11 @@
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
 #include <unistd.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <esp_timer.h>
 
 #ifdef __cplusplus
@@ -50,6 +53,52 @@ static inline othread_t httpd_os_thread_handle(void)
     return xTaskGetCurrentTaskHandle();
 }
 
+typedef QueueHandle_t oqueue_t;
+
+static inline oqueue_t httpd_os_queue_create(unsigned length, size_t item_size)
+{
+    return xQueueCreate(length, item_size);
+}
+
+static inline void httpd_os_queue_delete(oqueue_t queue)
+{
+    vQueueDelete(queue);
+}
+
+/* Blocks while the queue is full */
+static inline int httpd_os_queue_send(oqueue_t queue, const void *item)
+{
+    return xQueueSend(queue, item, portMAX_DELAY) == pdTRUE ? OS_SUCCESS : OS_FAIL;
+}
+
+/* Blocks while the queue is empty, unless wait is false */
+static inline int httpd_os_queue_recv(oqueue_t queue, void *item, bool wait)
+{
+    return xQueueReceive(queue, item, wait ? portMAX_DELAY : 0) == pdTRUE ? OS_SUCCESS : OS_FAIL;
+}
+
+typedef SemaphoreHandle_t omutex_t;
+
+static inline omutex_t httpd_os_mutex_create(void)
+{
+    return xSemaphoreCreateMutex();
+}
+
+static inline void httpd_os_mutex_delete(omutex_t mutex)
+{
+    vSemaphoreDelete(mutex);
+}
+
+static inline void httpd_os_mutex_lock(omutex_t mutex)
+{
+    xSemaphoreTake(mutex, portMAX_DELAY);
+}
+
+static inline void httpd_os_mutex_unlock(omutex_t mutex)
+{
+    xSemaphoreGive(mutex);
+}
+
 #ifdef __cplusplus
 }
 #endif
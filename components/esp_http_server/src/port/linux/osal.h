@@ -0,0 +1,154 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _OSAL_H_
+#define _OSAL_H_
+
+#include <pthread.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OS_SUCCESS ESP_OK
+#define OS_FAIL    ESP_FAIL
+
+typedef pthread_t othread_t;
+
+/* The stack size, priority and core affinity are left to the host OS */
+static inline int httpd_os_thread_create(othread_t *thread,
+                                 const char *name, uint16_t stacksize, int prio,
+                                 void (*thread_routine)(void *arg), void *arg,
+                                 int core_id)
+{
+    if (pthread_create(thread, NULL, (void *(*)(void *)) thread_routine, arg) == 0) {
+        return OS_SUCCESS;
+    }
+    return OS_FAIL;
+}
+
+/* Only self delete is supported */
+static inline void httpd_os_thread_delete(void)
+{
+    pthread_detach(pthread_self());
+    pthread_exit(NULL);
+}
+
+static inline void httpd_os_thread_sleep(int msecs)
+{
+    usleep(msecs * 1000);
+}
+
+static inline othread_t httpd_os_thread_handle(void)
+{
+    return pthread_self();
+}
+
+/* Bounded FIFO of fixed size items, the equivalent of a FreeRTOS queue */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t  not_empty;
+    pthread_cond_t  not_full;
+    unsigned        length;
+    size_t          item_size;
+    unsigned        head;
+    unsigned        count;
+    char            items[];
+} *oqueue_t;
+
+static inline oqueue_t httpd_os_queue_create(unsigned length, size_t item_size)
+{
+    oqueue_t queue = calloc(1, sizeof(*queue) + length * item_size);
+    if (queue) {
+        pthread_mutex_init(&queue->lock, NULL);
+        pthread_cond_init(&queue->not_empty, NULL);
+        pthread_cond_init(&queue->not_full, NULL);
+        queue->length = length;
+        queue->item_size = item_size;
+    }
+    return queue;
+}
+
+static inline void httpd_os_queue_delete(oqueue_t queue)
+{
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+    free(queue);
+}
+
+/* Blocks while the queue is full */
+static inline int httpd_os_queue_send(oqueue_t queue, const void *item)
+{
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == queue->length) {
+        pthread_cond_wait(&queue->not_full, &queue->lock);
+    }
+    unsigned tail = (queue->head + queue->count) % queue->length;
+    memcpy(queue->items + tail * queue->item_size, item, queue->item_size);
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+    pthread_mutex_unlock(&queue->lock);
+    return OS_SUCCESS;
+}
+
+/* Blocks while the queue is empty, unless wait is false */
+static inline int httpd_os_queue_recv(oqueue_t queue, void *item, bool wait)
+{
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0) {
+        if (!wait) {
+            pthread_mutex_unlock(&queue->lock);
+            return OS_FAIL;
+        }
+        pthread_cond_wait(&queue->not_empty, &queue->lock);
+    }
+    memcpy(item, queue->items + queue->head * queue->item_size, queue->item_size);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    pthread_cond_signal(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+    return OS_SUCCESS;
+}
+
+typedef pthread_mutex_t *omutex_t;
+
+static inline omutex_t httpd_os_mutex_create(void)
+{
+    omutex_t mutex = malloc(sizeof(*mutex));
+    if (mutex) {
+        pthread_mutex_init(mutex, NULL);
+    }
+    return mutex;
+}
+
+static inline void httpd_os_mutex_delete(omutex_t mutex)
+{
+    pthread_mutex_destroy(mutex);
+    free(mutex);
+}
+
+static inline void httpd_os_mutex_lock(omutex_t mutex)
+{
+    pthread_mutex_lock(mutex);
+}
+
+static inline void httpd_os_mutex_unlock(omutex_t mutex)
+{
+    pthread_mutex_unlock(mutex);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ! _OSAL_H_ */
@@ -6,8 +6,11 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <esp_system.h>
+#include <esp_timer.h>
 #include <esp_http_server.h>
+#include <lwip/sockets.h>
 
 #include "unity.h"
 #include "test_utils.h"
@@ -160,6 +163,32 @@ TEST_CASE("Basic Functionality Tests", "[HTTP SERVER]")
     TEST_ASSERT(httpd_stop(hd) == ESP_OK);
 }
 
+TEST_CASE("Only identical URI templates and methods are duplicates", "[HTTP SERVER]")
+{
+    httpd_handle_t hd;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.uri_match_fn = httpd_uri_match_wildcard;
+
+    test_case_uses_tcpip();
+
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+
+    char wildcard[] = "/dev/*";
+    char list[] = "/dev/list";
+    httpd_uri_t uri = handler_limit_uri(wildcard);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &uri) == ESP_OK);
+    /* Matched by the template already registered, but a different template */
+    uri = handler_limit_uri(list);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &uri) == ESP_OK);
+    uri.method = HTTP_POST;
+    TEST_ASSERT(httpd_register_uri_handler(hd, &uri) == ESP_OK);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &uri) == ESP_ERR_HTTPD_HANDLER_EXISTS);
+    uri = handler_limit_uri(wildcard);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &uri) == ESP_ERR_HTTPD_HANDLER_EXISTS);
+
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+}
+
 TEST_CASE("URI Wildcard Matcher Tests", "[HTTP SERVER]")
 {
     struct uritest {
@@ -243,3 +272,91 @@ TEST_CASE("Max Allowed Sockets Test", "[HTTP SERVER]")
     config.max_open_sockets += 1;
     TEST_ASSERT(httpd_start(&hd, &config) != ESP_OK);
 }
+
+#define ROUTER_TEST_REQUESTS 500
+
+static esp_err_t router_test_handler(httpd_req_t *req)
+{
+#ifdef CONFIG_HTTPD_URI_ROUTER
+    char id[8];
+    if (httpd_req_get_path_param(req, "id", id, sizeof(id)) != ESP_OK || strcmp(id, "42") != 0) {
+        return httpd_resp_send_500(req);
+    }
+#endif
+    return httpd_resp_send(req, "ok", HTTPD_RESP_USE_STRLEN);
+}
+
+/* Sends keep-alive requests for the handler registered last,
+ * which is the worst case for searching the handlers linearly */
+static void test_router_throughput(unsigned routes)
+{
+    httpd_handle_t hd;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.max_uri_handlers = routes;
+    config.server_port += 10;
+    config.ctrl_port += 10;
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+
+    char (*paths)[32] = calloc(routes, sizeof(*paths));
+    TEST_ASSERT_NOT_NULL(paths);
+    for (unsigned i = 0; i < routes; i++) {
+#ifdef CONFIG_HTTPD_URI_ROUTER
+        snprintf(paths[i], sizeof(paths[i]), "/route%u/item/{id}", i);
+#else
+        snprintf(paths[i], sizeof(paths[i]), "/route%u/item/42", i);
+#endif
+        httpd_uri_t uri = {
+            .uri      = paths[i],
+            .method   = HTTP_GET,
+            .handler  = router_test_handler,
+            .user_ctx = NULL,
+        };
+        TEST_ASSERT(httpd_register_uri_handler(hd, &uri) == ESP_OK);
+    }
+
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(config.server_port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    TEST_ASSERT(sock >= 0);
+    TEST_ASSERT(connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+
+    char request[64];
+    int request_len = snprintf(request, sizeof(request),
+                               "GET /route%u/item/42 HTTP/1.1\r\n\r\n", routes - 1);
+    char response[256];
+    int response_len = 0;
+
+    int64_t start = esp_timer_get_time();
+    for (unsigned i = 0; i < ROUTER_TEST_REQUESTS; i++) {
+        TEST_ASSERT(send(sock, request, request_len, 0) == request_len);
+        /* All responses have the length of the first one */
+        int received = 0;
+        do {
+            int len = recv(sock, response + received, sizeof(response) - 1 - received, 0);
+            TEST_ASSERT(len > 0);
+            received += len;
+            response[received] = '\0';
+        } while (response_len ? received < response_len : strstr(response, "\r\n\r\nok") == NULL);
+        response_len = received;
+        TEST_ASSERT(strncmp(response, "HTTP/1.1 200", 12) == 0);
+    }
+    int64_t elapsed = esp_timer_get_time() - start;
+
+    printf("%u routes: %d requests/sec\n", routes, (int) (ROUTER_TEST_REQUESTS * 1000000LL / elapsed));
+
+    close(sock);
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+    free(paths);
+}
+
+TEST_CASE("URI Router Throughput Test", "[HTTP SERVER]")
+{
+    test_case_uses_tcpip();
+
+    test_router_throughput(8);
+    test_router_throughput(32);
+    test_router_throughput(128);
+}
@@ -33,6 +33,9 @@ typedef struct {
     bool bulk_flash_erase;                         /*!< Erase entire flash partition during initialization. By default flash partition is erased during write operation and in chunk of 4K sector size */
     bool partial_http_download;                    /*!< Enable Firmware image to be downloaded over multiple HTTP requests */
     int max_http_request_size;                     /*!< Maximum request size for partial HTTP download */
+    bool ota_resumption;                           /*!< Continue a download which was interrupted instead of downloading the image from the start */
+    size_t ota_image_bytes_written;                /*!< Bytes written by the interrupted download, as returned by esp_https_ota_get_image_len_read() */
+    int max_parallel_requests;                     /*!< Number of HTTP requests for different parts of the image in flight at once, requires partial_http_download */
 } esp_https_ota_config_t;
 
 #define ESP_ERR_HTTPS_OTA_BASE            (0x9000)
@@ -192,6 +195,10 @@ esp_err_t esp_https_ota_get_img_desc(esp_https_ota_handle_t https_ota_handle, es
 *
 * @note   This API should be called only if `esp_https_ota_perform()` has been called atleast once or
 *         if `esp_https_ota_get_img_desc` has been called before.
+*         With `max_parallel_requests`, only the data up to the first part of the image which isn't
+*         downloaded completely is counted. The value can be saved, e.g. in NVS, and passed as
+*         `ota_image_bytes_written` to continue the download after a reset.
+*         For a compressed image, the bytes of the compressed image are counted.
 *
 * @param[in]   https_ota_handle   pointer to esp_https_ota_handle_t structure
 *
@@ -208,6 +215,7 @@ int esp_https_ota_get_image_len_read(esp_https_ota_handle_t https_ota_handle);
 * @note   This API should be called after esp_https_ota_begin() has been already called.
 *         This can be used to create some sort of progress indication
 *         (in combination with esp_https_ota_get_image_len_read())
+*         For a compressed image, this is the size of the compressed image.
 *
 * @param[in]   https_ota_handle   pointer to esp_https_ota_handle_t structure
 *
@@ -18,14 +18,39 @@
 #include <esp_https_ota.h>
 #include <esp_log.h>
 #include <esp_ota_ops.h>
+#include <esp_ota_compressed.h>
 #include <errno.h>
 #include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 
 #define IMAGE_HEADER_SIZE sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t) + sizeof(esp_app_desc_t) + 1
+_Static_assert(IMAGE_HEADER_SIZE >= sizeof(esp_ota_compressed_header_t), "image header read should include the compressed image header");
 #define DEFAULT_OTA_BUF_SIZE IMAGE_HEADER_SIZE
 #define DEFAULT_REQUEST_SIZE (64 * 1024)
+#define DEFAULT_RANGE_RETRIES 3
+#define RANGE_TASK_WAIT_MS 100
+/* Flash encryption requires writes of 16 byte blocks, parts of the image are written at multiples of it */
+#define FLASH_WRITE_ALIGN 16
 static const char *TAG = "esp_https_ota";
 
+struct esp_https_ota_handle;
+
+/* Connection downloading one range of the image at a time, for parallel download */
+typedef struct {
+    struct esp_https_ota_handle *ota;
+    esp_http_client_handle_t http_client;
+    char *buf;
+    int range;          /* Index of the range being downloaded */
+    int offset;         /* Image offset of the first byte in buf */
+    int buffered;       /* Bytes in buf which aren't written to the partition yet */
+    int end;            /* Image offset after the last byte of the range */
+    int retries;        /* Failures since data was last received */
+    bool connected;
+    bool finished;      /* All the ranges were taken */
+} ota_stream_t;
+
 typedef enum {
     ESP_HTTPS_OTA_INIT,
     ESP_HTTPS_OTA_BEGIN,
@@ -45,6 +70,20 @@ struct esp_https_ota_handle {
     esp_https_ota_state state;
     bool bulk_flash_erase;
     bool partial_http_download;
+    bool compressed;                    /* The image is a compressed image, decompressed by esp_ota_write */
+    int image_offset;                   /* Bytes of the image kept from an interrupted download */
+    int max_parallel_requests;
+    ota_stream_t *streams;              /* streams[0] is read by esp_https_ota_perform, the others by tasks */
+    int stream_count;
+    int range_tasks;                    /* Tasks which haven't exited yet */
+    int range_count;
+    int next_range;                     /* Index of the first range which no stream took */
+    int ranges_written;                 /* Number of ranges at the start of the image which are written */
+    bool *range_done;
+    SemaphoreHandle_t range_lock;
+    SemaphoreHandle_t range_task_exit;
+    bool range_stop;                    /* Tasks exit, protected by range_lock */
+    esp_err_t range_err;                /* First error of a task, protected by range_lock */
 };
 
 typedef struct esp_https_ota_handle esp_https_ota_t;
@@ -149,6 +188,24 @@ static void _http_cleanup(esp_http_client_handle_t client)
     esp_http_client_cleanup(client);
 }
 
+/* Requests bytes start to end of the image, to its end if end is negative */
+static esp_err_t _http_set_range(esp_http_client_handle_t http_client, int start, int end)
+{
+    char *header_val = NULL;
+    if (end < 0) {
+        asprintf(&header_val, "bytes=%d-", start);
+    } else {
+        asprintf(&header_val, "bytes=%d-%d", start, end);
+    }
+    if (header_val == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate memory for HTTP header");
+        return ESP_ERR_NO_MEM;
+    }
+    esp_http_client_set_header(http_client, "Range", header_val);
+    free(header_val);
+    return ESP_OK;
+}
+
 static esp_err_t _ota_write(esp_https_ota_t *https_ota_handle, const void *buffer, size_t buf_len)
 {
     if (buffer == NULL || https_ota_handle == NULL) {
@@ -165,6 +222,317 @@ static esp_err_t _ota_write(esp_https_ota_t *https_ota_handle, const void *buffe
     return err;
 }
 
+static esp_err_t _ota_stream_next_range(esp_https_ota_t *handle, ota_stream_t *stream)
+{
+    xSemaphoreTake(handle->range_lock, portMAX_DELAY);
+    int range = (handle->next_range < handle->range_count) ? handle->next_range++ : -1;
+    xSemaphoreGive(handle->range_lock);
+    if (range < 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    stream->range = range;
+    stream->offset = handle->image_offset + range * handle->max_http_request_size;
+    stream->end = MIN(stream->offset + handle->max_http_request_size, handle->image_length);
+    stream->buffered = 0;
+    stream->retries = 0;
+    stream->connected = false;
+    return ESP_OK;
+}
+
+static void _ota_stream_range_done(esp_https_ota_t *handle, ota_stream_t *stream)
+{
+    xSemaphoreTake(handle->range_lock, portMAX_DELAY);
+    handle->range_done[stream->range] = true;
+    while (handle->ranges_written < handle->range_count && handle->range_done[handle->ranges_written]) {
+        handle->ranges_written++;
+    }
+    /* Only the data which doesn't have to be downloaded again when the OTA is resumed */
+    handle->binary_file_len = MIN(handle->image_offset + handle->ranges_written * handle->max_http_request_size,
+                                  handle->image_length);
+    xSemaphoreGive(handle->range_lock);
+}
+
+static esp_err_t _ota_stream_connect(ota_stream_t *stream)
+{
+    if (!esp_http_client_is_complete_data_received(stream->http_client)) {
+        /* The connection is kept for the next range only if the whole response was read */
+        esp_http_client_close(stream->http_client);
+    }
+    esp_err_t err = _http_set_range(stream->http_client, stream->offset + stream->buffered, stream->end - 1);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = _http_connect(stream->http_client);
+    if (err == ESP_OK && esp_http_client_get_status_code(stream->http_client) != HttpStatus_PartialContent) {
+        ESP_LOGE(TAG, "Server ignored the range request (%d)", esp_http_client_get_status_code(stream->http_client));
+        err = ESP_FAIL;
+    }
+    if (err != ESP_OK) {
+        esp_http_client_close(stream->http_client);
+    }
+    return err;
+}
+
+static esp_err_t _ota_stream_retry(ota_stream_t *stream, esp_err_t err)
+{
+    if (++stream->retries > DEFAULT_RANGE_RETRIES) {
+        ESP_LOGE(TAG, "Failed to download bytes %d-%d of the image", stream->offset + stream->buffered, stream->end - 1);
+        return err;
+    }
+    ESP_LOGW(TAG, "Connection lost, requesting bytes %d-%d again", stream->offset + stream->buffered, stream->end - 1);
+    return ESP_ERR_HTTPS_OTA_IN_PROGRESS;
+}
+
+static esp_err_t _ota_stream_write(esp_https_ota_t *handle, ota_stream_t *stream)
+{
+    const bool range_received = (stream->offset + stream->buffered == stream->end);
+    /* Ranges start at aligned offsets, only the end of the image is padded */
+    const int len = range_received ? stream->buffered : (stream->buffered & ~(FLASH_WRITE_ALIGN - 1));
+    const int write_len = (len + FLASH_WRITE_ALIGN - 1) & ~(FLASH_WRITE_ALIGN - 1);
+    if (len == 0) {
+        return ESP_ERR_HTTPS_OTA_IN_PROGRESS;
+    }
+    memset(stream->buf + len, 0xFF, write_len - len);
+    esp_err_t err = esp_ota_write_with_offset(handle->update_handle, stream->buf, write_len, stream->offset);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error: esp_ota_write_with_offset failed! err=0x%x", err);
+        return err;
+    }
+    stream->buffered -= len;
+    memmove(stream->buf, stream->buf + len, stream->buffered);
+    stream->offset += len;
+    ESP_LOGD(TAG, "Written image bytes %d-%d", stream->offset - len, stream->offset - 1);
+    if (range_received) {
+        _ota_stream_range_done(handle, stream);
+    }
+    return ESP_ERR_HTTPS_OTA_IN_PROGRESS;
+}
+
+/*
+ * Reads the next part of the range of the stream and writes it to the partition.
+ * Returns ESP_ERR_NOT_FOUND once all the ranges were taken by the streams.
+ */
+static esp_err_t _ota_stream_perform(esp_https_ota_t *handle, ota_stream_t *stream)
+{
+    esp_err_t err;
+    if (stream->offset + stream->buffered == stream->end) {
+        err = _ota_stream_next_range(handle, stream);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    if (!stream->connected) {
+        err = _ota_stream_connect(stream);
+        if (err != ESP_OK) {
+            return _ota_stream_retry(stream, err);
+        }
+        stream->connected = true;
+    }
+    const int len = MIN(handle->ota_upgrade_buf_size - stream->buffered, stream->end - stream->offset - stream->buffered);
+    if (len > 0) {
+        errno = 0;
+        int data_read = esp_http_client_read(stream->http_client, stream->buf + stream->buffered, len);
+        if (data_read <= 0) {
+            /* As in esp_https_ota_perform, errno tells whether the connection was closed */
+            if (data_read < 0 || errno == ENOTCONN || errno == ECONNRESET || errno == ECONNABORTED ||
+                    esp_http_client_is_complete_data_received(stream->http_client)) {
+                stream->connected = false;
+                return _ota_stream_retry(stream, ESP_FAIL);
+            }
+            return ESP_ERR_HTTPS_OTA_IN_PROGRESS;
+        }
+        stream->buffered += data_read;
+        stream->retries = 0;
+    }
+    return _ota_stream_write(handle, stream);
+}
+
+static void _ota_stream_task(void *arg)
+{
+    ota_stream_t *stream = (ota_stream_t *)arg;
+    esp_https_ota_t *handle = stream->ota;
+    esp_err_t err;
+    bool stop;
+
+    do {
+        err = _ota_stream_perform(handle, stream);
+        xSemaphoreTake(handle->range_lock, portMAX_DELAY);
+        if (err != ESP_ERR_HTTPS_OTA_IN_PROGRESS && err != ESP_ERR_NOT_FOUND && handle->range_err == ESP_OK) {
+            handle->range_err = err;
+        }
+        stop = handle->range_stop || handle->range_err != ESP_OK;
+        xSemaphoreGive(handle->range_lock);
+    } while (err == ESP_ERR_HTTPS_OTA_IN_PROGRESS && !stop);
+    esp_http_client_close(stream->http_client);
+    xSemaphoreGive(handle->range_task_exit);
+    vTaskDelete(NULL);
+}
+
+/* Stops the tasks and frees the streams, the first stream uses the client and buffer of the handle */
+static void _ota_parallel_cleanup(esp_https_ota_t *handle)
+{
+    if (handle->streams) {
+        xSemaphoreTake(handle->range_lock, portMAX_DELAY);
+        handle->range_stop = true;
+        xSemaphoreGive(handle->range_lock);
+        while (handle->range_tasks > 0) {
+            xSemaphoreTake(handle->range_task_exit, portMAX_DELAY);
+            handle->range_tasks--;
+        }
+        for (int i = 1; i < handle->stream_count; i++) {
+            if (handle->streams[i].http_client) {
+                _http_cleanup(handle->streams[i].http_client);
+            }
+            free(handle->streams[i].buf);
+        }
+        free(handle->streams);
+        handle->streams = NULL;
+    }
+    free(handle->range_done);
+    handle->range_done = NULL;
+    if (handle->range_lock) {
+        vSemaphoreDelete(handle->range_lock);
+        handle->range_lock = NULL;
+    }
+    if (handle->range_task_exit) {
+        vSemaphoreDelete(handle->range_task_exit);
+        handle->range_task_exit = NULL;
+    }
+}
+
+/*
+ * Splits the rest of the image in ranges of max_http_request_size. The connection of the handle
+ * already requested the first range, a client is created for each other stream.
+ */
+static esp_err_t _ota_parallel_init(esp_https_ota_t *handle, esp_https_ota_config_t *ota_config)
+{
+    handle->range_count = (handle->image_length - handle->image_offset + handle->max_http_request_size - 1) / handle->max_http_request_size;
+    handle->stream_count = MIN(handle->max_parallel_requests, handle->range_count);
+    if (handle->stream_count < 2) {
+        return ESP_OK;
+    }
+    handle->streams = calloc(handle->stream_count, sizeof(ota_stream_t));
+    handle->range_done = calloc(handle->range_count, sizeof(bool));
+    handle->range_lock = xSemaphoreCreateMutex();
+    handle->range_task_exit = xSemaphoreCreateCounting(handle->stream_count, 0);
+    if (!handle->streams || !handle->range_done || !handle->range_lock || !handle->range_task_exit) {
+        goto failure;
+    }
+
+    handle->streams[0] = (ota_stream_t) {
+        .ota = handle,
+        .http_client = handle->http_client,
+        .buf = handle->ota_upgrade_buf,
+        .range = 0,
+        .offset = handle->image_offset,
+        .end = MIN(handle->image_offset + handle->max_http_request_size, handle->image_length),
+        .connected = true,
+    };
+    handle->next_range = 1;
+    for (int i = 1; i < handle->stream_count; i++) {
+        ota_stream_t *stream = &handle->streams[i];
+        stream->ota = handle;
+        stream->buf = malloc(handle->ota_upgrade_buf_size + FLASH_WRITE_ALIGN);
+        stream->http_client = esp_http_client_init(ota_config->http_config);
+        if (!stream->buf || !stream->http_client) {
+            goto failure;
+        }
+        if (ota_config->http_client_init_cb && ota_config->http_client_init_cb(stream->http_client) != ESP_OK) {
+            goto failure;
+        }
+    }
+    return ESP_OK;
+
+failure:
+    _ota_parallel_cleanup(handle);
+    return ESP_ERR_NO_MEM;
+}
+
+static esp_err_t _ota_parallel_start(esp_https_ota_t *handle)
+{
+    for (int i = 1; i < handle->stream_count; i++) {
+        if (xTaskCreate(_ota_stream_task, "ota_range", CONFIG_ESP_HTTPS_OTA_RANGE_TASK_STACK_SIZE,
+                        &handle->streams[i], uxTaskPriorityGet(NULL), NULL) != pdPASS) {
+            ESP_LOGW(TAG, "Failed to create download task, continuing with %d connections", i);
+            break;
+        }
+        handle->range_tasks++;
+    }
+    return ESP_ERR_HTTPS_OTA_IN_PROGRESS;
+}
+
+static esp_err_t _ota_parallel_perform(esp_https_ota_t *handle)
+{
+    xSemaphoreTake(handle->range_lock, portMAX_DELAY);
+    esp_err_t err = handle->range_err;
+    xSemaphoreGive(handle->range_lock);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    ota_stream_t *stream = &handle->streams[0];
+    if (!stream->finished) {
+        err = _ota_stream_perform(handle, stream);
+        if (err != ESP_ERR_NOT_FOUND) {
+            return err;
+        }
+        stream->finished = true;
+        esp_http_client_close(stream->http_client);
+    }
+    /* Wait for the tasks to write the ranges they took */
+    while (handle->range_tasks > 0) {
+        if (xSemaphoreTake(handle->range_task_exit, pdMS_TO_TICKS(RANGE_TASK_WAIT_MS)) != pdTRUE) {
+            return ESP_ERR_HTTPS_OTA_IN_PROGRESS;
+        }
+        handle->range_tasks--;
+        xSemaphoreTake(handle->range_lock, portMAX_DELAY);
+        err = handle->range_err;
+        xSemaphoreGive(handle->range_lock);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+/* Reads the headers at the start of the image to the buffer, they are written with the rest of the image */
+static esp_err_t _read_image_header(esp_https_ota_t *handle)
+{
+    /*
+     * `data_read_size` holds number of bytes needed to read complete header.
+     * `bytes_read` holds number of bytes read.
+     */
+    int data_read_size = IMAGE_HEADER_SIZE;
+    int data_read = 0, bytes_read = 0;
+    /*
+     * while loop is added to download complete image headers, even if the headers
+     * are not sent in a single packet.
+     */
+    while (data_read_size > 0 && !esp_http_client_is_complete_data_received(handle->http_client)) {
+        data_read = esp_http_client_read(handle->http_client,
+                                          (handle->ota_upgrade_buf + bytes_read),
+                                          data_read_size);
+        /*
+         * As esp_http_client_read doesn't return negative error code if select fails, we rely on
+         * `errno` to check for underlying transport connectivity closure if any
+         */
+        if (errno == ENOTCONN || errno == ECONNRESET || errno == ECONNABORTED || data_read < 0) {
+            ESP_LOGE(TAG, "Connection closed, errno = %d", errno);
+            break;
+        }
+        data_read_size -= data_read;
+        bytes_read += data_read;
+    }
+    if (data_read_size > 0) {
+        ESP_LOGE(TAG, "Complete headers were not received");
+        return ESP_FAIL;
+    }
+    handle->binary_file_len = bytes_read;
+    /* The compressed image header holds a copy of the app description */
+    handle->compressed = (memcmp(handle->ota_upgrade_buf, ESP_OTA_COMPRESSED_MAGIC, strlen(ESP_OTA_COMPRESSED_MAGIC)) == 0);
+    return ESP_OK;
+}
+
 static bool is_server_verification_enabled(esp_https_ota_config_t *ota_config) {
     return  (ota_config->http_config->cert_pem
             || ota_config->http_config->use_global_ca_store
@@ -202,6 +570,18 @@ esp_err_t esp_https_ota_begin(esp_https_ota_config_t *ota_config, esp_https_ota_
 
     https_ota_handle->partial_http_download = ota_config->partial_http_download;
     https_ota_handle->max_http_request_size = (ota_config->max_http_request_size == 0) ? DEFAULT_REQUEST_SIZE : ota_config->max_http_request_size;
+    if (ota_config->ota_resumption) {
+        /* The partition is erased in sectors, the data of a sector which was partly written is downloaded again */
+        https_ota_handle->image_offset = ota_config->ota_image_bytes_written & ~(SPI_FLASH_SEC_SIZE - 1);
+    }
+    if (ota_config->max_parallel_requests > 1) {
+        if (https_ota_handle->partial_http_download) {
+            https_ota_handle->max_parallel_requests = ota_config->max_parallel_requests;
+            https_ota_handle->max_http_request_size = MAX(https_ota_handle->max_http_request_size & ~(FLASH_WRITE_ALIGN - 1), FLASH_WRITE_ALIGN);
+        } else {
+            ESP_LOGW(TAG, "max_parallel_requests requires partial_http_download, downloading over one connection");
+        }
+    }
 
     /* Initiate HTTP Connection */
     https_ota_handle->http_client = esp_http_client_init(ota_config->http_config);
@@ -221,18 +601,24 @@ esp_err_t esp_https_ota_begin(esp_https_ota_config_t *ota_config, esp_https_ota_
         https_ota_handle->image_length = esp_http_client_get_content_length(https_ota_handle->http_client);
         esp_http_client_close(https_ota_handle->http_client);
 
-        if (https_ota_handle->image_length > https_ota_handle->max_http_request_size) {
-            char *header_val = NULL;
-            asprintf(&header_val, "bytes=0-%d", https_ota_handle->max_http_request_size - 1);
-            if (header_val == NULL) {
-                ESP_LOGE(TAG, "Failed to allocate memory for HTTP header");
-                err = ESP_ERR_NO_MEM;
+        if (https_ota_handle->image_offset >= https_ota_handle->image_length) {
+            ESP_LOGW(TAG, "Image is smaller than the data written so far, downloading it from the start");
+            https_ota_handle->image_offset = 0;
+        }
+        if (https_ota_handle->image_length - https_ota_handle->image_offset > https_ota_handle->max_http_request_size ||
+                https_ota_handle->image_offset) {
+            err = _http_set_range(https_ota_handle->http_client, https_ota_handle->image_offset,
+                                  MIN(https_ota_handle->image_offset + https_ota_handle->max_http_request_size, https_ota_handle->image_length) - 1);
+            if (err != ESP_OK) {
                 goto http_cleanup;
             }
-            esp_http_client_set_header(https_ota_handle->http_client, "Range", header_val);
-            free(header_val);
         }
         esp_http_client_set_method(https_ota_handle->http_client, HTTP_METHOD_GET);
+    } else if (https_ota_handle->image_offset) {
+        err = _http_set_range(https_ota_handle->http_client, https_ota_handle->image_offset, -1);
+        if (err != ESP_OK) {
+            goto http_cleanup;
+        }
     }
 
     if (ota_config->http_client_init_cb) {
@@ -249,8 +635,23 @@ esp_err_t esp_https_ota_begin(esp_https_ota_config_t *ota_config, esp_https_ota_
         goto http_cleanup;
     }
 
+    if ((https_ota_handle->image_offset || https_ota_handle->max_parallel_requests) &&
+            esp_http_client_get_status_code(https_ota_handle->http_client) != HttpStatus_PartialContent) {
+        if (https_ota_handle->image_offset) {
+            ESP_LOGW(TAG, "Server doesn't support range requests, downloading the image from the start");
+        }
+        https_ota_handle->image_offset = 0;
+        https_ota_handle->max_parallel_requests = 0;
+    }
+
     if (!https_ota_handle->partial_http_download) {
         https_ota_handle->image_length = esp_http_client_get_content_length(https_ota_handle->http_client);
+        if (https_ota_handle->image_offset && https_ota_handle->image_length >= 0) {
+            https_ota_handle->image_length += https_ota_handle->image_offset;
+        }
+    }
+    if (https_ota_handle->image_offset) {
+        ESP_LOGI(TAG, "Resuming download at offset %d", https_ota_handle->image_offset);
     }
 
     https_ota_handle->update_partition = NULL;
@@ -265,7 +666,8 @@ esp_err_t esp_https_ota_begin(esp_https_ota_config_t *ota_config, esp_https_ota_
         https_ota_handle->update_partition->subtype, https_ota_handle->update_partition->address);
 
     const int alloc_size = MAX(ota_config->http_config->buffer_size, DEFAULT_OTA_BUF_SIZE);
-    https_ota_handle->ota_upgrade_buf = (char *)malloc(alloc_size);
+    /* Parallel download pads the end of the image to the flash write alignment in the buffer */
+    https_ota_handle->ota_upgrade_buf = (char *)malloc(alloc_size + (https_ota_handle->max_parallel_requests ? FLASH_WRITE_ALIGN : 0));
     if (!https_ota_handle->ota_upgrade_buf) {
         ESP_LOGE(TAG, "Couldn't allocate memory to upgrade data buffer");
         err = ESP_ERR_NO_MEM;
@@ -273,7 +675,11 @@ esp_err_t esp_https_ota_begin(esp_https_ota_config_t *ota_config, esp_https_ota_
     }
     https_ota_handle->ota_upgrade_buf_size = alloc_size;
     https_ota_handle->bulk_flash_erase = ota_config->bulk_flash_erase;
-    https_ota_handle->binary_file_len = 0;
+    https_ota_handle->binary_file_len = https_ota_handle->image_offset;
+    if (https_ota_handle->max_parallel_requests &&
+            _ota_parallel_init(https_ota_handle, ota_config) != ESP_OK) {
+        ESP_LOGW(TAG, "Couldn't allocate memory for parallel download, downloading over one connection");
+    }
     *handle = (esp_https_ota_handle_t)https_ota_handle;
     https_ota_handle->state = ESP_HTTPS_OTA_BEGIN;
     return ESP_OK;
@@ -297,37 +703,22 @@ esp_err_t esp_https_ota_get_img_desc(esp_https_ota_handle_t https_ota_handle, es
         ESP_LOGE(TAG, "esp_https_ota_read_img_desc: Invalid state");
         return ESP_FAIL;
     }
-    /*
-     * `data_read_size` holds number of bytes needed to read complete header.
-     * `bytes_read` holds number of bytes read.
-     */
-    int data_read_size = IMAGE_HEADER_SIZE;
-    int data_read = 0, bytes_read = 0;
-    /*
-     * while loop is added to download complete image headers, even if the headers
-     * are not sent in a single packet.
-     */
-    while (data_read_size > 0 && !esp_http_client_is_complete_data_received(handle->http_client)) {
-        data_read = esp_http_client_read(handle->http_client,
-                                          (handle->ota_upgrade_buf + bytes_read),
-                                          data_read_size);
-        /*
-         * As esp_http_client_read doesn't return negative error code if select fails, we rely on
-         * `errno` to check for underlying transport connectivity closure if any
-         */
-        if (errno == ENOTCONN || errno == ECONNRESET || errno == ECONNABORTED || data_read < 0) {
-            ESP_LOGE(TAG, "Connection closed, errno = %d", errno);
-            break;
+    if (handle->image_offset) {
+        /* The interrupted download already wrote the image headers to the partition */
+        return esp_ota_get_partition_description(handle->update_partition, new_app_info);
+    }
+    if (handle->binary_file_len == 0) {
+        esp_err_t err = _read_image_header(handle);
+        if (err != ESP_OK) {
+            return err;
         }
-        data_read_size -= data_read;
-        bytes_read += data_read;
     }
-    if (data_read_size > 0) {
-        ESP_LOGE(TAG, "Complete headers were not received");
-        return ESP_FAIL;
+    if (handle->compressed) {
+        const esp_ota_compressed_header_t *header = (const esp_ota_compressed_header_t *)handle->ota_upgrade_buf;
+        memcpy(new_app_info, &header->app_desc, sizeof(esp_app_desc_t));
+    } else {
+        memcpy(new_app_info, &handle->ota_upgrade_buf[sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t)], sizeof(esp_app_desc_t));
     }
-    handle->binary_file_len = bytes_read;
-    memcpy(new_app_info, &handle->ota_upgrade_buf[sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t)], sizeof(esp_app_desc_t));
     return ESP_OK;
 }
 
@@ -345,29 +736,59 @@ esp_err_t esp_https_ota_perform(esp_https_ota_handle_t https_ota_handle)
 
     esp_err_t err;
     int data_read;
-    const int erase_size = handle->bulk_flash_erase ? OTA_SIZE_UNKNOWN : OTA_WITH_SEQUENTIAL_WRITES;
+    int erase_size;
     switch (handle->state) {
         case ESP_HTTPS_OTA_BEGIN:
-            err = esp_ota_begin(handle->update_partition, erase_size, &handle->update_handle);
+            if (handle->streams && handle->binary_file_len == 0) {
+                err = _read_image_header(handle);
+                if (err != ESP_OK) {
+                    return err;
+                }
+            }
+            if (handle->streams && handle->compressed) {
+                /* A compressed image is decompressed in order, the first range continues as a sequential download */
+                ESP_LOGI(TAG, "Compressed image, downloading over one connection");
+                _ota_parallel_cleanup(handle);
+            }
+            erase_size = handle->bulk_flash_erase ? OTA_SIZE_UNKNOWN : OTA_WITH_SEQUENTIAL_WRITES;
+            if (handle->streams && !handle->bulk_flash_erase) {
+                /* Ranges are written out of order, esp_ota_write_with_offset needs the partition erased first */
+                erase_size = handle->image_length;
+            }
+            /* image_offset is 0 unless an interrupted download is resumed */
+            err = esp_ota_resume(handle->update_partition, erase_size, handle->image_offset, &handle->update_handle);
             if (err != ESP_OK) {
                 ESP_LOGE(TAG, "esp_ota_begin failed (%s)", esp_err_to_name(err));
                 return err;
             }
             handle->state = ESP_HTTPS_OTA_IN_PROGRESS;
+            if (handle->streams) {
+                /* Image data read by `esp_https_ota_read_img_desc` is written with the first range */
+                handle->streams[0].buffered = handle->binary_file_len - handle->image_offset;
+                handle->binary_file_len = handle->image_offset;
+                return _ota_parallel_start(handle);
+            }
             /* In case `esp_https_ota_read_img_desc` was invoked first,
                then the image data read there should be written to OTA partition
                */
-            if (handle->binary_file_len) {
+            if (handle->binary_file_len > handle->image_offset) {
                 /*
                  * Header length gets added to handle->binary_file_len in _ota_write
                  * Clear handle->binary_file_len to avoid additional 289 bytes in binary_file_len
                  */
-                int binary_file_len = handle->binary_file_len;
-                handle->binary_file_len = 0;
+                int binary_file_len = handle->binary_file_len - handle->image_offset;
+                handle->binary_file_len = handle->image_offset;
                 return _ota_write(handle, (const void *)handle->ota_upgrade_buf, binary_file_len);
             }
             /* falls through */
         case ESP_HTTPS_OTA_IN_PROGRESS:
+            if (handle->streams) {
+                err = _ota_parallel_perform(handle);
+                if (err == ESP_OK) {
+                    handle->state = ESP_HTTPS_OTA_SUCCESS;
+                }
+                return err;
+            }
             data_read = esp_http_client_read(handle->http_client,
                                              handle->ota_upgrade_buf,
                                              handle->ota_upgrade_buf_size);
@@ -408,18 +829,14 @@ esp_err_t esp_https_ota_perform(esp_https_ota_handle_t https_ota_handle)
     if (handle->partial_http_download) {
         if (handle->state == ESP_HTTPS_OTA_IN_PROGRESS && handle->image_length > handle->binary_file_len) {
             esp_http_client_close(handle->http_client);
-            char *header_val = NULL;
             if ((handle->image_length - handle->binary_file_len) > handle->max_http_request_size) {
-                asprintf(&header_val, "bytes=%d-%d", handle->binary_file_len, (handle->binary_file_len + handle->max_http_request_size - 1));
+                err = _http_set_range(handle->http_client, handle->binary_file_len, handle->binary_file_len + handle->max_http_request_size - 1);
             } else {
-                asprintf(&header_val, "bytes=%d-", handle->binary_file_len);
+                err = _http_set_range(handle->http_client, handle->binary_file_len, -1);
             }
-            if (header_val == NULL) {
-                ESP_LOGE(TAG, "Failed to allocate memory for HTTP header");
-                return ESP_ERR_NO_MEM;
+            if (err != ESP_OK) {
+                return err;
             }
-            esp_http_client_set_header(handle->http_client, "Range", header_val);
-            free(header_val);
             err = _http_connect(handle->http_client);
             if (err != ESP_OK) {
                 ESP_LOGE(TAG, "Failed to establish HTTP connection");
@@ -455,6 +872,7 @@ esp_err_t esp_https_ota_finish(esp_https_ota_handle_t https_ota_handle)
     }
 
     esp_err_t err = ESP_OK;
+    _ota_parallel_cleanup(handle);
     switch (handle->state) {
         case ESP_HTTPS_OTA_SUCCESS:
         case ESP_HTTPS_OTA_IN_PROGRESS:
@@ -495,6 +913,7 @@ esp_err_t esp_https_ota_abort(esp_https_ota_handle_t https_ota_handle)
     }
 
     esp_err_t err = ESP_OK;
+    _ota_parallel_cleanup(handle);
     switch (handle->state) {
         case ESP_HTTPS_OTA_SUCCESS:
         case ESP_HTTPS_OTA_IN_PROGRESS:
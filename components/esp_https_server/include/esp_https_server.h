@@ -83,6 +83,7 @@ typedef struct httpd_ssl_config httpd_ssl_config_t;
         .task_priority      = tskIDLE_PRIORITY+5, \
         .stack_size         = 10240,              \
         .core_id            = tskNO_AFFINITY,     \
+        .worker_count       = 0,                  \
         .server_port        = 0,                  \
         .ctrl_port          = 32768,              \
         .max_open_sockets   = 4,                  \
@@ -20,6 +20,12 @@ COMPONENT_OBJS += heap_trace_standalone.o
 
 endif
 
+ifdef CONFIG_HEAP_TRACING_PROFILE
+
+COMPONENT_OBJS += heap_profile.o
+
+endif
+
 ifdef CONFIG_HEAP_TRACING
 
 WRAP_FUNCTIONS = calloc malloc free realloc heap_caps_malloc heap_caps_free heap_caps_realloc heap_caps_malloc_default heap_caps_realloc_default
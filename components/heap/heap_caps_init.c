@@ -37,6 +37,15 @@ static void register_heap(heap_t *region)
     }
 }
 
+/* Set the lock of a registered heap, and enable its cache of small blocks */
+static void set_heap_lock(heap_t *heap)
+{
+    multi_heap_set_lock(heap->heap, &heap->heap_mux);
+#if CONFIG_HEAP_CACHE
+    multi_heap_cache_enable(heap->heap, CONFIG_HEAP_CACHE_SIZE);
+#endif
+}
+
 void heap_caps_enable_nonos_stack_heaps(void)
 {
     heap_t *heap;
@@ -46,7 +55,7 @@ void heap_caps_enable_nonos_stack_heaps(void)
         if (heap->heap == NULL) {
             register_heap(heap);
             if (heap->heap != NULL) {
-                multi_heap_set_lock(heap->heap, &heap->heap_mux);
+                set_heap_lock(heap);
             }
         }
     }
@@ -142,7 +151,7 @@ void heap_caps_init(void)
     /* Iterate the heaps and set their locks, also add them to the linked list. */
     for (size_t i = 0; i < num_heaps; i++) {
         if (heaps_array[i].heap != NULL) {
-            multi_heap_set_lock(heaps_array[i].heap, &heaps_array[i].heap_mux);
+            set_heap_lock(&heaps_array[i]);
         }
         if (i == 0) {
             SLIST_INSERT_HEAD(&registered_heaps, &heaps_array[0], next);
@@ -221,7 +230,7 @@ esp_err_t heap_caps_add_region_with_caps(const uint32_t caps[], intptr_t start,
         err = ESP_ERR_INVALID_SIZE;
         goto done;
     }
-    multi_heap_set_lock(p_new->heap, &p_new->heap_mux);
+    set_heap_lock(p_new);
 
     /* (This insertion is atomic to registered_heaps, so
        we don't need to worry about thread safety for readers,
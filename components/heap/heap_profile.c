@@ -0,0 +1,554 @@
+// Copyright 2021 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/* Heap profiler: statistics of the heap allocations aggregated by call site.
+
+   On the target, allocations and frees are recorded by the heap tracing hooks of heap_trace.inc. The rest of this
+   file doesn't depend on FreeRTOS, so it is also built and tested on the host.
+*/
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include "multi_heap_platform.h"
+#include "esp_heap_profile.h"
+#include "heap_profile_private.h"
+
+#ifdef MULTI_HEAP_FREERTOS
+
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Tables are accessed with the cache disabled */
+#define PROFILE_MALLOC(SIZE) heap_caps_malloc((SIZE), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#define PROFILE_FREE(P) heap_caps_free(P)
+
+/* Lifetimes are measured with the resolution of the RTOS tick */
+static IRAM_ATTR uint32_t get_time_ms(void)
+{
+    return xTaskGetTickCount() * portTICK_PERIOD_MS;
+}
+
+#else // MULTI_HEAP_FREERTOS
+
+#include <stdlib.h>
+#include <time.h>
+
+#define IRAM_ATTR
+
+#define PROFILE_MALLOC(SIZE) malloc(SIZE)
+#define PROFILE_FREE(P) free(P)
+
+static uint32_t get_time_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+#endif // MULTI_HEAP_FREERTOS
+
+#define STACK_DEPTH CONFIG_HEAP_TRACING_STACK_DEPTH
+
+/* Index of an entry in the site or allocation table */
+typedef uint16_t profile_index_t;
+
+#define NO_ENTRY ((profile_index_t)UINT16_MAX)
+#define MAX_ENTRIES (NO_ENTRY - 1)
+
+typedef struct {
+    heap_profile_site_t stats;
+    uint32_t hash;               /* hash of stats.callers */
+    profile_index_t hash_next;   /* next site with the same hash bucket */
+} site_t;
+
+/* An allocation which has not been freed yet */
+typedef struct {
+    void *address;
+    size_t size;
+    uint32_t time_ms;            /* when it was allocated */
+    profile_index_t site;
+    profile_index_t hash_next;   /* next allocation with the same hash bucket, or next unused entry */
+} allocation_t;
+
+static multi_heap_lock_t profile_lock = MULTI_HEAP_LOCK_STATIC_INITIALIZER;
+static bool profiling;
+
+/* Call sites in the order they first allocated memory, and a hash index of their call stacks */
+static site_t *sites;
+static size_t max_sites;
+static size_t site_count;
+static profile_index_t *site_buckets;
+static unsigned site_hash_bits;
+
+/* Allocations which have not been freed yet, and a hash index of their addresses */
+static allocation_t *allocations;
+static size_t max_allocations;
+static profile_index_t *allocation_buckets;
+static unsigned allocation_hash_bits;
+static profile_index_t free_allocation;
+
+/* Allocations which were not counted, because the site table was full */
+static size_t dropped_allocations;
+
+/* Allocations counted in their site, but whose free can't be attributed as the allocation table was full */
+static size_t untracked_allocations;
+
+/* Smallest number of bits which can index 'n' hash buckets */
+static unsigned hash_bits_for(size_t n)
+{
+    unsigned bits = 1;
+    while ((1U << bits) < n) {
+        bits++;
+    }
+    return bits;
+}
+
+/* Forget all sites and allocations, called with profiling stopped */
+static void reset_tables(void)
+{
+    memset(site_buckets, 0xff, (1U << site_hash_bits) * sizeof(profile_index_t));
+    memset(allocation_buckets, 0xff, (1U << allocation_hash_bits) * sizeof(profile_index_t));
+    for (size_t i = 0; i < max_allocations; i++) {
+        allocations[i].address = NULL;
+        allocations[i].hash_next = (i + 1 < max_allocations) ? i + 1 : NO_ENTRY;
+    }
+    free_allocation = 0;
+    site_count = 0;
+    dropped_allocations = 0;
+    untracked_allocations = 0;
+}
+
+esp_err_t heap_profile_init(size_t num_sites, size_t num_allocations)
+{
+    if (profiling) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (num_sites > MAX_ENTRIES || num_allocations > MAX_ENTRIES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    PROFILE_FREE(sites);
+    sites = NULL;
+    allocations = NULL;
+    site_buckets = NULL;
+    allocation_buckets = NULL;
+    max_sites = 0;
+    max_allocations = 0;
+    site_count = 0;
+    if (num_sites == 0 || num_allocations == 0) {
+        return ESP_OK;
+    }
+
+    /* One block for all the tables, ordered by alignment */
+    unsigned site_bits = hash_bits_for(num_sites);
+    unsigned allocation_bits = hash_bits_for(num_allocations);
+    size_t size = num_sites * sizeof(site_t) + num_allocations * sizeof(allocation_t)
+                  + ((1U << site_bits) + (1U << allocation_bits)) * sizeof(profile_index_t);
+    sites = PROFILE_MALLOC(size);
+    if (sites == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    allocations = (allocation_t *)&sites[num_sites];
+    site_buckets = (profile_index_t *)&allocations[num_allocations];
+    allocation_buckets = &site_buckets[1U << site_bits];
+    site_hash_bits = site_bits;
+    allocation_hash_bits = allocation_bits;
+    max_sites = num_sites;
+    max_allocations = num_allocations;
+    reset_tables();
+    return ESP_OK;
+}
+
+esp_err_t heap_profile_start(void)
+{
+    if (sites == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    MULTI_HEAP_LOCK(&profile_lock);
+    profiling = false;
+    MULTI_HEAP_UNLOCK(&profile_lock);
+
+    reset_tables();
+
+    MULTI_HEAP_LOCK(&profile_lock);
+    profiling = true;
+    MULTI_HEAP_UNLOCK(&profile_lock);
+    return ESP_OK;
+}
+
+static esp_err_t set_profiling(bool enable)
+{
+    if (profiling == enable) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    profiling = enable;
+    return ESP_OK;
+}
+
+esp_err_t heap_profile_stop(void)
+{
+    return set_profiling(false);
+}
+
+esp_err_t heap_profile_resume(void)
+{
+    if (sites == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return set_profiling(true);
+}
+
+size_t heap_profile_get_count(void)
+{
+    return site_count;
+}
+
+esp_err_t heap_profile_get(size_t index, heap_profile_site_t *site)
+{
+    if (site == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t result = ESP_OK;
+
+    MULTI_HEAP_LOCK(&profile_lock);
+    if (index >= site_count) {
+        result = ESP_ERR_INVALID_ARG;
+    } else {
+        memcpy(site, &sites[index].stats, sizeof(heap_profile_site_t));
+    }
+    MULTI_HEAP_UNLOCK(&profile_lock);
+    return result;
+}
+
+/* FNV-1a hash of a call stack */
+static IRAM_ATTR uint32_t callers_hash(void *const *callers)
+{
+    uint32_t hash = 2166136261U;
+    for (int i = 0; i < STACK_DEPTH; i++) {
+        hash = (hash ^ (uint32_t)(uintptr_t)callers[i]) * 16777619U;
+    }
+    return hash;
+}
+
+/* Bucket of 'hash' in a table of 2^bits buckets */
+static IRAM_ATTR unsigned bucket_of(uint32_t hash, unsigned bits)
+{
+    /* Fibonacci hashing, to use the upper bits which are mixed best */
+    return (hash * 2654435761U) >> (32 - bits);
+}
+
+/* Find the site of a call stack, adding it if it's new. Called with the lock held. */
+static IRAM_ATTR profile_index_t get_site(void *const *callers, uint32_t hash)
+{
+    profile_index_t *bucket = &site_buckets[bucket_of(hash, site_hash_bits)];
+    for (profile_index_t s = *bucket; s != NO_ENTRY; s = sites[s].hash_next) {
+        if (sites[s].hash == hash && memcmp(sites[s].stats.callers, callers, sizeof(void *) * STACK_DEPTH) == 0) {
+            return s;
+        }
+    }
+    if (site_count == max_sites) {
+        return NO_ENTRY;
+    }
+
+    profile_index_t s = site_count++;
+    memset(&sites[s], 0, sizeof(site_t));
+    memcpy(sites[s].stats.callers, callers, sizeof(void *) * STACK_DEPTH);
+    sites[s].hash = hash;
+    sites[s].hash_next = *bucket;
+    *bucket = s;
+    return s;
+}
+
+/* Bucket of an address in the allocation table */
+static IRAM_ATTR profile_index_t *allocation_bucket(void *p)
+{
+    /* the low bits of heap addresses are always zero */
+    return &allocation_buckets[bucket_of((uint32_t)((uintptr_t)p >> 2), allocation_hash_bits)];
+}
+
+IRAM_ATTR void heap_profile_record_alloc(void *p, size_t size, void *const *callers)
+{
+    if (!profiling || size == 0) {
+        return;
+    }
+    uint32_t hash = callers_hash(callers);
+    uint32_t time_ms = get_time_ms();
+
+    MULTI_HEAP_LOCK(&profile_lock);
+    if (profiling) {
+        profile_index_t s = get_site(callers, hash);
+        if (s == NO_ENTRY) {
+            dropped_allocations++;
+        } else if (p == NULL) {
+            sites[s].stats.fail_count++;
+        } else {
+            heap_profile_site_t *stats = &sites[s].stats;
+            stats->alloc_count++;
+            stats->bytes_total += size;
+
+            profile_index_t a = free_allocation;
+            if (a == NO_ENTRY) {
+                untracked_allocations++;
+            } else {
+                allocation_t *allocation = &allocations[a];
+                free_allocation = allocation->hash_next;
+                allocation->address = p;
+                allocation->size = size;
+                allocation->time_ms = time_ms;
+                allocation->site = s;
+                profile_index_t *bucket = allocation_bucket(p);
+                allocation->hash_next = *bucket;
+                *bucket = a;
+
+                stats->live_count++;
+                stats->bytes_live += size;
+                if (stats->bytes_live > stats->bytes_peak) {
+                    stats->bytes_peak = stats->bytes_live;
+                }
+            }
+        }
+    }
+    MULTI_HEAP_UNLOCK(&profile_lock);
+}
+
+IRAM_ATTR void heap_profile_record_free(void *p)
+{
+    if (!profiling || p == NULL) {
+        return;
+    }
+    uint32_t time_ms = get_time_ms();
+
+    MULTI_HEAP_LOCK(&profile_lock);
+    if (profiling) {
+        profile_index_t *next = allocation_bucket(p);
+        while (*next != NO_ENTRY && allocations[*next].address != p) {
+            next = &allocations[*next].hash_next;
+        }
+
+        profile_index_t a = *next;
+        if (a != NO_ENTRY) {
+            allocation_t *allocation = &allocations[a];
+            *next = allocation->hash_next;
+
+            heap_profile_site_t *stats = &sites[allocation->site].stats;
+            stats->free_count++;
+            stats->live_count--;
+            stats->bytes_live -= allocation->size;
+            stats->lifetime_ms += time_ms - allocation->time_ms;
+
+            allocation->address = NULL;
+            allocation->hash_next = free_allocation;
+            free_allocation = a;
+        }
+    }
+    MULTI_HEAP_UNLOCK(&profile_lock);
+}
+
+/* Longest line written by heap_profile_export() */
+#define LINE_SIZE (64 + STACK_DEPTH * 20)
+
+/* Format the call stack of a site at the end of 'line', innermost caller first separated by spaces for pprof, or
+   outermost caller first separated by semicolons for folded stacks.
+*/
+static size_t format_callers(char *line, size_t len, const heap_profile_site_t *site, bool folded)
+{
+    size_t start = len;
+    for (int i = 0; i < STACK_DEPTH && len < LINE_SIZE; i++) {
+        void *caller = site->callers[folded ? STACK_DEPTH - 1 - i : i];
+        if (caller != NULL) {
+            const char *separator = !folded ? " " : (len == start) ? "" : ";";
+            len += snprintf(line + len, LINE_SIZE - len, "%s%p", separator, caller);
+        }
+    }
+    if (folded && len == start) {
+        len += snprintf(line + len, LINE_SIZE - len, "[unknown]");
+    }
+    return len;
+}
+
+esp_err_t heap_profile_export(heap_profile_format_t format, heap_profile_write_cb_t write, void *arg)
+{
+    if (write == NULL || format > HEAP_PROFILE_FORMAT_PPROF) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    char line[LINE_SIZE];
+    heap_profile_site_t site;
+    esp_err_t err;
+
+    if (format == HEAP_PROFILE_FORMAT_PPROF) {
+        uint32_t live_count = 0;
+        uint32_t alloc_count = 0;
+        size_t bytes_live = 0;
+        uint64_t bytes_total = 0;
+        for (size_t i = 0; heap_profile_get(i, &site) == ESP_OK; i++) {
+            live_count += site.live_count;
+            alloc_count += site.alloc_count;
+            bytes_live += site.bytes_live;
+            bytes_total += site.bytes_total;
+        }
+        size_t len = snprintf(line, sizeof(line), "heap profile: %"PRIu32": %u [%"PRIu32": %"PRIu64"] @ heapprofile\n",
+                           live_count, (unsigned)bytes_live, alloc_count, bytes_total);
+        err = write(line, len, arg);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    for (size_t i = 0; heap_profile_get(i, &site) == ESP_OK; i++) {
+        size_t len;
+        if (format == HEAP_PROFILE_FORMAT_PPROF) {
+            len = snprintf(line, sizeof(line), "%"PRIu32": %u [%"PRIu32": %"PRIu64"] @",
+                           site.live_count, (unsigned)site.bytes_live, site.alloc_count, site.bytes_total);
+            len = format_callers(line, len, &site, false);
+        } else {
+            uint64_t value = (format == HEAP_PROFILE_FORMAT_FOLDED_LIVE) ? site.bytes_live : site.bytes_total;
+            if (value == 0) {
+                continue;
+            }
+            len = format_callers(line, 0, &site, true);
+            if (len < sizeof(line)) {
+                len += snprintf(line + len, sizeof(line) - len, " %"PRIu64, value);
+            }
+        }
+        /* a truncated line still ends with a newline */
+        if (len >= sizeof(line)) {
+            len = sizeof(line) - 1;
+        }
+        line[len++] = '\n';
+        err = write(line, len, arg);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+static esp_err_t write_to_file(const void *data, size_t len, void *arg)
+{
+    return (fwrite(data, 1, len, (FILE *)arg) == len) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t heap_profile_export_file(heap_profile_format_t format, const char *path)
+{
+    if (format > HEAP_PROFILE_FORMAT_PPROF) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        return ESP_FAIL;
+    }
+    esp_err_t err = heap_profile_export(format, write_to_file, f);
+    if (fclose(f) != 0 && err == ESP_OK) {
+        err = ESP_FAIL;
+    }
+    return err;
+}
+
+void heap_profile_dump(void)
+{
+    heap_profile_site_t site;
+    printf("%u call sites (%u entry table)\n", (unsigned)site_count, (unsigned)max_sites);
+    for (size_t i = 0; heap_profile_get(i, &site) == ESP_OK; i++) {
+        printf("%u allocs %u frees %u fails, %u bytes live (peak %u) %"PRIu64" bytes total",
+               (unsigned)site.alloc_count, (unsigned)site.free_count, (unsigned)site.fail_count,
+               (unsigned)site.bytes_live, (unsigned)site.bytes_peak, site.bytes_total);
+        if (site.free_count > 0) {
+            printf(", lifetime %"PRIu64" ms", site.lifetime_ms / site.free_count);
+        }
+        printf(" caller ");
+        for (int j = 0; j < STACK_DEPTH; j++) {
+            printf("%p%s", site.callers[j], (j < STACK_DEPTH - 1) ? ":" : "");
+        }
+        printf("\n");
+    }
+    if (dropped_allocations > 0) {
+        printf("(NB: Site table is full, %u allocations were not counted.)\n", (unsigned)dropped_allocations);
+    }
+    if (untracked_allocations > 0) {
+        printf("(NB: Allocation table is full, frees of %u allocations were not counted.)\n",
+               (unsigned)untracked_allocations);
+    }
+}
+
+#ifdef CONFIG_HEAP_TRACING_PROFILE
+
+/* Hooks called by heap_trace.inc for each traced malloc and free */
+
+#define HEAP_TRACE_SRCFILE /* don't warn on inclusion here */
+#include "esp_heap_trace.h"
+#undef HEAP_TRACE_SRCFILE
+
+static IRAM_ATTR void record_allocation(const heap_trace_record_t *record)
+{
+    heap_profile_record_alloc(record->address, record->size, record->alloced_by);
+}
+
+static IRAM_ATTR void record_free(void *p, void **callers)
+{
+    heap_profile_record_free(p);
+}
+
+#include "heap_trace.inc"
+
+/* The heap tracing API isn't available when the hooks feed the profiler */
+
+esp_err_t heap_trace_init_standalone(heap_trace_record_t *record_buffer, size_t num_records)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t heap_trace_init_tohost(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t heap_trace_start(heap_trace_mode_t mode)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t heap_trace_stop(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t heap_trace_resume(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t heap_trace_set_sampling(size_t interval)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+size_t heap_trace_get_count(void)
+{
+    return 0;
+}
+
+esp_err_t heap_trace_get(size_t index, heap_trace_record_t *record)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void heap_trace_dump(void)
+{
+}
+
+#endif /*CONFIG_HEAP_TRACING_PROFILE*/
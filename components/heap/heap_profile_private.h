@@ -0,0 +1,34 @@
+// Copyright 2021 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Functions called by the heap tracing hooks, or by the host tests, to record heap operations in the heap profile */
+
+/* Record an allocation of 'size' bytes at 'p' from the call stack 'callers' (CONFIG_HEAP_TRACING_STACK_DEPTH entries).
+   'p' is NULL if the allocation failed.
+*/
+void heap_profile_record_alloc(void *p, size_t size, void *const *callers);
+
+/* Record a free of 'p' */
+void heap_profile_record_free(void *p);
+
+#ifdef __cplusplus
+}
+#endif
@@ -19,6 +19,7 @@
 #undef HEAP_TRACE_SRCFILE
 
 #include "esp_attr.h"
+#include "esp_heap_caps.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
@@ -31,18 +32,53 @@ static portMUX_TYPE trace_mux = portMUX_INITIALIZER_UNLOCKED;
 static bool tracing;
 static heap_trace_mode_t mode;
 
-/* Buffer used for records, starting at offset 0
+/* Buffer used for records.
+
+   Records stay in the slot they were written to until they are removed, the order in which they were
+   allocated is kept by the 'links' below.
 */
 static heap_trace_record_t *buffer;
 static size_t total_records;
 
+/* Index of a slot in the buffer */
+typedef uint16_t record_index_t;
+
+#define NO_RECORD ((record_index_t)UINT16_MAX)
+#define MAX_RECORDS (NO_RECORD - 1)
+
+typedef struct {
+    record_index_t prev;      /* previous record in allocation order */
+    record_index_t next;      /* next record in allocation order, or next free slot */
+    record_index_t hash_next; /* next record with the same address hash */
+} record_links_t;
+
+/* Links of each slot of the buffer, followed by the buckets of the hash index.
+
+   The hash index finds the record of an address which has not been freed yet. Allocated from internal
+   memory by heap_trace_init_standalone(), as it is used with the cache disabled.
+*/
+static record_links_t *links;
+static record_index_t *hash_buckets;
+static unsigned hash_bits;
+
+/* Oldest and newest record, and first unused slot */
+static record_index_t first_record;
+static record_index_t last_record;
+static record_index_t free_slot;
+
+/* Position of the last record returned by heap_trace_get(), so reading all records in order doesn't
+   need to walk the list from the start each time. NO_RECORD when the list has changed.
+*/
+static size_t cursor_index;
+static record_index_t cursor_slot = NO_RECORD;
+
 /* Count of entries logged in the buffer.
 
    Maximum total_records
 */
 static size_t count;
 
-/* Actual number of allocations logged */
+/* Actual number of allocations logged, including those skipped by sampling */
 static size_t total_allocations;
 
 /* Actual number of frees logged */
@@ -51,17 +87,59 @@ static size_t total_frees;
 /* Has the buffer overflowed and lost trace entries? */
 static bool has_overflowed = false;
 
+/* Only one in 'sample_interval' allocations is recorded */
+static size_t sample_interval = 1;
+static size_t sample_counter;
+
 esp_err_t heap_trace_init_standalone(heap_trace_record_t *record_buffer, size_t num_records)
 {
     if (tracing) {
         return ESP_ERR_INVALID_STATE;
     }
+    if (num_records > MAX_RECORDS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    heap_caps_free(links);
+    links = NULL;
+    hash_buckets = NULL;
+    buffer = NULL;
+    total_records = 0;
+    if (record_buffer == NULL || num_records == 0) {
+        return ESP_OK;
+    }
+
+    unsigned bits = 1;
+    while ((1U << bits) < num_records) {
+        bits++;
+    }
+    links = heap_caps_malloc(num_records * sizeof(record_links_t) + (1U << bits) * sizeof(record_index_t),
+                             MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (links == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    hash_buckets = (record_index_t *)&links[num_records];
+    hash_bits = bits;
+
     buffer = record_buffer;
     total_records = num_records;
     memset(buffer, 0, num_records * sizeof(heap_trace_record_t));
     return ESP_OK;
 }
 
+/* Forget all records, called with tracing stopped */
+static void reset_records(void)
+{
+    for (size_t i = 0; i < total_records; i++) {
+        links[i].next = (i + 1 < total_records) ? i + 1 : NO_RECORD;
+    }
+    memset(hash_buckets, 0xff, (1U << hash_bits) * sizeof(record_index_t));
+    first_record = NO_RECORD;
+    last_record = NO_RECORD;
+    free_slot = 0;
+    cursor_slot = NO_RECORD;
+}
+
 esp_err_t heap_trace_start(heap_trace_mode_t mode_param)
 {
     if (buffer == NULL || total_records == 0) {
@@ -69,13 +147,19 @@ esp_err_t heap_trace_start(heap_trace_mode_t mode_param)
     }
 
     portENTER_CRITICAL(&trace_mux);
-
     tracing = false;
+    portEXIT_CRITICAL(&trace_mux);
+
+    reset_records();
+
+    portENTER_CRITICAL(&trace_mux);
+
     mode = mode_param;
     count = 0;
     total_allocations = 0;
     total_frees = 0;
     has_overflowed = false;
+    sample_counter = 0;
     heap_trace_resume();
 
     portEXIT_CRITICAL(&trace_mux);
@@ -101,6 +185,15 @@ esp_err_t heap_trace_resume(void)
     return set_tracing(true);
 }
 
+esp_err_t heap_trace_set_sampling(size_t interval)
+{
+    portENTER_CRITICAL(&trace_mux);
+    sample_interval = (interval == 0) ? 1 : interval;
+    sample_counter = 0;
+    portEXIT_CRITICAL(&trace_mux);
+    return ESP_OK;
+}
+
 size_t heap_trace_get_count(void)
 {
     return count;
@@ -117,7 +210,18 @@ esp_err_t heap_trace_get(size_t index, heap_trace_record_t *record)
     if (index >= count) {
         result = ESP_ERR_INVALID_ARG; /* out of range for 'count' */
     } else {
-        memcpy(record, &buffer[index], sizeof(heap_trace_record_t));
+        record_index_t slot = first_record;
+        size_t i = 0;
+        if (cursor_slot != NO_RECORD && cursor_index <= index) {
+            slot = cursor_slot;
+            i = cursor_index;
+        }
+        for (; i < index; i++) {
+            slot = links[slot].next;
+        }
+        cursor_slot = slot;
+        cursor_index = index;
+        memcpy(record, &buffer[slot], sizeof(heap_trace_record_t));
     }
     portEXIT_CRITICAL(&trace_mux);
     return result;
@@ -131,8 +235,10 @@ void heap_trace_dump(void)
     printf("%u allocations trace (%u entry buffer)\n",
            count, total_records);
     size_t start_count = count;
-    for (int i = 0; i < count; i++) {
-        heap_trace_record_t *rec = &buffer[i];
+    /* the number of steps is bounded, in case the list changes while dumping */
+    record_index_t slot = first_record;
+    for (int i = 0; i < total_records && slot != NO_RECORD; i++, slot = links[slot].next) {
+        heap_trace_record_t *rec = &buffer[slot];
 
         if (rec->address != NULL) {
             printf("%d bytes (@ %p) allocated CPU %d ccount 0x%08x caller ",
@@ -168,8 +274,35 @@ void heap_trace_dump(void)
     if (has_overflowed) {
         printf("(NB: Buffer has overflowed, so trace data is incomplete.)\n");
     }
+    if (sample_interval > 1) {
+        printf("(NB: Only 1 in %u allocations is traced, the totals include the others.)\n", sample_interval);
+    }
+}
+
+/* Bucket of the hash index for an address */
+static IRAM_ATTR record_index_t *hash_bucket(void *p)
+{
+    /* Fibonacci hashing, the low bits of heap addresses are always zero */
+    uint32_t hash = ((uint32_t)(uintptr_t)p >> 2) * 2654435761U;
+    return &hash_buckets[hash >> (32 - hash_bits)];
+}
+
+/* Remove a record from the hash index, if it is in it */
+static IRAM_ATTR void hash_remove(record_index_t slot)
+{
+    record_index_t *next = hash_bucket(buffer[slot].address);
+    while (*next != NO_RECORD) {
+        if (*next == slot) {
+            *next = links[slot].hash_next;
+            return;
+        }
+        next = &links[*next].hash_next;
+    }
 }
 
+// remove a record, used when freeing
+static void remove_record(record_index_t slot);
+
 /* Add a new allocation to the heap trace records */
 static IRAM_ATTR void record_allocation(const heap_trace_record_t *record)
 {
@@ -179,29 +312,42 @@ static IRAM_ATTR void record_allocation(const heap_trace_record_t *record)
 
     portENTER_CRITICAL(&trace_mux);
     if (tracing) {
+        /* counted before sampling, as total_frees counts the frees of unrecorded allocations too */
+        total_allocations++;
+    }
+    if (tracing && ++sample_counter >= sample_interval) {
+        sample_counter = 0;
         if (count == total_records) {
             has_overflowed = true;
-            /* Move the whole buffer back one slot.
-
-               This is a bit slow, compared to treating this buffer as a ringbuffer and rotating a head pointer.
+            /* Drop the oldest record to make room */
+            hash_remove(first_record);
+            remove_record(first_record);
+        }
 
-               However, ringbuffer code gets tricky when we remove elements in mid-buffer (for leak trace mode) while
-               trying to keep track of an item count that may overflow.
-            */
-            memmove(&buffer[0], &buffer[1], sizeof(heap_trace_record_t) * (total_records -1));
-            count--;
+        // Copy new record into a free slot, at the end of the list
+        record_index_t slot = free_slot;
+        free_slot = links[slot].next;
+        memcpy(&buffer[slot], record, sizeof(heap_trace_record_t));
+
+        links[slot].prev = last_record;
+        links[slot].next = NO_RECORD;
+        if (last_record != NO_RECORD) {
+            links[last_record].next = slot;
+        } else {
+            first_record = slot;
         }
-        // Copy new record into place
-        memcpy(&buffer[count], record, sizeof(heap_trace_record_t));
+        last_record = slot;
+
+        /* insert at the head of the bucket, so the newest record of an address is found first */
+        record_index_t *bucket = hash_bucket(record->address);
+        links[slot].hash_next = *bucket;
+        *bucket = slot;
+
         count++;
-        total_allocations++;
     }
     portEXIT_CRITICAL(&trace_mux);
 }
 
-// remove a record, used when freeing
-static void remove_record(int index);
-
 /* record a free event in the heap trace log
 
    For HEAP_TRACE_ALL, this means filling in the freed_by pointer.
@@ -216,37 +362,47 @@ static IRAM_ATTR void record_free(void *p, void **callers)
     portENTER_CRITICAL(&trace_mux);
     if (tracing && count > 0) {
         total_frees++;
-        /* search backwards for the allocation record matching this free */
-        int i;
-        for (i = count - 1; i >= 0; i--) {
-            if (buffer[i].address == p) {
-                break;
-            }
+        /* find the allocation record matching this free, and take it out of the hash index as
+           the address may be allocated again */
+        record_index_t *next = hash_bucket(p);
+        while (*next != NO_RECORD && buffer[*next].address != p) {
+            next = &links[*next].hash_next;
         }
 
-        if (i >= 0) {
+        record_index_t slot = *next;
+        if (slot != NO_RECORD) {
+            *next = links[slot].hash_next;
             if (mode == HEAP_TRACE_ALL) {
-                memcpy(buffer[i].freed_by, callers, sizeof(void *) * STACK_DEPTH);
+                memcpy(buffer[slot].freed_by, callers, sizeof(void *) * STACK_DEPTH);
             } else { // HEAP_TRACE_LEAKS
                 // Leak trace mode, once an allocation is freed we remove it from the list
-                remove_record(i);
+                remove_record(slot);
             }
         }
     }
     portEXIT_CRITICAL(&trace_mux);
 }
 
-/* remove the entry at 'index' from the ringbuffer of saved records */
-static IRAM_ATTR void remove_record(int index)
+/* remove the record in 'slot' from the list of saved records, it must not be in the hash index */
+static IRAM_ATTR void remove_record(record_index_t slot)
 {
-    if (index < count - 1) {
-        // Remove the buffer entry from the list
-        memmove(&buffer[index], &buffer[index+1],
-                sizeof(heap_trace_record_t) * (total_records - index - 1));
+    record_links_t *link = &links[slot];
+    if (link->prev != NO_RECORD) {
+        links[link->prev].next = link->next;
     } else {
-        // For last element, just zero it out to avoid ambiguity
-        memset(&buffer[index], 0, sizeof(heap_trace_record_t));
+        first_record = link->next;
     }
+    if (link->next != NO_RECORD) {
+        links[link->next].prev = link->prev;
+    } else {
+        last_record = link->prev;
+    }
+
+    // Zero out the slot to avoid ambiguity, and make it available again
+    memset(&buffer[slot], 0, sizeof(heap_trace_record_t));
+    link->next = free_slot;
+    free_slot = slot;
+    cursor_slot = NO_RECORD;
     count--;
 }
 
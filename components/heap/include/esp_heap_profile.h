@@ -0,0 +1,183 @@
+// Copyright 2021 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+#include <stdint.h>
+#include <stddef.h>
+#include <esp_err.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef CONFIG_HEAP_TRACING_STACK_DEPTH
+#define CONFIG_HEAP_TRACING_STACK_DEPTH 0
+#endif
+
+/**
+ * @brief Statistics of the allocations made from one call site.
+ *
+ * A call site is identified by the call stack of the caller of malloc() and related functions.
+ */
+typedef struct {
+    void *callers[CONFIG_HEAP_TRACING_STACK_DEPTH]; ///< Call stack of the call site, innermost caller first. Unused entries are NULL.
+    uint32_t alloc_count;     ///< Number of successful allocations
+    uint32_t free_count;      ///< Number of these allocations which have been freed
+    uint32_t fail_count;      ///< Number of allocations which failed
+    uint32_t live_count;      ///< Number of allocations not freed yet
+    size_t bytes_live;        ///< Bytes allocated and not freed yet
+    size_t bytes_peak;        ///< Highest value of bytes_live
+    uint64_t bytes_total;     ///< Total bytes allocated
+    uint64_t lifetime_ms;     ///< Sum of the lifetimes of the freed allocations, in milliseconds. Divide by free_count for the average.
+} heap_profile_site_t;
+
+/**
+ * @brief Formats of heap_profile_export()
+ */
+typedef enum {
+    HEAP_PROFILE_FORMAT_FOLDED_LIVE,  ///< Folded stacks ("caller;caller;caller bytes"), weighted by the bytes which are not freed
+    HEAP_PROFILE_FORMAT_FOLDED_TOTAL, ///< Folded stacks, weighted by the total bytes allocated
+    HEAP_PROFILE_FORMAT_PPROF,        ///< Legacy text heap profile, as written by gperftools and read by pprof
+} heap_profile_format_t;
+
+/**
+ * @brief Function called by heap_profile_export() to write the profile
+ *
+ * @param data Data to write
+ * @param len Length of the data
+ * @param arg Argument passed to heap_profile_export()
+ * @return ESP_OK, or an error which stops the export
+ */
+typedef esp_err_t (*heap_profile_write_cb_t)(const void *data, size_t len, void *arg);
+
+/**
+ * @brief Initialise the heap profiler.
+ *
+ * This function must be called before any other heap profiler functions. The tables of the profiler are allocated
+ * from internal memory: about 56 bytes per call site with the default stack depth, and 16 bytes per allocation.
+ *
+ * To free the tables, stop profiling and then call heap_profile_init(0, 0);
+ *
+ * @param max_sites Maximum number of call sites, at most 65534.
+ * @param max_allocations Maximum number of allocations not freed yet which are tracked, at most 65534. Further allocations
+ * are counted in alloc_count and bytes_total of their site, but not in the live statistics, and their frees are not counted.
+ * @return
+ *  - ESP_ERR_NOT_SUPPORTED Project was compiled without the heap profiler enabled in menuconfig.
+ *  - ESP_ERR_INVALID_STATE Heap profiling is currently in progress.
+ *  - ESP_ERR_INVALID_ARG Too many sites or allocations.
+ *  - ESP_ERR_NO_MEM Not enough memory for the tables.
+ *  - ESP_OK Heap profiler initialised successfully.
+ */
+esp_err_t heap_profile_init(size_t max_sites, size_t max_allocations);
+
+/**
+ * @brief Clear the statistics and start profiling all heap allocations & frees, until heap_profile_stop() is called.
+ *
+ * @return
+ * - ESP_ERR_NOT_SUPPORTED Project was compiled without the heap profiler enabled in menuconfig.
+ * - ESP_ERR_INVALID_STATE heap_profile_init() has not been called with a non-zero number of sites and allocations.
+ * - ESP_OK Profiling is started.
+ */
+esp_err_t heap_profile_start(void);
+
+/**
+ * @brief Stop heap profiling. The statistics are kept.
+ *
+ * @return
+ * - ESP_ERR_NOT_SUPPORTED Project was compiled without the heap profiler enabled in menuconfig.
+ * - ESP_ERR_INVALID_STATE Heap profiling was not in progress.
+ * - ESP_OK Heap profiling stopped.
+ */
+esp_err_t heap_profile_stop(void);
+
+/**
+ * @brief Resume heap profiling which was previously stopped, without clearing the statistics.
+ *
+ * Allocations which were freed while profiling was stopped are still counted as live.
+ *
+ * @return
+ * - ESP_ERR_NOT_SUPPORTED Project was compiled without the heap profiler enabled in menuconfig.
+ * - ESP_ERR_INVALID_STATE Heap profiling was already started.
+ * - ESP_OK Heap profiling resumed.
+ */
+esp_err_t heap_profile_resume(void);
+
+/**
+ * @brief Return the number of call sites in the profile
+ *
+ * It is safe to call this function while heap profiling is running.
+ */
+size_t heap_profile_get_count(void);
+
+/**
+ * @brief Return the statistics of a call site.
+ *
+ * Call sites are numbered in the order they first allocated memory, and keep their index until heap_profile_start() is
+ * called again.
+ *
+ * @param index Index (zero-based) of the call site.
+ * @param[out] site Statistics of the call site.
+ * @return
+ * - ESP_ERR_NOT_SUPPORTED Project was compiled without the heap profiler enabled in menuconfig.
+ * - ESP_ERR_INVALID_STATE site is NULL.
+ * - ESP_ERR_INVALID_ARG Index is out of bounds.
+ * - ESP_OK Statistics returned successfully.
+ */
+esp_err_t heap_profile_get(size_t index, heap_profile_site_t *site);
+
+/**
+ * @brief Write the profile with a callback.
+ *
+ * The callback is called without holding the lock of the profiler, so it may allocate memory, for example to write
+ * to a file with esp_apptrace_fwrite(). It is safe to call this function while heap profiling is running.
+ *
+ * Call stacks are written as hexadecimal addresses, and need to be symbolized with the ELF file of the application.
+ *
+ * @param format Format of the profile
+ * @param write Callback which writes the profile
+ * @param arg Argument passed to the callback
+ * @return
+ * - ESP_ERR_NOT_SUPPORTED Project was compiled without the heap profiler enabled in menuconfig.
+ * - ESP_ERR_INVALID_ARG Unknown format, or write is NULL.
+ * - The error returned by the callback.
+ * - ESP_OK Profile written successfully.
+ */
+esp_err_t heap_profile_export(heap_profile_format_t format, heap_profile_write_cb_t write, void *arg);
+
+/**
+ * @brief Write the profile to a file.
+ *
+ * @param format Format of the profile
+ * @param path Path of the file, in a file system registered in the VFS
+ * @return
+ * - ESP_ERR_NOT_SUPPORTED Project was compiled without the heap profiler enabled in menuconfig.
+ * - ESP_ERR_INVALID_ARG Unknown format.
+ * - ESP_FAIL The file could not be written.
+ * - ESP_OK Profile written successfully.
+ */
+esp_err_t heap_profile_export_file(heap_profile_format_t format, const char *path);
+
+/**
+ * @brief Dump the statistics of all call sites to stdout
+ *
+ * It is safe to call this function while heap profiling is running.
+ */
+void heap_profile_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
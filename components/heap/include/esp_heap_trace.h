@@ -52,12 +52,16 @@ typedef struct {
  *
  * To disable heap tracing and allow the buffer to be freed, stop tracing and then call heap_trace_init_standalone(NULL, 0);
  *
+ * An index of the records, of about 8 bytes per record, is allocated from internal memory by this function.
+ *
  * @param record_buffer Provide a buffer to use for heap trace data. Must remain valid any time heap tracing is enabled, meaning
  * it must be allocated from internal memory not in PSRAM.
- * @param num_records Size of the heap trace buffer, as number of record structures.
+ * @param num_records Size of the heap trace buffer, as number of record structures. At most 65534.
  * @return
  *  - ESP_ERR_NOT_SUPPORTED Project was compiled without heap tracing enabled in menuconfig.
  *  - ESP_ERR_INVALID_STATE Heap tracing is currently in progress.
+ *  - ESP_ERR_INVALID_ARG Too many records.
+ *  - ESP_ERR_NO_MEM Not enough memory for the index of the records.
  *  - ESP_OK Heap tracing initialised successfully.
  */
 esp_err_t heap_trace_init_standalone(heap_trace_record_t *record_buffer, size_t num_records);
@@ -116,6 +120,19 @@ esp_err_t heap_trace_stop(void);
  */
 esp_err_t heap_trace_resume(void);
 
+/**
+ * @brief Only record one in a number of allocations, to reduce the overhead of heap tracing in standalone mode.
+ *
+ * Frees of allocations which were not recorded are ignored. The totals printed by heap_trace_dump() still count
+ * all allocations and frees. The setting is kept when heap_trace_start() is called.
+ *
+ * @param interval Record one in 'interval' allocations. 0 or 1 records all allocations (the default).
+ * @return
+ * - ESP_ERR_NOT_SUPPORTED Project was compiled without heap tracing enabled in menuconfig, or with host mode tracing.
+ * - ESP_OK Sampling interval set.
+ */
+esp_err_t heap_trace_set_sampling(size_t interval);
+
 /**
  * @brief Return number of records in the heap trace buffer
  *
@@ -119,6 +119,27 @@ multi_heap_handle_t multi_heap_register(void *start, size_t size);
  */
 void multi_heap_set_lock(multi_heap_handle_t heap, void* lock);
 
+/** @brief Cache freed small blocks of a heap per CPU core
+ *
+ * Blocks of up to 256 bytes freed on a CPU core are kept in lists of that core, up to size bytes in total, instead of
+ * being returned to the heap. Allocations of up to 256 bytes are rounded up to a multiple of 16 bytes and taken from
+ * these lists, without taking the heap lock. The cached blocks count as allocated in the heap statistics, they are
+ * returned to the heap when an allocation would fail otherwise.
+ *
+ * The cache is allocated from the heap. It can't be disabled once enabled, and can't be enabled with heap poisoning.
+ *
+ * @param heap Handle to a registered heap.
+ * @param size Maximum size in bytes of the blocks cached for each CPU core.
+ * @return true if the cache was enabled, false if it was enabled already, with heap poisoning, or if out of memory.
+ */
+bool multi_heap_cache_enable(multi_heap_handle_t heap, size_t size);
+
+/** @brief Return the blocks cached by multi_heap_cache_enable() to the heap
+ *
+ * @param heap Handle to a registered heap.
+ */
+void multi_heap_cache_flush(multi_heap_handle_t heap);
+
 /** @brief Dump heap information to stdout
  *
  * For debugging purposes, this function dumps information about every block in the heap to stdout.
@@ -77,12 +77,40 @@ void *multi_heap_get_block_owner(multi_heap_block_handle_t block)
 #define ALIGN_UP_BY(num, align) (((num) + ((align) - 1)) & ~((align) - 1))
 
 
+/* Cache of small blocks, see multi_heap_cache_enable().
+
+   Freed blocks whose size is a multiple of CACHE_CLASS_SIZE up to CACHE_MAX_SIZE are kept in a list of
+   the CPU core, linked through their first word, instead of being returned to the TLSF. Allocations of
+   up to CACHE_MAX_SIZE bytes are rounded up to such a size and taken from these lists, which only needs
+   the lock of the core instead of the heap lock. A list which is empty is refilled with a few blocks at
+   once. The blocks in the lists are allocated as far as the TLSF is concerned, a few of them are returned
+   to it when the cache of a core is full, and all of them when an allocation fails. */
+#define CACHE_CLASS_SIZE 16
+#define CACHE_CLASSES 16
+#define CACHE_MAX_SIZE (CACHE_CLASS_SIZE * CACHE_CLASSES)
+/* Blocks allocated at once to refill an empty list */
+#define CACHE_REFILL_BLOCKS 4
+/* Most blocks returned to the TLSF by a free which finds the cache of the core full */
+#define CACHE_TRIM_BLOCKS 8
+
+typedef struct {
+    multi_heap_lock_t lock;
+    size_t bytes;                       /* size of the blocks in the lists */
+    void *blocks[CACHE_CLASSES];        /* free blocks of CACHE_CLASS_SIZE * (index + 1) bytes */
+} heap_core_cache_t;
+
+typedef struct {
+    size_t max_bytes;                   /* per core */
+    heap_core_cache_t cores[MULTI_HEAP_NUM_CORES];
+} heap_cache_t;
+
 typedef struct multi_heap_info {
     void *lock;
     size_t free_bytes;
     size_t minimum_free_bytes;
     size_t pool_size;
     tlsf_t heap_data;
+    heap_cache_t *cache;
 } heap_t;
 
 /* Return true if this block is free. */
@@ -136,6 +164,7 @@ multi_heap_handle_t multi_heap_register_impl(void *start_ptr, size_t size)
     }
 
     result->lock = NULL;
+    result->cache = NULL;
     result->free_bytes = size - tlsf_size();
     result->pool_size = size;
     result->minimum_free_bytes = result->free_bytes;
@@ -186,14 +215,9 @@ bool multi_heap_is_free(multi_heap_block_handle_t block)
     return is_free(block);
 }
 
-void *multi_heap_malloc_impl(multi_heap_handle_t heap, size_t size)
+/* Allocate from the TLSF, the heap must be locked */
+static void *heap_tlsf_malloc(heap_t *heap, size_t size)
 {
-    if (size == 0 || heap == NULL) {
-        return NULL;
-    }
-
-
-    multi_heap_internal_lock(heap);
     void *result = tlsf_malloc(heap->heap_data, size);
     if(result) {
         heap->free_bytes -= tlsf_block_size(result);
@@ -201,8 +225,175 @@ void *multi_heap_malloc_impl(multi_heap_handle_t heap, size_t size)
             heap->minimum_free_bytes = heap->free_bytes;
         }
     }
+    return result;
+}
+
+/* Free to the TLSF, the heap must be locked */
+static void heap_tlsf_free(heap_t *heap, void *p)
+{
+    heap->free_bytes += tlsf_block_size(p);
+    tlsf_free(heap->heap_data, p);
+}
+
+/* Return the blocks in the lists of a core to the TLSF, the core must be locked */
+static void cache_flush_core(heap_t *heap, heap_core_cache_t *core)
+{
+    multi_heap_internal_lock(heap);
+    for (int class = 0; class < CACHE_CLASSES; class++) {
+        while (core->blocks[class] != NULL) {
+            void *block = core->blocks[class];
+            core->blocks[class] = *(void **)block;
+            heap_tlsf_free(heap, block);
+        }
+    }
+    core->bytes = 0;
+    multi_heap_internal_unlock(heap);
+}
+
+/* Return up to CACHE_TRIM_BLOCKS blocks of a full core to the TLSF, largest first, until there is room for
+   block_size more bytes. Return false if there still isn't. The core must be locked */
+static bool cache_trim_core(heap_t *heap, heap_core_cache_t *core, size_t block_size)
+{
+    heap_cache_t *cache = heap->cache;
+    int freed = 0;
+
+    multi_heap_internal_lock(heap);
+    for (int class = CACHE_CLASSES - 1; class >= 0 && freed < CACHE_TRIM_BLOCKS; class--) {
+        while (core->blocks[class] != NULL && freed < CACHE_TRIM_BLOCKS
+                && core->bytes + block_size > cache->max_bytes) {
+            void *block = core->blocks[class];
+            core->blocks[class] = *(void **)block;
+            core->bytes -= (class + 1) * CACHE_CLASS_SIZE;
+            heap_tlsf_free(heap, block);
+            freed++;
+        }
+    }
     multi_heap_internal_unlock(heap);
 
+    return core->bytes + block_size <= cache->max_bytes;
+}
+
+static void *cache_malloc(heap_t *heap, size_t size)
+{
+    heap_cache_t *cache = heap->cache;
+    int class = (size - 1) / CACHE_CLASS_SIZE;
+    size_t block_size = (class + 1) * CACHE_CLASS_SIZE;
+    heap_core_cache_t *core = &cache->cores[MULTI_HEAP_CORE_ID()];
+
+    MULTI_HEAP_LOCK(&core->lock);
+    void *result = core->blocks[class];
+    if (result != NULL) {
+        core->blocks[class] = *(void **)result;
+        core->bytes -= block_size;
+    } else {
+        multi_heap_internal_lock(heap);
+        result = heap_tlsf_malloc(heap, block_size);
+        for (int i = 1; result != NULL && i < CACHE_REFILL_BLOCKS
+                && core->bytes + block_size <= cache->max_bytes; i++) {
+            void *block = heap_tlsf_malloc(heap, block_size);
+            if (block == NULL) {
+                break;
+            }
+            *(void **)block = core->blocks[class];
+            core->blocks[class] = block;
+            core->bytes += block_size;
+        }
+        multi_heap_internal_unlock(heap);
+    }
+    MULTI_HEAP_UNLOCK(&core->lock);
+
+    return result;
+}
+
+/* Put a freed block in the list of the current core, return false if it must be freed to the TLSF */
+static bool cache_free(heap_t *heap, void *p)
+{
+    heap_cache_t *cache = heap->cache;
+    /* Read without the heap lock, like multi_heap_get_allocated_size(): while the block is allocated, the
+       TLSF only changes the flag bits of its size word */
+    size_t block_size = tlsf_block_size(p);
+    if (block_size > CACHE_MAX_SIZE || block_size % CACHE_CLASS_SIZE != 0 || block_size > cache->max_bytes) {
+        return false;
+    }
+    int class = block_size / CACHE_CLASS_SIZE - 1;
+    heap_core_cache_t *core = &cache->cores[MULTI_HEAP_CORE_ID()];
+
+    MULTI_HEAP_LOCK(&core->lock);
+    if (core->bytes + block_size > cache->max_bytes && !cache_trim_core(heap, core, block_size)) {
+        /* Still full, the following frees make more room */
+        MULTI_HEAP_UNLOCK(&core->lock);
+        return false;
+    }
+    *(void **)p = core->blocks[class];
+    core->blocks[class] = p;
+    core->bytes += block_size;
+    MULTI_HEAP_UNLOCK(&core->lock);
+
+    return true;
+}
+
+bool multi_heap_cache_enable(multi_heap_handle_t heap, size_t size)
+{
+#ifdef MULTI_HEAP_POISONING
+    /* Heap poisoning checks the contents of free blocks, which the cache overwrites */
+    (void)heap;
+    (void)size;
+    return false;
+#else
+    if (heap == NULL || heap->cache != NULL) {
+        return false;
+    }
+    heap_cache_t *cache = multi_heap_malloc_impl(heap, sizeof(heap_cache_t));
+    if (cache == NULL) {
+        return false;
+    }
+    memset(cache, 0, sizeof(heap_cache_t));
+    cache->max_bytes = size;
+    for (int i = 0; i < MULTI_HEAP_NUM_CORES; i++) {
+        MULTI_HEAP_LOCK_INIT(&cache->cores[i].lock);
+    }
+    heap->cache = cache;
+    return true;
+#endif
+}
+
+void multi_heap_cache_flush(multi_heap_handle_t heap)
+{
+    if (heap == NULL || heap->cache == NULL) {
+        return;
+    }
+
+    for (int i = 0; i < MULTI_HEAP_NUM_CORES; i++) {
+        heap_core_cache_t *core = &heap->cache->cores[i];
+        MULTI_HEAP_LOCK(&core->lock);
+        cache_flush_core(heap, core);
+        MULTI_HEAP_UNLOCK(&core->lock);
+    }
+}
+
+void *multi_heap_malloc_impl(multi_heap_handle_t heap, size_t size)
+{
+    if (size == 0 || heap == NULL) {
+        return NULL;
+    }
+
+    void *result;
+    if (heap->cache != NULL && size <= CACHE_MAX_SIZE) {
+        result = cache_malloc(heap, size);
+    } else {
+        multi_heap_internal_lock(heap);
+        result = heap_tlsf_malloc(heap, size);
+        multi_heap_internal_unlock(heap);
+    }
+
+    if (result == NULL && heap->cache != NULL) {
+        /* Out of memory, return the cached blocks and try again without the cache */
+        multi_heap_cache_flush(heap);
+        multi_heap_internal_lock(heap);
+        result = heap_tlsf_malloc(heap, size);
+        multi_heap_internal_unlock(heap);
+    }
+
     return result;
 }
 
@@ -215,12 +406,30 @@ void multi_heap_free_impl(multi_heap_handle_t heap, void *p)
 
     assert_valid_block(heap, p);
 
+    if (heap->cache != NULL && cache_free(heap, p)) {
+        return;
+    }
+
     multi_heap_internal_lock(heap);
-    heap->free_bytes += tlsf_block_size(p);
-    tlsf_free(heap->heap_data, p);
+    heap_tlsf_free(heap, p);
     multi_heap_internal_unlock(heap);
 }
 
+/* Reallocate in the TLSF, the heap must be locked */
+static void *heap_tlsf_realloc(heap_t *heap, void *p, size_t size)
+{
+    size_t previous_block_size =  tlsf_block_size(p);
+    void *result = tlsf_realloc(heap->heap_data, p, size);
+    if(result) {
+        heap->free_bytes += previous_block_size;
+        heap->free_bytes -= tlsf_block_size(result);
+        if (heap->free_bytes < heap->minimum_free_bytes) {
+            heap->minimum_free_bytes = heap->free_bytes;
+        }
+    }
+    return result;
+}
+
 void *multi_heap_realloc_impl(multi_heap_handle_t heap, void *p, size_t size)
 {
     assert(heap != NULL);
@@ -236,18 +445,30 @@ void *multi_heap_realloc_impl(multi_heap_handle_t heap, void *p, size_t size)
     }
 
     multi_heap_internal_lock(heap);
-    size_t previous_block_size =  tlsf_block_size(p);
-    void *result = tlsf_realloc(heap->heap_data, p, size);
+    void *result = heap_tlsf_realloc(heap, p, size);
+    multi_heap_internal_unlock(heap);
+
+    if (result == NULL && size != 0 && heap->cache != NULL) {
+        /* Out of memory, return the cached blocks and try again */
+        multi_heap_cache_flush(heap);
+        multi_heap_internal_lock(heap);
+        result = heap_tlsf_realloc(heap, p, size);
+        multi_heap_internal_unlock(heap);
+    }
+
+    return result;
+}
+
+/* Allocate aligned from the TLSF, the heap must be locked */
+static void *heap_tlsf_memalign_offs(heap_t *heap, size_t size, size_t alignment, size_t offset)
+{
+    void *result = tlsf_memalign_offs(heap->heap_data, alignment, size, offset);
     if(result) {
-        heap->free_bytes += previous_block_size;
         heap->free_bytes -= tlsf_block_size(result);
-        if (heap->free_bytes < heap->minimum_free_bytes) {
+        if(heap->free_bytes < heap->minimum_free_bytes) {
             heap->minimum_free_bytes = heap->free_bytes;
         }
     }
-
-    multi_heap_internal_unlock(heap);
-
     return result;
 }
 
@@ -267,15 +488,17 @@ void *multi_heap_aligned_alloc_impl_offs(multi_heap_handle_t heap, size_t size,
     }
 
     multi_heap_internal_lock(heap);
-    void *result = tlsf_memalign_offs(heap->heap_data, alignment, size, offset);
-    if(result) {
-        heap->free_bytes -= tlsf_block_size(result);
-        if(heap->free_bytes < heap->minimum_free_bytes) {
-            heap->minimum_free_bytes = heap->free_bytes;
-        }
-    }
+    void *result = heap_tlsf_memalign_offs(heap, size, alignment, offset);
     multi_heap_internal_unlock(heap);
 
+    if (result == NULL && heap->cache != NULL) {
+        /* Out of memory, return the cached blocks and try again */
+        multi_heap_cache_flush(heap);
+        multi_heap_internal_lock(heap);
+        result = heap_tlsf_memalign_offs(heap, size, alignment, offset);
+        multi_heap_internal_unlock(heap);
+    }
+
     return result;
 }
 
@@ -49,6 +49,10 @@ typedef portMUX_TYPE multi_heap_lock_t;
 
 #define MULTI_HEAP_LOCK_STATIC_INITIALIZER     portMUX_INITIALIZER_UNLOCKED
 
+/* Number of CPU cores, and the core the caller runs on, for the per-core caches of small blocks */
+#define MULTI_HEAP_NUM_CORES portNUM_PROCESSORS
+#define MULTI_HEAP_CORE_ID() xPortGetCoreID()
+
 /* Not safe to use std i/o while in a portmux critical section,
    can deadlock, so we use the ROM equivalent functions. */
 
@@ -91,13 +95,47 @@ inline static void multi_heap_assert(bool condition, const char *format, int lin
 #else // MULTI_HEAP_FREERTOS
 
 #include <assert.h>
+#include <pthread.h>
 
 #define MULTI_HEAP_PRINTF printf
 #define MULTI_HEAP_STDERR_PRINTF(MSG, ...) fprintf(stderr, MSG, __VA_ARGS__)
-#define MULTI_HEAP_LOCK(PLOCK)  (void) (PLOCK)
-#define MULTI_HEAP_UNLOCK(PLOCK)  (void) (PLOCK)
-#define MULTI_HEAP_LOCK_INIT(PLOCK)  (void) (PLOCK)
-#define MULTI_HEAP_LOCK_STATIC_INITIALIZER  0
+
+/* On the host, a heap is only locked if a pthread mutex was set with multi_heap_set_lock() */
+typedef pthread_mutex_t multi_heap_lock_t;
+
+static inline void multi_heap_host_lock(void *lock)
+{
+    if (lock != NULL) {
+        pthread_mutex_lock((pthread_mutex_t *) lock);
+    }
+}
+
+static inline void multi_heap_host_unlock(void *lock)
+{
+    if (lock != NULL) {
+        pthread_mutex_unlock((pthread_mutex_t *) lock);
+    }
+}
+
+#define MULTI_HEAP_LOCK(PLOCK)  multi_heap_host_lock(PLOCK)
+#define MULTI_HEAP_UNLOCK(PLOCK)  multi_heap_host_unlock(PLOCK)
+#define MULTI_HEAP_LOCK_INIT(PLOCK)  pthread_mutex_init((PLOCK), NULL)
+#define MULTI_HEAP_LOCK_STATIC_INITIALIZER  PTHREAD_MUTEX_INITIALIZER
+
+/* Threads are spread over the "cores" in turn */
+#define MULTI_HEAP_NUM_CORES 2
+
+static inline int multi_heap_host_core_id(void)
+{
+    static int s_next_core;
+    static __thread int s_core = -1;
+    if (s_core < 0) {
+        s_core = __atomic_fetch_add(&s_next_core, 1, __ATOMIC_RELAXED) % MULTI_HEAP_NUM_CORES;
+    }
+    return s_core;
+}
+
+#define MULTI_HEAP_CORE_ID() multi_heap_host_core_id()
 
 #define MULTI_HEAP_ASSERT(CONDITION, ADDRESS) assert((CONDITION) && "Heap corrupt")
 
@@ -0,0 +1,80 @@
+/*
+ Tests for the heap profiler
+
+ Only compiled in if CONFIG_HEAP_TRACING_PROFILE is set
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sdkconfig.h"
+#include "unity.h"
+
+#ifdef CONFIG_HEAP_TRACING_PROFILE
+
+#include "esp_heap_profile.h"
+
+#define NUM_ALLOCS 10
+
+static void * __attribute__((noinline)) alloc_from_one_site(size_t size)
+{
+    return malloc(size);
+}
+
+/* Find the site which made the NUM_ALLOCS allocations of the test, other tasks may allocate memory too */
+static bool find_test_site(heap_profile_site_t *site)
+{
+    for (size_t i = 0; heap_profile_get(i, site) == ESP_OK; i++) {
+        if (site->alloc_count == NUM_ALLOCS && site->bytes_total == NUM_ALLOCS * 100) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static esp_err_t count_bytes(const void *data, size_t len, void *arg)
+{
+    *(size_t *)arg += len;
+    return ESP_OK;
+}
+
+TEST_CASE("heap profile aggregates allocations by call site", "[heap]")
+{
+    void *p[NUM_ALLOCS];
+    heap_profile_site_t site;
+
+    TEST_ESP_OK(heap_profile_init(64, 128));
+    TEST_ESP_OK(heap_profile_start());
+
+    for (int i = 0; i < NUM_ALLOCS; i++) {
+        p[i] = alloc_from_one_site(100);
+        TEST_ASSERT_NOT_NULL(p[i]);
+    }
+    for (int i = 0; i < 4; i++) {
+        free(p[i]);
+    }
+    TEST_ASSERT_NULL(alloc_from_one_site(SIZE_MAX / 2));
+
+    TEST_ESP_OK(heap_profile_stop());
+    heap_profile_dump();
+
+    TEST_ASSERT_TRUE(find_test_site(&site));
+    TEST_ASSERT_EQUAL(4, site.free_count);
+    TEST_ASSERT_EQUAL(1, site.fail_count);
+    TEST_ASSERT_EQUAL(600, site.bytes_live);
+    TEST_ASSERT_EQUAL(1000, site.bytes_peak);
+    TEST_ASSERT_NOT_NULL(site.callers[0]);
+
+    size_t len = 0;
+    TEST_ESP_OK(heap_profile_export(HEAP_PROFILE_FORMAT_PPROF, count_bytes, &len));
+    TEST_ASSERT_GREATER_THAN(0, len);
+
+    for (int i = 4; i < NUM_ALLOCS; i++) {
+        free(p[i]);
+    }
+    TEST_ESP_OK(heap_profile_init(0, 0));
+}
+
+#endif
@@ -1,7 +1,7 @@
 /*
  Generic test for heap tracing support
 
- Only compiled in if CONFIG_HEAP_TRACING is set
+ Only compiled in if CONFIG_HEAP_TRACING_STANDALONE is set
 */
 
 #include <esp_types.h>
@@ -14,10 +14,11 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
-#ifdef CONFIG_HEAP_TRACING
+#ifdef CONFIG_HEAP_TRACING_STANDALONE
 // only compile in heap tracing tests if tracing is enabled
 
 #include "esp_heap_trace.h"
+#include "esp_heap_caps.h"
 
 TEST_CASE("heap trace leak check", "[heap]")
 {
@@ -59,9 +60,10 @@ TEST_CASE("heap trace leak check", "[heap]")
     heap_trace_get(0, &trace_b);
     TEST_ASSERT_EQUAL_PTR(b, trace_b.address);
 
-    /* buffer deletes trace_a when freed,
-       so trace_b at head of buffer */
-    TEST_ASSERT_EQUAL_PTR(recs[0].address, trace_b.address);
+    /* trace_a is cleared when freed,
+       trace_b stays where it was in the buffer */
+    TEST_ASSERT_NULL(recs[0].address);
+    TEST_ASSERT_EQUAL_PTR(recs[1].address, trace_b.address);
 
     heap_trace_stop();
 }
@@ -123,6 +125,77 @@ TEST_CASE("heap trace wrapped buffer check", "[heap]")
     heap_trace_stop();
 }
 
+TEST_CASE("heap trace keeps allocation order when freeing out of order", "[heap]")
+{
+    const size_t N = 64;
+    heap_trace_record_t *recs = heap_caps_calloc(N, sizeof(heap_trace_record_t), MALLOC_CAP_INTERNAL);
+    TEST_ASSERT_NOT_NULL(recs);
+    void *ptrs[N / 2];
+    TEST_ASSERT_EQUAL(ESP_OK, heap_trace_init_standalone(recs, N));
+
+    heap_trace_start(HEAP_TRACE_LEAKS);
+    for (int i = 0; i < N / 2; i++) {
+        ptrs[i] = malloc(i + 1);
+    }
+    /* free every other allocation, newest first */
+    for (int i = N / 2 - 2; i >= 0; i -= 2) {
+        free(ptrs[i]);
+    }
+    heap_trace_stop();
+
+    /* the allocations which are left are traced in the order they were made */
+    int next = 1;
+    for (int i = 0; i < heap_trace_get_count(); i++) {
+        heap_trace_record_t rec;
+        TEST_ASSERT_EQUAL(ESP_OK, heap_trace_get(i, &rec));
+        if (next < N / 2 && rec.address == ptrs[next]) {
+            TEST_ASSERT_EQUAL(next + 1, rec.size);
+            next += 2;
+        }
+    }
+    TEST_ASSERT_EQUAL(N / 2 + 1, next);
+
+    for (int i = 1; i < N / 2; i += 2) {
+        free(ptrs[i]);
+    }
+    TEST_ASSERT_EQUAL(ESP_OK, heap_trace_init_standalone(NULL, 0));
+    free(recs);
+}
+
+TEST_CASE("heap trace sampling", "[heap]")
+{
+    const size_t N = 8;
+    heap_trace_record_t recs[N];
+    void *ptrs[N * 4];
+    heap_trace_init_standalone(recs, N);
+    heap_trace_set_sampling(4);
+
+    heap_trace_start(HEAP_TRACE_LEAKS);
+    for (int i = 0; i < N * 4; i++) {
+        ptrs[i] = malloc(8);
+    }
+    heap_trace_stop();
+
+    /* other tasks may allocate too, but at most one in four allocations is traced */
+    TEST_ASSERT(heap_trace_get_count() <= N);
+    int traced = 0;
+    for (int i = 0; i < heap_trace_get_count(); i++) {
+        heap_trace_record_t rec;
+        heap_trace_get(i, &rec);
+        for (int j = 0; j < N * 4; j++) {
+            if (rec.address == ptrs[j]) {
+                traced++;
+            }
+        }
+    }
+    TEST_ASSERT(traced > 0 && traced <= N);
+
+    for (int i = 0; i < N * 4; i++) {
+        free(ptrs[i]);
+    }
+    heap_trace_set_sampling(1);
+}
+
 static void print_floats_task(void *ignore)
 {
     heap_trace_start(HEAP_TRACE_ALL);
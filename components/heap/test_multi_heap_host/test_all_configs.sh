@@ -5,9 +5,9 @@
 
 FAIL=0
 
-for FLAGS in "CONFIG_HEAP_POISONING_NONE" "CONFIG_HEAP_POISONING_LIGHT" "CONFIG_HEAP_POISONING_COMPREHENSIVE" ; do
-    echo "==== Testing with config: ${FLAGS} ===="
-    CPPFLAGS="-D${FLAGS}" make clean test || FAIL=1
+for POISONING in "NONE" "LIGHT" "COMPREHENSIVE" ; do
+    echo "==== Testing with config: CONFIG_HEAP_POISONING_${POISONING} ===="
+    POISONING="${POISONING}" make clean test || FAIL=1
 done
 
 make clean
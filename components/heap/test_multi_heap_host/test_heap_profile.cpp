@@ -0,0 +1,181 @@
+#include "catch.hpp"
+#include "esp_heap_profile.h"
+#include "../heap_profile_private.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <string>
+#include <unistd.h>
+
+#define STACK_DEPTH CONFIG_HEAP_TRACING_STACK_DEPTH
+
+/* Fake call stacks and heap addresses, the profiler doesn't dereference them */
+static void *const site_a[STACK_DEPTH] = { (void *)0x400d1000, (void *)0x400d2000, (void *)0x400d3000 };
+static void *const site_b[STACK_DEPTH] = { (void *)0x400d1100, (void *)0x400d2000, (void *)0x400d3000 };
+
+static void *addr(uintptr_t n)
+{
+    return (void *)(0x3ffb0000 + n * 16);
+}
+
+static esp_err_t append_string(const void *data, size_t len, void *arg)
+{
+    ((std::string *)arg)->append((const char *)data, len);
+    return ESP_OK;
+}
+
+static std::string export_profile(heap_profile_format_t format)
+{
+    std::string out;
+    REQUIRE( heap_profile_export(format, append_string, &out) == ESP_OK );
+    return out;
+}
+
+TEST_CASE("heap profile aggregates allocations by call site", "[heap_profile]")
+{
+    REQUIRE( heap_profile_start() == ESP_ERR_INVALID_STATE ); // not initialised
+    REQUIRE( heap_profile_init(8, 16) == ESP_OK );
+    REQUIRE( heap_profile_start() == ESP_OK );
+    REQUIRE( heap_profile_init(8, 16) == ESP_ERR_INVALID_STATE );
+
+    heap_profile_record_alloc(addr(0), 100, site_a);
+    heap_profile_record_alloc(addr(1), 50, site_b);
+    heap_profile_record_alloc(addr(2), 30, site_a);
+    heap_profile_record_alloc(NULL, 1000, site_b);
+    heap_profile_record_free(addr(0));
+    heap_profile_record_free(addr(99)); // allocated before profiling started
+    heap_profile_record_alloc(addr(0), 10, site_a);
+
+    REQUIRE( heap_profile_get_count() == 2 );
+
+    heap_profile_site_t a, b;
+    REQUIRE( heap_profile_get(0, &a) == ESP_OK );
+    REQUIRE( heap_profile_get(1, &b) == ESP_OK );
+    REQUIRE( heap_profile_get(2, &b) == ESP_ERR_INVALID_ARG );
+
+    REQUIRE( memcmp(a.callers, site_a, sizeof(site_a)) == 0 );
+    REQUIRE( a.alloc_count == 3 );
+    REQUIRE( a.free_count == 1 );
+    REQUIRE( a.live_count == 2 );
+    REQUIRE( a.fail_count == 0 );
+    REQUIRE( a.bytes_live == 40 );
+    REQUIRE( a.bytes_peak == 130 );
+    REQUIRE( a.bytes_total == 140 );
+
+    REQUIRE( memcmp(b.callers, site_b, sizeof(site_b)) == 0 );
+    REQUIRE( b.alloc_count == 1 );
+    REQUIRE( b.fail_count == 1 );
+    REQUIRE( b.bytes_live == 50 );
+
+    REQUIRE( heap_profile_stop() == ESP_OK );
+    REQUIRE( heap_profile_stop() == ESP_ERR_INVALID_STATE );
+    heap_profile_record_free(addr(1)); // not counted while stopped
+    REQUIRE( heap_profile_resume() == ESP_OK );
+    REQUIRE( heap_profile_get(1, &b) == ESP_OK );
+    REQUIRE( b.bytes_live == 50 );
+
+    // restarting clears the statistics
+    REQUIRE( heap_profile_start() == ESP_OK );
+    REQUIRE( heap_profile_get_count() == 0 );
+    heap_profile_record_free(addr(2));
+    REQUIRE( heap_profile_get_count() == 0 );
+
+    REQUIRE( heap_profile_stop() == ESP_OK );
+    REQUIRE( heap_profile_init(0, 0) == ESP_OK );
+}
+
+TEST_CASE("heap profile measures the lifetime of allocations", "[heap_profile]")
+{
+    REQUIRE( heap_profile_init(4, 4) == ESP_OK );
+    REQUIRE( heap_profile_start() == ESP_OK );
+
+    heap_profile_record_alloc(addr(0), 16, site_a);
+    heap_profile_record_alloc(addr(1), 16, site_a);
+    usleep(50 * 1000);
+    heap_profile_record_free(addr(0));
+    heap_profile_record_free(addr(1));
+
+    heap_profile_site_t a;
+    REQUIRE( heap_profile_get(0, &a) == ESP_OK );
+    REQUIRE( a.free_count == 2 );
+    REQUIRE( a.lifetime_ms / a.free_count >= 49 );
+    REQUIRE( a.lifetime_ms / a.free_count < 5000 );
+
+    REQUIRE( heap_profile_stop() == ESP_OK );
+    REQUIRE( heap_profile_init(0, 0) == ESP_OK );
+}
+
+TEST_CASE("heap profile tables overflow", "[heap_profile]")
+{
+    REQUIRE( heap_profile_init(65535, 1) == ESP_ERR_INVALID_ARG );
+    REQUIRE( heap_profile_init(1, 2) == ESP_OK );
+    REQUIRE( heap_profile_start() == ESP_OK );
+
+    heap_profile_record_alloc(addr(0), 8, site_a);
+    heap_profile_record_alloc(addr(1), 8, site_a);
+    heap_profile_record_alloc(addr(2), 8, site_a); // allocation table is full
+    heap_profile_record_alloc(addr(3), 8, site_b); // site table is full
+    heap_profile_record_free(addr(2));
+    heap_profile_record_free(addr(1));
+    heap_profile_record_alloc(addr(4), 8, site_a); // reuses the freed entry
+
+    REQUIRE( heap_profile_get_count() == 1 );
+    heap_profile_site_t a;
+    REQUIRE( heap_profile_get(0, &a) == ESP_OK );
+    REQUIRE( a.alloc_count == 4 );
+    REQUIRE( a.free_count == 1 );
+    REQUIRE( a.live_count == 2 );
+    REQUIRE( a.bytes_live == 16 );
+    REQUIRE( a.bytes_total == 32 );
+
+    heap_profile_dump();
+
+    REQUIRE( heap_profile_stop() == ESP_OK );
+    REQUIRE( heap_profile_init(0, 0) == ESP_OK );
+}
+
+TEST_CASE("heap profile export formats", "[heap_profile]")
+{
+    void *const no_callers[STACK_DEPTH] = {};
+
+    REQUIRE( heap_profile_init(4, 8) == ESP_OK );
+    REQUIRE( heap_profile_start() == ESP_OK );
+
+    heap_profile_record_alloc(addr(0), 100, site_a);
+    heap_profile_record_alloc(addr(1), 50, site_b);
+    heap_profile_record_alloc(addr(2), 20, no_callers);
+    heap_profile_record_free(addr(1));
+    REQUIRE( heap_profile_stop() == ESP_OK );
+
+    REQUIRE( export_profile(HEAP_PROFILE_FORMAT_FOLDED_LIVE) ==
+             "0x400d3000;0x400d2000;0x400d1000 100\n"
+             "[unknown] 20\n" );
+    REQUIRE( export_profile(HEAP_PROFILE_FORMAT_FOLDED_TOTAL) ==
+             "0x400d3000;0x400d2000;0x400d1000 100\n"
+             "0x400d3000;0x400d2000;0x400d1100 50\n"
+             "[unknown] 20\n" );
+    REQUIRE( export_profile(HEAP_PROFILE_FORMAT_PPROF) ==
+             "heap profile: 2: 120 [3: 170] @ heapprofile\n"
+             "1: 100 [1: 100] @ 0x400d1000 0x400d2000 0x400d3000\n"
+             "0: 0 [1: 50] @ 0x400d1100 0x400d2000 0x400d3000\n"
+             "1: 20 [1: 20] @\n" );
+
+    std::string out;
+    REQUIRE( heap_profile_export((heap_profile_format_t)42, append_string, &out) == ESP_ERR_INVALID_ARG );
+    REQUIRE( heap_profile_export(HEAP_PROFILE_FORMAT_PPROF, NULL, NULL) == ESP_ERR_INVALID_ARG );
+
+    char path[] = "/tmp/heap_profile_XXXXXX";
+    int fd = mkstemp(path);
+    REQUIRE( fd >= 0 );
+    close(fd);
+    REQUIRE( heap_profile_export_file(HEAP_PROFILE_FORMAT_FOLDED_LIVE, path) == ESP_OK );
+    char buf[128] = {};
+    FILE *f = fopen(path, "r");
+    REQUIRE( f != NULL );
+    REQUIRE( fread(buf, 1, sizeof(buf) - 1, f) > 0 );
+    fclose(f);
+    unlink(path);
+    REQUIRE( std::string(buf) == export_profile(HEAP_PROFILE_FORMAT_FOLDED_LIVE) );
+
+    REQUIRE( heap_profile_init(0, 0) == ESP_OK );
+}
@@ -5,6 +5,9 @@
 
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
 
 /* Insurance against accidentally using libc heap functions in tests */
 #undef free
@@ -487,3 +490,197 @@ TEST_CASE("multi_heap aligned allocations", "[multi_heap]")
     printf("[ALIGNED_ALLOC] heap_size after: %d \n", multi_heap_free_size(heap));
     REQUIRE((old_size - multi_heap_free_size(heap)) <= leakage);
 }
+
+TEST_CASE("multi_heap cache of small blocks", "[multi_heap]")
+{
+    uint8_t test_heap[16 * 1024];
+    multi_heap_handle_t heap = multi_heap_register(test_heap, sizeof(test_heap));
+
+#ifdef MULTI_HEAP_POISONING
+    REQUIRE( multi_heap_cache_enable(heap, 1024) == false );
+#else
+    REQUIRE( multi_heap_cache_enable(heap, 1024) );
+    REQUIRE( multi_heap_cache_enable(heap, 1024) == false );
+    size_t free_size = multi_heap_free_size(heap);
+
+    /* sizes are rounded up to 16 bytes */
+    void *a = multi_heap_malloc(heap, 20);
+    REQUIRE( a != NULL );
+    REQUIRE( multi_heap_get_allocated_size(heap, a) == 32 );
+    memset(a, 0xEE, 20);
+    multi_heap_free(heap, a);
+
+    /* the freed block comes from the cache */
+    void *b = multi_heap_malloc(heap, 32);
+    REQUIRE( b == a );
+    multi_heap_free(heap, b);
+    REQUIRE( multi_heap_check(heap, true) );
+
+    /* the cached blocks count as allocated until flushed */
+    REQUIRE( multi_heap_free_size(heap) < free_size );
+    multi_heap_cache_flush(heap);
+    REQUIRE( multi_heap_free_size(heap) == free_size );
+
+    /* large blocks aren't cached */
+    void *c = multi_heap_malloc(heap, 1000);
+    REQUIRE( c != NULL );
+    multi_heap_free(heap, c);
+    REQUIRE( multi_heap_free_size(heap) == free_size );
+
+    /* cached blocks are returned to the heap when it is out of memory */
+    size_t big_size = free_size;
+    void *big = NULL;
+    while (big == NULL) {
+        big_size -= 16;
+        big = multi_heap_malloc(heap, big_size);
+    }
+    multi_heap_free(heap, big);
+    void *small[8];
+    for (int i = 0; i < 8; i++) {
+        small[i] = multi_heap_malloc(heap, 16 * (i + 1));
+        REQUIRE( small[i] != NULL );
+    }
+    for (int i = 0; i < 8; i++) {
+        multi_heap_free(heap, small[i]);
+    }
+    REQUIRE( multi_heap_free_size(heap) < free_size );
+    big = multi_heap_malloc(heap, big_size);
+    REQUIRE( big != NULL );
+    multi_heap_free(heap, big);
+    REQUIRE( multi_heap_check(heap, true) );
+
+    /* the cache doesn't grow past its size */
+    void *blocks[32];
+    for (int i = 0; i < 32; i++) {
+        blocks[i] = multi_heap_malloc(heap, 64);
+        REQUIRE( blocks[i] != NULL );
+    }
+    for (int i = 0; i < 32; i++) {
+        multi_heap_free(heap, blocks[i]);
+    }
+    REQUIRE( free_size - multi_heap_free_size(heap) <= 1024 );
+    REQUIRE( multi_heap_check(heap, true) );
+
+    /* a free into the full cache only returns the blocks it needs room for */
+    REQUIRE( free_size - multi_heap_free_size(heap) == 1024 );
+    void *d = multi_heap_malloc(heap, 256);
+    REQUIRE( d != NULL );
+    multi_heap_free(heap, d);
+    REQUIRE( free_size - multi_heap_free_size(heap) == 1024 );
+    REQUIRE( multi_heap_check(heap, true) );
+    multi_heap_cache_flush(heap);
+    REQUIRE( multi_heap_free_size(heap) == free_size );
+#endif
+}
+
+typedef struct {
+    multi_heap_handle_t heap;
+    unsigned seed;
+    size_t iterations;
+    bool fill;                  /* fill the blocks and check their contents */
+    bool failed;
+} alloc_thread_args_t;
+
+/* Allocate and free small blocks of a few sizes in random order, checking that they keep their contents */
+static void *alloc_thread(void *arg)
+{
+    alloc_thread_args_t *args = (alloc_thread_args_t *)arg;
+    const size_t SIZES[] = { 12, 20, 32, 40, 64, 100, 128, 250 };
+    const int SLOTS = 8;
+    uint8_t *blocks[SLOTS] = { 0 };
+    size_t sizes[SLOTS] = { 0 };
+
+    for (size_t i = 0; i < args->iterations; i++) {
+        int slot = rand_r(&args->seed) % SLOTS;
+        if (blocks[slot] != NULL) {
+            for (size_t j = 0; args->fill && j < sizes[slot]; j++) {
+                if (blocks[slot][j] != (uint8_t)slot) {
+                    args->failed = true;
+                }
+            }
+            multi_heap_free(args->heap, blocks[slot]);
+            blocks[slot] = NULL;
+        } else {
+            sizes[slot] = SIZES[rand_r(&args->seed) % (sizeof(SIZES) / sizeof(SIZES[0]))];
+            blocks[slot] = (uint8_t *)multi_heap_malloc(args->heap, sizes[slot]);
+            if (blocks[slot] != NULL && args->fill) {
+                memset(blocks[slot], slot, sizes[slot]);
+            }
+        }
+    }
+    for (int slot = 0; slot < SLOTS; slot++) {
+        multi_heap_free(args->heap, blocks[slot]);
+    }
+    return NULL;
+}
+
+/* Run alloc_thread() in several threads, return the time taken in seconds */
+static double run_alloc_threads(multi_heap_handle_t heap, int threads, size_t iterations, bool fill)
+{
+    const int MAX_THREADS = 8;
+    pthread_t ids[MAX_THREADS];
+    alloc_thread_args_t args[MAX_THREADS];
+    struct timespec start, end;
+
+    REQUIRE( threads <= MAX_THREADS );
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int i = 0; i < threads; i++) {
+        args[i] = { heap, (unsigned)i + 1, iterations, fill, false };
+        REQUIRE( pthread_create(&ids[i], NULL, alloc_thread, &args[i]) == 0 );
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(ids[i], NULL);
+        REQUIRE( args[i].failed == false );
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    return (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static multi_heap_handle_t register_locked_heap(void *start, size_t size, pthread_mutex_t *lock)
+{
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(lock, &attr);
+    multi_heap_handle_t heap = multi_heap_register(start, size);
+    multi_heap_set_lock(heap, lock);
+    return heap;
+}
+
+TEST_CASE("multi_heap allocations from several threads", "[multi_heap]")
+{
+    static uint8_t test_heap[64 * 1024];
+    pthread_mutex_t lock;
+    multi_heap_handle_t heap = register_locked_heap(test_heap, sizeof(test_heap), &lock);
+    multi_heap_cache_enable(heap, 2048);
+    size_t free_size = multi_heap_free_size(heap);
+
+    run_alloc_threads(heap, 4, 20000, true);
+
+    REQUIRE( multi_heap_check(heap, true) );
+    multi_heap_cache_flush(heap);
+    REQUIRE( multi_heap_free_size(heap) == free_size );
+    REQUIRE( multi_heap_check(heap, true) );
+}
+
+/* Run with ./test_multi_heap "[perf]" */
+TEST_CASE("multi_heap small allocations benchmark", "[multi_heap][.][perf]")
+{
+    static uint8_t test_heap[2][64 * 1024];
+    pthread_mutex_t locks[2];
+    const size_t ITERATIONS = 1000000;
+
+    for (int threads = 1; threads <= 4; threads *= 2) {
+        multi_heap_handle_t plain = register_locked_heap(test_heap[0], sizeof(test_heap[0]), &locks[0]);
+        multi_heap_handle_t cached = register_locked_heap(test_heap[1], sizeof(test_heap[1]), &locks[1]);
+        bool has_cache = multi_heap_cache_enable(cached, 2048);
+
+        double plain_time = run_alloc_threads(plain, threads, ITERATIONS, false);
+        double cached_time = run_alloc_threads(cached, threads, ITERATIONS, false);
+        printf("%d thread(s): %.0f allocs+frees/s, %.0f with cache%s\n", threads,
+               threads * ITERATIONS / plain_time, threads * ITERATIONS / cached_time,
+               has_cache ? "" : " (not enabled)");
+        REQUIRE( multi_heap_check(plain, true) );
+        REQUIRE( multi_heap_check(cached, true) );
+    }
+}
@@ -8,7 +8,7 @@
 ifndef IS_BOOTLOADER_BUILD
 COMPONENT_OBJEXCLUDE := log_noos.o
 else
-COMPONENT_OBJEXCLUDE := log_freertos.o
+COMPONENT_OBJEXCLUDE := log_freertos.o log_deferred.o
 endif
 
 COMPONENT_OBJEXCLUDE += log_linux.o
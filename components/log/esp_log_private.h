@@ -1,6 +1,16 @@
 #pragma once
 #include <stdbool.h>
+#include <stdarg.h>
+#include "sdkconfig.h"
 
 void esp_log_impl_lock(void);
-bool esp_log_impl_lock_timeout(void);
 void esp_log_impl_unlock(void);
+
+#if CONFIG_LOG_DEFERRED
+/* Stores the message in the buffer of the current CPU core for the log task, returns false if the
+   message has to be output synchronously. Doesn't consume args. */
+bool esp_log_impl_deferred_write(const char *format, va_list args);
+
+/* Outputs text with the function set by esp_log_set_vprintf() */
+int esp_log_impl_print(const char *format, ...);
+#endif
@@ -10,6 +10,10 @@
 #include <cstdio>
 #include <regex>
 #include <iostream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
 #include "esp_log.h"
 
 #include "catch.hpp"
@@ -193,6 +197,117 @@ TEST_CASE("changing log level")
     CHECK(regex_search(fix.get_print_buffer_string(), test_print) == true);
 }
 
+TEST_CASE("log level of a tag set with another pointer to the same string")
+{
+    PrintFixture fix(ESP_LOG_INFO);
+    char tag_copy[] = "test";
+
+    esp_log_level_set(tag_copy, ESP_LOG_ERROR);
+    CHECK(esp_log_level_get(TEST_TAG) == ESP_LOG_ERROR);
+
+    ESP_LOGW(TEST_TAG, "must not be printed");
+    CHECK(fix.get_print_buffer_string().size() == 0);
+}
+
+TEST_CASE("wildcard log level resets the levels of all tags")
+{
+    PrintFixture fix(ESP_LOG_INFO);
+    esp_log_level_set(TEST_TAG, ESP_LOG_ERROR);
+    esp_log_level_set("other", ESP_LOG_VERBOSE);
+    CHECK(esp_log_level_get(TEST_TAG) == ESP_LOG_ERROR);
+    CHECK(esp_log_level_get("other") == ESP_LOG_VERBOSE);
+
+    esp_log_level_set("*", ESP_LOG_WARN);
+    CHECK(esp_log_level_get(TEST_TAG) == ESP_LOG_WARN);
+    CHECK(esp_log_level_get("other") == ESP_LOG_WARN);
+
+    esp_log_level_set("other", ESP_LOG_DEBUG);
+    CHECK(esp_log_level_get(TEST_TAG) == ESP_LOG_WARN);
+    CHECK(esp_log_level_get("other") == ESP_LOG_DEBUG);
+}
+
+TEST_CASE("log levels of many tags")
+{
+    BasicLogFixture fix(ESP_LOG_INFO);
+    static char tags[100][8];
+    for (int i = 0; i < 100; i++) {
+        snprintf(tags[i], sizeof(tags[i]), "tag%d", i);
+        esp_log_level_set(tags[i], (esp_log_level_t) (i % 6));
+    }
+    // twice, the second time from the cache
+    for (int round = 0; round < 2; round++) {
+        for (int i = 0; i < 100; i++) {
+            CHECK(esp_log_level_get(tags[i]) == (esp_log_level_t) (i % 6));
+        }
+    }
+}
+
+TEST_CASE("log level lookups while levels change in another thread")
+{
+    BasicLogFixture fix(ESP_LOG_INFO);
+    static const char *tags[] = { "tag_a", "tag_b", "tag_c", "tag_d" };
+    esp_log_level_set(tags[0], ESP_LOG_ERROR);
+    esp_log_level_set(tags[1], ESP_LOG_WARN);
+    esp_log_level_set(tags[2], ESP_LOG_DEBUG);
+    std::atomic<bool> done(false);
+    std::atomic<int> errors(0);
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; t++) {
+        readers.emplace_back([&]() {
+            while (!done) {
+                // tag_a and tag_b are only ever set to their own levels, tag_d is never set
+                if (esp_log_level_get(tags[0]) != ESP_LOG_ERROR
+                        || esp_log_level_get(tags[1]) != ESP_LOG_WARN
+                        || esp_log_level_get(tags[3]) != ESP_LOG_INFO) {
+                    errors++;
+                }
+                esp_log_level_t level = esp_log_level_get(tags[2]);
+                if (level != ESP_LOG_DEBUG && level != ESP_LOG_VERBOSE) {
+                    errors++;
+                }
+            }
+        });
+    }
+    for (int i = 0; i < 20000; i++) {
+        esp_log_level_set(tags[i % 2], (i % 2) ? ESP_LOG_WARN : ESP_LOG_ERROR);
+        esp_log_level_set(tags[2], (i % 3) ? ESP_LOG_DEBUG : ESP_LOG_VERBOSE);
+    }
+    done = true;
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    CHECK(errors == 0);
+}
+
+TEST_CASE("filtered out log calls per second", "[.][perf]")
+{
+    PrintFixture fix(ESP_LOG_WARN);
+    const int THREADS = 4;
+    const auto DURATION = std::chrono::seconds(1);
+    std::atomic<bool> done(false);
+    std::atomic<uint64_t> calls(0);
+
+    std::vector<std::thread> loggers;
+    for (int t = 0; t < THREADS; t++) {
+        loggers.emplace_back([&]() {
+            uint64_t n = 0;
+            while (!done) {
+                ESP_LOGI(TEST_TAG, "filtered out %d", 1);
+                n++;
+            }
+            calls += n;
+        });
+    }
+    std::this_thread::sleep_for(DURATION);
+    done = true;
+    for (auto &logger : loggers) {
+        logger.join();
+    }
+    cout << "filtered out log calls per second: " << calls / THREADS << " per thread, " << THREADS << " threads" << endl;
+    CHECK(fix.get_print_buffer_string().size() == 0);
+}
+
 TEST_CASE("rom printf")
 {
     PutcFixture fix;
@@ -152,6 +152,33 @@ void esp_log_write(esp_log_level_t level, const char* tag, const char* format, .
  */
 void esp_log_writev(esp_log_level_t level, const char* tag, const char* format, va_list args);
 
+#if CONFIG_LOG_DEFERRED || __DOXYGEN__
+/**
+ * @brief Counters of the deferred log output, see CONFIG_LOG_DEFERRED
+ */
+typedef struct {
+    uint32_t output;    /*!< Messages output by the log task */
+    uint32_t dropped;   /*!< Messages dropped because the log buffer of their CPU core was full */
+} esp_log_deferred_stats_t;
+
+/**
+ * @brief Output the log messages not output by the log task yet
+ *
+ * With CONFIG_LOG_DEFERRED, the messages are formatted and output by a low priority task.
+ * This function outputs the messages written so far from the calling task. esp_restart() calls
+ * it before restarting; the messages not output yet are lost on a panic or abort().
+ * Does nothing when called from an ISR or with the scheduler suspended.
+ */
+void esp_log_deferred_flush(void);
+
+/**
+ * @brief Get the counters of the deferred log output
+ *
+ * @param[out] stats Counters, summed over the CPU cores
+ */
+void esp_log_deferred_get_stats(esp_log_deferred_stats_t *stats);
+#endif // CONFIG_LOG_DEFERRED || __DOXYGEN__
+
 /** @cond */
 
 #include "esp_log_internal.h"
@@ -7,30 +7,35 @@
 /*
  * Log library implementation notes.
  *
- * Log library stores all tags provided to esp_log_level_set as a linked
- * list. See uncached_tag_entry_t structure.
+ * Log library stores all tags provided to esp_log_level_set in a hash
+ * table keyed by the tag string. See tag_entry_t structure. Entries are
+ * only added, under esp_log_impl_lock, and never removed: setting the
+ * level of "*" marks all of them as unset instead of freeing them, and an
+ * entry is reused when its tag is set again. Because an entry never goes
+ * away once it is in the table, the table is read without a lock.
  *
  * To avoid looking up log level for given tag each time message is
  * printed, this library caches pointers to tags. Because the suggested
  * way of creating tags uses one 'TAG' constant per file, this caching
- * should be effective. Cache is a binary min-heap of cached_tag_entry_t
- * items, ordering is done on 'generation' member. In this context,
- * generation is an integer which is incremented each time an operation
- * with cache is performed. When cache is full, new item is inserted in
- * place of an oldest item (that is, with smallest 'generation' value).
- * After that, bubble-down operation is performed to fix ordering in the
- * min-heap.
+ * should be effective. The cache is a table of tag_cache_slot_t indexed
+ * by a hash of the tag pointer, each tag having two possible slots. A
+ * slot is written by the task which missed it, under a sequence counter
+ * which is odd while the slot is being written, so that readers detect
+ * and ignore a slot which changed while they read it. Each change of a
+ * level increments s_log_generation, which invalidates all cached levels
+ * at once.
  *
- * The potential problem with wrap-around of cache generation counter is
- * ignored for now. This will happen if someone happens to output more
- * than 4 billion log entries, at which point wrap-around will not be
- * the biggest problem.
+ * The potential problem with wrap-around of the generation counter is
+ * ignored for now. This will happen if someone happens to change log
+ * levels more than 500 million times, at which point wrap-around will
+ * not be the biggest problem.
  *
  */
 
 #include <stdbool.h>
 #include <stdarg.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -39,34 +44,34 @@
 #include "esp_log_private.h"
 
 #ifndef NDEBUG
-// Enable built-in checks in queue.h in debug builds
-#define INVARIANTS
-// Enable consistency checks and cache statistics in this file.
+// Enable cache statistics in this file.
 #define LOG_BUILTIN_CHECKS
 #endif
 
-#include "sys/queue.h"
-
-// Number of tags to be cached. Must be 2**n - 1, n >= 2.
-#define TAG_CACHE_SIZE 31
+// Number of buckets of the tag table. Must be 2**n.
+#define TAG_TABLE_SIZE 16
+// Number of tags to be cached. Must be 2**n, n >= 1.
+#define TAG_CACHE_SIZE 32
+// Level of a tag_entry_t whose tag was reset by setting the level of "*"
+#define TAG_LEVEL_UNSET 0xff
+#define TAG_GENERATION_MASK (UINT32_MAX >> 3)
+
+typedef struct tag_entry_ {
+    struct tag_entry_ *next;
+    uint8_t level;  // esp_log_level_t as uint8_t, or TAG_LEVEL_UNSET
+    char tag[0];    // beginning of a zero-terminated string
+} tag_entry_t;
 
 typedef struct {
+    uint32_t seq;           // odd while the slot is being written
     const char *tag;
-    uint32_t level : 3;
-    uint32_t generation : 29;
-} cached_tag_entry_t;
-
-typedef struct uncached_tag_entry_ {
-    SLIST_ENTRY(uncached_tag_entry_) entries;
-    uint8_t level;  // esp_log_level_t as uint8_t
-    char tag[0];    // beginning of a zero-terminated string
-} uncached_tag_entry_t;
+    uint32_t stamp;         // generation << 3 | level
+} tag_cache_slot_t;
 
 esp_log_level_t esp_log_default_level = CONFIG_LOG_DEFAULT_LEVEL;
-static SLIST_HEAD(log_tags_head, uncached_tag_entry_) s_log_tags = SLIST_HEAD_INITIALIZER(s_log_tags);
-static cached_tag_entry_t s_log_cache[TAG_CACHE_SIZE];
-static uint32_t s_log_cache_max_generation = 0;
-static uint32_t s_log_cache_entry_count = 0;
+static tag_entry_t *s_log_tags[TAG_TABLE_SIZE];
+static tag_cache_slot_t s_log_cache[TAG_CACHE_SIZE];
+static uint32_t s_log_generation = 0;
 static vprintf_like_t s_log_print_func = &vprintf;
 
 #ifdef LOG_BUILTIN_CHECKS
@@ -74,11 +79,10 @@ static uint32_t s_log_cache_misses = 0;
 #endif
 
 
-static inline bool get_cached_log_level(const char *tag, esp_log_level_t *level);
+static inline bool get_cached_log_level(const char *tag, uint32_t generation, esp_log_level_t *level);
 static inline bool get_uncached_log_level(const char *tag, esp_log_level_t *level);
-static inline void add_to_cache(const char *tag, esp_log_level_t level);
-static void heap_bubble_down(int index);
-static inline void heap_swap(int i, int j);
+static inline void add_to_cache(const char *tag, uint32_t generation, esp_log_level_t level);
+static inline tag_entry_t **tag_bucket(const char *tag);
 static inline bool should_output(esp_log_level_t level_for_message, esp_log_level_t level_for_tag);
 static inline void clear_log_level_list(void);
 
@@ -95,90 +99,68 @@ void esp_log_level_set(const char *tag, esp_log_level_t level)
 {
     esp_log_impl_lock();
 
-    // for wildcard tag, remove all linked list items and clear the cache
+    // for wildcard tag, reset the level of all tags
     if (strcmp(tag, "*") == 0) {
         esp_log_default_level = level;
         clear_log_level_list();
-        esp_log_impl_unlock();
-        return;
-    }
-
-    // search for existing tag
-    uncached_tag_entry_t *it = NULL;
-    SLIST_FOREACH(it, &s_log_tags, entries) {
-        if (strcmp(it->tag, tag) == 0) {
-            // one tag in the linked list matched, update the level
-            it->level = level;
-            // quit with it != NULL
-            break;
+    } else {
+        // search for existing tag
+        tag_entry_t **bucket = tag_bucket(tag);
+        tag_entry_t *it;
+        for (it = *bucket; it != NULL; it = it->next) {
+            if (strcmp(it->tag, tag) == 0) {
+                break;
+            }
         }
-    }
-    // no existing tag, append new one
-    if (it == NULL) {
-        // allocate new linked list entry and append it to the head of the list
-        size_t tag_len = strlen(tag) + 1;
-        size_t entry_size = offsetof(uncached_tag_entry_t, tag) + tag_len;
-        uncached_tag_entry_t *new_entry = (uncached_tag_entry_t *) malloc(entry_size);
-        if (!new_entry) {
-            esp_log_impl_unlock();
-            return;
+        // no existing tag, add new one
+        if (it == NULL) {
+            size_t tag_len = strlen(tag) + 1;
+            size_t entry_size = offsetof(tag_entry_t, tag) + tag_len;
+            it = (tag_entry_t *) malloc(entry_size);
+            if (!it) {
+                esp_log_impl_unlock();
+                return;
+            }
+            memcpy(it->tag, tag, tag_len); // we know the size and strncpy would trigger a compiler warning here
+            it->next = *bucket;
+            it->level = (uint8_t) level;
+            // publish the entry to the readers once it is complete
+            __atomic_store_n(bucket, it, __ATOMIC_RELEASE);
         }
-        new_entry->level = (uint8_t) level;
-        memcpy(new_entry->tag, tag, tag_len); // we know the size and strncpy would trigger a compiler warning here
-        SLIST_INSERT_HEAD(&s_log_tags, new_entry, entries);
+        __atomic_store_n(&it->level, (uint8_t) level, __ATOMIC_RELAXED);
     }
 
-    // search in the cache and update the entry it if exists
-    for (uint32_t i = 0; i < s_log_cache_entry_count; ++i) {
-#ifdef LOG_BUILTIN_CHECKS
-        assert(i == 0 || s_log_cache[(i - 1) / 2].generation < s_log_cache[i].generation);
-#endif
-        if (strcmp(s_log_cache[i].tag, tag) == 0) {
-            s_log_cache[i].level = level;
-            break;
-        }
-    }
+    // invalidate the cache
+    __atomic_store_n(&s_log_generation, (s_log_generation + 1) & TAG_GENERATION_MASK, __ATOMIC_RELEASE);
     esp_log_impl_unlock();
 }
 
-
-/* Common code for getting the log level from cache, esp_log_impl_lock()
-   should be called before calling this function. The function unlocks,
-   as indicated in the name.
-*/
-static esp_log_level_t s_log_level_get_and_unlock(const char *tag)
+esp_log_level_t esp_log_level_get(const char *tag)
 {
     esp_log_level_t level_for_tag;
-    // Look for the tag in cache first, then in the linked list of all tags
-    if (!get_cached_log_level(tag, &level_for_tag)) {
+    // Read the generation first, so that a level looked up while it changes isn't cached as current
+    uint32_t generation = __atomic_load_n(&s_log_generation, __ATOMIC_ACQUIRE);
+    // Look for the tag in cache first, then in the table of all tags
+    if (!get_cached_log_level(tag, generation, &level_for_tag)) {
         if (!get_uncached_log_level(tag, &level_for_tag)) {
             level_for_tag = esp_log_default_level;
         }
-        add_to_cache(tag, level_for_tag);
+        add_to_cache(tag, generation, level_for_tag);
 #ifdef LOG_BUILTIN_CHECKS
-        ++s_log_cache_misses;
+        __atomic_fetch_add(&s_log_cache_misses, 1, __ATOMIC_RELAXED);
 #endif
     }
-    esp_log_impl_unlock();
 
     return level_for_tag;
 }
 
-esp_log_level_t esp_log_level_get(const char *tag)
-{
-    esp_log_impl_lock();
-    return s_log_level_get_and_unlock(tag);
-}
-
 void clear_log_level_list(void)
 {
-    uncached_tag_entry_t *it;
-    while ((it = SLIST_FIRST(&s_log_tags)) != NULL) {
-        SLIST_REMOVE_HEAD(&s_log_tags, entries);
-        free(it);
+    for (int i = 0; i < TAG_TABLE_SIZE; ++i) {
+        for (tag_entry_t *it = s_log_tags[i]; it != NULL; it = it->next) {
+            __atomic_store_n(&it->level, TAG_LEVEL_UNSET, __ATOMIC_RELAXED);
+        }
     }
-    s_log_cache_entry_count = 0;
-    s_log_cache_max_generation = 0;
 #ifdef LOG_BUILTIN_CHECKS
     s_log_cache_misses = 0;
 #endif
@@ -189,18 +171,31 @@ void esp_log_writev(esp_log_level_t level,
                    const char *format,
                    va_list args)
 {
-    if (!esp_log_impl_lock_timeout()) {
-        return;
-    }
-    esp_log_level_t level_for_tag = s_log_level_get_and_unlock(tag);
+    esp_log_level_t level_for_tag = esp_log_level_get(tag);
     if (!should_output(level, level_for_tag)) {
         return;
     }
 
+#if CONFIG_LOG_DEFERRED
+    if (esp_log_impl_deferred_write(format, args)) {
+        return;
+    }
+#endif
     (*s_log_print_func)(format, args);
 
 }
 
+#if CONFIG_LOG_DEFERRED
+int esp_log_impl_print(const char *format, ...)
+{
+    va_list list;
+    va_start(list, format);
+    int ret = (*s_log_print_func)(format, list);
+    va_end(list);
+    return ret;
+}
+#endif
+
 void esp_log_write(esp_log_level_t level,
                    const char *tag,
                    const char *format, ...)
@@ -211,72 +206,76 @@ void esp_log_write(esp_log_level_t level,
     va_end(list);
 }
 
-static inline bool get_cached_log_level(const char *tag, esp_log_level_t *level)
+static inline tag_cache_slot_t *cache_slot(const char *tag, int way)
 {
-    // Look for `tag` in cache
-    uint32_t i;
-    for (i = 0; i < s_log_cache_entry_count; ++i) {
-#ifdef LOG_BUILTIN_CHECKS
-        assert(i == 0 || s_log_cache[(i - 1) / 2].generation < s_log_cache[i].generation);
-#endif
-        if (s_log_cache[i].tag == tag) {
-            break;
-        }
-    }
-    if (i == s_log_cache_entry_count) { // Not found in cache
+    // Multiplicative hashing of the tag pointer, the two slots of a tag are adjacent
+    uint32_t hash = ((uint32_t) (uintptr_t) tag * 2654435769u) >> 16;
+    return &s_log_cache[(hash ^ way) & (TAG_CACHE_SIZE - 1)];
+}
+
+static inline bool read_cache_slot(tag_cache_slot_t *slot, const char *tag, uint32_t generation, esp_log_level_t *level)
+{
+    uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    const char *slot_tag = __atomic_load_n(&slot->tag, __ATOMIC_RELAXED);
+    uint32_t stamp = __atomic_load_n(&slot->stamp, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if ((seq & 1) != 0 || __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) != seq) {
+        // being written
         return false;
     }
-    // Return level from cache
-    *level = (esp_log_level_t) s_log_cache[i].level;
-    // If cache has been filled, start taking ordering into account
-    // (other options are: dynamically resize cache, add "dummy" entries
-    //  to the cache; this option was chosen because code is much simpler,
-    //  and the unfair behavior of cache will show it self at most once, when
-    //  it has just been filled)
-    if (s_log_cache_entry_count == TAG_CACHE_SIZE) {
-        // Update item generation
-        s_log_cache[i].generation = s_log_cache_max_generation++;
-        // Restore heap ordering
-        heap_bubble_down(i);
+    if (slot_tag != tag || (stamp >> 3) != generation) {
+        return false;
     }
+    *level = (esp_log_level_t) (stamp & 7);
     return true;
 }
 
-static inline void add_to_cache(const char *tag, esp_log_level_t level)
+static inline bool get_cached_log_level(const char *tag, uint32_t generation, esp_log_level_t *level)
 {
-    uint32_t generation = s_log_cache_max_generation++;
-    // First consider the case when cache is not filled yet.
-    // In this case, just add new entry at the end.
-    // This happens to satisfy binary min-heap ordering.
-    if (s_log_cache_entry_count < TAG_CACHE_SIZE) {
-        s_log_cache[s_log_cache_entry_count] = (cached_tag_entry_t) {
-            .generation = generation,
-            .level = level,
-            .tag = tag
-        };
-        ++s_log_cache_entry_count;
+    return read_cache_slot(cache_slot(tag, 0), tag, generation, level) ||
+           read_cache_slot(cache_slot(tag, 1), tag, generation, level);
+}
+
+static inline void add_to_cache(const char *tag, uint32_t generation, esp_log_level_t level)
+{
+    // Use the first slot of the tag, unless it holds another tag cached since the last level change
+    tag_cache_slot_t *slot = cache_slot(tag, 0);
+    if (__atomic_load_n(&slot->tag, __ATOMIC_RELAXED) != NULL &&
+            __atomic_load_n(&slot->stamp, __ATOMIC_RELAXED) >> 3 == generation) {
+        slot = cache_slot(tag, 1);
+    }
+    uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+    if ((seq & 1) != 0 ||
+            !__atomic_compare_exchange_n(&slot->seq, &seq, seq + 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        // another task is writing the slot, leave it to that one
         return;
     }
+    __atomic_store_n(&slot->tag, tag, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->stamp, generation << 3 | level, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+}
 
-    // Cache is full, so we replace the oldest entry (which is at index 0
-    // because this is a min-heap) with the new one, and do bubble-down
-    // operation to restore min-heap ordering.
-    s_log_cache[0] = (cached_tag_entry_t) {
-        .tag = tag,
-        .level = level,
-        .generation = generation
-    };
-    heap_bubble_down(0);
+static inline tag_entry_t **tag_bucket(const char *tag)
+{
+    // FNV-1a hash of the tag string
+    uint32_t hash = 2166136261u;
+    for (const char *c = tag; *c != '\0'; ++c) {
+        hash = (hash ^ (uint8_t) *c) * 16777619u;
+    }
+    return &s_log_tags[hash & (TAG_TABLE_SIZE - 1)];
 }
 
 static inline bool get_uncached_log_level(const char *tag, esp_log_level_t *level)
 {
-    // Walk the linked list of all tags and see if given tag is present in the list.
-    // This is slow because tags are compared as strings.
-    uncached_tag_entry_t *it;
-    SLIST_FOREACH(it, &s_log_tags, entries) {
+    // Walk the bucket of the tag and see if given tag is present in it.
+    // This is slower because the tag string is hashed and compared.
+    for (tag_entry_t *it = __atomic_load_n(tag_bucket(tag), __ATOMIC_ACQUIRE); it != NULL; it = it->next) {
         if (strcmp(tag, it->tag) == 0) {
-            *level = it->level;
+            uint8_t level_for_tag = __atomic_load_n(&it->level, __ATOMIC_RELAXED);
+            if (level_for_tag == TAG_LEVEL_UNSET) {
+                return false;
+            }
+            *level = (esp_log_level_t) level_for_tag;
             return true;
         }
     }
@@ -287,21 +286,3 @@ static inline bool should_output(esp_log_level_t level_for_message, esp_log_leve
 {
     return level_for_message <= level_for_tag;
 }
-
-static void heap_bubble_down(int index)
-{
-    while (index < TAG_CACHE_SIZE / 2) {
-        int left_index = index * 2 + 1;
-        int right_index = left_index + 1;
-        int next = (s_log_cache[left_index].generation < s_log_cache[right_index].generation) ? left_index : right_index;
-        heap_swap(index, next);
-        index = next;
-    }
-}
-
-static inline void heap_swap(int i, int j)
-{
-    cached_tag_entry_t tmp = s_log_cache[i];
-    s_log_cache[i] = s_log_cache[j];
-    s_log_cache[j] = tmp;
-}
@@ -0,0 +1,163 @@
+#!/usr/bin/env python
+#
+# log_decode rebuilds the log messages output as binary records by an app built with
+# CONFIG_LOG_DEFERRED_OUTPUT_BINARY, reading their format strings from the ELF file of the app.
+# Other lines are output unchanged.
+#
+# SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+from __future__ import division, print_function
+
+import argparse
+import base64
+import binascii
+import re
+import struct
+import sys
+
+from elftools.elf.constants import SH_FLAGS
+from elftools.elf.elffile import ELFFile
+
+__version__ = '1.0'
+
+BINARY_PREFIX = '~L:'
+
+# Same conversions as log_deferred.c, which outputs the other messages as text
+CONVERSION_RE = re.compile(r'%(?P<flags>[-+ #0]*)(?P<width>\*|\d+)?(?:\.(?P<precision>\*|\d*))?'
+                           r'(?P<length>hh|h|ll|l|j|q|z|t)?(?P<conversion>[diouxXcpfFeEgGaAs%])')
+
+
+class FormatStrings(object):
+    """ Reads the zero terminated strings at the addresses of the app """
+
+    def __init__(self, elf_file):  # type: (object) -> None
+        self.sections = []
+        self.cache = {}  # type: dict
+        elf = ELFFile(elf_file)
+        for section in elf.iter_sections():
+            if section['sh_flags'] & SH_FLAGS.SHF_ALLOC and section['sh_type'] == 'SHT_PROGBITS' and section['sh_size'] > 0:
+                self.sections.append((section['sh_addr'], section.data()))
+
+    def get(self, address):  # type: (int) -> str
+        if address not in self.cache:
+            for start, data in self.sections:
+                if start <= address < start + len(data):
+                    end = data.find(b'\0', address - start)
+                    self.cache[address] = data[address - start:end if end >= 0 else len(data)].decode('utf-8', 'replace')
+                    break
+            else:
+                raise ValueError('No format string at 0x{:08x}'.format(address))
+        return self.cache[address]
+
+
+class Record(object):
+    """ Arguments of a message, as stored by esp_log_impl_deferred_write() """
+
+    def __init__(self, data):  # type: (bytes) -> None
+        self.data = data
+        self.pos = 8
+
+    def word(self):  # type: () -> int
+        value = struct.unpack_from('<I', self.data, self.pos)[0]
+        self.pos += 4
+        return value
+
+    def int64(self):  # type: () -> int
+        value = struct.unpack_from('<Q', self.data, self.pos)[0]
+        self.pos += 8
+        return value
+
+    def double(self):  # type: () -> float
+        value = struct.unpack_from('<d', self.data, self.pos)[0]
+        self.pos += 8
+        return value
+
+    def string(self):  # type: () -> str
+        end = self.data.find(b'\0', self.pos)
+        value = self.data[self.pos:end].decode('utf-8', 'replace')
+        self.pos += (end - self.pos + 4) // 4 * 4
+        return value
+
+
+def signed(value, bits):  # type: (int, int) -> int
+    return value - (1 << bits) if value & (1 << (bits - 1)) else value
+
+
+def format_conversion(match, record):  # type: (re.Match, Record) -> str
+    conversion = match.group('conversion')
+    if conversion == '%':
+        return '%'
+    flags = match.group('flags')
+    width = match.group('width') or ''
+    precision = match.group('precision')
+    length = match.group('length')
+    if width == '*':
+        width = str(signed(record.word(), 32))
+        if width.startswith('-'):
+            flags += '-'
+            width = width[1:]
+    if precision == '*':
+        precision = str(signed(record.word(), 32))
+        if precision.startswith('-'):
+            precision = None
+    spec = '%' + flags + width + ('.' + precision if precision is not None else '')
+
+    if conversion in 'fFeEgGaA':
+        value = record.double()
+        if conversion in 'aA':
+            text = value.hex()
+            return (spec + 's') % (text.upper() if conversion == 'A' else text)
+        return (spec + conversion) % value
+    if conversion == 's':
+        return (spec + 's') % record.string()
+    if conversion == 'p':
+        return (spec + '#x') % record.word()
+
+    bits = 64 if length in ('ll', 'j', 'q') else 32
+    value = record.int64() if bits == 64 else record.word()
+    if length == 'hh':
+        bits, value = 8, value & 0xff
+    elif length == 'h':
+        bits, value = 16, value & 0xffff
+    if conversion in 'di':
+        value = signed(value, bits)
+    elif conversion == 'c':
+        return (spec + 'c') % chr(value & 0xff)
+    elif conversion == 'u':
+        conversion = 'd'
+    elif conversion == 'o' and '#' in flags:
+        # C prefixes a single 0, Python 0o
+        spec = spec.replace('#', '', 1)
+        return (spec + 's') % ('0{:o}'.format(value) if value else '0')
+    return (spec + conversion) % value
+
+
+def decode_line(line, strings):  # type: (str, FormatStrings) -> str
+    data = base64.b64decode(line[len(BINARY_PREFIX):].strip())
+    words, address = struct.unpack_from('<II', data)
+    if words * 4 != len(data):
+        raise ValueError('Record of {} bytes has a header of {} words'.format(len(data), words))
+    record = Record(data)
+    return CONVERSION_RE.sub(lambda match: format_conversion(match, record), strings.get(address))
+
+
+def main():  # type: () -> None
+    parser = argparse.ArgumentParser(description='ESP32 binary log decoder')
+    parser.add_argument('elf', help='ELF file of the app', type=argparse.FileType('rb'))
+    parser.add_argument('input', help='Log output of the app (default: standard input)', nargs='?',
+                        type=argparse.FileType('r'), default=sys.stdin)
+    args = parser.parse_args()
+
+    strings = FormatStrings(args.elf)
+    for line in args.input:
+        if line.startswith(BINARY_PREFIX):
+            try:
+                line = decode_line(line, strings)
+            except (ValueError, struct.error, binascii.Error) as e:
+                line = 'log_decode: {} in {}'.format(e, line)
+        sys.stdout.write(line)
+        sys.stdout.flush()
+
+
+if __name__ == '__main__':
+    main()
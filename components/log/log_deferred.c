@@ -0,0 +1,579 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Deferred log output, see CONFIG_LOG_DEFERRED.
+ *
+ * Instead of formatting a message, esp_log_writev() stores a record of it in the ring buffer of the
+ * CPU core it runs on. A record is a header word holding the number of words of the record, the
+ * address of the format string and the arguments, fetched according to the conversions in the
+ * format string: one word for 32-bit arguments, two words for 64-bit and floating point arguments
+ * and the characters of strings, zero terminated and padded to a word. Strings are copied because
+ * they may not exist anymore when the record is output.
+ *
+ * Writers reserve the words of a record by advancing the head of the ring with compare-and-set, encode
+ * the record into them and write its header word last. The log task outputs the records from the tail up to
+ * the first one whose header word is still zero, clears their words and advances the tail. A writer
+ * which finds the ring empty notifies the log task once its record is written.
+ *
+ * The log task formats the records with snprintf(), one conversion at a time, or outputs them as
+ * lines of base64 for log_decode.py. esp_restart() outputs the records left through a shutdown handler,
+ * the records left on a panic are lost.
+ */
+
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/param.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "soc/soc_memory_types.h"
+#include "esp_compiler.h"
+#include "esp_system.h"
+#include "esp_log.h"
+#include "esp_log_private.h"
+
+#if CONFIG_LOG_DEFERRED
+
+#define RING_WORDS (CONFIG_LOG_DEFERRED_BUFFER_SIZE / sizeof(uint32_t))
+#define RING_MASK (RING_WORDS - 1)
+
+_Static_assert((RING_WORDS & RING_MASK) == 0, "CONFIG_LOG_DEFERRED_BUFFER_SIZE must be a power of two");
+
+// Longest record, longer messages are output synchronously and string arguments truncated to fit
+#define RECORD_MAX_WORDS 64
+// Messages longer than this are output in several parts, and a single conversion truncated to it
+#define LINE_SIZE 256
+// Prefix of the lines of binary records, see log_decode.py
+#define BINARY_PREFIX "~L:"
+
+typedef struct {
+    volatile uint32_t head;             // words reserved by the writers
+    volatile uint32_t tail;             // words output by the log task
+    volatile uint32_t dropped;          // records not written because the ring was full
+    uint32_t output;                    // records output, only changed by the log task
+    volatile uint32_t words[RING_WORDS];
+} log_ring_t;
+
+typedef enum {
+    ARG_NONE,           // "%%"
+    ARG_INT,            // 32-bit integer or pointer, one word
+    ARG_INT64,          // two words
+    ARG_DOUBLE,         // two words
+    ARG_STRING,         // characters, zero terminated and padded to a word
+    ARG_UNSUPPORTED,    // can't be stored, the message is output synchronously
+} arg_type_t;
+
+typedef struct {
+    size_t len;         // characters from '%' to the conversion character, included
+    arg_type_t type;
+    int stars;          // '*' width and precision, each an int argument before the value
+    bool star_precision;
+    int precision;      // digits of the precision, -1 if none or '*'
+} conversion_t;
+
+static log_ring_t s_rings[portNUM_PROCESSORS];
+static volatile uint32_t s_state;       // 0: no log task, 1: starting it, 2: started
+static TaskHandle_t s_task;
+static SemaphoreHandle_t s_drain_mutex;
+static uint32_t s_reported_dropped;
+
+static inline void atomic_increment(volatile uint32_t *value)
+{
+    uint32_t old, new;
+    do {
+        old = *value;
+        new = old + 1;
+        uxPortCompareSet(value, old, &new);
+    } while (new != old);
+}
+
+/* Parses the conversion starting with the '%' at fmt */
+static void parse_conversion(const char *fmt, conversion_t *conv)
+{
+    const char *p = fmt + 1;
+    conv->stars = 0;
+    conv->star_precision = false;
+    conv->precision = -1;
+    while (*p && strchr("-+ #0", *p)) {
+        p++;
+    }
+    if (*p == '*') {
+        conv->stars++;
+        p++;
+    }
+    while (*p >= '0' && *p <= '9') {
+        p++;
+    }
+    if (*p == '$') {
+        // positional argument
+        conv->len = p - fmt;
+        conv->type = ARG_UNSUPPORTED;
+        return;
+    }
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            conv->stars++;
+            conv->star_precision = true;
+            p++;
+        } else {
+            conv->precision = 0;
+            while (*p >= '0' && *p <= '9') {
+                conv->precision = conv->precision * 10 + *p++ - '0';
+            }
+        }
+    }
+    size_t size = sizeof(int);
+    bool long_double = false;
+    bool wide = false;
+    switch (*p) {
+    case 'h':
+        p += (p[1] == 'h') ? 2 : 1;
+        break;
+    case 'l':
+        if (p[1] == 'l') {
+            size = sizeof(long long);
+            p += 2;
+        } else {
+            size = sizeof(long);
+            wide = true;
+            p++;
+        }
+        break;
+    case 'j':
+    case 'q':
+        size = sizeof(long long);
+        p++;
+        break;
+    case 'z':
+    case 't':
+        size = sizeof(size_t);
+        p++;
+        break;
+    case 'L':
+        long_double = true;
+        p++;
+        break;
+    }
+    switch (*p) {
+    case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+        conv->type = (size > sizeof(uint32_t)) ? ARG_INT64 : ARG_INT;
+        break;
+    case 'p':
+        conv->type = (sizeof(void *) > sizeof(uint32_t)) ? ARG_INT64 : ARG_INT;
+        break;
+    case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        conv->type = long_double ? ARG_UNSUPPORTED : ARG_DOUBLE;
+        break;
+    case 's':
+        conv->type = wide ? ARG_UNSUPPORTED : ARG_STRING;
+        break;
+    case '%':
+        conv->type = ARG_NONE;
+        break;
+    default:
+        // %n, or not a conversion
+        conv->type = ARG_UNSUPPORTED;
+        break;
+    }
+    conv->len = p - fmt + (*p ? 1 : 0);
+}
+
+/* Stores a word of a record at position n after pos, if words isn't NULL */
+static inline void put_word(volatile uint32_t *words, uint32_t pos, size_t n, uint32_t value)
+{
+    if (words != NULL) {
+        words[(pos + n) & RING_MASK] = value;
+    }
+}
+
+/* Fetches the arguments of format into the words of a ring from pos on, or only counts them if words is NULL.
+ * Returns the number of words of the record, at most max_words, or 0 if the message can't be stored */
+static size_t encode_record(volatile uint32_t *words, uint32_t pos, size_t max_words, const char *format, va_list args)
+{
+    size_t n = 2;
+    put_word(words, pos, 1, (uint32_t) (uintptr_t) format);
+    for (const char *p = strchr(format, '%'); p != NULL; p = strchr(p, '%')) {
+        conversion_t conv;
+        parse_conversion(p, &conv);
+        p += conv.len;
+        if (conv.type == ARG_NONE) {
+            continue;
+        }
+        // at least the terminating zero of a string
+        size_t value_words = (conv.type == ARG_INT64 || conv.type == ARG_DOUBLE) ? 2 : 1;
+        if (conv.type == ARG_UNSUPPORTED || n + conv.stars + value_words > max_words) {
+            return 0;
+        }
+        int star = 0;
+        for (int i = 0; i < conv.stars; i++) {
+            star = va_arg(args, int);
+            put_word(words, pos, n++, star);
+        }
+        if (conv.star_precision) {
+            conv.precision = star;
+        }
+        switch (conv.type) {
+        case ARG_INT:
+            if (p[-1] == 'p') {
+                put_word(words, pos, n++, (uint32_t) (uintptr_t) va_arg(args, void *));
+            } else {
+                put_word(words, pos, n++, va_arg(args, unsigned));
+            }
+            break;
+        case ARG_INT64:
+        case ARG_DOUBLE: {
+            uint32_t value[2];
+            if (conv.type == ARG_DOUBLE) {
+                double d = va_arg(args, double);
+                memcpy(value, &d, sizeof(d));
+            } else {
+                unsigned long long ll = (p[-1] == 'p') ? (uintptr_t) va_arg(args, void *) : va_arg(args, unsigned long long);
+                memcpy(value, &ll, sizeof(ll));
+            }
+            put_word(words, pos, n++, value[0]);
+            put_word(words, pos, n++, value[1]);
+            break;
+        }
+        case ARG_STRING: {
+            const char *str = va_arg(args, const char *);
+            if (str == NULL) {
+                str = "(null)";
+            }
+            size_t max_len = (max_words - n) * sizeof(uint32_t) - 1;
+            if (conv.precision >= 0 && (size_t) conv.precision < max_len) {
+                max_len = conv.precision;
+            }
+            size_t len = strnlen(str, max_len);
+            // the characters and the terminating zero, padded with zeros to a word
+            for (size_t i = 0; i <= len; i += sizeof(uint32_t)) {
+                uint32_t value = 0;
+                memcpy(&value, str + i, MIN(sizeof(uint32_t), len - i));
+                put_word(words, pos, n++, value);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    return n;
+}
+
+static bool ring_reserve(log_ring_t *ring, uint32_t words, uint32_t *pos, bool *was_empty)
+{
+    uint32_t head, tail, next;
+    do {
+        head = ring->head;
+        tail = ring->tail;
+        if (head - tail + words > RING_WORDS) {
+            return false;
+        }
+        next = head + words;
+        uxPortCompareSet(&ring->head, head, &next);
+    } while (next != head);
+    *pos = head;
+    *was_empty = (head == tail);
+    return true;
+}
+
+static bool start_task(void);
+
+bool esp_log_impl_deferred_write(const char *format, va_list args)
+{
+    if (unlikely(s_state != 2) && !start_task()) {
+        return false;
+    }
+    if (!esp_ptr_in_drom(format)) {
+        // the log task may not be able to read it, and log_decode.py can't
+        return false;
+    }
+
+    // The record is encoded twice, to find its size before reserving it and then into the reserved words
+    va_list copy;
+    va_copy(copy, args);
+    size_t words = encode_record(NULL, 0, RECORD_MAX_WORDS, format, copy);
+    va_end(copy);
+    if (words == 0) {
+        return false;
+    }
+
+    log_ring_t *ring = &s_rings[xPortGetCoreID()];
+    uint32_t pos;
+    bool was_empty;
+    if (!ring_reserve(ring, words, &pos, &was_empty)) {
+        atomic_increment(&ring->dropped);
+        return true;
+    }
+    // Strings changed meanwhile are truncated to the reserved words, the words not written are still zero
+    va_copy(copy, args);
+    encode_record(ring->words, pos, words, format, copy);
+    va_end(copy);
+    ring->words[pos & RING_MASK] = words;
+
+    if (was_empty) {
+        if (xPortInIsrContext()) {
+            vTaskNotifyGiveFromISR(s_task, NULL);
+        } else {
+            xTaskNotifyGive(s_task);
+        }
+    }
+    return true;
+}
+
+#if CONFIG_LOG_DEFERRED_OUTPUT_BINARY
+
+static void output_record(const uint32_t *record)
+{
+    static const char s_digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    static char s_line[sizeof(BINARY_PREFIX) + RECORD_MAX_WORDS * sizeof(uint32_t) * 4 / 3 + 4];
+    const uint8_t *data = (const uint8_t *) record;
+    size_t size = record[0] * sizeof(uint32_t);
+    char *out = s_line + strlen(BINARY_PREFIX);
+
+    memcpy(s_line, BINARY_PREFIX, strlen(BINARY_PREFIX));
+    for (size_t i = 0; i < size; i += 3) {
+        uint32_t v = data[i] << 16;
+        v |= (i + 1 < size) ? data[i + 1] << 8 : 0;
+        v |= (i + 2 < size) ? data[i + 2] : 0;
+        *out++ = s_digits[(v >> 18) & 0x3f];
+        *out++ = s_digits[(v >> 12) & 0x3f];
+        *out++ = (i + 1 < size) ? s_digits[(v >> 6) & 0x3f] : '=';
+        *out++ = (i + 2 < size) ? s_digits[v & 0x3f] : '=';
+    }
+    *out++ = '\n';
+    *out = '\0';
+    esp_log_impl_print("%s", s_line);
+}
+
+#else // CONFIG_LOG_DEFERRED_OUTPUT_TEXT
+
+/* Formats a single conversion into buf, spec is the conversion with the '*' replaced by their value */
+static int format_value(char *buf, size_t size, const char *spec, arg_type_t type, const uint32_t *value)
+{
+    char conversion = spec[strlen(spec) - 1];
+    switch (type) {
+    case ARG_INT:
+        if (conversion == 'p') {
+            return snprintf(buf, size, spec, (void *) (uintptr_t) value[0]);
+        }
+        return snprintf(buf, size, spec, value[0]);
+    case ARG_INT64: {
+        unsigned long long v;
+        memcpy(&v, value, sizeof(v));
+        if (conversion == 'p') {
+            return snprintf(buf, size, spec, (void *) (uintptr_t) v);
+        }
+        return snprintf(buf, size, spec, v);
+    }
+    case ARG_DOUBLE: {
+        double v;
+        memcpy(&v, value, sizeof(v));
+        return snprintf(buf, size, spec, v);
+    }
+    case ARG_STRING:
+        return snprintf(buf, size, spec, (const char *) value);
+    default:
+        return 0;
+    }
+}
+
+typedef struct {
+    char buf[LINE_SIZE];
+    size_t len;
+} line_t;
+
+static void line_flush(line_t *line)
+{
+    if (line->len > 0) {
+        line->buf[line->len] = '\0';
+        esp_log_impl_print("%s", line->buf);
+        line->len = 0;
+    }
+}
+
+static void line_append(line_t *line, const char *text, size_t len)
+{
+    while (len > 0) {
+        if (line->len == LINE_SIZE - 1) {
+            line_flush(line);
+        }
+        size_t chunk = MIN(len, LINE_SIZE - 1 - line->len);
+        memcpy(line->buf + line->len, text, chunk);
+        line->len += chunk;
+        text += chunk;
+        len -= chunk;
+    }
+}
+
+static void line_append_value(line_t *line, const char *spec, arg_type_t type, const uint32_t *value)
+{
+    int len = format_value(line->buf + line->len, LINE_SIZE - line->len, spec, type, value);
+    if (len >= 0 && line->len + len >= LINE_SIZE && line->len > 0) {
+        // doesn't fit after the text so far, output that first
+        line_flush(line);
+        len = format_value(line->buf, LINE_SIZE, spec, type, value);
+    }
+    if (len > 0) {
+        line->len = MIN(line->len + len, LINE_SIZE - 1);
+    }
+}
+
+static void output_record(const uint32_t *record)
+{
+    static line_t s_line;
+    size_t words = record[0];
+    size_t n = 2;
+    const char *p = (const char *) (uintptr_t) record[1];
+
+    while (*p) {
+        const char *conv_start = strchr(p, '%');
+        size_t literal = conv_start ? (size_t) (conv_start - p) : strlen(p);
+        line_append(&s_line, p, literal);
+        p += literal;
+        if (conv_start == NULL) {
+            break;
+        }
+
+        conversion_t conv;
+        parse_conversion(p, &conv);
+        if (conv.type == ARG_NONE) {
+            line_append(&s_line, "%", 1);
+            p += conv.len;
+            continue;
+        }
+        // Copy the conversion, replacing the '*' with their value
+        char spec[32];
+        size_t spec_len = 0;
+        for (size_t i = 0; i < conv.len && spec_len < sizeof(spec) - 12; i++) {
+            if (p[i] == '*' && n < words) {
+                spec_len += snprintf(spec + spec_len, sizeof(spec) - spec_len, "%d", (int) record[n++]);
+            } else {
+                spec[spec_len++] = p[i];
+            }
+        }
+        spec[spec_len] = '\0';
+        p += conv.len;
+        if (n + ((conv.type == ARG_INT64 || conv.type == ARG_DOUBLE) ? 2 : 1) > words) {
+            // cut short by a string argument which grew while the record was written
+            break;
+        }
+        line_append_value(&s_line, spec, conv.type, &record[n]);
+        if (conv.type == ARG_STRING) {
+            n += (strlen((const char *) &record[n]) + sizeof(uint32_t)) / sizeof(uint32_t);
+        } else {
+            n += (conv.type == ARG_INT) ? 1 : 2;
+        }
+    }
+    line_flush(&s_line);
+}
+
+#endif // CONFIG_LOG_DEFERRED_OUTPUT_BINARY
+
+/* Outputs the records of a ring, returns true if a record reserved by a writer isn't written yet */
+static bool drain_ring(log_ring_t *ring)
+{
+    static uint32_t s_record[RECORD_MAX_WORDS];
+
+    while (ring->tail != ring->head) {
+        uint32_t tail = ring->tail;
+        uint32_t words = ring->words[tail & RING_MASK];
+        if (words == 0) {
+            return true;
+        }
+        for (uint32_t i = 0; i < words; i++) {
+            s_record[i] = ring->words[(tail + i) & RING_MASK];
+            ring->words[(tail + i) & RING_MASK] = 0;
+        }
+        ring->tail = tail + words;
+        output_record(s_record);
+        ring->output++;
+    }
+    return false;
+}
+
+static bool drain(void)
+{
+    bool pending = false;
+    xSemaphoreTake(s_drain_mutex, portMAX_DELAY);
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        pending |= drain_ring(&s_rings[i]);
+    }
+    uint32_t dropped = 0;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        dropped += s_rings[i].dropped;
+    }
+    if (dropped != s_reported_dropped) {
+        esp_log_impl_print(LOG_FORMAT(W, "%u messages dropped, the log buffer was full"),
+                           esp_log_timestamp(), "log", dropped - s_reported_dropped);
+        s_reported_dropped = dropped;
+    }
+    xSemaphoreGive(s_drain_mutex);
+    return pending;
+}
+
+static void log_task(void *arg)
+{
+    while (true) {
+        // A record reserved before the ring was empty again doesn't notify, check it in a tick
+        bool pending = drain();
+        ulTaskNotifyTake(pdTRUE, pending ? 1 : portMAX_DELAY);
+    }
+}
+
+/* Starts the log task on the first message, returns true once it is started */
+static bool start_task(void)
+{
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED || xPortInIsrContext()) {
+        return false;
+    }
+    uint32_t state = 1;
+    uxPortCompareSet(&s_state, 0, &state);
+    if (state != 0) {
+        // started, or being started by another task
+        return state == 2;
+    }
+    s_drain_mutex = xSemaphoreCreateMutex();
+    if (s_drain_mutex == NULL) {
+        s_state = 0;
+        return false;
+    }
+    if (xTaskCreatePinnedToCore(log_task, "log", CONFIG_LOG_DEFERRED_TASK_STACK_SIZE, NULL,
+                                CONFIG_LOG_DEFERRED_TASK_PRIORITY, &s_task, tskNO_AFFINITY) != pdPASS) {
+        vSemaphoreDelete(s_drain_mutex);
+        s_state = 0;
+        return false;
+    }
+    // Output the messages left before restarting. If all the handlers are taken they are lost, as without it.
+    esp_register_shutdown_handler(esp_log_deferred_flush);
+    s_state = 2;
+    return true;
+}
+
+void esp_log_deferred_flush(void)
+{
+    // The drain mutex can't be taken from an ISR or with the scheduler suspended
+    if (s_state == 2 && !xPortInIsrContext() && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING) {
+        drain();
+    }
+}
+
+void esp_log_deferred_get_stats(esp_log_deferred_stats_t *stats)
+{
+    stats->output = 0;
+    stats->dropped = 0;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        stats->output += s_rings[i].output;
+        stats->dropped += s_rings[i].dropped;
+    }
+}
+
+#endif // CONFIG_LOG_DEFERRED
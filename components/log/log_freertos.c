@@ -15,15 +15,6 @@
 #include "esp_log.h"
 #include "esp_log_private.h"
 
-
-// Maximum time to wait for the mutex in a logging statement.
-//
-// We don't expect this to happen in most cases, as contention is low. The most likely case is if a
-// log function is called from an ISR (technically caller should use the ISR-friendly logging macros but
-// possible they use the normal one instead and disable the log type by tag).
-#define MAX_MUTEX_WAIT_MS 10
-#define MAX_MUTEX_WAIT_TICKS ((MAX_MUTEX_WAIT_MS + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS)
-
 static SemaphoreHandle_t s_log_mutex = NULL;
 
 void esp_log_impl_lock(void)
@@ -37,17 +28,6 @@ void esp_log_impl_lock(void)
     xSemaphoreTake(s_log_mutex, portMAX_DELAY);
 }
 
-bool esp_log_impl_lock_timeout(void)
-{
-    if (unlikely(!s_log_mutex)) {
-        s_log_mutex = xSemaphoreCreateMutex();
-    }
-    if (unlikely(xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED)) {
-        return true;
-    }
-    return xSemaphoreTake(s_log_mutex, MAX_MUTEX_WAIT_TICKS) == pdTRUE;
-}
-
 void esp_log_impl_unlock(void)
 {
     if (unlikely(xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED)) {
@@ -25,12 +25,6 @@ void esp_log_impl_lock(void)
     assert(pthread_mutex_lock(&mutex1) == 0);
 }
 
-bool esp_log_impl_lock_timeout(void)
-{
-    esp_log_impl_lock();
-    return true;
-}
-
 void esp_log_impl_unlock(void)
 {
     assert(pthread_mutex_unlock(&mutex1) == 0);
@@ -16,12 +16,6 @@ void esp_log_impl_lock(void)
     s_lock = 1;
 }
 
-bool esp_log_lock_impl_timeout(void)
-{
-    esp_log_impl_lock();
-    return true;
-}
-
 void esp_log_impl_unlock(void)
 {
     assert(s_lock == 1);
@@ -0,0 +1,234 @@
+/*
+ * SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "unity.h"
+#include "test_utils.h"
+#if CONFIG_LOG_DEFERRED_OUTPUT_BINARY
+#include "mbedtls/base64.h"
+#endif
+
+#if CONFIG_LOG_DEFERRED
+
+static const char *TAG = "log_deferred";
+
+#define WRITERS             2
+// A message of a writer takes 16 bytes, many more than fit into the buffers
+#define WRITER_MESSAGES     1000
+#define WRITERS_START       BIT0
+
+static const char *const s_writer_format = "w%d %d\n";
+
+typedef struct {
+    char last[128];                 // last output, a line of text or a binary record
+    int lines;                      // messages of the writers output
+    int last_seq[WRITERS];          // sequence number of the last message output of each writer
+    bool in_order;                  // each writer's messages were output in the order they were logged
+} capture_t;
+
+static capture_t s_capture;
+
+typedef struct {
+    int id;
+    EventGroupHandle_t start;
+    SemaphoreHandle_t done;
+} writer_args_t;
+
+#if CONFIG_LOG_DEFERRED_OUTPUT_BINARY
+/* Decodes a line of a binary record into words, returns the number of words or 0 if it isn't a record */
+static size_t decode_record(const char *line, uint32_t *words, size_t max_words)
+{
+    size_t len;
+    if (strncmp(line, "~L:", 3) != 0) {
+        return 0;
+    }
+    line += 3;
+    if (mbedtls_base64_decode((unsigned char *) words, max_words * sizeof(uint32_t), &len,
+                              (const unsigned char *) line, strcspn(line, "\r\n")) != 0) {
+        return 0;
+    }
+    return len / sizeof(uint32_t);
+}
+#endif
+
+/* Parses a message of a writer */
+static bool parse_writer_message(const char *line, int *writer, int *seq)
+{
+#if CONFIG_LOG_DEFERRED_OUTPUT_BINARY
+    uint32_t words[4];
+    if (decode_record(line, words, 4) != 4 || words[1] != (uint32_t) s_writer_format) {
+        return false;
+    }
+    *writer = words[2];
+    *seq = words[3];
+    return true;
+#else
+    return sscanf(line, "w%d %d", writer, seq) == 2;
+#endif
+}
+
+/* Called by the log task and by esp_log_deferred_flush(), one at a time */
+static int capture_vprintf(const char *format, va_list args)
+{
+    int len = vsnprintf(s_capture.last, sizeof(s_capture.last), format, args);
+    int writer, seq;
+    if (parse_writer_message(s_capture.last, &writer, &seq) && writer >= 0 && writer < WRITERS) {
+        if (seq <= s_capture.last_seq[writer]) {
+            s_capture.in_order = false;
+        }
+        s_capture.last_seq[writer] = seq;
+        s_capture.lines++;
+    }
+    return len;
+}
+
+static vprintf_like_t start_capture(void)
+{
+    // Output the messages logged so far before capturing
+    esp_log_deferred_flush();
+    memset(&s_capture, 0, sizeof(s_capture));
+    for (int i = 0; i < WRITERS; i++) {
+        s_capture.last_seq[i] = -1;
+    }
+    s_capture.in_order = true;
+    return esp_log_set_vprintf(capture_vprintf);
+}
+
+static void writer_task(void *arg)
+{
+    writer_args_t *args = (writer_args_t *) arg;
+    // The writers start together and don't block, so the low priority log task doesn't run until they are done
+    xEventGroupWaitBits(args->start, WRITERS_START, pdFALSE, pdTRUE, portMAX_DELAY);
+    for (int seq = 0; seq < WRITER_MESSAGES; seq++) {
+        esp_log_write(ESP_LOG_INFO, TAG, s_writer_format, args->id, seq);
+    }
+    xSemaphoreGive(args->done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("deferred log drops messages when its buffer is full, outputs the others in order", "[log]")
+{
+    writer_args_t args[WRITERS];
+    EventGroupHandle_t start = xEventGroupCreate();
+    SemaphoreHandle_t done = xSemaphoreCreateCounting(WRITERS, 0);
+    TEST_ASSERT_NOT_NULL(start);
+    TEST_ASSERT_NOT_NULL(done);
+
+    vprintf_like_t orig_vprintf = start_capture();
+    esp_log_deferred_stats_t before, after;
+    esp_log_deferred_get_stats(&before);
+
+    for (int i = 0; i < WRITERS; i++) {
+        args[i] = (writer_args_t) {
+            .id = i,
+            .start = start,
+            .done = done,
+        };
+        TEST_ASSERT_EQUAL(pdPASS, xTaskCreatePinnedToCore(writer_task, "writer", 3072, &args[i],
+                                                          UNITY_FREERTOS_PRIORITY + 1, NULL, i % portNUM_PROCESSORS));
+    }
+    xEventGroupSetBits(start, WRITERS_START);
+    for (int i = 0; i < WRITERS; i++) {
+        TEST_ASSERT_TRUE(xSemaphoreTake(done, pdMS_TO_TICKS(5000)));
+    }
+
+    esp_log_deferred_flush();
+    esp_log_deferred_get_stats(&after);
+    esp_log_set_vprintf(orig_vprintf);
+
+    uint32_t output = after.output - before.output;
+    uint32_t dropped = after.dropped - before.dropped;
+    printf("%u messages output, %u dropped\n", (unsigned) output, (unsigned) dropped);
+    TEST_ASSERT_GREATER_THAN(0, dropped);
+    TEST_ASSERT_GREATER_THAN(0, output);
+    TEST_ASSERT_EQUAL(WRITERS * WRITER_MESSAGES, output + dropped);
+    TEST_ASSERT_EQUAL(output, s_capture.lines);
+    TEST_ASSERT_TRUE(s_capture.in_order);
+
+    vEventGroupDelete(start);
+    vSemaphoreDelete(done);
+}
+
+/* Logs a message and outputs it, s_capture.last is then its output */
+static void log_and_flush(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    esp_log_writev(ESP_LOG_INFO, TAG, format, args);
+    va_end(args);
+    esp_log_deferred_flush();
+}
+
+// The messages of the tests below, also checked by components/log/test_log_decode/test_log_decode.py
+static const char *const s_vector_formats[] = {
+    "%d %u %x %s\n",
+    "%lld %.2f|%*d|%.3s%%\n",
+};
+
+#define VECTORS (sizeof(s_vector_formats) / sizeof(s_vector_formats[0]))
+
+static void log_vector(size_t i)
+{
+    if (i == 0) {
+        log_and_flush(s_vector_formats[0], -5, 7, 0xabcd, "hi");
+    } else {
+        log_and_flush(s_vector_formats[1], -1234567890123LL, 3.5, 5, 42, "abcdef");
+    }
+}
+
+#if CONFIG_LOG_DEFERRED_OUTPUT_BINARY
+
+TEST_CASE("deferred log encodes the binary records read by log_decode.py", "[log]")
+{
+    // The words after the header and the address of the format string
+    static const uint32_t expected[VECTORS][7] = {
+        { 0xfffffffb, 7, 0xabcd, 0x00006968 },
+        { 0x8e04fb35, 0xfffffee0, 0x00000000, 0x400c0000, 5, 42, 0x00636261 },
+    };
+    static const size_t expected_words[VECTORS] = { 6, 9 };
+
+    vprintf_like_t orig_vprintf = start_capture();
+    for (size_t i = 0; i < VECTORS; i++) {
+        uint32_t words[16];
+        log_vector(i);
+        size_t count = decode_record(s_capture.last, words, 16);
+        TEST_ASSERT_EQUAL(expected_words[i], count);
+        TEST_ASSERT_EQUAL(count, words[0]);
+        TEST_ASSERT_EQUAL_HEX32((uint32_t) s_vector_formats[i], words[1]);
+        TEST_ASSERT_EQUAL_HEX32_ARRAY(expected[i], &words[2], count - 2);
+    }
+    esp_log_set_vprintf(orig_vprintf);
+}
+
+#else // CONFIG_LOG_DEFERRED_OUTPUT_TEXT
+
+TEST_CASE("deferred log formats the messages like printf", "[log]")
+{
+    static const char *const expected[VECTORS] = {
+        "-5 7 abcd hi\n",
+        "-1234567890123 3.50|   42|abc%\n",
+    };
+
+    vprintf_like_t orig_vprintf = start_capture();
+    for (size_t i = 0; i < VECTORS; i++) {
+        log_vector(i);
+        TEST_ASSERT_EQUAL_STRING(expected[i], s_capture.last);
+    }
+    esp_log_set_vprintf(orig_vprintf);
+}
+
+#endif // CONFIG_LOG_DEFERRED_OUTPUT_BINARY
+
+#endif // CONFIG_LOG_DEFERRED
@@ -0,0 +1,87 @@
+#!/usr/bin/env python
+#
+# Checks that log_decode.py rebuilds the messages from the binary records of log_deferred.c. The first records are
+# the ones the unit test components/log/test/test_log_deferred.c checks on the chip, with another format address.
+#
+# SPDX-FileCopyrightText: 2021 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+from __future__ import unicode_literals
+
+import base64
+import struct
+import sys
+import unittest
+
+try:
+    import log_decode
+except ImportError:
+    sys.path.append('..')
+    import log_decode
+
+FORMAT_ADDRESS = 0x3f400000
+
+
+class FakeFormatStrings(object):
+    """ Format strings by address, instead of reading them from an ELF file """
+
+    def __init__(self, formats):  # type: (dict) -> None
+        self.formats = formats
+
+    def get(self, address):  # type: (int) -> str
+        if address not in self.formats:
+            raise ValueError('No format string at 0x{:08x}'.format(address))
+        return self.formats[address]
+
+
+def record_line(*args):  # type: (int) -> str
+    """ Line of a record holding the words after the header and the format address """
+    data = struct.pack('<II', len(args) + 2, FORMAT_ADDRESS) + struct.pack('<{}I'.format(len(args)), *args)
+    return log_decode.BINARY_PREFIX + base64.b64encode(data).decode('ascii') + '\n'
+
+
+class LogDecodeTests(unittest.TestCase):
+
+    def __init__(self, *args, **kwargs):  # type: (str, str) -> None
+        super(LogDecodeTests, self).__init__(*args, **kwargs)
+        try:
+            self.assertRaisesRegex
+        except AttributeError:
+            # assertRaisesRegex doesn't exist in Python 2
+            self.assertRaisesRegex = self.assertRaisesRegexp
+
+    def decode(self, fmt, line):  # type: (str, str) -> str
+        return log_decode.decode_line(line, FakeFormatStrings({FORMAT_ADDRESS: fmt}))
+
+    def test_chip_records(self):
+        # Output by the chip for the messages of test_log_deferred.c, with the format address replaced
+        self.assertEqual('-5 7 abcd hi\n',
+                         self.decode('%d %u %x %s\n', '~L:BgAAAAAAQD/7////BwAAAM2rAABoaQAA\n'))
+        self.assertEqual('-1234567890123 3.50|   42|abc%\n',
+                         self.decode('%lld %.2f|%*d|%.3s%%\n',
+                                     '~L:CQAAAAAAQD81+wSO4P7//wAAAAAAAAxABQAAACoAAABhYmMA\n'))
+
+    def test_integers(self):
+        self.assertEqual('-1 255 -1 65535 0x10 010 c',
+                         self.decode('%d %hhu %hhd %hu %#x %#o %c', record_line(0xffffffff, 0xff, 0xff, 0xffff, 16, 8, 0x63)))
+        self.assertEqual('0x3ffb0000', self.decode('%p', record_line(0x3ffb0000)))
+        self.assertEqual('18446744073709551615', self.decode('%llu', record_line(0xffffffff, 0xffffffff)))
+
+    def test_width_and_precision(self):
+        self.assertEqual('42   |  3.1', self.decode('%-*d|%*.*f', record_line(5, 42, 5, 1, 0x9999999a, 0x40091999)))
+        self.assertEqual('ab', self.decode('%.*s', record_line(2, 0x00006261)))
+
+    def test_strings(self):
+        # The characters, zero terminated and padded to a word
+        self.assertEqual('[abcd]', self.decode('[%s]', record_line(0x64636261, 0)))
+        self.assertEqual('[]', self.decode('[%s]', record_line(0)))
+        self.assertEqual('x=abcde y=1', self.decode('x=%s y=%d', record_line(0x64636261, 0x00000065, 1)))
+
+    def test_invalid_records(self):
+        with self.assertRaisesRegex(ValueError, 'header of'):
+            self.decode('%d', log_decode.BINARY_PREFIX + base64.b64encode(struct.pack('<III', 4, FORMAT_ADDRESS, 1)).decode('ascii'))
+        with self.assertRaisesRegex(ValueError, 'No format string'):
+            log_decode.decode_line(record_line(1), FakeFormatStrings({}))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -13,4 +13,8 @@
 // limitations under the License.
 #pragma once
 
+#include <stddef.h>
+
 size_t strlcat(char *dest, const char *src, size_t size);
+
+size_t strlcpy(char *dest, const char *src, size_t size);
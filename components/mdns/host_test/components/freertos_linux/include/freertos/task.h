@@ -16,6 +16,8 @@
 #include "freertos/FreeRTOS.h"
 
 #define xTaskHandle TaskHandle_t
+#define tskNO_AFFINITY INT32_MAX
+#define tskIDLE_PRIORITY 0
 #define vSemaphoreDelete( xSemaphore ) vQueueDelete( ( QueueHandle_t ) ( xSemaphore ) )
 
 void vTaskDelay( const TickType_t xTicksToDelay );
@@ -167,6 +167,9 @@ struct NVSValidPageFlashFixture : public PartitionMockFixture {
 
     uint8_t value_entry [32];
 
+    // both entries, as read by one block read during Page::load()
+    uint8_t entry_block [64];
+
     NVSValidPageFlashFixture(uint32_t start_sector = 0,
             uint32_t sector_size = 1,
             const char *partition_name = NVS_DEFAULT_PART_NAME)
@@ -180,6 +183,8 @@ struct NVSValidPageFlashFixture : public PartitionMockFixture {
     {
         std::fill_n(raw_entry_table, sizeof(raw_entry_table)/sizeof(raw_entry_table[0]), 0);
         raw_entry_table[0] = 0xfa;
+        std::copy_n(ns_entry, sizeof(ns_entry), entry_block);
+        std::copy_n(value_entry, sizeof(value_entry), entry_block + sizeof(ns_entry));
 
         // read page header
         esp_partition_read_raw_ExpectAnyArgsAndReturn(ESP_OK);
@@ -193,13 +198,9 @@ struct NVSValidPageFlashFixture : public PartitionMockFixture {
         esp_partition_read_raw_ExpectAnyArgsAndReturn(ESP_OK);
         esp_partition_read_raw_ReturnArrayThruPtr_dst(raw_header, 4);
 
-        // read namespace entry
+        // read namespace entry and normal entry in one block
         esp_partition_read_ExpectAnyArgsAndReturn(ESP_OK);
-        esp_partition_read_ReturnArrayThruPtr_dst(ns_entry, 32);
-
-        // read normal entry
-        esp_partition_read_ExpectAnyArgsAndReturn(ESP_OK);
-        esp_partition_read_ReturnArrayThruPtr_dst(value_entry, 32);
+        esp_partition_read_ReturnArrayThruPtr_dst(entry_block, 64);
 
         // read normal entry second time during duplicated entry check
         esp_partition_read_ExpectAnyArgsAndReturn(ESP_OK);
@@ -291,15 +292,7 @@ struct NVSValidStorageFixture : public PartitionMockFixture {
         esp_partition_read_ExpectAnyArgsAndReturn(ESP_OK);
         esp_partition_read_ReturnArrayThruPtr_dst(ns_entry, 32);
 
-        // storage finally actually reads namespace
-        esp_partition_read_ExpectAnyArgsAndReturn(ESP_OK);
-        esp_partition_read_ReturnArrayThruPtr_dst(ns_entry, 32);
-
-        // storage looks for blob index entries
-        esp_partition_read_ExpectAnyArgsAndReturn(ESP_OK);
-        esp_partition_read_ReturnArrayThruPtr_dst(ns_entry, 32);
-
-        // Storage::eraseOrphanDataBlobs() also wants to take it's turn...
+        // storage reads namespaces and blob entries in one pass
         esp_partition_read_ExpectAnyArgsAndReturn(ESP_OK);
         esp_partition_read_ReturnArrayThruPtr_dst(ns_entry, 32);
 
@@ -325,6 +318,9 @@ struct NVSValidBlobPageFixture : public PartitionMockFixture {
     uint8_t blob_data [BLOB_DATA_SIZE];
     uint8_t blob_index [32];
 
+    // all entries, as read by one block read during Page::load()
+    uint8_t entry_block [128];
+
     NVSValidBlobPageFixture(uint32_t start_sector = 0,
             uint32_t sector_size = 1,
             const char *partition_name = NVS_DEFAULT_PART_NAME)
@@ -343,6 +339,10 @@ struct NVSValidBlobPageFixture : public PartitionMockFixture {
     {
         std::fill_n(raw_entry_table, sizeof(raw_entry_table)/sizeof(raw_entry_table[0]), 0xFF);
         raw_entry_table[0] = 0xaa;
+        std::copy_n(ns_entry, sizeof(ns_entry), entry_block);
+        std::copy_n(blob_entry, sizeof(blob_entry), entry_block + 32);
+        std::copy_n(blob_data, sizeof(blob_data), entry_block + 64);
+        std::copy_n(blob_index, sizeof(blob_index), entry_block + 96);
 
         // read page header
         esp_partition_read_raw_ExpectAnyArgsAndReturn(ESP_OK);
@@ -356,15 +356,9 @@ struct NVSValidBlobPageFixture : public PartitionMockFixture {
         esp_partition_read_raw_ExpectAnyArgsAndReturn(ESP_OK);
         esp_partition_read_raw_ReturnArrayThruPtr_dst(raw_header, 4);
 
-        // read namespace entry
-        esp_partition_read_ExpectAnyArgsAndReturn(ESP_OK);
-        esp_partition_read_ReturnArrayThruPtr_dst(ns_entry, 32);
-
-        // read normal blob entry + index, not the data
-        esp_partition_read_ExpectAnyArgsAndReturn(ESP_OK);
-        esp_partition_read_ReturnArrayThruPtr_dst(blob_entry, 32);
+        // read namespace entry, blob entry, data and index in one block
         esp_partition_read_ExpectAnyArgsAndReturn(ESP_OK);
-        esp_partition_read_ReturnArrayThruPtr_dst(blob_index, 32);
+        esp_partition_read_ReturnArrayThruPtr_dst(entry_block, 128);
 
         // read normal entry second time during duplicated entry check
         esp_partition_read_ExpectAnyArgsAndReturn(ESP_OK);
@@ -389,6 +383,9 @@ struct NVSFullPageFixture : public PartitionMockFixture {
 
     uint8_t value_entry [32];
 
+    // both entries, as read by one block read during Page::load()
+    uint8_t entry_block [64];
+
     NVSFullPageFixture(uint32_t start_sector = 0,
             uint32_t sector_size = 1,
             const char *partition_name = NVS_DEFAULT_PART_NAME,
@@ -406,6 +403,8 @@ struct NVSFullPageFixture : public PartitionMockFixture {
         std::fill_n(raw_entry_table, sizeof(raw_entry_table)/sizeof(raw_entry_table[0]), 0);
         raw_entry_table[0] = 0x0a;
         raw_entry_table[31] = 0xFC;
+        std::copy_n(ns_entry, sizeof(ns_entry), entry_block);
+        std::copy_n(value_entry, sizeof(value_entry), entry_block + sizeof(ns_entry));
 
         // read page header
         esp_partition_read_raw_ExpectAnyArgsAndReturn(ESP_OK);
@@ -417,13 +416,9 @@ struct NVSFullPageFixture : public PartitionMockFixture {
 
         // no next free entry check, only one entry written
 
-        // read namespace entry
-        esp_partition_read_ExpectAnyArgsAndReturn(ESP_OK);
-        esp_partition_read_ReturnArrayThruPtr_dst(ns_entry, 32);
-
-        // read normal entry
+        // read namespace entry and normal entry in one block
         esp_partition_read_ExpectAnyArgsAndReturn(ESP_OK);
-        esp_partition_read_ReturnArrayThruPtr_dst(value_entry, 32);
+        esp_partition_read_ReturnArrayThruPtr_dst(entry_block, 64);
 
         // no duplicated entry check
 
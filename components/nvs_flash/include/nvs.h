@@ -114,6 +114,11 @@ typedef struct {
  */
 typedef struct nvs_opaque_iterator_t *nvs_iterator_t;
 
+/**
+ * Opaque pointer type representing a reader streaming a blob, see nvs_blob_reader_open
+ */
+typedef struct nvs_opaque_blob_reader_t *nvs_blob_reader_t;
+
 /**
  * @brief      Open non-volatile storage with a given namespace from the default NVS partition
  *
@@ -455,6 +460,85 @@ esp_err_t nvs_get_str (nvs_handle_t handle, const char* key, char* out_value, si
 esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value, size_t* length);
 /**@}*/
 
+/**
+ * @brief      Open a reader which streams the blob stored under the given key
+ *
+ * Unlike nvs_get_blob, the reader doesn't need a buffer for the whole blob: nvs_blob_reader_read
+ * hands out the blob in pieces of the size of the buffer passed to it. The chunks the blob is
+ * stored in are located only once while reading it from the beginning to the end.
+ *
+ * \code{c}
+ * // Example (without error checking) of streaming a certificate:
+ * nvs_blob_reader_t reader;
+ * uint8_t buffer[256];
+ * nvs_blob_reader_open(my_handle, "server_cert", &reader, NULL);
+ * size_t length = sizeof(buffer);
+ * while (nvs_blob_reader_read(reader, buffer, &length) == ESP_OK && length > 0) {
+ *     process(buffer, length);
+ *     length = sizeof(buffer);
+ * }
+ * nvs_blob_reader_close(reader);
+ * \endcode
+ *
+ * @param[in]   handle      Handle obtained from nvs_open function.
+ * @param[in]   key         Key name. Maximal length is (NVS_KEY_NAME_MAX_SIZE-1) characters. Shouldn't be empty.
+ * @param[out]  out_reader  Set to the reader on success. It has to be closed with nvs_blob_reader_close.
+ * @param[out]  out_length  If not NULL, set to the size of the blob in bytes.
+ *
+ * @return
+ *             - ESP_OK if the reader was opened
+ *             - ESP_ERR_NVS_NOT_FOUND if the requested key doesn't exist
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_INVALID_STATE if a new value of the blob is staged by an active transaction
+ *             - ESP_ERR_NO_MEM if the memory for the reader couldn't be allocated
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_blob_reader_open(nvs_handle_t handle, const char* key, nvs_blob_reader_t* out_reader, size_t* out_length);
+
+/**
+ * @brief      Read the blob from the current position of the reader and advance the position
+ *
+ * @param[in]     reader     Reader obtained from nvs_blob_reader_open.
+ * @param[out]    out_value  Buffer for the data.
+ * @param[inout]  length     A non-zero pointer to the size of out_value. Set to the number of bytes
+ *                           read, which is only smaller than the size of out_value at the end of
+ *                           the blob, and 0 once the end has been reached.
+ *
+ * @return
+ *             - ESP_OK if the data was read successfully
+ *             - ESP_ERR_NVS_NOT_FOUND if the blob has been written or erased since the reader was opened,
+ *               or a chunk of it failed its CRC check. The data returned by earlier reads
+ *               of that chunk can't be trusted either.
+ *             - ESP_ERR_NVS_INVALID_HANDLE if the handle of the reader has been closed
+ *             - ESP_ERR_INVALID_ARG if out_value or length is NULL
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_blob_reader_read(nvs_blob_reader_t reader, void* out_value, size_t* length);
+
+/**
+ * @brief      Set the position of the next read within the blob
+ *
+ * Only the headers of the chunks between the old and new position are read from flash.
+ * The CRC of a chunk is only checked if the chunk is read from its beginning.
+ *
+ * @param[in]  reader  Reader obtained from nvs_blob_reader_open.
+ * @param[in]  offset  New position, at most the size of the blob.
+ *
+ * @return
+ *             - ESP_OK if the position was set
+ *             - ESP_ERR_NVS_INVALID_LENGTH if offset lies behind the end of the blob
+ *             - ESP_ERR_NVS_NOT_FOUND if the blob has been written or erased since the reader was opened
+ *             - ESP_ERR_NVS_INVALID_HANDLE if the handle of the reader has been closed
+ */
+esp_err_t nvs_blob_reader_seek(nvs_blob_reader_t reader, size_t offset);
+
+/**
+ * @brief      Release a reader obtained from nvs_blob_reader_open
+ *
+ * @param[in]  reader  Reader to release. NULL argument is allowed.
+ */
+void nvs_blob_reader_close(nvs_blob_reader_t reader);
+
 /**
  * @brief      Erase key-value pair with given key name.
  *
@@ -507,6 +591,57 @@ esp_err_t nvs_erase_all(nvs_handle_t handle);
  */
 esp_err_t nvs_commit(nvs_handle_t handle);
 
+/**
+ * @brief      Start staging writes of the given handle in RAM
+ *
+ * While a transaction is active, the nvs_set_* functions only record the new values in RAM
+ * and the nvs_get_* functions return the staged values. Nothing is written to flash until
+ * nvs_transaction_commit (or nvs_commit) is called. The staged values are then written together,
+ * using as few flash writes as possible. The values are not written atomically: after a power
+ * loss, some of them may have their new value and others their previous value.
+ *
+ * Erasing keys is not possible while a transaction is active.
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *                     Handles that were opened read only cannot be used.
+ *
+ * @return
+ *             - ESP_OK if the transaction has been started
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_READ_ONLY if handle was opened as read only
+ *             - ESP_ERR_NVS_INVALID_STATE if a transaction is already active on this handle
+ */
+esp_err_t nvs_transaction_begin(nvs_handle_t handle);
+
+/**
+ * @brief      Write all values staged since nvs_transaction_begin to non-volatile storage
+ *
+ * The transaction ends in any case, also if writing fails.
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *
+ * @return
+ *             - ESP_OK if all staged values have been written successfully
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_INVALID_STATE if no transaction is active on this handle
+ *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if there is not enough space in the
+ *               underlying storage to save the values
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_transaction_commit(nvs_handle_t handle);
+
+/**
+ * @brief      Discard all values staged since nvs_transaction_begin
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *
+ * @return
+ *             - ESP_OK if the transaction has been discarded
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_INVALID_STATE if no transaction is active on this handle
+ */
+esp_err_t nvs_transaction_abort(nvs_handle_t handle);
+
 /**
  * @brief      Close the storage handle and free any allocated resources
  *
@@ -565,6 +700,34 @@ typedef struct {
  */
 esp_err_t nvs_get_stats(const char *part_name, nvs_stats_t *nvs_stats);
 
+/**
+ * @note Info about the RAM cache of item values, see CONFIG_NVS_CACHE_SIZE.
+ */
+typedef struct {
+    size_t hits;              /**< Amount of reads served from the cache. */
+    size_t misses;            /**< Amount of reads which had to access flash. */
+    size_t used_bytes;        /**< Amount of RAM used by cached values. */
+    size_t capacity_bytes;    /**< Maximum amount of RAM used by cached values, 0 if the cache is disabled. */
+} nvs_cache_stats_t;
+
+/**
+ * @brief      Fill structure nvs_cache_stats_t with the counters of the item value cache of a partition.
+ *
+ * Only reads of integer and string values use the cache. The hit and miss counters can be used
+ * to choose CONFIG_NVS_CACHE_SIZE for the keys which are read by the application.
+ *
+ * @param[in]   part_name    Partition name NVS in the partition table.
+ *                           If pass a NULL than will use NVS_DEFAULT_PART_NAME ("nvs").
+ *
+ * @param[out]  cache_stats  Returns filled structure nvs_cache_stats_t.
+ *
+ * @return
+ *             - ESP_OK if the statistics have been filled
+ *             - ESP_ERR_NVS_NOT_INITIALIZED if the storage driver is not initialized.
+ *             - ESP_ERR_INVALID_ARG if cache_stats equal to NULL.
+ */
+esp_err_t nvs_get_cache_stats(const char *part_name, nvs_cache_stats_t *cache_stats);
+
 /**
  * @brief      Calculate all entries in a namespace.
  *
@@ -29,6 +29,161 @@ enum class ItemType : uint8_t {
 };
 
 
+/**
+ * @brief A piece of a blob, handed out by \ref BlobReader::iterator.
+ */
+struct BlobChunk {
+    const uint8_t *data;    /*!< Data of the piece, located in the buffer passed to \ref BlobReader::begin */
+    size_t size;            /*!< Number of bytes in data */
+    size_t offset;          /*!< Position of the piece within the blob */
+};
+
+/**
+ * @brief Reads a blob piece by piece, without the need for a buffer holding the whole blob.
+ *
+ * A reader is obtained from \ref NVSHandle::open_blob_reader and must not be used after the handle has been
+ * destroyed. The chunks of the blob are located only once while reading it from the beginning to the end.
+ * If the blob is written or erased while the reader is open, read and seek fail with ESP_ERR_NVS_NOT_FOUND.
+ */
+class BlobReader {
+public:
+    class iterator;
+
+    virtual ~BlobReader() { }
+
+    /**
+     * @brief Reads the blob from the current position and advances the position.
+     *
+     * @param[out]    out_data  Buffer for the data.
+     * @param[inout]  len       Size of out_data, set to the number of bytes read. This is only smaller than
+     *                          the size of out_data at the end of the blob, and 0 once the end has been reached.
+     *
+     * @return
+     *             - ESP_OK if the data was read successfully
+     *             - ESP_ERR_NVS_NOT_FOUND if the blob has been erased or a chunk of it failed its CRC check.
+     *               The data returned by earlier reads of that chunk can't be trusted either.
+     *             - other error codes from the underlying storage driver
+     */
+    virtual esp_err_t read(void *out_data, size_t &len) = 0;
+
+    /**
+     * @brief Sets the position of the next read. Only the chunk headers between the old and new position are read.
+     *
+     * The CRC of a chunk is only checked if the chunk has been read from its beginning.
+     *
+     * @return
+     *             - ESP_OK if the position was set
+     *             - ESP_ERR_NVS_INVALID_LENGTH if offset lies behind the end of the blob
+     *             - ESP_ERR_NVS_NOT_FOUND if the blob has been erased
+     */
+    virtual esp_err_t seek(size_t offset) = 0;
+
+    /**
+     * @brief Returns the position of the next read.
+     */
+    virtual size_t tell() const = 0;
+
+    /**
+     * @brief Returns the size of the whole blob in bytes.
+     */
+    virtual size_t size() const = 0;
+
+    /**
+     * @brief Returns an iterator handing out the rest of the blob in pieces of at most buffer_size bytes.
+     *
+     * Each piece is read into buffer, so it is only valid until the iterator is advanced.
+     *
+     * \code{cpp}
+     * uint8_t buffer[256];
+     * esp_err_t err;
+     * for (auto it = reader->begin(buffer, sizeof(buffer), &err); it != reader->end(); ++it) {
+     *     process(it->data, it->size);
+     * }
+     * \endcode
+     *
+     * @param err an optional pointer to the result of the last read. The iteration also ends if a read fails.
+     */
+    iterator begin(void *buffer, size_t buffer_size, esp_err_t *err = nullptr);
+
+    iterator end();
+};
+
+/**
+ * @brief Input iterator over the pieces of a blob, see \ref BlobReader::begin.
+ */
+class BlobReader::iterator {
+public:
+    iterator() : mReader(nullptr), mBuffer(nullptr), mBufferSize(0), mErr(nullptr), mChunk() { }
+
+    iterator(BlobReader *reader, void *buffer, size_t buffer_size, esp_err_t *err)
+        : mReader(reader), mBuffer(static_cast<uint8_t*>(buffer)), mBufferSize(buffer_size), mErr(err), mChunk()
+    {
+        advance();
+    }
+
+    const BlobChunk &operator*() const
+    {
+        return mChunk;
+    }
+
+    const BlobChunk *operator->() const
+    {
+        return &mChunk;
+    }
+
+    iterator &operator++()
+    {
+        advance();
+        return *this;
+    }
+
+    bool operator==(const iterator &other) const
+    {
+        return mReader == other.mReader;
+    }
+
+    bool operator!=(const iterator &other) const
+    {
+        return mReader != other.mReader;
+    }
+
+private:
+    void advance()
+    {
+        if (mReader == nullptr) {
+            return;
+        }
+        size_t len = mBufferSize;
+        mChunk.offset = mReader->tell();
+        esp_err_t result = mReader->read(mBuffer, len);
+        if (mErr != nullptr) {
+            *mErr = result;
+        }
+        if (result != ESP_OK || len == 0) {
+            mReader = nullptr;
+            return;
+        }
+        mChunk.data = mBuffer;
+        mChunk.size = len;
+    }
+
+    BlobReader *mReader;
+    uint8_t *mBuffer;
+    size_t mBufferSize;
+    esp_err_t *mErr;
+    BlobChunk mChunk;
+};
+
+inline BlobReader::iterator BlobReader::begin(void *buffer, size_t buffer_size, esp_err_t *err)
+{
+    return iterator(this, buffer, buffer_size, err);
+}
+
+inline BlobReader::iterator BlobReader::end()
+{
+    return iterator();
+}
+
 /**
  * @brief A handle allowing nvs-entry related operations on the NVS.
  *
@@ -183,6 +338,44 @@ public:
      */
     virtual esp_err_t commit() = 0;
 
+    /**
+     * @brief Starts a transaction on this handle.
+     *
+     * Until \ref transaction_commit or \ref transaction_abort is called, all set operations through this handle are
+     * staged in RAM instead of being written to flash. Get operations return the staged values.
+     * Erase operations are not allowed while a transaction is active.
+     *
+     * @return
+     *             - ESP_OK if the transaction was started
+     *             - ESP_ERR_NVS_READ_ONLY if the handle was opened as read only
+     *             - ESP_ERR_NVS_INVALID_STATE if a transaction is already active on this handle
+     */
+    virtual esp_err_t transaction_begin() = 0;
+
+    /**
+     * @brief Writes all items staged since \ref transaction_begin and ends the transaction.
+     *
+     * The staged items are packed into as few flash writes as possible and the entries they replace are erased
+     * afterwards. Items which fit into the free space of the current page are written all-or-nothing with respect to
+     * power loss. \ref commit also commits an active transaction.
+     *
+     * @return
+     *             - ESP_OK if all staged items have been written
+     *             - ESP_ERR_NVS_INVALID_STATE if no transaction is active on this handle
+     *             - other error codes from the underlying storage driver, as for the set functions.
+     *               The transaction is ended in any case.
+     */
+    virtual esp_err_t transaction_commit() = 0;
+
+    /**
+     * @brief Discards all items staged since \ref transaction_begin and ends the transaction.
+     *
+     * @return
+     *             - ESP_OK if the transaction was discarded
+     *             - ESP_ERR_NVS_INVALID_STATE if no transaction is active on this handle
+     */
+    virtual esp_err_t transaction_abort() = 0;
+
     /**
      * @brief      Calculate all entries in the scope of the handle.
      *
@@ -200,6 +393,21 @@ public:
      */
     virtual esp_err_t get_used_entry_count(size_t& usedEntries) = 0;
 
+    /**
+     * @brief Opens a reader which streams the blob stored under key, see \ref BlobReader.
+     *
+     * @param[in]  key     Key name. Maximal length is (NVS_KEY_NAME_MAX_SIZE-1) characters. Shouldn't be empty.
+     * @param[out] reader  Set to the reader on success.
+     *
+     * @return
+     *             - ESP_OK if the reader was opened
+     *             - ESP_ERR_NVS_NOT_FOUND if the requested key doesn't exist
+     *             - ESP_ERR_NVS_INVALID_STATE if a new value of the blob is staged by an active transaction
+     *             - ESP_ERR_NO_MEM if the memory for the reader couldn't be allocated
+     *             - other error codes from the underlying storage driver
+     */
+    virtual esp_err_t open_blob_reader(const char *key, std::unique_ptr<BlobReader> &reader) = 0;
+
 protected:
     virtual esp_err_t set_typed_item(ItemType datatype, const char *key, const void* data, size_t dataSize) = 0;
 
@@ -408,6 +408,39 @@ extern "C" esp_err_t nvs_commit(nvs_handle_t c_handle)
     return handle->commit();
 }
 
+extern "C" esp_err_t nvs_transaction_begin(nvs_handle_t c_handle)
+{
+    Lock lock;
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->transaction_begin();
+}
+
+extern "C" esp_err_t nvs_transaction_commit(nvs_handle_t c_handle)
+{
+    Lock lock;
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->transaction_commit();
+}
+
+extern "C" esp_err_t nvs_transaction_abort(nvs_handle_t c_handle)
+{
+    Lock lock;
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->transaction_abort();
+}
+
 extern "C" esp_err_t nvs_set_str(nvs_handle_t c_handle, const char* key, const char* value)
 {
     Lock lock;
@@ -526,6 +559,76 @@ extern "C" esp_err_t nvs_get_blob(nvs_handle_t c_handle, const char* key, void*
     return nvs_get_str_or_blob(c_handle, nvs::ItemType::BLOB, key, out_value, length);
 }
 
+struct nvs_opaque_blob_reader_t
+{
+    nvs_handle_t handle;
+    nvs::Storage::BlobCursor cursor;
+};
+
+extern "C" esp_err_t nvs_blob_reader_open(nvs_handle_t c_handle, const char* key, nvs_blob_reader_t* out_reader, size_t* out_length)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %s", __func__, key);
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(c_handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    nvs_blob_reader_t reader = new (std::nothrow) nvs_opaque_blob_reader_t;
+    if (!reader) {
+        return ESP_ERR_NO_MEM;
+    }
+    reader->handle = c_handle;
+    err = handle->open_blob(key, reader->cursor);
+    if (err != ESP_OK) {
+        delete reader;
+        return err;
+    }
+    if (out_length) {
+        *out_length = reader->cursor.size;
+    }
+    *out_reader = reader;
+    return ESP_OK;
+}
+
+extern "C" esp_err_t nvs_blob_reader_read(nvs_blob_reader_t reader, void* out_value, size_t* length)
+{
+    Lock lock;
+    assert(reader);
+    if (out_value == nullptr || length == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(reader->handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->read_blob(reader->cursor, out_value, *length);
+}
+
+extern "C" esp_err_t nvs_blob_reader_seek(nvs_blob_reader_t reader, size_t offset)
+{
+    Lock lock;
+    assert(reader);
+    NVSHandleSimple *handle;
+    auto err = nvs_find_ns_handle(reader->handle, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return handle->seek_blob(reader->cursor, offset);
+}
+
+extern "C" void nvs_blob_reader_close(nvs_blob_reader_t reader)
+{
+    if (reader == nullptr) {
+        return;
+    }
+    Lock lock;
+    nvs::Storage::closeBlob(reader->cursor);
+    delete reader;
+}
+
 extern "C" esp_err_t nvs_get_stats(const char* part_name, nvs_stats_t* nvs_stats)
 {
     Lock lock;
@@ -551,6 +654,24 @@ extern "C" esp_err_t nvs_get_stats(const char* part_name, nvs_stats_t* nvs_stats
     return pStorage->fillStats(*nvs_stats);
 }
 
+extern "C" esp_err_t nvs_get_cache_stats(const char* part_name, nvs_cache_stats_t* cache_stats)
+{
+    Lock lock;
+    nvs::Storage* pStorage;
+
+    if (cache_stats == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pStorage = lookup_storage_from_name((part_name == nullptr) ? NVS_DEFAULT_PART_NAME : part_name);
+    if (pStorage == nullptr) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    pStorage->fillCacheStats(*cache_stats);
+    return ESP_OK;
+}
+
 extern "C" esp_err_t nvs_get_used_entry_count(nvs_handle_t c_handle, size_t* used_entries)
 {
     Lock lock;
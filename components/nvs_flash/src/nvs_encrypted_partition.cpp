@@ -41,9 +41,9 @@ esp_err_t NVSEncryptedPartition::init(nvs_sec_cfg_t* cfg)
 
 esp_err_t NVSEncryptedPartition::read(size_t src_offset, void* dst, size_t size)
 {
-    /** Currently upper layer of NVS reads entries one by one even for variable size
-    * multi-entry data types. So length should always be equal to size of an entry.*/
-    if (size != sizeof(Item)) return ESP_ERR_INVALID_SIZE;
+    /** Entries are encrypted one by one, each with its own address as tweak.
+    * So length should always be a multiple of the size of an entry.*/
+    if (size % sizeof(Item) != 0) return ESP_ERR_INVALID_SIZE;
 
     // read data
     esp_err_t read_result = esp_partition_read(mESPPartition, src_offset, dst, size);
@@ -59,12 +59,16 @@ esp_err_t NVSEncryptedPartition::read(size_t src_offset, void* dst, size_t size)
 
     memset(data_unit, 0, sizeof(data_unit));
 
-    memcpy(data_unit, &relAddr, sizeof(relAddr));
-
     uint8_t *destination = reinterpret_cast<uint8_t*>(dst);
 
-    if (mbedtls_aes_crypt_xts(&mDctxt, MBEDTLS_AES_DECRYPT, size, data_unit, destination, destination) != 0)  {
-        return ESP_ERR_NVS_XTS_DECR_FAILED;
+    for (size_t offset = 0; offset < size; offset += sizeof(Item)) {
+        uint32_t entryAddr = relAddr + offset;
+        memcpy(data_unit, &entryAddr, sizeof(entryAddr));
+
+        if (mbedtls_aes_crypt_xts(&mDctxt, MBEDTLS_AES_DECRYPT, sizeof(Item), data_unit,
+                    destination + offset, destination + offset) != 0)  {
+            return ESP_ERR_NVS_XTS_DECR_FAILED;
+        }
     }
 
     return ESP_OK;
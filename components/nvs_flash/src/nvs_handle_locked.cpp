@@ -62,11 +62,41 @@ esp_err_t NVSHandleLocked::commit() {
     return handle->commit();
 }
 
+esp_err_t NVSHandleLocked::transaction_begin() {
+    Lock lock;
+    return handle->transaction_begin();
+}
+
+esp_err_t NVSHandleLocked::transaction_commit() {
+    Lock lock;
+    return handle->transaction_commit();
+}
+
+esp_err_t NVSHandleLocked::transaction_abort() {
+    Lock lock;
+    return handle->transaction_abort();
+}
+
 esp_err_t NVSHandleLocked::get_used_entry_count(size_t& usedEntries) {
     Lock lock;
     return handle->get_used_entry_count(usedEntries);
 }
 
+esp_err_t NVSHandleLocked::open_blob_reader(const char *key, std::unique_ptr<BlobReader> &reader) {
+    Lock lock;
+    std::unique_ptr<BlobReader> simpleReader;
+    esp_err_t err = handle->open_blob_reader(key, simpleReader);
+    if (err != ESP_OK) {
+        return err;
+    }
+    BlobReader *lockedReader = new (std::nothrow) NVSBlobReaderLocked(std::move(simpleReader));
+    if (!lockedReader) {
+        return ESP_ERR_NO_MEM;
+    }
+    reader.reset(lockedReader);
+    return ESP_OK;
+}
+
 esp_err_t NVSHandleLocked::set_typed_item(ItemType datatype, const char *key, const void* data, size_t dataSize) {
     Lock lock;
     return handle->set_typed_item(datatype, key, data, dataSize);
@@ -77,4 +107,27 @@ esp_err_t NVSHandleLocked::get_typed_item(ItemType datatype, const char *key, vo
     return handle->get_typed_item(datatype, key, data, dataSize);
 }
 
+NVSBlobReaderLocked::~NVSBlobReaderLocked() {
+    Lock lock;
+    reader.reset();
+}
+
+esp_err_t NVSBlobReaderLocked::read(void *out_data, size_t &len) {
+    Lock lock;
+    return reader->read(out_data, len);
+}
+
+esp_err_t NVSBlobReaderLocked::seek(size_t offset) {
+    Lock lock;
+    return reader->seek(offset);
+}
+
+size_t NVSBlobReaderLocked::tell() const {
+    return reader->tell();
+}
+
+size_t NVSBlobReaderLocked::size() const {
+    return reader->size();
+}
+
 } // namespace nvs
@@ -55,8 +55,16 @@ public:
 
     esp_err_t commit() override;
 
+    esp_err_t transaction_begin() override;
+
+    esp_err_t transaction_commit() override;
+
+    esp_err_t transaction_abort() override;
+
     esp_err_t get_used_entry_count(size_t& usedEntries) override;
 
+    esp_err_t open_blob_reader(const char *key, std::unique_ptr<BlobReader> &reader) override;
+
 protected:
     esp_err_t set_typed_item(ItemType datatype, const char *key, const void* data, size_t dataSize) override;
 
@@ -66,6 +74,27 @@ private:
     NVSHandleSimple *handle;
 };
 
+/**
+ * @brief A BlobReader which locks all public member functions of the reader it decorates, see NVSHandleLocked.
+ */
+class NVSBlobReaderLocked : public BlobReader {
+public:
+    NVSBlobReaderLocked(std::unique_ptr<BlobReader> reader) : reader(std::move(reader)) { }
+
+    virtual ~NVSBlobReaderLocked();
+
+    esp_err_t read(void *out_data, size_t &len) override;
+
+    esp_err_t seek(size_t offset) override;
+
+    size_t tell() const override;
+
+    size_t size() const override;
+
+private:
+    std::unique_ptr<BlobReader> reader;
+};
+
 } // namespace nvs
 
 #endif // NVS_HANDLE_LOCKED_HPP_
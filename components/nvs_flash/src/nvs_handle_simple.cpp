@@ -18,13 +18,58 @@
 namespace nvs {
 
 NVSHandleSimple::~NVSHandleSimple() {
+    mPendingItems.clearAndFreeNodes();
     NVSPartitionManager::get_instance()->close_handle(this);
 }
 
+Storage::PendingItem *NVSHandleSimple::find_staged_item(ItemType datatype, const char *key)
+{
+    for (auto it = mPendingItems.begin(); it != mPendingItems.end(); ++it) {
+        if (it->datatype == datatype && strncmp(it->key, key, sizeof(it->key) - 1) == 0) {
+            return it;
+        }
+    }
+    return nullptr;
+}
+
+esp_err_t NVSHandleSimple::stage_item(ItemType datatype, const char *key, const void* data, size_t dataSize)
+{
+    if (strlen(key) > Item::MAX_KEY_LENGTH) {
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+    if (datatype != ItemType::BLOB && dataSize > Page::CHUNK_MAX_SIZE) {
+        return ESP_ERR_NVS_VALUE_TOO_LONG;
+    }
+
+    uint8_t *stagedData = new (std::nothrow) uint8_t[dataSize ? dataSize : 1];
+    if (!stagedData) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(stagedData, data, dataSize);
+
+    Storage::PendingItem *item = find_staged_item(datatype, key);
+    if (item == nullptr) {
+        item = new (std::nothrow) Storage::PendingItem;
+        if (!item) {
+            delete[] stagedData;
+            return ESP_ERR_NO_MEM;
+        }
+        strncpy(item->key, key, sizeof(item->key) - 1);
+        item->key[sizeof(item->key) - 1] = 0;
+        item->datatype = datatype;
+        mPendingItems.push_back(item);
+    }
+    delete[] item->data;
+    item->data = stagedData;
+    item->dataSize = dataSize;
+    return ESP_OK;
+}
+
 esp_err_t NVSHandleSimple::set_typed_item(ItemType datatype, const char *key, const void* data, size_t dataSize)
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mInTransaction) return stage_item(datatype, key, data, dataSize);
 
     return mStoragePtr->writeItem(mNsIndex, datatype, key, data, dataSize);
 }
@@ -33,6 +78,15 @@ esp_err_t NVSHandleSimple::get_typed_item(ItemType datatype, const char *key, vo
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
 
+    if (mInTransaction) {
+        Storage::PendingItem *item = find_staged_item(datatype, key);
+        if (item != nullptr) {
+            if (dataSize < item->dataSize) return ESP_ERR_NVS_INVALID_LENGTH;
+            memcpy(data, item->data, item->dataSize);
+            return ESP_OK;
+        }
+    }
+
     return mStoragePtr->readItem(mNsIndex, datatype, key, data, dataSize);
 }
 
@@ -40,6 +94,7 @@ esp_err_t NVSHandleSimple::set_string(const char *key, const char* str)
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mInTransaction) return stage_item(nvs::ItemType::SZ, key, str, strlen(str) + 1);
 
     return mStoragePtr->writeItem(mNsIndex, nvs::ItemType::SZ, key, str, strlen(str) + 1);
 }
@@ -48,6 +103,7 @@ esp_err_t NVSHandleSimple::set_blob(const char *key, const void* blob, size_t le
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mInTransaction) return stage_item(nvs::ItemType::BLOB, key, blob, len);
 
     return mStoragePtr->writeItem(mNsIndex, nvs::ItemType::BLOB, key, blob, len);
 }
@@ -55,6 +111,9 @@ esp_err_t NVSHandleSimple::set_blob(const char *key, const void* blob, size_t le
 esp_err_t NVSHandleSimple::get_string(const char *key, char* out_str, size_t len)
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (mInTransaction && find_staged_item(nvs::ItemType::SZ, key)) {
+        return get_typed_item(nvs::ItemType::SZ, key, out_str, len);
+    }
 
     return mStoragePtr->readItem(mNsIndex, nvs::ItemType::SZ, key, out_str, len);
 }
@@ -62,6 +121,9 @@ esp_err_t NVSHandleSimple::get_string(const char *key, char* out_str, size_t len
 esp_err_t NVSHandleSimple::get_blob(const char *key, void* out_blob, size_t len)
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (mInTransaction && find_staged_item(nvs::ItemType::BLOB, key)) {
+        return get_typed_item(nvs::ItemType::BLOB, key, out_blob, len);
+    }
 
     return mStoragePtr->readItem(mNsIndex, nvs::ItemType::BLOB, key, out_blob, len);
 }
@@ -70,13 +132,64 @@ esp_err_t NVSHandleSimple::get_item_size(ItemType datatype, const char *key, siz
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
 
+    if (mInTransaction) {
+        Storage::PendingItem *item = find_staged_item(datatype, key);
+        if (item != nullptr) {
+            size = item->dataSize;
+            return ESP_OK;
+        }
+    }
+
     return mStoragePtr->getItemDataSize(mNsIndex, datatype, key, size);
 }
 
+esp_err_t NVSHandleSimple::open_blob_reader(const char *key, std::unique_ptr<BlobReader> &reader)
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+
+    std::unique_ptr<NVSBlobReaderSimple> blobReader(new (std::nothrow) NVSBlobReaderSimple(this));
+    if (!blobReader) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = open_blob(key, blobReader->mCursor);
+    if (err != ESP_OK) {
+        return err;
+    }
+    reader = std::move(blobReader);
+    return ESP_OK;
+}
+
+esp_err_t NVSHandleSimple::open_blob(const char *key, Storage::BlobCursor &cursor)
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (mInTransaction && find_staged_item(nvs::ItemType::BLOB, key)) return ESP_ERR_NVS_INVALID_STATE;
+
+    return mStoragePtr->openBlob(mNsIndex, key, cursor);
+}
+
+esp_err_t NVSHandleSimple::read_blob(Storage::BlobCursor &cursor, void *out_data, size_t &len)
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+
+    size_t readSize;
+    esp_err_t err = mStoragePtr->readBlob(cursor, out_data, len, readSize);
+    len = readSize;
+    return err;
+}
+
+esp_err_t NVSHandleSimple::seek_blob(Storage::BlobCursor &cursor, size_t offset)
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+
+    return mStoragePtr->seekBlob(cursor, offset);
+}
+
 esp_err_t NVSHandleSimple::erase_item(const char* key)
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mInTransaction) return ESP_ERR_NVS_INVALID_STATE;
 
     return mStoragePtr->eraseItem(mNsIndex, key);
 }
@@ -85,6 +198,7 @@ esp_err_t NVSHandleSimple::erase_all()
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
     if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mInTransaction) return ESP_ERR_NVS_INVALID_STATE;
 
     return mStoragePtr->eraseNamespace(mNsIndex);
 }
@@ -92,7 +206,39 @@ esp_err_t NVSHandleSimple::erase_all()
 esp_err_t NVSHandleSimple::commit()
 {
     if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (mInTransaction) return transaction_commit();
+
+    return ESP_OK;
+}
+
+esp_err_t NVSHandleSimple::transaction_begin()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (mReadOnly) return ESP_ERR_NVS_READ_ONLY;
+    if (mInTransaction) return ESP_ERR_NVS_INVALID_STATE;
+
+    mInTransaction = 1;
+    return ESP_OK;
+}
+
+esp_err_t NVSHandleSimple::transaction_commit()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mInTransaction) return ESP_ERR_NVS_INVALID_STATE;
+
+    esp_err_t err = mStoragePtr->writeItems(mNsIndex, mPendingItems);
+    mPendingItems.clearAndFreeNodes();
+    mInTransaction = 0;
+    return err;
+}
 
+esp_err_t NVSHandleSimple::transaction_abort()
+{
+    if (!valid) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!mInTransaction) return ESP_ERR_NVS_INVALID_STATE;
+
+    mPendingItems.clearAndFreeNodes();
+    mInTransaction = 0;
     return ESP_OK;
 }
 
@@ -134,4 +280,24 @@ const char *NVSHandleSimple::get_partition_name() const {
     return mStoragePtr->getPartName();
 }
 
+NVSBlobReaderSimple::~NVSBlobReaderSimple() {
+    Storage::closeBlob(mCursor);
+}
+
+esp_err_t NVSBlobReaderSimple::read(void *out_data, size_t &len) {
+    return mHandle->read_blob(mCursor, out_data, len);
+}
+
+esp_err_t NVSBlobReaderSimple::seek(size_t offset) {
+    return mHandle->seek_blob(mCursor, offset);
+}
+
+size_t NVSBlobReaderSimple::tell() const {
+    return mCursor.offset;
+}
+
+size_t NVSBlobReaderSimple::size() const {
+    return mCursor.size;
+}
+
 }
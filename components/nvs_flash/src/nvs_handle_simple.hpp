@@ -37,7 +37,8 @@ public:
         mStoragePtr(StoragePtr),
         mNsIndex(nsIndex),
         mReadOnly(readOnly),
-        valid(1)
+        valid(1),
+        mInTransaction(0)
     { }
 
     ~NVSHandleSimple();
@@ -62,8 +63,22 @@ public:
 
     esp_err_t commit() override;
 
+    esp_err_t transaction_begin() override;
+
+    esp_err_t transaction_commit() override;
+
+    esp_err_t transaction_abort() override;
+
     esp_err_t get_used_entry_count(size_t &usedEntries) override;
 
+    esp_err_t open_blob_reader(const char *key, std::unique_ptr<BlobReader> &reader) override;
+
+    esp_err_t open_blob(const char *key, Storage::BlobCursor &cursor);
+
+    esp_err_t read_blob(Storage::BlobCursor &cursor, void *out_data, size_t &len);
+
+    esp_err_t seek_blob(Storage::BlobCursor &cursor, size_t offset);
+
     esp_err_t getItemDataSize(ItemType datatype, const char *key, size_t &dataSize);
 
     void debugDump();
@@ -79,6 +94,10 @@ public:
     const char *get_partition_name() const;
 
 private:
+    esp_err_t stage_item(ItemType datatype, const char *key, const void *data, size_t dataSize);
+
+    Storage::PendingItem *find_staged_item(ItemType datatype, const char *key);
+
     /**
      * The underlying storage's object.
      */
@@ -100,6 +119,41 @@ private:
      * Upon opening, a handle is valid. It becomes invalid if the underlying storage is de-initialized.
      */
     uint8_t valid;
+
+    /**
+     * Whether set operations are currently staged in mPendingItems instead of being written to storage.
+     */
+    uint8_t mInTransaction;
+
+    /**
+     * Items staged by the active transaction.
+     */
+    Storage::TPendingItemList mPendingItems;
+};
+
+/**
+ * @brief BlobReader which reads through an NVSHandleSimple.
+ */
+class NVSBlobReaderSimple : public BlobReader {
+public:
+    NVSBlobReaderSimple(NVSHandleSimple *handle) : mHandle(handle) { }
+
+    ~NVSBlobReaderSimple();
+
+    esp_err_t read(void *out_data, size_t &len) override;
+
+    esp_err_t seek(size_t offset) override;
+
+    size_t tell() const override;
+
+    size_t size() const override;
+
+private:
+    NVSHandleSimple *mHandle;
+
+    Storage::BlobCursor mCursor;
+
+    friend class NVSHandleSimple;
 };
 
 } // nvs
@@ -0,0 +1,200 @@
+// Copyright 2015-2021 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nvs_item_cache.hpp"
+#include "nvs.h"
+#include "esp_rom_crc.h"
+#include <cstring>
+#include <new>
+#include <algorithm>
+
+namespace nvs
+{
+
+ItemCache::~ItemCache()
+{
+    mEntries.clearAndFreeNodes();
+    delete[] mBuckets;
+}
+
+void ItemCache::clear()
+{
+    mEntries.clearAndFreeNodes();
+    if (mBuckets) {
+        std::fill_n(mBuckets, mBucketCount, nullptr);
+    }
+    mUsedBytes = 0;
+}
+
+uint32_t ItemCache::keyHash(uint8_t nsIndex, const char* key)
+{
+    uint32_t hash = esp_rom_crc32_le(0xffffffff, &nsIndex, sizeof(nsIndex));
+    return esp_rom_crc32_le(hash, reinterpret_cast<const uint8_t*>(key), strnlen(key, Item::MAX_KEY_LENGTH));
+}
+
+bool ItemCache::initBuckets()
+{
+    if (mBuckets) {
+        return true;
+    }
+    size_t count = 1;
+    while (count * 2 < mCapacity / entryCost(0)) {
+        count *= 2;
+    }
+    mBuckets = new (std::nothrow) CacheEntry*[count]();
+    if (!mBuckets) {
+        return false;
+    }
+    mBucketCount = count;
+    return true;
+}
+
+ItemCache::CacheEntry* ItemCache::find(uint8_t nsIndex, ItemType datatype, const char* key)
+{
+    if (!mBuckets) {
+        return nullptr;
+    }
+    uint32_t hash = keyHash(nsIndex, key);
+    for (CacheEntry* entry = *bucket(hash); entry != nullptr; entry = entry->mHashNext) {
+        if (entry->mHash == hash && entry->mNsIndex == nsIndex && entry->mDatatype == datatype
+                && strncmp(entry->mKey, key, Item::MAX_KEY_LENGTH) == 0) {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+void ItemCache::remove(CacheEntry* entry)
+{
+    CacheEntry** next = bucket(entry->mHash);
+    while (*next != entry) {
+        next = &(*next)->mHashNext;
+    }
+    *next = entry->mHashNext;
+    mUsedBytes -= entryCost(entry->mDataSize);
+    mEntries.erase(entry);
+    delete entry;
+}
+
+esp_err_t ItemCache::read(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize)
+{
+    if (mCapacity == 0) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    CacheEntry* entry = find(nsIndex, datatype, key);
+    if (entry == nullptr) {
+        ++mMisses;
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    ++mHits;
+
+    if (entry != &mEntries.front()) {
+        mEntries.erase(entry);
+        mEntries.push_front(entry);
+    }
+
+    if (dataSize < entry->mDataSize) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(data, entry->mData, entry->mDataSize);
+    return ESP_OK;
+}
+
+esp_err_t ItemCache::getSize(uint8_t nsIndex, ItemType datatype, const char* key, size_t& dataSize)
+{
+    CacheEntry* entry = find(nsIndex, datatype, key);
+    if (entry == nullptr) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    dataSize = entry->mDataSize;
+    return ESP_OK;
+}
+
+void ItemCache::insert(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize)
+{
+    CacheEntry* entry = find(nsIndex, datatype, key);
+    if (entry != nullptr) {
+        if (entry->mDataSize == dataSize) {
+            memcpy(entry->mData, data, dataSize);
+            if (entry != &mEntries.front()) {
+                mEntries.erase(entry);
+                mEntries.push_front(entry);
+            }
+            return;
+        }
+        remove(entry);
+    }
+
+    const size_t cost = entryCost(dataSize);
+    if (cost > mCapacity || !initBuckets()) {
+        return;
+    }
+    while (mUsedBytes + cost > mCapacity) {
+        remove(&mEntries.back());
+    }
+
+    entry = new (std::nothrow) CacheEntry;
+    if (!entry) {
+        return;
+    }
+    entry->mData = new (std::nothrow) uint8_t[dataSize ? dataSize : 1];
+    if (!entry->mData) {
+        delete entry;
+        return;
+    }
+    strncpy(entry->mKey, key, sizeof(entry->mKey) - 1);
+    entry->mKey[sizeof(entry->mKey) - 1] = 0;
+    entry->mHash = keyHash(nsIndex, key);
+    entry->mNsIndex = nsIndex;
+    entry->mDatatype = datatype;
+    entry->mDataSize = dataSize;
+    memcpy(entry->mData, data, dataSize);
+    CacheEntry** head = bucket(entry->mHash);
+    entry->mHashNext = *head;
+    *head = entry;
+    mEntries.push_front(entry);
+    mUsedBytes += cost;
+}
+
+void ItemCache::erase(uint8_t nsIndex, ItemType datatype, const char* key)
+{
+    if (!mBuckets) {
+        return;
+    }
+    uint32_t hash = keyHash(nsIndex, key);
+    CacheEntry* entry = *bucket(hash);
+    while (entry != nullptr) {
+        CacheEntry* next = entry->mHashNext;
+        if (entry->mHash == hash && entry->mNsIndex == nsIndex
+                && (datatype == ItemType::ANY || entry->mDatatype == datatype)
+                && strncmp(entry->mKey, key, Item::MAX_KEY_LENGTH) == 0) {
+            remove(entry);
+        }
+        entry = next;
+    }
+}
+
+void ItemCache::eraseNamespace(uint8_t nsIndex)
+{
+    auto it = mEntries.begin();
+    while (it != mEntries.end()) {
+        CacheEntry* entry = it++;
+        if (entry->mNsIndex == nsIndex) {
+            remove(entry);
+        }
+    }
+}
+
+} // namespace nvs
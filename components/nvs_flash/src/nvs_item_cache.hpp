@@ -0,0 +1,148 @@
+// Copyright 2015-2021 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef nvs_item_cache_hpp
+#define nvs_item_cache_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_err.h"
+#include "nvs_types.hpp"
+#include "intrusive_list.h"
+
+namespace nvs
+{
+
+/**
+ * RAM cache of decoded values of primitive and string items, evicted in least recently used order.
+ *
+ * The cache doesn't touch flash: Storage fills it after reading an item and has to invalidate entries
+ * whenever the corresponding item is written or erased. The memory used by the entries, including
+ * their bookkeeping, is kept below the capacity given on construction. A capacity of 0 disables the cache.
+ *
+ * Entries are found through a hash table of namespace index and key, so the cost of a lookup doesn't grow with
+ * the number of cached values. The table is allocated with the first entry, with one bucket for every two
+ * entries which fit into the capacity, and is not counted in the capacity.
+ */
+class ItemCache
+{
+public:
+    ItemCache(size_t capacity) : mCapacity(capacity) { }
+    ~ItemCache();
+
+    /**
+     * Copies the cached value of the item into data.
+     * Returns ESP_ERR_NVS_NOT_FOUND if the item isn't cached, ESP_ERR_NVS_INVALID_LENGTH if dataSize
+     * is too small for the value. Lookups are counted as hits or misses.
+     */
+    esp_err_t read(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize);
+
+    /**
+     * Same as read, but only returns the size of the cached value. Lookups are not counted.
+     */
+    esp_err_t getSize(uint8_t nsIndex, ItemType datatype, const char* key, size_t& dataSize);
+
+    /**
+     * Adds or replaces the value of the item, evicting the least recently used values if necessary.
+     * Values which don't fit into the cache are silently dropped.
+     */
+    void insert(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize);
+
+    /**
+     * Drops the cached value of the item. ItemType::ANY drops the values of all types stored under key.
+     */
+    void erase(uint8_t nsIndex, ItemType datatype, const char* key);
+
+    void eraseNamespace(uint8_t nsIndex);
+
+    void clear();
+
+    size_t hits() const
+    {
+        return mHits;
+    }
+
+    size_t misses() const
+    {
+        return mMisses;
+    }
+
+    size_t usedBytes() const
+    {
+        return mUsedBytes;
+    }
+
+    size_t capacity() const
+    {
+        return mCapacity;
+    }
+
+private:
+    ItemCache(const ItemCache& other);
+    const ItemCache& operator= (const ItemCache& rhs);
+
+protected:
+    struct CacheEntry : public intrusive_list_node<CacheEntry> {
+    public:
+        ~CacheEntry()
+        {
+            delete[] mData;
+        }
+
+        char mKey[Item::MAX_KEY_LENGTH + 1];
+        CacheEntry* mHashNext;  // next entry in the same hash bucket
+        uint32_t mHash;         // hash of namespace index and key, see keyHash
+        uint8_t mNsIndex;
+        ItemType mDatatype;
+        size_t mDataSize;
+        uint8_t* mData = nullptr;
+    };
+
+    typedef intrusive_list<CacheEntry> TEntryList;
+
+    static size_t entryCost(size_t dataSize)
+    {
+        return sizeof(CacheEntry) + dataSize;
+    }
+
+    /**
+     * Hash of namespace index and key. The type isn't hashed, so that all types stored under a key are in
+     * the same bucket.
+     */
+    static uint32_t keyHash(uint8_t nsIndex, const char* key);
+
+    CacheEntry** bucket(uint32_t hash)
+    {
+        return &mBuckets[hash & (mBucketCount - 1)];
+    }
+
+    bool initBuckets();
+
+    CacheEntry* find(uint8_t nsIndex, ItemType datatype, const char* key);
+
+    void remove(CacheEntry* entry);
+
+    // most recently used entries first
+    TEntryList mEntries;
+    CacheEntry** mBuckets = nullptr;
+    size_t mBucketCount = 0;
+    size_t mCapacity;
+    size_t mUsedBytes = 0;
+    size_t mHits = 0;
+    size_t mMisses = 0;
+}; // class ItemCache
+
+} // namespace nvs
+
+#endif /* nvs_item_cache_hpp */
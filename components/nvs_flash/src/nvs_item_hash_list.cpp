@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "nvs_item_hash_list.hpp"
+#include <new>
 
 namespace nvs
 {
@@ -21,14 +22,26 @@ HashList::HashList()
 {
 }
 
+void HashList::setItemIndex(ItemIndex* itemIndex, Page* owner)
+{
+    assert(mSize == 0);
+    mItemIndex = itemIndex;
+    mOwner = owner;
+}
+
 void HashList::clear()
 {
-    for (auto it = mBlockList.begin(); it != mBlockList.end();) {
-        auto tmp = it;
-        ++it;
-        mBlockList.erase(tmp);
-        delete static_cast<HashListBlock*>(tmp);
+    if (mItemIndex) {
+        for (size_t i = 0; i < mCapacity; ++i) {
+            if (!isEmpty(mNodes[i])) {
+                mItemIndex->erase(mNodes[i].mHash, mOwner);
+            }
+        }
     }
+    delete[] mNodes;
+    mNodes = nullptr;
+    mCapacity = 0;
+    mSize = 0;
 }
 
 HashList::~HashList()
@@ -36,87 +49,134 @@ HashList::~HashList()
     clear();
 }
 
-HashList::HashListBlock::HashListBlock()
+size_t HashList::capacityFor(size_t itemCount)
+{
+    size_t capacity = MIN_CAPACITY;
+    while (itemCount * 4 > capacity * 3 && capacity < MAX_CAPACITY) {
+        capacity *= 2;
+    }
+    return (capacity < MAX_CAPACITY) ? capacity : MAX_CAPACITY;
+}
+
+esp_err_t HashList::resize(size_t capacity)
 {
-    static_assert(sizeof(HashListBlock) == HashListBlock::BYTE_SIZE,
-                  "cache block size calculation incorrect");
+    HashListNode* newNodes = new (std::nothrow) HashListNode[capacity];
+    if (!newNodes) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    HashListNode* oldNodes = mNodes;
+    size_t oldCapacity = mCapacity;
+    mNodes = newNodes;
+    mCapacity = capacity;
+
+    // re-insert in slot order, the relative order of nodes with the same hash doesn't matter for find()
+    for (size_t i = 0; i < oldCapacity; ++i) {
+        if (isEmpty(oldNodes[i])) {
+            continue;
+        }
+        size_t slot = homeSlot(oldNodes[i].mHash);
+        while (!isEmpty(mNodes[slot])) {
+            slot = nextSlot(slot);
+        }
+        mNodes[slot] = oldNodes[i];
+    }
+    delete[] oldNodes;
+    return ESP_OK;
 }
 
 esp_err_t HashList::insert(const Item& item, size_t index)
 {
+    assert(index < 0xff);
     const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
-    // add entry to the end of last block if possible
-    if (mBlockList.size()) {
-        auto& block = mBlockList.back();
-        if (block.mCount < HashListBlock::ENTRY_COUNT) {
-            block.mNodes[block.mCount++] = HashListNode(hash_24, index);
-            return ESP_OK;
+
+    if ((mSize + 1) * 4 > mCapacity * 3 && mCapacity < MAX_CAPACITY) {
+        esp_err_t err = resize(capacityFor(mSize + 1));
+        if (err != ESP_OK) {
+            return err;
         }
     }
-    // if the above failed, create a new block and add entry to it
-    HashListBlock* newBlock = new (std::nothrow) HashListBlock;
+    // at least one slot must stay empty to terminate the probe sequences
+    if (mSize + 1 >= mCapacity) {
+        return ESP_ERR_NO_MEM;
+    }
 
-    if (!newBlock) return ESP_ERR_NO_MEM;
+    if (mItemIndex) {
+        esp_err_t err = mItemIndex->insert(hash_24, mOwner);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
 
-    mBlockList.push_back(newBlock);
-    newBlock->mNodes[0] = HashListNode(hash_24, index);
-    newBlock->mCount++;
+    size_t slot = homeSlot(hash_24);
+    while (!isEmpty(mNodes[slot])) {
+        slot = nextSlot(slot);
+    }
+    mNodes[slot] = HashListNode(hash_24, index);
+    ++mSize;
 
     return ESP_OK;
 }
 
+void HashList::eraseSlot(size_t slot)
+{
+    // Backward shift deletion: move following nodes of the cluster into the hole
+    // if their home slot doesn't lie cyclically between the hole and their current position.
+    mNodes[slot] = HashListNode();
+    --mSize;
+    size_t hole = slot;
+    size_t next = nextSlot(hole);
+    while (!isEmpty(mNodes[next])) {
+        size_t home = homeSlot(mNodes[next].mHash);
+        bool canMove = (hole <= next) ? (home <= hole || home > next) : (home <= hole && home > next);
+        if (canMove) {
+            mNodes[hole] = mNodes[next];
+            mNodes[next] = HashListNode();
+            hole = next;
+        }
+        next = nextSlot(next);
+    }
+}
+
 bool HashList::erase(size_t index)
 {
-    for (auto it = mBlockList.begin(); it != mBlockList.end();) {
-        bool haveEntries = false;
-        bool foundIndex = false;
-        for (size_t i = 0; i < it->mCount; ++i) {
-            if (it->mNodes[i].mIndex == index) {
-                it->mNodes[i].mIndex = 0xff;
-                foundIndex = true;
-                /* found the item and removed it */
-            }
-            if (it->mNodes[i].mIndex != 0xff) {
-                haveEntries = true;
-            }
-            if (haveEntries && foundIndex) {
-                /* item was found, and HashListBlock still has some items */
-                return true;
-            }
+    // Entries are erased by index only, so this is a linear pass over the table.
+    // It is cheap compared to the flash write which goes along with erasing an entry.
+    for (size_t slot = 0; slot < mCapacity; ++slot) {
+        if (mNodes[slot].mIndex != index || isEmpty(mNodes[slot])) {
+            continue;
         }
-        /* no items left in HashListBlock, can remove */
-        if (!haveEntries) {
-            auto tmp = it;
-            ++it;
-            mBlockList.erase(tmp);
-            delete static_cast<HashListBlock*>(tmp);
-        } else {
-            ++it;
+        if (mItemIndex) {
+            mItemIndex->erase(mNodes[slot].mHash, mOwner);
         }
-        if (foundIndex) {
-            /* item was found and empty HashListBlock was removed */
-            return true;
+        eraseSlot(slot);
+        if (mSize == 0) {
+            // release the table as soon as the page holds no more items
+            clear();
         }
+        return true;
     }
 
-    // item hasn't been present in cache");
+    // item hasn't been present in cache
     return false;
 }
 
 size_t HashList::find(size_t start, const Item& item)
 {
+    if (mSize == 0) {
+        return SIZE_MAX;
+    }
     const uint32_t hash_24 = item.calculateCrc32WithoutValue() & 0xffffff;
-    for (auto it = mBlockList.begin(); it != mBlockList.end(); ++it) {
-        for (size_t index = 0; index < it->mCount; ++index) {
-            HashListNode& e = it->mNodes[index];
-            if (e.mIndex >= start &&
-                    e.mHash == hash_24 &&
-                    e.mIndex != 0xff) {
-                return e.mIndex;
-            }
+
+    // several items may share a hash, return the first one at or after start
+    size_t result = SIZE_MAX;
+    for (size_t slot = homeSlot(hash_24); !isEmpty(mNodes[slot]); slot = nextSlot(slot)) {
+        const HashListNode& e = mNodes[slot];
+        if (e.mHash == hash_24 && e.mIndex >= start && e.mIndex < result) {
+            result = e.mIndex;
         }
     }
-    return SIZE_MAX;
+    return result;
 }
 
 
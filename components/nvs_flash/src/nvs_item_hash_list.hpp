@@ -17,11 +17,18 @@
 
 #include "nvs.h"
 #include "nvs_types.hpp"
-#include "intrusive_list.h"
+#include "nvs_item_index.hpp"
 
 namespace nvs
 {
 
+/**
+ * Hashes of namespace index, key and chunk index of the items in a page, mapped to the index of their first entry.
+ *
+ * The nodes are kept in one contiguous open addressing table with linear probing, so a lookup only checks
+ * the few nodes following the home slot of the hash. The table grows by doubling up to MAX_CAPACITY, which is
+ * enough for a page full of single entry items, and is freed once the last item has been erased.
+ */
 class HashList
 {
 public:
@@ -33,6 +40,17 @@ public:
     size_t find(size_t start, const Item& item);
     void clear();
 
+    /**
+     * Mirrors all hashes of this list into the given storage-wide index, on behalf of the given page.
+     * Must be called while the list is still empty.
+     */
+    void setItemIndex(ItemIndex* itemIndex, Page* owner);
+
+    /**
+     * Maximum number of items, equal to the number of entries in a page.
+     */
+    static const size_t MAX_ITEM_COUNT = 126;
+
 private:
     HashList(const HashList& other);
     const HashList& operator= (const HashList& rhs);
@@ -54,18 +72,39 @@ protected:
         uint32_t mHash  : 24;
     };
 
-    struct HashListBlock : public intrusive_list_node<HashList::HashListBlock> {
-        HashListBlock();
+    // 128 bytes, enough for pages which mostly hold strings and blobs
+    static const size_t MIN_CAPACITY = 32;
+    // keeps the load factor at or below 3/4 for a full page
+    static const size_t MAX_CAPACITY = (MAX_ITEM_COUNT * 4 + 2) / 3;
 
-        static const size_t BYTE_SIZE = 128;
-        static const size_t ENTRY_COUNT = (BYTE_SIZE - sizeof(intrusive_list_node<HashListBlock>) - sizeof(size_t)) / 4;
+    static bool isEmpty(const HashListNode& node)
+    {
+        return node.mIndex == 0xff;
+    }
 
-        size_t mCount = 0;
-        HashListNode mNodes[ENTRY_COUNT];
-    };
+    size_t homeSlot(uint32_t hash) const
+    {
+        // maps the 24 bit hash onto [0, mCapacity) without a division
+        return (static_cast<size_t>(hash) * mCapacity) >> 24;
+    }
+
+    size_t nextSlot(size_t slot) const
+    {
+        return (slot + 1 == mCapacity) ? 0 : slot + 1;
+    }
+
+    static size_t capacityFor(size_t itemCount);
+
+    esp_err_t resize(size_t capacity);
+
+    void eraseSlot(size_t slot);
+
+    HashListNode* mNodes = nullptr;
+    uint16_t mCapacity = 0;
+    uint16_t mSize = 0;
 
-    typedef intrusive_list<HashListBlock> TBlockList;
-    TBlockList mBlockList;
+    ItemIndex* mItemIndex = nullptr;
+    Page* mOwner = nullptr;
 }; // class HashList
 
 } // namespace nvs
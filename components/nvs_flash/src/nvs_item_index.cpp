@@ -0,0 +1,159 @@
+// Copyright 2015-2021 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "nvs_item_index.hpp"
+#include <cassert>
+#include <new>
+
+namespace nvs
+{
+
+ItemIndex::ItemIndex()
+{
+}
+
+ItemIndex::~ItemIndex()
+{
+    delete[] mNodes;
+}
+
+void ItemIndex::clear()
+{
+    delete[] mNodes;
+    mNodes = nullptr;
+    mCapacity = 0;
+    mSize = 0;
+}
+
+esp_err_t ItemIndex::grow()
+{
+    size_t newCapacity = (mCapacity == 0) ? MIN_CAPACITY : mCapacity * 2;
+    IndexNode* newNodes = new (std::nothrow) IndexNode[newCapacity];
+    if (!newNodes) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (size_t i = 0; i < newCapacity; ++i) {
+        newNodes[i].mPage = nullptr;
+    }
+
+    IndexNode* oldNodes = mNodes;
+    size_t oldCapacity = mCapacity;
+    mNodes = newNodes;
+    mCapacity = newCapacity;
+
+    // Node counts stay the same, only the slots change
+    for (size_t i = 0; i < oldCapacity; ++i) {
+        if (oldNodes[i].mPage == nullptr) {
+            continue;
+        }
+        size_t slot = homeSlot(oldNodes[i].mHash);
+        while (mNodes[slot].mPage != nullptr) {
+            slot = (slot + 1) & (mCapacity - 1);
+        }
+        mNodes[slot] = oldNodes[i];
+    }
+    delete[] oldNodes;
+    return ESP_OK;
+}
+
+esp_err_t ItemIndex::insert(uint32_t hash, Page* page)
+{
+    assert(page != nullptr);
+    hash &= 0xffffff;
+
+    // keep the load factor below 3/4 so that probe sequences stay short
+    if ((mSize + 1) * 4 > mCapacity * 3) {
+        esp_err_t err = grow();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    size_t slot = homeSlot(hash);
+    while (mNodes[slot].mPage != nullptr) {
+        if (mNodes[slot].mHash == hash && mNodes[slot].mPage == page) {
+            ++mNodes[slot].mCount;
+            return ESP_OK;
+        }
+        slot = (slot + 1) & (mCapacity - 1);
+    }
+
+    mNodes[slot].mHash = hash;
+    mNodes[slot].mCount = 1;
+    mNodes[slot].mPage = page;
+    ++mSize;
+    return ESP_OK;
+}
+
+void ItemIndex::erase(uint32_t hash, Page* page)
+{
+    if (mSize == 0) {
+        return;
+    }
+    hash &= 0xffffff;
+
+    size_t slot = homeSlot(hash);
+    while (mNodes[slot].mPage != nullptr) {
+        if (mNodes[slot].mHash == hash && mNodes[slot].mPage == page) {
+            break;
+        }
+        slot = (slot + 1) & (mCapacity - 1);
+    }
+    if (mNodes[slot].mPage == nullptr) {
+        return;
+    }
+    if (--mNodes[slot].mCount > 0) {
+        return;
+    }
+
+    // Backward shift deletion: move following nodes of the cluster into the hole
+    // if their home slot doesn't lie cyclically between the hole and their current position.
+    mNodes[slot].mPage = nullptr;
+    --mSize;
+    size_t hole = slot;
+    size_t next = (hole + 1) & (mCapacity - 1);
+    while (mNodes[next].mPage != nullptr) {
+        size_t home = homeSlot(mNodes[next].mHash);
+        bool canMove = (hole <= next) ? (home <= hole || home > next) : (home <= hole && home > next);
+        if (canMove) {
+            mNodes[hole] = mNodes[next];
+            mNodes[next].mPage = nullptr;
+            hole = next;
+        }
+        next = (next + 1) & (mCapacity - 1);
+    }
+}
+
+size_t ItemIndex::find(uint32_t hash, Page** pages, size_t maxPages) const
+{
+    if (mSize == 0) {
+        return 0;
+    }
+    hash &= 0xffffff;
+
+    size_t found = 0;
+    size_t slot = homeSlot(hash);
+    while (mNodes[slot].mPage != nullptr) {
+        if (mNodes[slot].mHash == hash) {
+            if (found < maxPages) {
+                pages[found] = mNodes[slot].mPage;
+            }
+            ++found;
+        }
+        slot = (slot + 1) & (mCapacity - 1);
+    }
+    return found;
+}
+
+} // namespace nvs
@@ -0,0 +1,90 @@
+// Copyright 2015-2021 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef nvs_item_index_hpp
+#define nvs_item_index_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include "esp_err.h"
+
+namespace nvs
+{
+
+class Page;
+
+/**
+ * Storage-wide index which maps the 24-bit item hash used by HashList (namespace index, key and chunk index)
+ * to the pages holding items with this hash.
+ *
+ * The index is kept up to date by the per-page HashLists: every hash inserted into or erased from a HashList
+ * attached to the index is mirrored here, together with the number of items in that page sharing the hash.
+ * Hence the set of pages returned by find() is always a superset of the pages which hold a matching item,
+ * and a storage-wide lookup only needs to search those pages instead of the whole page list.
+ */
+class ItemIndex
+{
+public:
+    ItemIndex();
+    ~ItemIndex();
+
+    esp_err_t insert(uint32_t hash, Page* page);
+    void erase(uint32_t hash, Page* page);
+
+    /**
+     * Stores up to maxPages pages which may contain an item with the given hash into pages.
+     * Returns the total number of candidate pages, which may be larger than maxPages.
+     */
+    size_t find(uint32_t hash, Page** pages, size_t maxPages) const;
+
+    void clear();
+
+    size_t size() const
+    {
+        return mSize;
+    }
+
+    size_t capacity() const
+    {
+        return mCapacity;
+    }
+
+private:
+    ItemIndex(const ItemIndex& other);
+    const ItemIndex& operator= (const ItemIndex& rhs);
+
+protected:
+    struct IndexNode {
+        uint32_t mHash  : 24;
+        uint32_t mCount : 8;
+        Page* mPage;
+    };
+
+    static const size_t MIN_CAPACITY = 64;
+
+    size_t homeSlot(uint32_t hash) const
+    {
+        return hash & (mCapacity - 1);
+    }
+
+    esp_err_t grow();
+
+    IndexNode* mNodes = nullptr;
+    size_t mCapacity = 0;
+    size_t mSize = 0;
+}; // class ItemIndex
+
+} // namespace nvs
+
+#endif /* nvs_item_index_hpp */
@@ -15,6 +15,7 @@
 #include <esp_rom_crc.h>
 #include <cstdio>
 #include <cstring>
+#include <memory>
 
 namespace nvs
 {
@@ -266,6 +267,80 @@ esp_err_t Page::writeItem(uint8_t nsIndex, ItemType datatype, const char* key, c
     return ESP_OK;
 }
 
+size_t Page::getItemSpan(ItemType datatype, size_t dataSize)
+{
+    if (!isVariableLengthType(datatype)) {
+        return 1;
+    }
+    return 1 + (dataSize + ENTRY_SIZE - 1) / ENTRY_SIZE;
+}
+
+void Page::encodeItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize, Item* entries)
+{
+    const size_t span = getItemSpan(datatype, dataSize);
+    Item& item = entries[0];
+    item = Item(nsIndex, datatype, span, key);
+
+    if (!isVariableLengthType(datatype)) {
+        memcpy(item.data, data, dataSize);
+        item.crc32 = item.calculateCrc32();
+        return;
+    }
+
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(data);
+    item.varLength.dataCrc32 = Item::calculateCrc32(src, dataSize);
+    item.varLength.dataSize = dataSize;
+    item.varLength.reserved = 0xffff;
+    item.crc32 = item.calculateCrc32();
+
+    size_t left = dataSize / ENTRY_SIZE * ENTRY_SIZE;
+    memcpy(reinterpret_cast<uint8_t*>(entries + 1), src, left);
+    size_t tail = dataSize - left;
+    if (tail > 0) {
+        Item& last = entries[span - 1];
+        std::fill_n(last.rawData, ENTRY_SIZE, 0xff);
+        memcpy(last.rawData, src + left, tail);
+    }
+}
+
+esp_err_t Page::writeEntries(const Item* entries, size_t count)
+{
+    esp_err_t err;
+
+    if (mState == PageState::INVALID) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    if (mState == PageState::UNINITIALIZED) {
+        err = initialize();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    if (mState == PageState::FULL) {
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
+
+    if (mNextFreeEntry == INVALID_ENTRY || mNextFreeEntry + count > ENTRY_COUNT) {
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
+
+    for (size_t i = 0; i < count; i += entries[i].span) {
+        assert(entries[i].span > 0 && i + entries[i].span <= count);
+        err = mHashList.insert(entries[i], mNextFreeEntry + i);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    if (mFirstUsedEntry == INVALID_ENTRY) {
+        mFirstUsedEntry = mNextFreeEntry;
+    }
+
+    return writeEntryData(reinterpret_cast<const uint8_t*>(entries), count * ENTRY_SIZE);
+}
+
 esp_err_t Page::readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize, uint8_t chunkIdx, VerOffset chunkStart)
 {
     size_t index = 0;
@@ -317,6 +392,38 @@ esp_err_t Page::readItem(uint8_t nsIndex, ItemType datatype, const char* key, vo
     return ESP_OK;
 }
 
+esp_err_t Page::readItemData(size_t index, size_t offset, void* data, size_t size) const
+{
+    uint8_t* dst = static_cast<uint8_t*>(data);
+    size_t entry = index + 1 + offset / ENTRY_SIZE;
+    size_t skip = offset % ENTRY_SIZE;
+
+    while (size > 0) {
+        size_t willCopy;
+        if (skip == 0 && size >= ENTRY_SIZE) {
+            willCopy = size - size % ENTRY_SIZE;
+            auto rc = mPartition->read(getEntryAddress(entry), dst, willCopy);
+            if (rc != ESP_OK) {
+                return rc;
+            }
+        } else {
+            Item ditem;
+            auto rc = readEntry(entry, ditem);
+            if (rc != ESP_OK) {
+                return rc;
+            }
+            willCopy = ENTRY_SIZE - skip;
+            willCopy = (size < willCopy)?size:willCopy;
+            memcpy(dst, ditem.rawData + skip, willCopy);
+        }
+        entry += (skip + willCopy + ENTRY_SIZE - 1) / ENTRY_SIZE;
+        skip = 0;
+        dst += willCopy;
+        size -= willCopy;
+    }
+    return ESP_OK;
+}
+
 esp_err_t Page::cmpItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize, uint8_t chunkIdx, VerOffset chunkStart)
 {
     size_t index = 0;
@@ -529,6 +636,11 @@ esp_err_t Page::mLoadEntryTable()
         }
     }
 
+    // Item headers are read in blocks, few large flash reads are much faster than many small ones.
+    // Without a block, readEntryBlock falls back to reading the entries one by one.
+    std::unique_ptr<Item[]> block(new (std::nothrow) Item[LOAD_BLOCK_ENTRIES]);
+    size_t blockStart = INVALID_ENTRY;
+
     mErasedEntryCount = 0;
     mUsedEntryCount = 0;
     for (size_t i = 0; i < ENTRY_COUNT; ++i) {
@@ -610,7 +722,7 @@ esp_err_t Page::mLoadEntryTable()
 
             lastItemIndex = i;
 
-            auto err = readEntry(i, item);
+            auto err = readEntryBlock(i, item, block.get(), blockStart);
             if (err != ESP_OK) {
                 mState = PageState::INVALID;
                 return err;
@@ -682,7 +794,7 @@ esp_err_t Page::mLoadEntryTable()
                 continue;
             }
 
-            auto err = readEntry(i, item);
+            auto err = readEntryBlock(i, item, block.get(), blockStart);
             if (err != ESP_OK) {
                 mState = PageState::INVALID;
                 return err;
@@ -808,6 +920,24 @@ esp_err_t Page::readEntry(size_t index, Item& dst) const
     return ESP_OK;
 }
 
+esp_err_t Page::readEntryBlock(size_t index, Item& dst, Item* block, size_t& blockStart) const
+{
+    if (block == nullptr) {
+        return readEntry(index, dst);
+    }
+    if (blockStart == INVALID_ENTRY || index < blockStart || index >= blockStart + LOAD_BLOCK_ENTRIES) {
+        size_t count = std::min(size_t(LOAD_BLOCK_ENTRIES), ENTRY_COUNT - index);
+        auto rc = mPartition->read(getEntryAddress(index), block, count * ENTRY_SIZE);
+        if (rc != ESP_OK) {
+            blockStart = INVALID_ENTRY;
+            return rc;
+        }
+        blockStart = index;
+    }
+    dst = block[index - blockStart];
+    return ESP_OK;
+}
+
 esp_err_t Page::findItem(uint8_t nsIndex, ItemType datatype, const char* key, size_t &itemIndex, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
 {
     if (mState == PageState::CORRUPT || mState == PageState::INVALID || mState == PageState::UNINITIALIZED) {
@@ -979,6 +1109,16 @@ size_t Page::getVarDataTailroom() const
     return ((mNextFreeEntry < (ENTRY_COUNT-1)) ? ((ENTRY_COUNT - mNextFreeEntry - 1) * ENTRY_SIZE): 0);
 }
 
+size_t Page::getFreeEntryCount() const
+{
+    if (mState == PageState::UNINITIALIZED) {
+        return ENTRY_COUNT;
+    } else if (mState != PageState::ACTIVE || mNextFreeEntry >= ENTRY_COUNT) {
+        return 0;
+    }
+    return ENTRY_COUNT - mNextFreeEntry;
+}
+
 const char* Page::pageStateToName(PageState ps)
 {
     switch (ps) {
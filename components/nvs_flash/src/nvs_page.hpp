@@ -95,8 +95,21 @@ public:
 
     esp_err_t writeItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize, uint8_t chunkIdx = CHUNK_ANY);
 
+    /**
+     * Writes a sequence of complete items, encoded with encodeItem(), using a single flash write for the entries
+     * and a single update of the entry state table.
+     * Returns ESP_ERR_NVS_PAGE_FULL if the page can't hold all the entries.
+     */
+    esp_err_t writeEntries(const Item* entries, size_t count);
+
     esp_err_t readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    /**
+     * Reads size bytes at offset within the data of the variable length item whose header is the entry at index,
+     * as returned by findItem(). Whole entries are read directly into data. The CRC of the data is not checked.
+     */
+    esp_err_t readItemData(size_t index, size_t offset, void* data, size_t size) const;
+
     esp_err_t cmpItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
     esp_err_t eraseItem(uint8_t nsIndex, ItemType datatype, const char* key, uint8_t chunkIdx = CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
@@ -140,6 +153,18 @@ public:
     }
     size_t getVarDataTailroom() const ;
 
+    size_t getFreeEntryCount() const;
+
+    /**
+     * Number of entries needed to store an item of the given type and data size.
+     */
+    static size_t getItemSpan(ItemType datatype, size_t dataSize);
+
+    /**
+     * Encodes an item the same way writeItem() stores it into getItemSpan() consecutive entries.
+     */
+    static void encodeItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize, Item* entries);
+
     esp_err_t markFull();
 
     esp_err_t markFreeing();
@@ -152,6 +177,11 @@ public:
 
     esp_err_t calcEntries(nvs_stats_t &nvsStats);
 
+    void setItemIndex(ItemIndex* itemIndex)
+    {
+        mHashList.setItemIndex(itemIndex, this);
+    }
+
 protected:
 
     class Header
@@ -191,6 +221,14 @@ protected:
 
     esp_err_t readEntry(size_t index, Item& dst) const;
 
+    /**
+     * Same as readEntry, but reads LOAD_BLOCK_ENTRIES entries starting at index into block whenever index
+     * is not in the block yet, so that scanning through a page takes few flash reads.
+     * blockStart is the index of the first entry in block, INVALID_ENTRY if block hasn't been filled yet.
+     * If block is nullptr, the entry is read on its own.
+     */
+    esp_err_t readEntryBlock(size_t index, Item& dst, Item* block, size_t& blockStart) const;
+
     esp_err_t writeEntry(const Item& item);
 
     esp_err_t writeEntryData(const uint8_t* data, size_t size);
@@ -235,10 +273,12 @@ protected:
     static const uint32_t HEADER_OFFSET = 0;
     static const uint32_t ENTRY_TABLE_OFFSET = HEADER_OFFSET + 32;
     static const uint32_t ENTRY_DATA_OFFSET = ENTRY_TABLE_OFFSET + 32;
+    static const size_t LOAD_BLOCK_ENTRIES = 16;
 
     static_assert(sizeof(Header) == 32, "header size must be 32 bytes");
     static_assert(ENTRY_TABLE_OFFSET % 32 == 0, "entry table offset should be aligned");
     static_assert(ENTRY_DATA_OFFSET % 32 == 0, "entry data offset should be aligned");
+    static_assert(HashList::MAX_ITEM_COUNT == ENTRY_COUNT, "hash list should fit the items of a full page");
 
 }; // class Page
 
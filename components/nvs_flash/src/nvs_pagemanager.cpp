@@ -30,6 +30,7 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
     if (!mPages) return ESP_ERR_NO_MEM;
 
     for (uint32_t i = 0; i < sectorCount; ++i) {
+        mPages[i].setItemIndex(mItemIndex);
         auto err = mPages[i].load(partition, baseSector + i);
         if (err != ESP_OK) {
             return err;
@@ -60,18 +61,14 @@ esp_err_t PageManager::load(Partition *partition, uint32_t baseSector, uint32_t
     }
 
     // if power went out after a new item for the given key was written,
-    // but before the old one was erased, we end up with a duplicate item
+    // but before the old one was erased, we end up with a duplicate item.
+    // Storage::writeItems may leave several of them, so check every item of the last page.
     Page& lastPage = back();
-    size_t lastItemIndex = SIZE_MAX;
+    auto last = PageManager::TPageListIterator(&lastPage);
     Item item;
     size_t itemIndex = 0;
     while (lastPage.findItem(Page::NS_ANY, ItemType::ANY, nullptr, itemIndex, item) == ESP_OK) {
         itemIndex += item.span;
-        lastItemIndex = itemIndex;
-    }
-
-    if (lastItemIndex != SIZE_MAX) {
-        auto last = PageManager::TPageListIterator(&lastPage);
         TPageListIterator it;
 
         for (it = begin(); it != last; ++it) {
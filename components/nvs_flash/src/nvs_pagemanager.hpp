@@ -61,6 +61,14 @@ public:
         return mBaseSector;
     }
 
+    /**
+     * Attaches a storage-wide item index to all pages created by subsequent calls to load().
+     */
+    void setItemIndex(ItemIndex* itemIndex)
+    {
+        mItemIndex = itemIndex;
+    }
+
 protected:
     friend class Iterator;
 
@@ -72,6 +80,7 @@ protected:
     uint32_t mBaseSector;
     uint32_t mPageCount;
     uint32_t mSeqNumber;
+    ItemIndex* mItemIndex = nullptr;
 }; // class PageManager
 
 
@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #include "nvs_storage.hpp"
+#include "esp_rom_crc.h"
 
 #ifndef ESP_PLATFORM
 // We need NO_DEBUG_STORAGE here since the integration tests on the host add some debug code.
@@ -29,6 +30,11 @@ namespace nvs
 
 Storage::~Storage()
 {
+    for (auto it = std::begin(mBlobCursors); it != std::end(mBlobCursors); ++it) {
+        it->storage = nullptr;
+        it->changed = true;
+    }
+    mBlobCursors.clear();
     clearNamespaces();
 }
 
@@ -37,110 +43,126 @@ void Storage::clearNamespaces()
     mNamespaces.clearAndFreeNodes();
 }
 
-esp_err_t Storage::populateBlobIndices(TBlobIndexList& blobIdxList)
+esp_err_t Storage::populateItemLists(TBlobIndexList& blobIdxList, TBlobDataList& blobDataList)
 {
+    // Namespaces, blob indices and data chunks are all collected in a single pass over the items
     for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
         Page& p = *it;
         size_t itemIndex = 0;
         Item item;
 
-        /* If the power went off just after writing a blob index, the duplicate detection
-         * logic in pagemanager will remove the earlier index. So we should never find a
-         * duplicate index at this point */
+        while (p.findItem(Page::NS_ANY, ItemType::ANY, nullptr, itemIndex, item) == ESP_OK) {
+            itemIndex += item.span;
+
+            if (item.nsIndex == Page::NS_INDEX && item.datatype == ItemType::U8) {
+                NamespaceEntry* entry = new (std::nothrow) NamespaceEntry;
 
-        while (p.findItem(Page::NS_ANY, ItemType::BLOB_IDX, nullptr, itemIndex, item) == ESP_OK) {
-            BlobIndexNode* entry = new (std::nothrow) BlobIndexNode;
+                if (!entry) return ESP_ERR_NO_MEM;
 
-            if (!entry) return ESP_ERR_NO_MEM;
+                item.getKey(entry->mName, sizeof(entry->mName));
+                item.getValue(entry->mIndex);
+                mNamespaces.push_back(entry);
+                mNamespaceUsage.set(entry->mIndex, true);
+            } else if (item.datatype == ItemType::BLOB_IDX && item.chunkIndex == Page::CHUNK_ANY) {
+                /* If the power went off just after writing a blob index, the duplicate detection
+                 * logic in pagemanager will remove the earlier index. So we should never find a
+                 * duplicate index at this point */
+                BlobIndexNode* entry = new (std::nothrow) BlobIndexNode;
 
-            item.getKey(entry->key, sizeof(entry->key));
-            entry->nsIndex = item.nsIndex;
-            entry->chunkStart = item.blobIndex.chunkStart;
-            entry->chunkCount = item.blobIndex.chunkCount;
+                if (!entry) return ESP_ERR_NO_MEM;
 
-            blobIdxList.push_back(entry);
-            itemIndex += item.span;
+                item.getKey(entry->key, sizeof(entry->key));
+                entry->nsIndex = item.nsIndex;
+                entry->chunkStart = item.blobIndex.chunkStart;
+                entry->chunkCount = item.blobIndex.chunkCount;
+
+                blobIdxList.push_back(entry);
+            } else if (item.datatype == ItemType::BLOB_DATA) {
+                BlobDataNode* entry = new (std::nothrow) BlobDataNode;
+
+                if (!entry) return ESP_ERR_NO_MEM;
+
+                item.getKey(entry->key, sizeof(entry->key));
+                entry->nsIndex = item.nsIndex;
+                entry->chunkIndex = item.chunkIndex;
+                entry->page = &p;
+
+                blobDataList.push_back(entry);
+            }
         }
     }
 
     return ESP_OK;
 }
 
-void Storage::eraseOrphanDataBlobs(TBlobIndexList& blobIdxList)
+void Storage::markBlobCursorsChanged(uint8_t nsIndex, const char* key)
 {
-    for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
-        Page& p = *it;
-        size_t itemIndex = 0;
-        Item item;
-        /* Chunks with same <ns,key> and with chunkIndex in the following ranges
-         * belong to same family.
-         * 1) VER_0_OFFSET <= chunkIndex < VER_1_OFFSET-1 => Version0 chunks
-         * 2) VER_1_OFFSET <= chunkIndex < VER_ANY => Version1 chunks
-         */
-        while (p.findItem(Page::NS_ANY, ItemType::BLOB_DATA, nullptr, itemIndex, item) == ESP_OK) {
-
-            auto iter = std::find_if(blobIdxList.begin(),
-                    blobIdxList.end(),
-                    [=] (const BlobIndexNode& e) -> bool
-                    {return (strncmp(item.key, e.key, sizeof(e.key) - 1) == 0)
-                            && (item.nsIndex == e.nsIndex)
-                            && (item.chunkIndex >=  static_cast<uint8_t> (e.chunkStart))
-                            && (item.chunkIndex < static_cast<uint8_t> (e.chunkStart) + e.chunkCount);});
-            if (iter == std::end(blobIdxList)) {
-                p.eraseItem(item.nsIndex, item.datatype, item.key, item.chunkIndex);
-            }
-            itemIndex += item.span;
+    for (auto it = std::begin(mBlobCursors); it != std::end(mBlobCursors); ++it) {
+        if (it->nsIndex == nsIndex && (key == nullptr || strncmp(it->key, key, sizeof(it->key) - 1) == 0)) {
+            it->changed = true;
+        }
+    }
+}
+
+void Storage::eraseOrphanDataBlobs(TBlobIndexList& blobIdxList, TBlobDataList& blobDataList)
+{
+    /* Chunks with same <ns,key> and with chunkIndex in the following ranges
+     * belong to same family.
+     * 1) VER_0_OFFSET <= chunkIndex < VER_1_OFFSET-1 => Version0 chunks
+     * 2) VER_1_OFFSET <= chunkIndex < VER_ANY => Version1 chunks
+     */
+    for (auto it = blobDataList.begin(); it != blobDataList.end(); ++it) {
+        const BlobDataNode& data = *it;
+
+        auto iter = std::find_if(blobIdxList.begin(),
+                blobIdxList.end(),
+                [=] (const BlobIndexNode& e) -> bool
+                {return (strncmp(data.key, e.key, sizeof(e.key) - 1) == 0)
+                        && (data.nsIndex == e.nsIndex)
+                        && (data.chunkIndex >=  static_cast<uint8_t> (e.chunkStart))
+                        && (data.chunkIndex < static_cast<uint8_t> (e.chunkStart) + e.chunkCount);});
+        if (iter == std::end(blobIdxList)) {
+            data.page->eraseItem(data.nsIndex, ItemType::BLOB_DATA, data.key, data.chunkIndex);
         }
     }
 }
 
 esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
 {
+#ifdef CONFIG_NVS_STORAGE_INDEX
+    // The index is filled by the pages' hash lists while they are loaded
+    mItemIndex.clear();
+    mPageManager.setItemIndex(&mItemIndex);
+#endif
+    mItemCache.clear();
     auto err = mPageManager.load(mPartition, baseSector, sectorCount);
     if (err != ESP_OK) {
         mState = StorageState::INVALID;
         return err;
     }
 
-    // load namespaces list
+    // load namespaces list, multi-page index entries and data chunks
     clearNamespaces();
     std::fill_n(mNamespaceUsage.data(), mNamespaceUsage.byteSize() / 4, 0);
-    for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
-        Page& p = *it;
-        size_t itemIndex = 0;
-        Item item;
-        while (p.findItem(Page::NS_INDEX, ItemType::U8, nullptr, itemIndex, item) == ESP_OK) {
-            NamespaceEntry* entry = new (std::nothrow) NamespaceEntry;
-
-            if (!entry) {
-                mState = StorageState::INVALID;
-                return ESP_ERR_NO_MEM;
-            }
-
-            item.getKey(entry->mName, sizeof(entry->mName));
-            item.getValue(entry->mIndex);
-            mNamespaces.push_back(entry);
-            mNamespaceUsage.set(entry->mIndex, true);
-            itemIndex += item.span;
-        }
-    }
-    mNamespaceUsage.set(0, true);
-    mNamespaceUsage.set(255, true);
-    mState = StorageState::ACTIVE;
-
-    // Populate list of multi-page index entries.
     TBlobIndexList blobIdxList;
-    err = populateBlobIndices(blobIdxList);
+    TBlobDataList blobDataList;
+    err = populateItemLists(blobIdxList, blobDataList);
     if (err != ESP_OK) {
+        blobIdxList.clearAndFreeNodes();
+        blobDataList.clearAndFreeNodes();
         mState = StorageState::INVALID;
         return ESP_ERR_NO_MEM;
     }
+    mNamespaceUsage.set(0, true);
+    mNamespaceUsage.set(255, true);
+    mState = StorageState::ACTIVE;
 
     // Remove the entries for which there is no parent multi-page index.
-    eraseOrphanDataBlobs(blobIdxList);
+    eraseOrphanDataBlobs(blobIdxList, blobDataList);
 
-    // Purge the blob index list
+    // Purge the blob lists
     blobIdxList.clearAndFreeNodes();
+    blobDataList.clearAndFreeNodes();
 
 #ifdef DEBUG_STORAGE
     debugCheck();
@@ -155,6 +177,15 @@ bool Storage::isValid() const
 
 esp_err_t Storage::findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
 {
+#ifdef CONFIG_NVS_STORAGE_INDEX
+    // Searching for ItemType::ANY also matches blob data chunks of any chunk index, which the hash doesn't cover
+    if (datatype != ItemType::ANY) {
+        auto err = findIndexedItem(nsIndex, datatype, key, page, item, chunkIdx, chunkStart);
+        if (err != ESP_ERR_NOT_SUPPORTED) {
+            return err;
+        }
+    }
+#endif
     for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
         size_t itemIndex = 0;
         auto err = it->findItem(nsIndex, datatype, key, itemIndex, item, chunkIdx, chunkStart);
@@ -166,6 +197,45 @@ esp_err_t Storage::findItem(uint8_t nsIndex, ItemType datatype, const char* key,
     return ESP_ERR_NVS_NOT_FOUND;
 }
 
+#ifdef CONFIG_NVS_STORAGE_INDEX
+esp_err_t Storage::findIndexedItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
+{
+    Page* candidates[INDEX_CANDIDATES_MAX];
+    const uint32_t hash = Item(nsIndex, datatype, 0, key, chunkIdx).calculateCrc32WithoutValue();
+    size_t candidateCount = mItemIndex.find(hash, candidates, INDEX_CANDIDATES_MAX);
+    if (candidateCount > INDEX_CANDIDATES_MAX) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    // Candidates are not ordered, so pick the oldest page holding the item, as the linear search would do
+    Page* foundPage = nullptr;
+    uint32_t foundSeqNumber = UINT32_MAX;
+    for (size_t i = 0; i < candidateCount; ++i) {
+        size_t itemIndex = 0;
+        Item candidateItem;
+        uint32_t seqNumber;
+        if (candidates[i]->getSeqNumber(seqNumber) != ESP_OK) {
+            continue;
+        }
+        if (foundPage != nullptr && seqNumber > foundSeqNumber) {
+            continue;
+        }
+        auto err = candidates[i]->findItem(nsIndex, datatype, key, itemIndex, candidateItem, chunkIdx, chunkStart);
+        if (err == ESP_OK) {
+            foundPage = candidates[i];
+            foundSeqNumber = seqNumber;
+            item = candidateItem;
+        }
+    }
+
+    if (foundPage == nullptr) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    page = foundPage;
+    return ESP_OK;
+}
+#endif // CONFIG_NVS_STORAGE_INDEX
+
 esp_err_t Storage::writeMultiPageBlob(uint8_t nsIndex, const char* key, const void* data, size_t dataSize, VerOffset chunkStart)
 {
     uint8_t chunkCount = 0;
@@ -275,6 +345,9 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    // Dropped first, so that the cache doesn't hold a stale value if writing fails half way
+    mItemCache.erase(nsIndex, datatype, key);
+
     Page* findPage = nullptr;
     Item item;
 
@@ -312,6 +385,9 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
             nextStart
                 = (prevStart == VerOffset::VER_1_OFFSET) ? VerOffset::VER_0_OFFSET : VerOffset::VER_1_OFFSET;
         }
+        /* The chunk indices of this version are reused by the next write, open readers must not mix the two */
+        markBlobCursorsChanged(nsIndex, key);
+
         /* Write the blob with new version*/
         err = writeMultiPageBlob(nsIndex, key, data, dataSize, nextStart);
 
@@ -347,6 +423,9 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
         // since it may invoke an erasure of flash.
         if (findPage != nullptr &&
                 findPage->cmpItem(nsIndex, datatype, key, data, dataSize) == ESP_OK) {
+            if (nsIndex != Page::NS_INDEX) {
+                mItemCache.insert(nsIndex, datatype, key, data, dataSize);
+            }
             return ESP_OK;
         }
 
@@ -389,6 +468,139 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
             return err;
         }
     }
+    if (datatype != ItemType::BLOB && nsIndex != Page::NS_INDEX) {
+        mItemCache.insert(nsIndex, datatype, key, data, dataSize);
+    }
+#ifdef DEBUG_STORAGE
+    debugCheck();
+#endif
+    return ESP_OK;
+}
+
+esp_err_t Storage::writePendingRun(uint8_t nsIndex, Page& page, const Item* entries, size_t count,
+        TPendingItemList::iterator begin, TPendingItemList::iterator end)
+{
+    auto err = page.writeEntries(entries, count);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // The previous versions precede the new items, so findItem returns them
+    for (auto it = begin; it != end; ++it) {
+        if (!it->replaces) {
+            continue;
+        }
+        Page* findPage = nullptr;
+        Item item;
+        err = findItem(nsIndex, it->datatype, it->key, findPage, item);
+        if (err != ESP_OK) {
+            return err;
+        }
+        err = findPage->eraseItem(nsIndex, it->datatype, it->key);
+        if (err == ESP_ERR_FLASH_OP_FAIL) {
+            return ESP_ERR_NVS_REMOVE_FAILED;
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t Storage::writeItems(uint8_t nsIndex, TPendingItemList& items)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    size_t totalSpan = 0;
+    for (auto it = items.begin(); it != items.end(); ++it) {
+        it->replaces = false;
+        it->unchanged = false;
+        mItemCache.erase(nsIndex, it->datatype, it->key);
+        if (it->datatype == ItemType::BLOB) {
+            continue;
+        }
+        Page* findPage = nullptr;
+        Item item;
+        if (findItem(nsIndex, it->datatype, it->key, findPage, item) == ESP_OK) {
+            // Same check as in writeItem, unmodified items are not written again
+            if (findPage->cmpItem(nsIndex, it->datatype, it->key, it->data, it->dataSize) == ESP_OK) {
+                it->unchanged = true;
+                continue;
+            }
+            it->replaces = true;
+        }
+        totalSpan += Page::getItemSpan(it->datatype, it->dataSize);
+    }
+
+    esp_err_t err = ESP_OK;
+    if (totalSpan > 0) {
+        Item* entries = new (std::nothrow) Item[std::min(totalSpan, size_t(Page::ENTRY_COUNT))];
+        if (!entries) {
+            return ESP_ERR_NO_MEM;
+        }
+
+        Page* page = &getCurrentPage();
+        size_t room = page->getFreeEntryCount();
+        size_t count = 0;
+        auto runBegin = items.begin();
+        for (auto it = items.begin(); it != items.end(); ++it) {
+            if (it->datatype == ItemType::BLOB || it->unchanged) {
+                continue;
+            }
+            size_t span = Page::getItemSpan(it->datatype, it->dataSize);
+            if (count + span > room) {
+                if (count > 0) {
+                    err = writePendingRun(nsIndex, *page, entries, count, runBegin, it);
+                    if (err != ESP_OK) {
+                        break;
+                    }
+                    count = 0;
+                    runBegin = it;
+                }
+                if (page->state() != Page::PageState::FULL) {
+                    err = page->markFull();
+                    if (err != ESP_OK) {
+                        break;
+                    }
+                }
+                err = mPageManager.requestNewPage();
+                if (err != ESP_OK) {
+                    break;
+                }
+                page = &getCurrentPage();
+                room = page->getFreeEntryCount();
+                if (span > room) {
+                    err = ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+                    break;
+                }
+            }
+            Page::encodeItem(nsIndex, it->datatype, it->key, it->data, it->dataSize, entries + count);
+            count += span;
+        }
+        if (err == ESP_OK && count > 0) {
+            err = writePendingRun(nsIndex, *page, entries, count, runBegin, items.end());
+        }
+        delete[] entries;
+        if (err == ESP_ERR_NVS_PAGE_FULL) {
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    for (auto it = items.begin(); it != items.end(); ++it) {
+        if (it->datatype != ItemType::BLOB) {
+            continue;
+        }
+        err = writeItem(nsIndex, ItemType::BLOB, it->key, it->data, it->dataSize);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
 #ifdef DEBUG_STORAGE
     debugCheck();
 #endif
@@ -461,7 +673,8 @@ esp_err_t Storage::readMultiPageBlob(uint8_t nsIndex, const char* key, void* dat
 
     /* Now read corresponding chunks */
     for (uint8_t chunkNum = 0; chunkNum < chunkCount; chunkNum++) {
-        err = findItem(nsIndex, ItemType::BLOB_DATA, key, findPage, item, static_cast<uint8_t> (chunkStart) + chunkNum);
+        size_t itemIndex;
+        err = findBlobChunk(nsIndex, ItemType::BLOB_DATA, key, static_cast<uint8_t> (chunkStart) + chunkNum, findPage, itemIndex, item);
         if (err != ESP_OK) {
             if (err == ESP_ERR_NVS_NOT_FOUND) {
                 break;
@@ -526,12 +739,190 @@ esp_err_t Storage::cmpMultiPageBlob(uint8_t nsIndex, const char* key, const void
     return err;
 }
 
+esp_err_t Storage::findBlobChunk(uint8_t nsIndex, ItemType datatype, const char* key, uint8_t chunkIdx, Page* &page, size_t& itemIndex, Item& item)
+{
+    if (page != nullptr) {
+        auto it = intrusive_list<Page>::iterator(page);
+        for (size_t i = 0; i < 2 && it != std::end(mPageManager); ++i, ++it) {
+            itemIndex = 0;
+            if (it->findItem(nsIndex, datatype, key, itemIndex, item, chunkIdx) == ESP_OK) {
+                page = it;
+                return ESP_OK;
+            }
+        }
+    }
+
+    auto err = findItem(nsIndex, datatype, key, page, item, chunkIdx);
+    if (err != ESP_OK) {
+        return err;
+    }
+    itemIndex = 0;
+    return page->findItem(nsIndex, datatype, key, itemIndex, item, chunkIdx);
+}
+
+void Storage::resetBlobChunk(BlobCursor& cursor, uint8_t chunk, size_t chunkOffset)
+{
+    cursor.chunk = chunk;
+    cursor.chunkOffset = chunkOffset;
+    cursor.offset = chunkOffset;
+    cursor.crc = 0xffffffff;
+    cursor.crcSize = 0;
+}
+
+esp_err_t Storage::openBlob(uint8_t nsIndex, const char* key, BlobCursor& cursor)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    Item item;
+    Page* findPage = nullptr;
+    auto err = findItem(nsIndex, ItemType::BLOB_IDX, key, findPage, item);
+    if (err == ESP_OK) {
+        cursor.chunkType = ItemType::BLOB_DATA;
+        cursor.chunkStart = static_cast<uint8_t>(item.blobIndex.chunkStart);
+        cursor.chunkCount = item.blobIndex.chunkCount;
+        cursor.size = item.blobIndex.dataSize;
+    } else if (err == ESP_ERR_NVS_NOT_FOUND) {
+        // the blob may be stored in the format of version 1 pages, as a single item without index
+        err = findItem(nsIndex, ItemType::BLOB, key, findPage, item);
+        if (err != ESP_OK) {
+            return err;
+        }
+        cursor.chunkType = ItemType::BLOB;
+        cursor.chunkStart = Page::CHUNK_ANY;
+        cursor.chunkCount = 1;
+        cursor.size = item.varLength.dataSize;
+    } else {
+        return err;
+    }
+
+    closeBlob(cursor);
+    strncpy(cursor.key, key, sizeof(cursor.key) - 1);
+    cursor.key[sizeof(cursor.key) - 1] = 0;
+    cursor.nsIndex = nsIndex;
+    cursor.page = findPage;
+    cursor.storage = this;
+    cursor.changed = false;
+    mBlobCursors.push_back(&cursor);
+    resetBlobChunk(cursor, 0, 0);
+    return ESP_OK;
+}
+
+void Storage::closeBlob(BlobCursor& cursor)
+{
+    if (cursor.storage) {
+        cursor.storage->mBlobCursors.erase(&cursor);
+        cursor.storage = nullptr;
+    }
+}
+
+esp_err_t Storage::readBlob(BlobCursor& cursor, void* data, size_t dataSize, size_t& readSize)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    uint8_t* dst = static_cast<uint8_t*>(data);
+    readSize = 0;
+    if (cursor.changed) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    while (dataSize > 0 && cursor.offset < cursor.size) {
+        if (cursor.chunk >= cursor.chunkCount) {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        uint8_t chunkIdx = (cursor.chunkType == ItemType::BLOB) ? Page::CHUNK_ANY : cursor.chunkStart + cursor.chunk;
+        size_t itemIndex;
+        Item item;
+        auto err = findBlobChunk(cursor.nsIndex, cursor.chunkType, cursor.key, chunkIdx, cursor.page, itemIndex, item);
+        if (err != ESP_OK) {
+            return err;
+        }
+
+        size_t chunkSize = item.varLength.dataSize;
+        size_t chunkPos = cursor.offset - cursor.chunkOffset;
+        if (chunkPos < chunkSize) {
+            size_t willRead = std::min(dataSize, chunkSize - chunkPos);
+            err = cursor.page->readItemData(itemIndex, chunkPos, dst, willRead);
+            if (err != ESP_OK) {
+                return err;
+            }
+            if (cursor.crcSize == chunkPos) {
+                cursor.crc = esp_rom_crc32_le(cursor.crc, dst, willRead);
+                cursor.crcSize += willRead;
+                if (cursor.crcSize == chunkSize && cursor.crc != item.varLength.dataCrc32) {
+                    return ESP_ERR_NVS_NOT_FOUND;
+                }
+            }
+            dst += willRead;
+            dataSize -= willRead;
+            readSize += willRead;
+            cursor.offset += willRead;
+        }
+        if (cursor.offset - cursor.chunkOffset >= chunkSize) {
+            resetBlobChunk(cursor, cursor.chunk + 1, cursor.chunkOffset + chunkSize);
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t Storage::seekBlob(BlobCursor& cursor, size_t offset)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    if (cursor.changed) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (offset > cursor.size) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    if (offset == cursor.offset) {
+        return ESP_OK;
+    }
+
+    if (offset < cursor.chunkOffset) {
+        resetBlobChunk(cursor, 0, 0);
+    }
+    // Only the chunk headers are read to skip the chunks before offset
+    while (offset > cursor.chunkOffset && cursor.chunk + 1 < cursor.chunkCount) {
+        uint8_t chunkIdx = (cursor.chunkType == ItemType::BLOB) ? Page::CHUNK_ANY : cursor.chunkStart + cursor.chunk;
+        size_t itemIndex;
+        Item item;
+        auto err = findBlobChunk(cursor.nsIndex, cursor.chunkType, cursor.key, chunkIdx, cursor.page, itemIndex, item);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (offset < cursor.chunkOffset + item.varLength.dataSize) {
+            break;
+        }
+        resetBlobChunk(cursor, cursor.chunk + 1, cursor.chunkOffset + item.varLength.dataSize);
+    }
+
+    if (offset != cursor.chunkOffset) {
+        cursor.crcSize = BlobCursor::CRC_UNKNOWN;
+    } else {
+        cursor.crc = 0xffffffff;
+        cursor.crcSize = 0;
+    }
+    cursor.offset = offset;
+    return ESP_OK;
+}
+
 esp_err_t Storage::readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize)
 {
     if (mState != StorageState::ACTIVE) {
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    if (datatype != ItemType::BLOB) {
+        auto err = mItemCache.read(nsIndex, datatype, key, data, dataSize);
+        if (err != ESP_ERR_NVS_NOT_FOUND) {
+            return err;
+        }
+    }
+
     Item item;
     Page* findPage = nullptr;
     if (datatype == ItemType::BLOB) {
@@ -545,8 +936,11 @@ esp_err_t Storage::readItem(uint8_t nsIndex, ItemType datatype, const char* key,
     if (err != ESP_OK) {
         return err;
     }
-    return findPage->readItem(nsIndex, datatype, key, data, dataSize);
-
+    err = findPage->readItem(nsIndex, datatype, key, data, dataSize);
+    if (err == ESP_OK && datatype != ItemType::BLOB) {
+        mItemCache.insert(nsIndex, datatype, key, data, isVariableLengthType(datatype) ? item.varLength.dataSize : dataSize);
+    }
+    return err;
 }
 
 esp_err_t Storage::eraseMultiPageBlob(uint8_t nsIndex, const char* key, VerOffset chunkStart)
@@ -561,6 +955,8 @@ esp_err_t Storage::eraseMultiPageBlob(uint8_t nsIndex, const char* key, VerOffse
     if (err != ESP_OK) {
         return err;
     }
+    markBlobCursorsChanged(nsIndex, key);
+
     /* Erase the index first and make children blobs orphan*/
     err = findPage->eraseItem(nsIndex, ItemType::BLOB_IDX, key, Page::CHUNK_ANY, chunkStart);
     if (err != ESP_OK) {
@@ -600,6 +996,8 @@ esp_err_t Storage::eraseItem(uint8_t nsIndex, ItemType datatype, const char* key
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    mItemCache.erase(nsIndex, datatype, key);
+
     if (datatype == ItemType::BLOB) {
         return eraseMultiPageBlob(nsIndex, key);
     }
@@ -614,6 +1012,9 @@ esp_err_t Storage::eraseItem(uint8_t nsIndex, ItemType datatype, const char* key
     if (item.datatype == ItemType::BLOB_DATA || item.datatype == ItemType::BLOB_IDX) {
         return eraseMultiPageBlob(nsIndex, key);
     }
+    if (item.datatype == ItemType::BLOB) {
+        markBlobCursorsChanged(nsIndex, key);
+    }
 
     return findPage->eraseItem(nsIndex, datatype, key);
 }
@@ -624,6 +1025,9 @@ esp_err_t Storage::eraseNamespace(uint8_t nsIndex)
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    mItemCache.eraseNamespace(nsIndex);
+    markBlobCursorsChanged(nsIndex, nullptr);
+
     for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
         while (true) {
             auto err = it->eraseItem(nsIndex, ItemType::ANY, nullptr);
@@ -645,6 +1049,10 @@ esp_err_t Storage::getItemDataSize(uint8_t nsIndex, ItemType datatype, const cha
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    if (datatype == ItemType::SZ && mItemCache.getSize(nsIndex, datatype, key, dataSize) == ESP_OK) {
+        return ESP_OK;
+    }
+
     Item item;
     Page* findPage = nullptr;
     auto err = findItem(nsIndex, datatype, key, findPage, item);
@@ -690,6 +1098,12 @@ void Storage::debugCheck()
                 assert(0);
             }
             keys.insert(std::make_pair(keystr, static_cast<Page*>(p)));
+#ifdef CONFIG_NVS_STORAGE_INDEX
+            Page* candidates[INDEX_CANDIDATES_MAX];
+            size_t candidateCount = mItemIndex.find(item.calculateCrc32WithoutValue(), candidates, INDEX_CANDIDATES_MAX);
+            assert(candidateCount > INDEX_CANDIDATES_MAX
+                    || std::find(candidates, candidates + candidateCount, static_cast<Page*>(p)) != candidates + candidateCount);
+#endif
             itemIndex += item.span;
             usedCount += item.span;
         }
@@ -704,6 +1118,14 @@ esp_err_t Storage::fillStats(nvs_stats_t& nvsStats)
     return mPageManager.fillStats(nvsStats);
 }
 
+void Storage::fillCacheStats(nvs_cache_stats_t& cacheStats)
+{
+    cacheStats.hits = mItemCache.hits();
+    cacheStats.misses = mItemCache.misses();
+    cacheStats.used_bytes = mItemCache.usedBytes();
+    cacheStats.capacity_bytes = mItemCache.capacity();
+}
+
 esp_err_t Storage::calcEntriesInNamespace(uint8_t nsIndex, size_t& usedEntries)
 {
     usedEntries = 0;
@@ -20,7 +20,10 @@
 #include "nvs_types.hpp"
 #include "nvs_page.hpp"
 #include "nvs_pagemanager.hpp"
+#include "nvs_item_index.hpp"
+#include "nvs_item_cache.hpp"
 #include "partition.hpp"
+#include "sdkconfig.h"
 
 //extern void dumpBytes(const uint8_t* data, size_t count);
 
@@ -58,10 +61,65 @@ class Storage : public intrusive_list_node<Storage>
 
     typedef intrusive_list<BlobIndexNode> TBlobIndexList;
 
+    struct BlobDataNode: public intrusive_list_node<BlobDataNode> {
+        public:
+            char key[Item::MAX_KEY_LENGTH + 1];
+            uint8_t nsIndex;
+            uint8_t chunkIndex;
+            Page* page;
+    };
+
+    typedef intrusive_list<BlobDataNode> TBlobDataList;
+
 public:
+    /**
+     * An item staged by a transaction and written by writeItems().
+     */
+    struct PendingItem : public intrusive_list_node<PendingItem> {
+    public:
+        ~PendingItem()
+        {
+            delete[] data;
+        }
+
+        char key[Item::MAX_KEY_LENGTH + 1];
+        ItemType datatype;
+        size_t dataSize;
+        uint8_t* data = nullptr;
+        bool replaces = false;
+        bool unchanged = false;
+    };
+
+    typedef intrusive_list<PendingItem> TPendingItemList;
+
+    /**
+     * Read position within a blob, used by readBlob() to stream the blob chunk by chunk.
+     * Open cursors are listed by the storage, which marks them changed when their blob is written or erased.
+     */
+    struct BlobCursor : public intrusive_list_node<BlobCursor> {
+        char key[Item::MAX_KEY_LENGTH + 1];
+        uint8_t nsIndex;
+        ItemType chunkType;   // BLOB_DATA, or BLOB for blobs written in the format of version 1 pages
+        uint8_t chunkStart;   // chunk index of the first chunk, CHUNK_ANY for the version 1 format
+        uint8_t chunkCount;
+        size_t size;
+        size_t offset;        // read position within the blob
+        uint8_t chunk;        // chunk holding offset, counted from chunkStart
+        size_t chunkOffset;   // position of that chunk within the blob
+        uint32_t crc;         // CRC of the data of the chunk read so far
+        size_t crcSize;       // number of bytes covered by crc, CRC_UNKNOWN after seeking into the chunk
+        Page* page;           // page holding the chunk last read, searched first for the next one
+        Storage* storage = nullptr; // storage listing the cursor, nullptr once closed
+        bool changed = false; // the blob has been written or erased since the cursor was opened
+
+        static const size_t CRC_UNKNOWN = SIZE_MAX;
+    };
+
+    typedef intrusive_list<BlobCursor> TBlobCursorList;
+
     ~Storage();
 
-    Storage(Partition *partition) : mPartition(partition) {
+    Storage(Partition *partition) : mPartition(partition), mItemCache(CACHE_SIZE) {
         if (partition == nullptr) {
             abort();
         }
@@ -75,6 +133,15 @@ public:
 
     esp_err_t writeItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize);
 
+    /**
+     * Writes all items of the list to the namespace nsIndex.
+     * Items which fit into the free space of the current page are written with a single flash write of their
+     * entries, followed by marking the entries as written and erasing the entries they supersede. Marking takes
+     * several writes of the entry state bitmap, so a power loss can leave only some items of a group written;
+     * each item then has either its previous or its new value. Blobs are written one by one after the other items.
+     */
+    esp_err_t writeItems(uint8_t nsIndex, TPendingItemList& items);
+
     esp_err_t readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize);
 
     esp_err_t getItemDataSize(uint8_t nsIndex, ItemType datatype, const char* key, size_t& dataSize);
@@ -123,12 +190,35 @@ public:
 
     esp_err_t eraseMultiPageBlob(uint8_t nsIndex, const char* key, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    /**
+     * Looks up the blob stored under key and sets up cursor to read it from the beginning.
+     * The cursor stays listed by the storage until it is passed to closeBlob().
+     */
+    esp_err_t openBlob(uint8_t nsIndex, const char* key, BlobCursor& cursor);
+
+    /**
+     * Removes cursor from the list of its storage, if the storage still exists.
+     */
+    static void closeBlob(BlobCursor& cursor);
+
+    /**
+     * Reads up to dataSize bytes of the blob from the position of cursor into data and advances the cursor.
+     * readSize is set to the number of bytes read, which is only smaller than dataSize at the end of the blob.
+     * The data of each chunk is checked against its CRC once the chunk has been read completely,
+     * ESP_ERR_NVS_NOT_FOUND is returned if it doesn't match or if the blob has been written or erased meanwhile.
+     */
+    esp_err_t readBlob(BlobCursor& cursor, void* data, size_t dataSize, size_t& readSize);
+
+    esp_err_t seekBlob(BlobCursor& cursor, size_t offset);
+
     void debugDump();
 
     void debugCheck();
 
     esp_err_t fillStats(nvs_stats_t& nvsStats);
 
+    void fillCacheStats(nvs_cache_stats_t& cacheStats);
+
     esp_err_t calcEntriesInNamespace(uint8_t nsIndex, size_t& usedEntries);
 
     bool findEntry(nvs_opaque_iterator_t*, const char* name);
@@ -144,19 +234,54 @@ protected:
 
     void clearNamespaces();
 
-    esp_err_t populateBlobIndices(TBlobIndexList&);
+    esp_err_t populateItemLists(TBlobIndexList&, TBlobDataList&);
+
+    void eraseOrphanDataBlobs(TBlobIndexList&, TBlobDataList&);
 
-    void eraseOrphanDataBlobs(TBlobIndexList&);
+    /**
+     * Marks the open cursors of the blob stored under key as changed, or of all blobs of the namespace if key is nullptr.
+     */
+    void markBlobCursorsChanged(uint8_t nsIndex, const char* key);
 
     void fillEntryInfo(Item &item, nvs_entry_info_t &info);
 
     esp_err_t findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx = Page::CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    /**
+     * Same as findItem, but searches the given page and the page following it first. Since the chunks of a blob are
+     * written to consecutive pages, passing the page of the previous chunk usually avoids the search over all pages.
+     */
+    esp_err_t findBlobChunk(uint8_t nsIndex, ItemType datatype, const char* key, uint8_t chunkIdx, Page* &page, size_t& itemIndex, Item& item);
+
+    void resetBlobChunk(BlobCursor& cursor, uint8_t chunk, size_t chunkOffset);
+
+    esp_err_t writePendingRun(uint8_t nsIndex, Page& page, const Item* entries, size_t count, TPendingItemList::iterator begin, TPendingItemList::iterator end);
+
+#ifdef CONFIG_NVS_STORAGE_INDEX
+    esp_err_t findIndexedItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx, VerOffset chunkStart);
+
+    /**
+     * Maximum number of pages sharing one item hash which are searched through the index.
+     * If there are more, findItem falls back to searching all pages.
+     */
+    static const size_t INDEX_CANDIDATES_MAX = 8;
+#endif
+
+#ifdef CONFIG_NVS_CACHE_SIZE
+    static const size_t CACHE_SIZE = CONFIG_NVS_CACHE_SIZE;
+#else
+    static const size_t CACHE_SIZE = 0;
+#endif
+
 protected:
     Partition *mPartition;
     size_t mPageCount;
+    // must be declared before mPageManager since the pages detach from the index on destruction
+    ItemIndex mItemIndex;
     PageManager mPageManager;
+    ItemCache mItemCache;
     TNamespaces mNamespaces;
+    TBlobCursorList mBlobCursors;
     CompressedEnumTable<bool, 1, 256> mNamespaceUsage;
     StorageState mState = StorageState::INVALID;
 };
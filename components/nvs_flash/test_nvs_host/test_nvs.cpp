@@ -27,6 +27,7 @@
 #include <sys/wait.h>
 #include <string.h>
 #include <string>
+#include <chrono>
 
 #include "test_fixtures.hpp"
 
@@ -293,9 +294,9 @@ TEST_CASE("Page handles invalid CRC of variable length items", "[nvs][cur]")
 class HashListTestHelper : public HashList
 {
     public:
-        size_t getBlockCount()
+        size_t getCapacity()
         {
-            return mBlockList.size();
+            return mCapacity;
         }
 };
 
@@ -310,13 +311,13 @@ TEST_CASE("HashList is cleaned up as soon as items are erased", "[nvs]")
         Item item(1, ItemType::U32, 1, key);
         hashlist.insert(item, i);
     }
-    INFO("Added " << count << " items, " << hashlist.getBlockCount() << " blocks");
+    INFO("Added " << count << " items, capacity " << hashlist.getCapacity());
     // Remove them in reverse order
     for (size_t i = count; i > 0; --i) {
         // Make sure that the element existed before it's erased
         CHECK(hashlist.erase(i - 1) == true);
     }
-    CHECK(hashlist.getBlockCount() == 0);
+    CHECK(hashlist.getCapacity() == 0);
     // Add again
     for (size_t i = 0; i < count; ++i) {
         char key[16];
@@ -324,12 +325,47 @@ TEST_CASE("HashList is cleaned up as soon as items are erased", "[nvs]")
         Item item(1, ItemType::U32, 1, key);
         hashlist.insert(item, i);
     }
-    INFO("Added " << count << " items, " << hashlist.getBlockCount() << " blocks");
+    INFO("Added " << count << " items, capacity " << hashlist.getCapacity());
     // Remove them in the same order
     for (size_t i = 0; i < count; ++i) {
         CHECK(hashlist.erase(i) == true);
     }
-    CHECK(hashlist.getBlockCount() == 0);
+    CHECK(hashlist.getCapacity() == 0);
+}
+
+TEST_CASE("HashList returns the first matching item at or after the start index", "[nvs]")
+{
+    HashListTestHelper hashlist;
+    Item item(1, ItemType::U32, 1, "same_key");
+    // items with the same hash, e.g. the same key with different types, are all kept
+    TEST_ESP_OK(hashlist.insert(item, 50));
+    TEST_ESP_OK(hashlist.insert(item, 3));
+    TEST_ESP_OK(hashlist.insert(item, 10));
+    std::vector<Item> others;
+    char key[16];
+    for (size_t i = 0; i < 100; ++i) {
+        snprintf(key, sizeof(key), "other_%u", static_cast<unsigned>(i));
+        others.push_back(Item(1, ItemType::U32, 1, key));
+        TEST_ESP_OK(hashlist.insert(others.back(), (i < 3) ? i : i + 20));
+    }
+    CHECK(hashlist.find(0, item) == 3);
+    CHECK(hashlist.find(4, item) == 10);
+    CHECK(hashlist.find(11, item) == 50);
+    CHECK(hashlist.find(51, item) == SIZE_MAX);
+    CHECK(hashlist.erase(10) == true);
+    CHECK(hashlist.erase(10) == false);
+    CHECK(hashlist.find(4, item) == 50);
+
+    // the remaining items are still found after nodes were moved by erasing
+    for (size_t i = 0; i < 100; i += 2) {
+        CHECK(hashlist.erase((i < 3) ? i : i + 20) == true);
+    }
+    for (size_t i = 1; i < 100; i += 2) {
+        CHECK(hashlist.find(0, others[i]) == ((i < 3) ? i : i + 20));
+    }
+    CHECK(hashlist.find(0, others[0]) == SIZE_MAX);
+    CHECK(hashlist.find(0, item) == 3);
+    CHECK(hashlist.getCapacity() >= 103 * 4 / 3);
 }
 
 TEST_CASE("can init PageManager in empty flash", "[nvs]")
@@ -2320,6 +2356,19 @@ TEST_CASE("Check that NVS supports old blob format without blob index", "[nvs]")
     /* Check that item is stored in old format without blob index*/
     TEST_ESP_OK(p.findItem(1, ItemType::BLOB, "dummyHex2BinKey"));
 
+    /* Check that the blob reader streams blobs stored in old format*/
+    nvs_blob_reader_t reader;
+    TEST_ESP_OK( nvs_blob_reader_open(handle, "dummyHex2BinKey", &reader, &buflen));
+    CHECK(buflen == sizeof(hexdata));
+    buflen = 4;
+    TEST_ESP_OK( nvs_blob_reader_read(reader, buf, &buflen));
+    CHECK(buflen == 4);
+    buflen = 4;
+    TEST_ESP_OK( nvs_blob_reader_read(reader, buf + 4, &buflen));
+    CHECK(buflen == 2);
+    CHECK(memcmp(buf, hexdata, sizeof(hexdata)) == 0);
+    nvs_blob_reader_close(reader);
+
     /* Modify the blob so that it is stored in the new format*/
     hexdata[0] = hexdata[1] = hexdata[2] = 0x99;
     TEST_ESP_OK(nvs_set_blob(handle, "dummyHex2BinKey", hexdata, sizeof(hexdata)));
@@ -3523,6 +3572,681 @@ TEST_CASE("check and read data from partition generated via manufacturing utilit
 }
 #endif
 
+TEST_CASE("item index tracks items across pages", "[nvs]")
+{
+    ItemIndex index;
+    Page* pages[4];
+    Page page1, page2;
+    CHECK(index.find(0x123456, pages, 4) == 0);
+    for (uint32_t i = 0; i < 1000; ++i) {
+        TEST_ESP_OK(index.insert(i * 64, &page1));
+    }
+    TEST_ESP_OK(index.insert(0x40, &page1));
+    TEST_ESP_OK(index.insert(0x40, &page2));
+    CHECK(index.size() == 1001);
+    CHECK(index.find(0x40, pages, 4) == 2);
+    index.erase(0x40, &page1);
+    CHECK(index.find(0x40, pages, 4) == 2);
+    index.erase(0x40, &page1);
+    CHECK(index.find(0x40, pages, 4) == 1);
+    CHECK(pages[0] == &page2);
+    for (uint32_t i = 0; i < 1000; i += 2) {
+        index.erase(i * 64, &page1);
+    }
+    for (uint32_t i = 0; i < 1000; ++i) {
+        CHECK(index.find(i * 64, pages, 4) == i % 2);
+    }
+    CHECK(index.size() == 500);
+    index.clear();
+    CHECK(index.find(0x40, pages, 4) == 0);
+}
+
+TEST_CASE("storage lookups stay consistent with item index after page reclaim", "[nvs]")
+{
+    const size_t writeCount = Page::ENTRY_COUNT * 4 * 2;
+    auto lastValue = [=](size_t i) -> int { return static_cast<int>((writeCount - 1 - i) / 20 * 20 + i); };
+    PartitionEmulationFixture f(0, 8);
+    Storage storage(&f.part);
+    f.emu.setBounds(4, 8);
+    CHECK(storage.init(4, 4) == ESP_OK);
+    for (size_t i = 0; i < writeCount; ++i) {
+        char key[16];
+        snprintf(key, sizeof(key), "key_%d", static_cast<int>(i % 20));
+        REQUIRE(storage.writeItem(1, key, static_cast<int>(i)) == ESP_OK);
+    }
+    for (size_t i = 0; i < 20; ++i) {
+        char key[16];
+        int value;
+        snprintf(key, sizeof(key), "key_%d", static_cast<int>(i));
+        REQUIRE(storage.readItem(1, key, value) == ESP_OK);
+        CHECK(value == lastValue(i));
+        uint32_t u32;
+        CHECK(storage.readItem(1, key, u32) == ESP_ERR_NVS_NOT_FOUND);
+    }
+    int missing;
+    CHECK(storage.readItem(1, "missing", missing) == ESP_ERR_NVS_NOT_FOUND);
+
+    // re-mount and check that the index is rebuilt from flash
+    Storage storage2(&f.part);
+    CHECK(storage2.init(4, 4) == ESP_OK);
+    for (size_t i = 0; i < 20; ++i) {
+        char key[16];
+        int value;
+        snprintf(key, sizeof(key), "key_%d", static_cast<int>(i));
+        REQUIRE(storage2.readItem(1, key, value) == ESP_OK);
+        CHECK(value == lastValue(i));
+    }
+}
+
+TEST_CASE("benchmark key lookup latency against key count", "[nvs]")
+{
+    const size_t sectors = 64;
+    const size_t lookupRounds = 20;
+
+    for (size_t keyCount : {100, 400, 1600}) {
+        PartitionEmulationFixture f(0, sectors);
+        Storage storage(&f.part);
+        REQUIRE(storage.init(0, sectors) == ESP_OK);
+        char key[16];
+        for (size_t i = 0; i < keyCount; ++i) {
+            snprintf(key, sizeof(key), "k%u", static_cast<unsigned>(i));
+            REQUIRE(storage.writeItem(1, key, static_cast<uint32_t>(i)) == ESP_OK);
+        }
+
+        f.emu.clearStats();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < lookupRounds; ++round) {
+            for (size_t i = 0; i < keyCount; ++i) {
+                uint32_t value;
+                snprintf(key, sizeof(key), "k%u", static_cast<unsigned>(i));
+                REQUIRE(storage.readItem(1, key, value) == ESP_OK);
+                snprintf(key, sizeof(key), "m%u", static_cast<unsigned>(i));
+                REQUIRE(storage.readItem(1, key, value) == ESP_ERR_NVS_NOT_FOUND);
+            }
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        size_t lookups = lookupRounds * keyCount * 2;
+        s_perf << "Key lookup with " << keyCount << " keys in " << sectors << " sectors: "
+               << elapsed.count() / lookups << " ns per lookup, "
+               << static_cast<double>(f.emu.getReadOps()) / lookups << " flash reads per lookup" << std::endl;
+    }
+}
+
+static void stagePendingItem(Storage::TPendingItemList& items, const char* key, uint32_t value)
+{
+    auto item = new Storage::PendingItem;
+    strncpy(item->key, key, sizeof(item->key) - 1);
+    item->key[sizeof(item->key) - 1] = 0;
+    item->datatype = ItemType::U32;
+    item->dataSize = sizeof(value);
+    item->data = new uint8_t[sizeof(value)];
+    memcpy(item->data, &value, sizeof(value));
+    items.push_back(item);
+}
+
+TEST_CASE("nvs transaction stages values until commit", "[nvs]")
+{
+    PartitionEmulationFixture f(0, 4);
+    TEST_ESP_OK( NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 4) );
+    nvs_handle_t handle, reader;
+    TEST_ESP_OK( nvs_open("test", NVS_READWRITE, &handle) );
+    TEST_ESP_OK( nvs_open("test", NVS_READONLY, &reader) );
+    TEST_ESP_ERR( nvs_transaction_begin(reader), ESP_ERR_NVS_READ_ONLY );
+    TEST_ESP_ERR( nvs_transaction_commit(handle), ESP_ERR_NVS_INVALID_STATE );
+
+    TEST_ESP_OK( nvs_set_i32(handle, "old", 1) );
+    TEST_ESP_OK( nvs_transaction_begin(handle) );
+    TEST_ESP_ERR( nvs_transaction_begin(handle), ESP_ERR_NVS_INVALID_STATE );
+    TEST_ESP_OK( nvs_set_i32(handle, "old", 2) );
+    TEST_ESP_OK( nvs_set_i32(handle, "old", 3) );
+    TEST_ESP_OK( nvs_set_str(handle, "str", "staged string") );
+    const uint8_t blob[] = {1, 2, 3, 4, 5};
+    TEST_ESP_OK( nvs_set_blob(handle, "blob", blob, sizeof(blob)) );
+    TEST_ESP_ERR( nvs_erase_key(handle, "old"), ESP_ERR_NVS_INVALID_STATE );
+    TEST_ESP_ERR( nvs_erase_all(handle), ESP_ERR_NVS_INVALID_STATE );
+    TEST_ESP_ERR( nvs_set_i8(handle, "a_key_which_is_too_long", 1), ESP_ERR_NVS_KEY_TOO_LONG );
+
+    // the writing handle reads its own staged values, other handles don't see them yet
+    int32_t value;
+    TEST_ESP_OK( nvs_get_i32(handle, "old", &value) );
+    CHECK(value == 3);
+    TEST_ESP_OK( nvs_get_i32(reader, "old", &value) );
+    CHECK(value == 1);
+    char str[32];
+    size_t len = sizeof(str);
+    TEST_ESP_OK( nvs_get_str(handle, "str", nullptr, &len) );
+    CHECK(len == strlen("staged string") + 1);
+    len = 4;
+    TEST_ESP_ERR( nvs_get_str(handle, "str", str, &len), ESP_ERR_NVS_INVALID_LENGTH );
+    len = sizeof(str);
+    TEST_ESP_ERR( nvs_get_str(reader, "str", str, &len), ESP_ERR_NVS_NOT_FOUND );
+
+    TEST_ESP_OK( nvs_transaction_commit(handle) );
+    TEST_ESP_OK( nvs_get_i32(reader, "old", &value) );
+    CHECK(value == 3);
+    len = sizeof(str);
+    TEST_ESP_OK( nvs_get_str(reader, "str", str, &len) );
+    CHECK(strcmp(str, "staged string") == 0);
+    uint8_t blobOut[sizeof(blob)];
+    len = sizeof(blobOut);
+    TEST_ESP_OK( nvs_get_blob(reader, "blob", blobOut, &len) );
+    CHECK(memcmp(blob, blobOut, sizeof(blob)) == 0);
+
+    // aborted values are discarded, nvs_commit ends an active transaction
+    TEST_ESP_OK( nvs_transaction_begin(handle) );
+    TEST_ESP_OK( nvs_set_i32(handle, "old", 4) );
+    TEST_ESP_OK( nvs_transaction_abort(handle) );
+    TEST_ESP_OK( nvs_get_i32(handle, "old", &value) );
+    CHECK(value == 3);
+    TEST_ESP_OK( nvs_transaction_begin(handle) );
+    TEST_ESP_OK( nvs_set_i32(handle, "old", 5) );
+    TEST_ESP_OK( nvs_commit(handle) );
+    TEST_ESP_OK( nvs_get_i32(reader, "old", &value) );
+    CHECK(value == 5);
+    TEST_ESP_OK( nvs_erase_key(handle, "old") );
+
+    nvs_close(reader);
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(f.part.get_partition_name()));
+}
+
+TEST_CASE("nvs transaction leaves each value old or new on power loss", "[nvs]")
+{
+    const size_t keyCount = 20;
+    char key[16];
+    for (size_t failAfter = 0; ; ++failAfter) {
+        PartitionEmulationFixture f(0, 4);
+        Storage storage(&f.part);
+        REQUIRE(storage.init(0, 4) == ESP_OK);
+        for (size_t i = 0; i < keyCount; ++i) {
+            snprintf(key, sizeof(key), "key_%u", static_cast<unsigned>(i));
+            REQUIRE(storage.writeItem(1, key, static_cast<uint32_t>(1)) == ESP_OK);
+        }
+
+        Storage::TPendingItemList items;
+        for (size_t i = 0; i < keyCount; ++i) {
+            snprintf(key, sizeof(key), "key_%u", static_cast<unsigned>(i));
+            stagePendingItem(items, key, 2);
+        }
+        f.emu.failAfter(failAfter);
+        esp_err_t err = storage.writeItems(1, items);
+        items.clearAndFreeNodes();
+        f.emu.failAfter(UINT32_MAX);
+
+        Storage storage2(&f.part);
+        REQUIRE(storage2.init(0, 4) == ESP_OK);
+        // Marking the entries of a group as written takes several bitmap writes, so the group may be cut
+        size_t updated = 0;
+        for (size_t i = 0; i < keyCount; ++i) {
+            uint32_t value;
+            snprintf(key, sizeof(key), "key_%u", static_cast<unsigned>(i));
+            REQUIRE(storage2.readItem(1, key, value) == ESP_OK);
+            CHECK((value == 1 || value == 2));
+            updated += (value == 2);
+        }
+        nvs_stats_t stats;
+        TEST_ESP_OK(storage2.fillStats(stats));
+        CHECK(stats.used_entries == keyCount);
+        if (err == ESP_OK) {
+            CHECK(updated == keyCount);
+            break;
+        }
+    }
+}
+
+TEST_CASE("benchmark flash writes of individual sets against one transaction", "[nvs]")
+{
+    const size_t keyCount = 40;
+    char key[16];
+    size_t writeOps[2];
+    for (int mode = 0; mode < 2; ++mode) {
+        PartitionEmulationFixture f(0, 8);
+        Storage storage(&f.part);
+        REQUIRE(storage.init(0, 8) == ESP_OK);
+        f.emu.clearStats();
+        if (mode == 0) {
+            for (size_t i = 0; i < keyCount; ++i) {
+                snprintf(key, sizeof(key), "key_%u", static_cast<unsigned>(i));
+                REQUIRE(storage.writeItem(1, key, static_cast<uint32_t>(i)) == ESP_OK);
+            }
+        } else {
+            Storage::TPendingItemList items;
+            for (size_t i = 0; i < keyCount; ++i) {
+                snprintf(key, sizeof(key), "key_%u", static_cast<unsigned>(i));
+                stagePendingItem(items, key, i);
+            }
+            REQUIRE(storage.writeItems(1, items) == ESP_OK);
+            items.clearAndFreeNodes();
+        }
+        writeOps[mode] = f.emu.getWriteOps();
+        for (size_t i = 0; i < keyCount; ++i) {
+            uint32_t value;
+            snprintf(key, sizeof(key), "key_%u", static_cast<unsigned>(i));
+            REQUIRE(storage.readItem(1, key, value) == ESP_OK);
+            CHECK(value == i);
+        }
+    }
+    CHECK(writeOps[1] < writeOps[0]);
+    s_perf << "Writing " << keyCount << " u32 keys: " << writeOps[0] << " flash writes individually, "
+           << writeOps[1] << " flash writes in one transaction" << std::endl;
+}
+
+TEST_CASE("item cache evicts least recently used values", "[nvs]")
+{
+    const size_t entryCost = 200;
+    ItemCache cache(entryCost * 3);
+    ItemCache disabled(0);
+    uint8_t value[entryCost] = {};
+    uint8_t out[sizeof(value)];
+    size_t valueSize = 0;
+    // find the value size which makes one entry cost exactly entryCost bytes
+    for (valueSize = 0; valueSize < sizeof(value); ++valueSize) {
+        ItemCache probe(entryCost);
+        probe.insert(1, ItemType::SZ, "probe", value, valueSize);
+        if (probe.usedBytes() == entryCost) {
+            break;
+        }
+    }
+    REQUIRE(valueSize < sizeof(value));
+
+    disabled.insert(1, ItemType::SZ, "a", value, valueSize);
+    CHECK(disabled.read(1, ItemType::SZ, "a", out, sizeof(out)) == ESP_ERR_NVS_NOT_FOUND);
+    CHECK(disabled.misses() == 0);
+
+    value[0] = 'a';
+    cache.insert(1, ItemType::SZ, "a", value, valueSize);
+    value[0] = 'b';
+    cache.insert(1, ItemType::SZ, "b", value, valueSize);
+    value[0] = 'c';
+    cache.insert(1, ItemType::SZ, "c", value, valueSize);
+    CHECK(cache.usedBytes() == entryCost * 3);
+    TEST_ESP_OK(cache.read(1, ItemType::SZ, "a", out, sizeof(out)));
+    CHECK(out[0] == 'a');
+    CHECK(cache.read(1, ItemType::SZ, "a", out, valueSize - 1) == ESP_ERR_NVS_INVALID_LENGTH);
+    CHECK(cache.read(1, ItemType::I32, "a", out, sizeof(out)) == ESP_ERR_NVS_NOT_FOUND);
+    CHECK(cache.read(2, ItemType::SZ, "a", out, sizeof(out)) == ESP_ERR_NVS_NOT_FOUND);
+
+    // "b" is now the least recently used value
+    value[0] = 'd';
+    cache.insert(1, ItemType::SZ, "d", value, valueSize);
+    CHECK(cache.usedBytes() == entryCost * 3);
+    CHECK(cache.read(1, ItemType::SZ, "b", out, sizeof(out)) == ESP_ERR_NVS_NOT_FOUND);
+    TEST_ESP_OK(cache.read(1, ItemType::SZ, "c", out, sizeof(out)));
+    CHECK(out[0] == 'c');
+
+    // values larger than the cache are dropped
+    ItemCache small(entryCost - 1);
+    small.insert(1, ItemType::SZ, "a", value, valueSize);
+    CHECK(small.usedBytes() == 0);
+
+    cache.erase(1, ItemType::ANY, "c");
+    CHECK(cache.read(1, ItemType::SZ, "c", out, sizeof(out)) == ESP_ERR_NVS_NOT_FOUND);
+    cache.eraseNamespace(1);
+    CHECK(cache.usedBytes() == 0);
+    CHECK(cache.hits() == 3);
+    CHECK(cache.misses() == 4);
+}
+
+TEST_CASE("item cache finds many values through its hash table", "[nvs]")
+{
+    const size_t keyCount = 200;
+    ItemCache cache(keyCount * 2 * 256);
+    char key[16];
+    for (size_t i = 0; i < keyCount; ++i) {
+        snprintf(key, sizeof(key), "key_%u", static_cast<unsigned>(i));
+        uint32_t value = i;
+        cache.insert(i % 3, ItemType::U32, key, &value, sizeof(value));
+        cache.insert(i % 3, ItemType::I32, key, &value, sizeof(value));
+    }
+    for (size_t i = 0; i < keyCount; ++i) {
+        snprintf(key, sizeof(key), "key_%u", static_cast<unsigned>(i));
+        uint32_t value = 0;
+        TEST_ESP_OK(cache.read(i % 3, ItemType::U32, key, &value, sizeof(value)));
+        CHECK(value == i);
+        CHECK(cache.read((i + 1) % 3, ItemType::U32, key, &value, sizeof(value)) == ESP_ERR_NVS_NOT_FOUND);
+    }
+
+    // erasing ItemType::ANY drops all types of the key, and only them
+    cache.erase(1, ItemType::ANY, "key_1");
+    uint32_t value;
+    CHECK(cache.read(1, ItemType::U32, "key_1", &value, sizeof(value)) == ESP_ERR_NVS_NOT_FOUND);
+    CHECK(cache.read(1, ItemType::I32, "key_1", &value, sizeof(value)) == ESP_ERR_NVS_NOT_FOUND);
+    TEST_ESP_OK(cache.read(1, ItemType::U32, "key_4", &value, sizeof(value)));
+
+    cache.eraseNamespace(0);
+    CHECK(cache.read(0, ItemType::U32, "key_0", &value, sizeof(value)) == ESP_ERR_NVS_NOT_FOUND);
+    TEST_ESP_OK(cache.read(2, ItemType::I32, "key_2", &value, sizeof(value)));
+    cache.clear();
+    CHECK(cache.usedBytes() == 0);
+    CHECK(cache.read(2, ItemType::I32, "key_2", &value, sizeof(value)) == ESP_ERR_NVS_NOT_FOUND);
+}
+
+TEST_CASE("storage reads are served from item cache and stay coherent", "[nvs]")
+{
+    PartitionEmulationFixture f(0, 4);
+    TEST_ESP_OK( NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 4) );
+    nvs_handle_t handle;
+    TEST_ESP_OK( nvs_open("test", NVS_READWRITE, &handle) );
+    std::shared_ptr<NVSHandle> cxxHandle(open_nvs_handle("test", NVS_READWRITE, nullptr));
+    nvs_cache_stats_t stats;
+    TEST_ESP_ERR( nvs_get_cache_stats(NVS_DEFAULT_PART_NAME, nullptr), ESP_ERR_INVALID_ARG );
+    TEST_ESP_OK( nvs_get_cache_stats(NVS_DEFAULT_PART_NAME, &stats) );
+    CHECK(stats.capacity_bytes == CONFIG_NVS_CACHE_SIZE);
+    CHECK(stats.used_bytes == 0);
+
+    TEST_ESP_OK( nvs_set_i32(handle, "counter", 1) );
+    TEST_ESP_OK( nvs_set_str(handle, "name", "calibration") );
+    f.emu.clearStats();
+    int32_t value;
+    char str[16];
+    size_t len;
+    for (int i = 0; i < 10; ++i) {
+        TEST_ESP_OK( nvs_get_i32(handle, "counter", &value) );
+        CHECK(value == 1);
+        TEST_ESP_OK( cxxHandle->get_item("counter", value) );
+        CHECK(value == 1);
+        len = sizeof(str);
+        TEST_ESP_OK( nvs_get_str(handle, "name", str, &len) );
+        CHECK(strcmp(str, "calibration") == 0);
+    }
+    CHECK(f.emu.getReadOps() == 0);
+    len = 4;
+    TEST_ESP_ERR( nvs_get_str(handle, "name", str, &len), ESP_ERR_NVS_INVALID_LENGTH );
+
+    // writes through either handle and erases are visible to the other one
+    TEST_ESP_OK( cxxHandle->set_item("counter", static_cast<int32_t>(2)) );
+    TEST_ESP_OK( nvs_get_i32(handle, "counter", &value) );
+    CHECK(value == 2);
+    TEST_ESP_OK( nvs_erase_key(handle, "counter") );
+    TEST_ESP_ERR( cxxHandle->get_item("counter", value), ESP_ERR_NVS_NOT_FOUND );
+    TEST_ESP_OK( nvs_set_i32(handle, "counter", 3) );
+    TEST_ESP_OK( nvs_transaction_begin(handle) );
+    TEST_ESP_OK( nvs_set_i32(handle, "counter", 4) );
+    TEST_ESP_OK( nvs_transaction_commit(handle) );
+    TEST_ESP_OK( cxxHandle->get_item("counter", value) );
+    CHECK(value == 4);
+    TEST_ESP_OK( nvs_erase_all(handle) );
+    len = sizeof(str);
+    TEST_ESP_ERR( nvs_get_str(handle, "name", str, &len), ESP_ERR_NVS_NOT_FOUND );
+
+    TEST_ESP_OK( nvs_get_cache_stats(NVS_DEFAULT_PART_NAME, &stats) );
+    CHECK(stats.hits >= 30);
+    CHECK(stats.misses >= 2);
+    CHECK(stats.used_bytes == 0);
+
+    cxxHandle.reset();
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(f.part.get_partition_name()));
+}
+
+TEST_CASE("benchmark reads of hot keys with item cache", "[nvs]")
+{
+    const size_t keyCount = 8;
+    const size_t rounds = 1000;
+    PartitionEmulationFixture f(0, 8);
+    Storage storage(&f.part);
+    REQUIRE(storage.init(0, 8) == ESP_OK);
+    char key[16];
+    for (size_t i = 0; i < 200; ++i) {
+        snprintf(key, sizeof(key), "k%u", static_cast<unsigned>(i));
+        REQUIRE(storage.writeItem(1, key, static_cast<uint32_t>(i)) == ESP_OK);
+    }
+
+    size_t nanoseconds[2];
+    size_t readOps[2];
+    for (int cached = 0; cached < 2; ++cached) {
+        // nothing is cached after mounting, so each uncached round starts with a re-mount
+        f.emu.clearStats();
+        auto elapsed = std::chrono::nanoseconds::zero();
+        for (size_t round = 0; round < rounds; ++round) {
+            if (!cached) {
+                REQUIRE(storage.init(0, 8) == ESP_OK);
+                f.emu.clearStats();
+            }
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < keyCount; ++i) {
+                uint32_t value;
+                snprintf(key, sizeof(key), "k%u", static_cast<unsigned>(i * 20));
+                REQUIRE(storage.readItem(1, key, value) == ESP_OK);
+                CHECK(value == i * 20);
+            }
+            elapsed += std::chrono::steady_clock::now() - start;
+        }
+        nanoseconds[cached] = elapsed.count() / (rounds * keyCount);
+        readOps[cached] = f.emu.getReadOps();
+    }
+    CHECK(readOps[1] == 0);
+    s_perf << "Reading " << keyCount << " hot u32 keys: " << nanoseconds[0] << " ns per read and "
+           << readOps[0] << " flash reads per round without cache, "
+           << nanoseconds[1] << " ns per read with cache" << std::endl;
+}
+
+TEST_CASE("benchmark mount time of a filled partition", "[nvs]")
+{
+    const size_t mountRounds = 10;
+    for (size_t sectors : {16, 64}) {
+        PartitionEmulationFixture f(0, sectors);
+        Storage storage(&f.part);
+        REQUIRE(storage.init(0, sectors) == ESP_OK);
+        uint8_t nsIndex;
+        REQUIRE(storage.createOrOpenNamespace("bench", true, nsIndex) == ESP_OK);
+        // fill about three quarters of the entries with integers, strings and blobs
+        const size_t itemCount = (sectors - 1) * Page::ENTRY_COUNT * 3 / 4 / 4;
+        char key[16];
+        char str[64];
+        uint8_t blob[80] = {};
+        for (size_t i = 0; i < itemCount; ++i) {
+            snprintf(key, sizeof(key), "k%u", static_cast<unsigned>(i));
+            switch (i % 3) {
+            case 0:
+                REQUIRE(storage.writeItem(nsIndex, key, static_cast<uint32_t>(i)) == ESP_OK);
+                break;
+            case 1:
+                snprintf(str, sizeof(str), "string value number %u", static_cast<unsigned>(i));
+                REQUIRE(storage.writeItem(nsIndex, ItemType::SZ, key, str, strlen(str) + 1) == ESP_OK);
+                break;
+            default:
+                blob[0] = static_cast<uint8_t>(i);
+                REQUIRE(storage.writeItem(nsIndex, ItemType::BLOB, key, blob, sizeof(blob)) == ESP_OK);
+                break;
+            }
+        }
+
+        f.emu.clearStats();
+        auto start = std::chrono::steady_clock::now();
+        for (size_t round = 0; round < mountRounds; ++round) {
+            Storage mounted(&f.part);
+            REQUIRE(mounted.init(0, sectors) == ESP_OK);
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+        s_perf << "Mount of " << sectors << " sectors with " << itemCount << " items: "
+               << elapsed.count() / mountRounds << " us, "
+               << f.emu.getReadOps() / mountRounds << " flash reads, "
+               << f.emu.getReadBytes() / mountRounds << " bytes read" << std::endl;
+    }
+}
+
+TEST_CASE("benchmark HashList lookups in a full page", "[nvs]")
+{
+    const size_t rounds = 2000;
+    HashListTestHelper hashlist;
+    std::vector<Item> items;
+    char key[16];
+    for (size_t i = 0; i < Page::ENTRY_COUNT; ++i) {
+        snprintf(key, sizeof(key), "key_%u", static_cast<unsigned>(i));
+        items.push_back(Item(1, ItemType::U32, 1, key));
+        REQUIRE(hashlist.insert(items.back(), i) == ESP_OK);
+    }
+
+    size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < Page::ENTRY_COUNT; ++i) {
+            found += (hashlist.find(0, items[i]) == i);
+        }
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    CHECK(found == rounds * Page::ENTRY_COUNT);
+    s_perf << "HashList lookup with " << Page::ENTRY_COUNT << " items: "
+           << elapsed.count() / (rounds * Page::ENTRY_COUNT) << " ns per lookup, "
+           << hashlist.getCapacity() * sizeof(uint32_t) << " bytes" << std::endl;
+}
+
+TEST_CASE("nvs blob reader streams a blob in pieces", "[nvs]")
+{
+    PartitionEmulationFixture f(0, 10);
+    TEST_ESP_OK( NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 10) );
+    nvs_handle_t handle;
+    TEST_ESP_OK( nvs_open("test", NVS_READWRITE, &handle) );
+
+    std::vector<uint8_t> blob(12345);
+    for (size_t i = 0; i < blob.size(); ++i) {
+        blob[i] = static_cast<uint8_t>(i ^ (i >> 8));
+    }
+    TEST_ESP_OK( nvs_set_blob(handle, "blob", blob.data(), blob.size()) );
+
+    nvs_blob_reader_t reader;
+    TEST_ESP_ERR( nvs_blob_reader_open(handle, "missing", &reader, nullptr), ESP_ERR_NVS_NOT_FOUND );
+    size_t length;
+    TEST_ESP_OK( nvs_blob_reader_open(handle, "blob", &reader, &length) );
+    CHECK(length == blob.size());
+
+    // pieces of an odd size cross entry and chunk boundaries
+    std::vector<uint8_t> readBlob;
+    uint8_t buffer[101];
+    do {
+        length = sizeof(buffer);
+        TEST_ESP_OK( nvs_blob_reader_read(reader, buffer, &length) );
+        readBlob.insert(readBlob.end(), buffer, buffer + length);
+    } while (length == sizeof(buffer));
+    CHECK(readBlob == blob);
+    length = sizeof(buffer);
+    TEST_ESP_OK( nvs_blob_reader_read(reader, buffer, &length) );
+    CHECK(length == 0);
+
+    // seek backwards and forwards, into other chunks and within a chunk
+    for (size_t offset : {5000, 17, 4000, 11111, 11112, 0}) {
+        TEST_ESP_OK( nvs_blob_reader_seek(reader, offset) );
+        length = sizeof(buffer);
+        TEST_ESP_OK( nvs_blob_reader_read(reader, buffer, &length) );
+        CHECK(length == sizeof(buffer));
+        CHECK(memcmp(buffer, blob.data() + offset, length) == 0);
+    }
+    TEST_ESP_OK( nvs_blob_reader_seek(reader, blob.size()) );
+    TEST_ESP_ERR( nvs_blob_reader_seek(reader, blob.size() + 1), ESP_ERR_NVS_INVALID_LENGTH );
+    nvs_blob_reader_close(reader);
+
+    // a reader opened in a transaction doesn't read staged blobs
+    TEST_ESP_OK( nvs_transaction_begin(handle) );
+    TEST_ESP_OK( nvs_set_blob(handle, "blob", blob.data(), 10) );
+    TEST_ESP_ERR( nvs_blob_reader_open(handle, "blob", &reader, nullptr), ESP_ERR_NVS_INVALID_STATE );
+    TEST_ESP_OK( nvs_transaction_abort(handle) );
+
+    TEST_ESP_OK( nvs_blob_reader_open(handle, "blob", &reader, nullptr) );
+    TEST_ESP_ERR( nvs_blob_reader_read(reader, buffer, nullptr), ESP_ERR_INVALID_ARG );
+    TEST_ESP_ERR( nvs_blob_reader_read(reader, nullptr, &length), ESP_ERR_INVALID_ARG );
+
+    // writing the blob twice reuses the chunk indices of the value being read, which must not be mixed in
+    length = sizeof(buffer);
+    TEST_ESP_OK( nvs_blob_reader_read(reader, buffer, &length) );
+    std::vector<uint8_t> otherBlob(blob.rbegin(), blob.rend());
+    TEST_ESP_OK( nvs_set_blob(handle, "blob", otherBlob.data(), otherBlob.size()) );
+    otherBlob[0] ^= 1;
+    TEST_ESP_OK( nvs_set_blob(handle, "blob", otherBlob.data(), otherBlob.size()) );
+    length = sizeof(buffer);
+    TEST_ESP_ERR( nvs_blob_reader_read(reader, buffer, &length), ESP_ERR_NVS_NOT_FOUND );
+    TEST_ESP_ERR( nvs_blob_reader_seek(reader, 0), ESP_ERR_NVS_NOT_FOUND );
+    nvs_blob_reader_close(reader);
+
+    // erasing the blob or closing the handle fails subsequent reads
+    TEST_ESP_OK( nvs_blob_reader_open(handle, "blob", &reader, nullptr) );
+    TEST_ESP_OK( nvs_erase_key(handle, "blob") );
+    length = sizeof(buffer);
+    TEST_ESP_ERR( nvs_blob_reader_read(reader, buffer, &length), ESP_ERR_NVS_NOT_FOUND );
+    nvs_close(handle);
+    TEST_ESP_ERR( nvs_blob_reader_read(reader, buffer, &length), ESP_ERR_NVS_INVALID_HANDLE );
+    nvs_blob_reader_close(reader);
+
+    TEST_ESP_OK(nvs_flash_deinit_partition(f.part.get_partition_name()));
+}
+
+TEST_CASE("nvs blob reader detects corrupted chunk data", "[nvs]")
+{
+    PartitionEmulationFixture f(0, 4);
+    Storage storage(&f.part);
+    TEST_ESP_OK( storage.init(0, 4) );
+
+    uint8_t blob[100];
+    for (size_t i = 0; i < sizeof(blob); ++i) {
+        blob[i] = static_cast<uint8_t>(i);
+    }
+    TEST_ESP_OK( storage.writeItem(1, ItemType::BLOB, "blob", blob, sizeof(blob)) );
+
+    // flip a bit in the last data entry of the chunk, which follows the chunk header in the first page
+    size_t address = 64 + 3 * 32;
+    uint32_t word;
+    f.emu.read(&word, address, sizeof(word));
+    word &= ~0x100u;
+    f.emu.write(address, &word, sizeof(word));
+
+    Storage::BlobCursor cursor;
+    TEST_ESP_OK( storage.openBlob(1, "blob", cursor) );
+    uint8_t buffer[sizeof(blob)];
+    size_t readSize;
+    TEST_ESP_OK( storage.readBlob(cursor, buffer, 60, readSize) );
+    CHECK(readSize == 60);
+    TEST_ESP_ERR( storage.readBlob(cursor, buffer, 60, readSize), ESP_ERR_NVS_NOT_FOUND );
+
+    // without reading the start of the chunk, the CRC can't be checked
+    TEST_ESP_OK( storage.seekBlob(cursor, 50) );
+    TEST_ESP_OK( storage.readBlob(cursor, buffer, 60, readSize) );
+    CHECK(readSize == 50);
+}
+
+TEST_CASE("benchmark streaming a multi-page blob", "[nvs]")
+{
+    const size_t sectors = 32;
+    PartitionEmulationFixture f(0, sectors);
+    TEST_ESP_OK( NVSPartitionManager::get_instance()->init_custom(&f.part, 0, sectors) );
+    nvs_handle_t handle;
+    TEST_ESP_OK( nvs_open("test", NVS_READWRITE, &handle) );
+
+    std::vector<uint8_t> blob(60000);
+    for (size_t i = 0; i < blob.size(); ++i) {
+        blob[i] = static_cast<uint8_t>(i * 13);
+    }
+    TEST_ESP_OK( nvs_set_blob(handle, "model", blob.data(), blob.size()) );
+
+    std::vector<uint8_t> readBlob(blob.size());
+    size_t length = readBlob.size();
+    f.emu.clearStats();
+    TEST_ESP_OK( nvs_get_blob(handle, "model", readBlob.data(), &length) );
+    CHECK(readBlob == blob);
+    size_t wholeReads = f.emu.getReadOps();
+
+    const size_t pieceSize = 512;
+    uint8_t buffer[pieceSize];
+    size_t offset = 0;
+    nvs_blob_reader_t reader;
+    f.emu.clearStats();
+    TEST_ESP_OK( nvs_blob_reader_open(handle, "model", &reader, nullptr) );
+    do {
+        length = sizeof(buffer);
+        TEST_ESP_OK( nvs_blob_reader_read(reader, buffer, &length) );
+        CHECK(memcmp(buffer, blob.data() + offset, length) == 0);
+        offset += length;
+    } while (length > 0);
+    nvs_blob_reader_close(reader);
+    CHECK(offset == blob.size());
+    size_t streamReads = f.emu.getReadOps();
+
+    s_perf << "Reading a " << blob.size() << " byte blob: " << wholeReads << " flash reads into one buffer, "
+           << streamReads << " flash reads streamed in " << pieceSize << " byte pieces" << std::endl;
+
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(f.part.get_partition_name()));
+}
+
 /* Add new tests above */
 /* This test has to be the final one */
 
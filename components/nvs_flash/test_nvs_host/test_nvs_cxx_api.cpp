@@ -191,3 +191,46 @@ TEST_CASE("NVSHandleSimple CXX api read/write blob", "[nvs cxx]")
 
     nvs::NVSPartitionManager::get_instance()->deinit_partition("nvs");
 }
+
+TEST_CASE("NVSHandleSimple CXX api blob reader iterates over a multi-page blob", "[nvs cxx]")
+{
+    PartitionEmulationFixture f(0, 10);
+    vector<uint8_t> blob(10000);
+    for (size_t i = 0; i < blob.size(); ++i) {
+        blob[i] = static_cast<uint8_t>(i * 7);
+    }
+    esp_err_t result;
+    shared_ptr<nvs::NVSHandle> handle;
+
+    REQUIRE(nvs::NVSPartitionManager::get_instance()->init_custom(&f.part, 0, 10) == ESP_OK);
+
+    handle = nvs::open_nvs_handle("test_ns", NVS_READWRITE, &result);
+    REQUIRE(result == ESP_OK);
+    CHECK(handle->set_blob("blob", blob.data(), blob.size()) == ESP_OK);
+
+    unique_ptr<nvs::BlobReader> reader;
+    CHECK(handle->open_blob_reader("missing", reader) == ESP_ERR_NVS_NOT_FOUND);
+    REQUIRE(handle->open_blob_reader("blob", reader) == ESP_OK);
+    CHECK(reader->size() == blob.size());
+
+    vector<uint8_t> read_blob;
+    uint8_t buffer[300];
+    for (auto it = reader->begin(buffer, sizeof(buffer), &result); it != reader->end(); ++it) {
+        CHECK(it->offset == read_blob.size());
+        CHECK(it->size <= sizeof(buffer));
+        read_blob.insert(read_blob.end(), it->data, it->data + it->size);
+    }
+    CHECK(result == ESP_OK);
+    CHECK(read_blob == blob);
+
+    CHECK(reader->seek(blob.size() - 10) == ESP_OK);
+    size_t len = sizeof(buffer);
+    CHECK(reader->read(buffer, len) == ESP_OK);
+    CHECK(len == 10);
+    CHECK(vector<uint8_t>(buffer, buffer + len) == vector<uint8_t>(blob.end() - 10, blob.end()));
+    CHECK(reader->tell() == blob.size());
+
+    reader.reset();
+    handle.reset();
+    nvs::NVSPartitionManager::get_instance()->deinit_partition("nvs");
+}
@@ -26,9 +26,9 @@
 using namespace std;
 using namespace nvs;
 
-TEST_CASE("encrypted partition read size must be item size", "[nvs]")
+TEST_CASE("encrypted partition read size must be mod item size", "[nvs]")
 {
-    char foo [32] = { };
+    char foo [64] = { };
     nvs_sec_cfg_t xts_cfg;
     for(int count = 0; count < NVS_KEY_SIZE; count++) {
         xts_cfg.eky[count] = 0x11;
@@ -37,6 +37,8 @@ TEST_CASE("encrypted partition read size must be item size", "[nvs]")
     EncryptedPartitionFixture fix(&xts_cfg);
 
     CHECK(fix.part.read(0, foo, sizeof (foo) -1) == ESP_ERR_INVALID_SIZE);
+    CHECK(fix.part.read(0, foo, sizeof (foo) / 2) == ESP_OK);
+    CHECK(fix.part.read(0, foo, sizeof (foo)) == ESP_OK);
 }
 
 TEST_CASE("encrypted partition write size must be mod item size", "[nvs]")
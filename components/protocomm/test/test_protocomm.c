@@ -37,7 +37,7 @@
 
 #include "session.pb-c.h"
 
-#ifdef CONFIG_HEAP_TRACING
+#ifdef CONFIG_HEAP_TRACING_STANDALONE
     #include <esp_heap_trace.h>
     #define NUM_RECORDS 100
     static heap_trace_record_t trace_record[NUM_RECORDS]; // This buffer must be in internal RAM
@@ -1110,7 +1110,7 @@ static esp_err_t test_security0 (void)
 
 TEST_CASE("leak test", "[PROTOCOMM]")
 {
-#ifdef CONFIG_HEAP_TRACING
+#ifdef CONFIG_HEAP_TRACING_STANDALONE
     heap_trace_init_standalone(trace_record, NUM_RECORDS);
     heap_trace_start(HEAP_TRACE_LEAKS);
 #endif
@@ -1121,7 +1121,7 @@ TEST_CASE("leak test", "[PROTOCOMM]")
     test_security1();
     usleep(1000);
 
-#ifdef CONFIG_HEAP_TRACING
+#ifdef CONFIG_HEAP_TRACING_STANDALONE
     heap_trace_stop();
     heap_trace_dump();
 #endif
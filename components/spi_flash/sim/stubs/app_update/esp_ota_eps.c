@@ -19,3 +19,60 @@ const esp_partition_t* esp_ota_get_running_partition(void)
 
     return partition;
 }
+
+static const esp_partition_t *s_ota_partition;
+static size_t s_ota_written;
+
+esp_err_t esp_ota_begin(const esp_partition_t *partition, size_t image_size, esp_ota_handle_t *out_handle)
+{
+    if (partition == NULL || out_handle == NULL || s_ota_partition != NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_ota_partition = partition;
+    s_ota_written = 0;
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
+{
+    if (handle != 1 || s_ota_partition == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_ota_written + size > s_ota_partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    // Erase sectors as they are reached, as for OTA_WITH_SEQUENTIAL_WRITES
+    size_t erase_start = (s_ota_written + SPI_FLASH_SEC_SIZE - 1) / SPI_FLASH_SEC_SIZE * SPI_FLASH_SEC_SIZE;
+    size_t erase_end = (s_ota_written + size + SPI_FLASH_SEC_SIZE - 1) / SPI_FLASH_SEC_SIZE * SPI_FLASH_SEC_SIZE;
+    if (erase_end > erase_start) {
+        esp_err_t err = esp_partition_erase_range(s_ota_partition, erase_start, erase_end - erase_start);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    esp_err_t err = esp_partition_write(s_ota_partition, s_ota_written, data, size);
+    if (err == ESP_OK) {
+        s_ota_written += size;
+    }
+    return err;
+}
+
+esp_err_t esp_ota_end(esp_ota_handle_t handle)
+{
+    // Images used on the host are not app images, they are not verified
+    if (handle != 1 || s_ota_partition == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    s_ota_partition = NULL;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_abort(esp_ota_handle_t handle)
+{
+    if (handle != 1 || s_ota_partition == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    s_ota_partition = NULL;
+    return ESP_OK;
+}
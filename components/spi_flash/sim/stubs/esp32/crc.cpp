@@ -56,3 +56,8 @@ extern "C" unsigned int crc32_le(unsigned int crc, unsigned char const * buf,uns
     }
     return ~crc;
 }
+
+extern "C" uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len)
+{
+    return crc32_le(crc, buf, len);
+}
@@ -22,7 +22,7 @@
 #include "test_utils.h"
 #include "esp_newlib.h"
 
-#ifdef CONFIG_HEAP_TRACING
+#ifdef CONFIG_HEAP_TRACING_STANDALONE
 #include "esp_heap_trace.h"
 #endif
 
@@ -51,7 +51,7 @@ void unity_reset_leak_checks(void)
     before_free_8bit = heap_caps_get_free_size(MALLOC_CAP_8BIT);
     before_free_32bit = heap_caps_get_free_size(MALLOC_CAP_32BIT);
 
-#ifdef CONFIG_HEAP_TRACING
+#ifdef CONFIG_HEAP_TRACING_STANDALONE
     heap_trace_start(HEAP_TRACE_LEAKS);
 #endif
 }
@@ -60,7 +60,7 @@ void unity_reset_leak_checks(void)
 void setUp(void)
 {
 // If heap tracing is enabled in kconfig, leak trace the test
-#ifdef CONFIG_HEAP_TRACING
+#ifdef CONFIG_HEAP_TRACING_STANDALONE
     const size_t num_heap_records = 80;
     static heap_trace_record_t *record_buffer;
     if (!record_buffer) {
@@ -149,7 +149,7 @@ void tearDown(void)
     TEST_ASSERT_MESSAGE( heap_caps_check_integrity(MALLOC_CAP_INVALID, true), "The test has corrupted the heap");
 
     /* check for leaks */
-#ifdef CONFIG_HEAP_TRACING
+#ifdef CONFIG_HEAP_TRACING_STANDALONE
     heap_trace_stop();
     heap_trace_dump();
 #endif